@@ -0,0 +1,75 @@
+// bench/bench_bcd_decode.cpp
+// Микробенчмарк разбора BCD IMSI: побайтовый цикл (как было в UdpServer), скалярное SWAR-ядро
+// и AVX2-ядро decode_bcd_batch на пачках по batch датаграмм.
+//
+// Запуск: bench_bcd_decode [batch=32] [iterations=200000]
+#include "pgw/imsi_batch.hpp"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <string>
+#include <vector>
+
+using namespace pgw;
+
+// Прежний разбор: по полубайту с ветвлением на заполнителе, результат — std::string
+static std::string decode_bytewise(const uint8_t* data, size_t len) {
+    std::string imsi;
+    imsi.reserve(len * 2);
+    for (size_t i = 0; i < len; ++i) {
+        uint8_t low  =  data[i]       & 0x0F;
+        uint8_t high = (data[i] >> 4) & 0x0F;
+        if (low  != 0xF) imsi.push_back(char('0' + low));
+        if (high != 0xF) imsi.push_back(char('0' + high));
+    }
+    return imsi;
+}
+
+template <typename F>
+static double measure(size_t iterations, size_t batch, F&& body) {
+    auto t0 = std::chrono::steady_clock::now();
+    for (size_t it = 0; it < iterations; ++it) {
+        body();
+    }
+    double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - t0).count();
+    return ns / double(iterations * batch);
+}
+
+int main(int argc, char** argv) {
+    size_t batch      = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 32;
+    size_t iterations = argc > 2 ? std::strtoul(argv[2], nullptr, 10) : 200000;
+
+    // Пачка 15-значных IMSI
+    std::mt19937_64 rng(1);
+    std::vector<uint8_t> lanes(batch * 8);
+    for (size_t i = 0; i < batch; ++i) {
+        std::string s = "00101";
+        for (int d = 0; d < 10; ++d) s.push_back(char('0' + rng() % 10));
+        Imsi::from_string(s).to_bcd(lanes.data() + 8 * i);
+    }
+
+    std::vector<Imsi> out(batch);
+    std::vector<uint64_t> mask((batch + 63) / 64);
+    volatile size_t sink = 0;
+
+    double bytewise = measure(iterations, batch, [&] {
+        for (size_t i = 0; i < batch; ++i) {
+            sink = sink + decode_bytewise(lanes.data() + 8 * i, 8).size();
+        }
+    });
+    double scalar = measure(iterations, batch, [&] {
+        sink = sink + decode_bcd_batch(BcdKernel::Scalar, lanes.data(), batch, out.data(), mask.data());
+    });
+    double avx2 = measure(iterations, batch, [&] {
+        sink = sink + decode_bcd_batch(BcdKernel::Avx2, lanes.data(), batch, out.data(), mask.data());
+    });
+
+    std::printf("runtime kernel: %s, batch %zu\n", to_string(bcd_batch_kernel()), batch);
+    std::printf("%-10s %8s %9s\n", "decoder", "ns/imsi", "speedup");
+    std::printf("%-10s %8.2f %8.1fx\n", "bytewise", bytewise, 1.0);
+    std::printf("%-10s %8.2f %8.1fx\n", "scalar", scalar, bytewise / scalar);
+    std::printf("%-10s %8.2f %8.1fx\n", "avx2", avx2, bytewise / avx2);
+    return 0;
+}
@@ -0,0 +1,125 @@
+// bench/bench_gtpv2_parse.cpp
+// Пропускная способность разбора GTPv2-C на синтетических сообщениях, повторяющих состав IE
+// реальных запросов SGW → PGW (Create Session ~190 байт, Modify Bearer, Delete Session).
+// Для сравнения — прежний путь: разбор голого BCD IMSI.
+//
+// Запуск: bench_gtpv2_parse [iterations=2000000]
+#include "pgw/gtpv2.hpp"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+using namespace pgw;
+
+static void put_ie(std::vector<uint8_t>& m, uint8_t type, std::vector<uint8_t> value, uint8_t instance = 0) {
+    m.push_back(type);
+    m.push_back(uint8_t(value.size() >> 8));
+    m.push_back(uint8_t(value.size()));
+    m.push_back(instance);
+    m.insert(m.end(), value.begin(), value.end());
+}
+
+static std::vector<uint8_t> make_message(uint8_t type, uint32_t teid, const std::vector<uint8_t>& ies) {
+    std::vector<uint8_t> m{0x48, type, 0, 0,
+                           uint8_t(teid >> 24), uint8_t(teid >> 16), uint8_t(teid >> 8), uint8_t(teid),
+                           0x00, 0x3A, 0x51, 0};
+    m.insert(m.end(), ies.begin(), ies.end());
+    m[2] = uint8_t((m.size() - 4) >> 8);
+    m[3] = uint8_t(m.size() - 4);
+    return m;
+}
+
+static std::vector<uint8_t> make_create_session() {
+    std::vector<uint8_t> ies;
+    put_ie(ies, 1,   {0x00, 0x01, 0x01, 0x21, 0x43, 0x65, 0x87, 0xF9});              // IMSI
+    put_ie(ies, 76,  {0x64, 0x07, 0x21, 0x43, 0x65, 0x87, 0x09});                    // MSISDN
+    put_ie(ies, 75,  {0x53, 0x61, 0x02, 0x10, 0x32, 0x54, 0x76, 0x98});              // MEI
+    put_ie(ies, 86,  {0x18, 0x00, 0xF1, 0x10, 0x00, 0x01, 0x00, 0xF1, 0x10, 0x00, 0x00, 0x0A, 0x01}); // ULI (TAI + ECGI)
+    put_ie(ies, 83,  {0x00, 0xF1, 0x10});                                            // Serving Network
+    put_ie(ies, 82,  {0x06});                                                        // RAT Type: EUTRAN
+    put_ie(ies, 77,  {0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00});                    // Indication
+    put_ie(ies, 87,  {0x86, 0x11, 0x22, 0x33, 0x44, 10, 0, 0, 1});                  // Sender F-TEID (S5/S8 SGW)
+    put_ie(ies, 71,  {8, 'i', 'n', 't', 'e', 'r', 'n', 'e', 't', 3, 'm', 'n', 'c', 3, '0', '0', '1'}); // APN
+    put_ie(ies, 128, {0x00});                                                        // Selection Mode
+    put_ie(ies, 99,  {0x01});                                                        // PDN Type: IPv4
+    put_ie(ies, 79,  {0x01, 0, 0, 0, 0});                                            // PAA
+    put_ie(ies, 127, {0x00});                                                        // APN Restriction
+    put_ie(ies, 72,  {0x00, 0x00, 0xC3, 0x50, 0x00, 0x01, 0x86, 0xA0});              // APN-AMBR
+    put_ie(ies, 78,  {0x80, 0x80, 0x21, 0x10, 0x01, 0x00, 0x00, 0x10, 0x81, 0x06, 0, 0, 0, 0}); // PCO
+    std::vector<uint8_t> bearer;
+    put_ie(bearer, 73, {0x05});                                                      // EBI
+    put_ie(bearer, 87, {0x84, 0x55, 0x66, 0x77, 0x88, 10, 0, 0, 1}, 2);             // S5/S8-U SGW F-TEID
+    put_ie(bearer, 80, {0x24, 0x09, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0}); // Bearer QoS
+    put_ie(ies, 93, bearer);
+    put_ie(ies, 3,   {0x07});                                                        // Recovery
+    return make_message(32, 0, ies);
+}
+
+static std::vector<uint8_t> make_modify_bearer() {
+    std::vector<uint8_t> ies, bearer;
+    put_ie(bearer, 73, {0x05});
+    put_ie(bearer, 87, {0x80, 0x01, 0x02, 0x03, 0x04, 10, 0, 0, 2}, 0);              // S1-U eNodeB F-TEID
+    put_ie(ies, 93, bearer);
+    return make_message(34, 0x00000042, ies);
+}
+
+static std::vector<uint8_t> make_delete_session() {
+    std::vector<uint8_t> ies;
+    put_ie(ies, 73, {0x05});                                                         // Linked EBI
+    put_ie(ies, 77, {0x00, 0x08, 0x00});                                             // Indication
+    return make_message(36, 0x00000042, ies);
+}
+
+template <typename F>
+static double measure(size_t iterations, F&& body) {
+    auto t0 = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < iterations; ++i) {
+        body();
+    }
+    double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - t0).count();
+    return ns / double(iterations);
+}
+
+int main(int argc, char** argv) {
+    size_t iterations = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 2000000;
+
+    struct Case {
+        const char*          name;
+        std::vector<uint8_t> pkt;
+    };
+    std::vector<Case> cases = {
+        {"create_session", make_create_session()},
+        {"modify_bearer", make_modify_bearer()},
+        {"delete_session", make_delete_session()},
+    };
+
+    volatile uint64_t sink = 0;
+    uint8_t out[kGtpMaxResponseSize];
+
+    std::printf("%-16s %6s %10s %12s %10s\n", "message", "bytes", "parse ns", "parse+resp ns", "Mmsg/s");
+    for (auto& c : cases) {
+        GtpMessage msg;
+        double parse = measure(iterations, [&] {
+            parse_gtpv2(c.pkt.data(), c.pkt.size(), msg);
+            sink = sink + msg.sender_teid + msg.ebi;
+        });
+        GtpResponse resp;
+        resp.local_teid = 1;
+        double full = measure(iterations, [&] {
+            parse_gtpv2(c.pkt.data(), c.pkt.size(), msg);
+            resp.peer_teid = msg.sender_teid;
+            sink = sink + build_gtpv2_response(msg, resp, out);
+        });
+        std::printf("%-16s %6zu %10.1f %12.1f %10.1f\n", c.name, c.pkt.size(), parse, full, 1e3 / full);
+    }
+
+    // Прежний протокол: 8 байт BCD IMSI
+    const uint8_t bcd[8] = {0x00, 0x01, 0x01, 0x21, 0x43, 0x65, 0x87, 0xF9};
+    double legacy = measure(iterations, [&] {
+        sink = sink + Imsi::from_bcd(bcd, sizeof(bcd)).packed();
+    });
+    std::printf("%-16s %6zu %10.1f %12s %10.1f\n", "legacy_bcd", sizeof(bcd), legacy, "-", 1e3 / legacy);
+    return 0;
+}
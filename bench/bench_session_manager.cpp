@@ -0,0 +1,74 @@
+// bench/bench_session_manager.cpp
+// Масштабирование SessionManager по потокам: каждый поток продлевает сессии своих абонентов
+// (путь touch_session для уже существующей сессии). Сравнивается один шард (прежний глобальный
+// мьютекс) и шардированный менеджер.
+//
+// Запуск: bench_session_manager [ops_per_thread=200000] [sessions=65536] [max_threads=8] [shards=16]
+#include "pgw/in_memory_session_store.hpp"
+#include "pgw/session_manager.hpp"
+
+#include <spdlog/spdlog.h>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace pgw;
+
+static double run(SessionManager& sessions, const std::vector<Imsi>& imsis, size_t threads, size_t ops) {
+    std::vector<std::thread> pool;
+    auto t0 = std::chrono::steady_clock::now();
+    for (size_t t = 0; t < threads; ++t) {
+        pool.emplace_back([&, t] {
+            // Потоки идут по таблице с разных мест — как worker'ы, получающие разных абонентов
+            size_t i = t * (imsis.size() / threads);
+            for (size_t n = 0; n < ops; ++n) {
+                sessions.touch_session(imsis[i]);
+                if (++i == imsis.size()) i = 0;
+            }
+        });
+    }
+    for (auto& th : pool) th.join();
+    double sec = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+    return double(threads * ops) / sec;
+}
+
+int main(int argc, char** argv) {
+    size_t ops         = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 200000;
+    size_t count       = argc > 2 ? std::strtoul(argv[2], nullptr, 10) : 65536;
+    size_t max_threads = argc > 3 ? std::strtoul(argv[3], nullptr, 10) : 8;
+    size_t shards      = argc > 4 ? std::strtoul(argv[4], nullptr, 10) : 16;
+
+    // Логирование каждой операции измеряло бы spdlog, а не менеджер
+    spdlog::set_level(spdlog::level::warn);
+
+    std::vector<Imsi> imsis;
+    imsis.reserve(count);
+    for (size_t i = 0; i < count; ++i) {
+        imsis.push_back(Imsi::from_string(std::to_string(1010000000000ull + i)));
+    }
+
+    const std::string cdr_path = "bench_session_manager_cdr.csv";
+    {
+        CdrWriter cdr(cdr_path);
+        auto make_store = [](size_t) { return std::make_unique<InMemorySessionStore>(); };
+
+        std::printf("%-8s %8s %14s %14s\n", "threads", "shards", "1 shard op/s", "sharded op/s");
+        for (size_t threads = 1; threads <= max_threads; threads *= 2) {
+            SessionManager single(std::chrono::seconds(300), make_store, 1, cdr);
+            SessionManager sharded(std::chrono::seconds(300), make_store, shards, cdr);
+            for (Imsi imsi : imsis) {
+                single.touch_session(imsi);
+                sharded.touch_session(imsi);
+            }
+            double a = run(single, imsis, threads, ops);
+            double b = run(sharded, imsis, threads, ops);
+            std::printf("%-8zu %8zu %14.0f %14.0f\n", threads, sharded.shard_count(), a, b);
+        }
+    }
+    std::filesystem::remove(cdr_path);
+    return 0;
+}
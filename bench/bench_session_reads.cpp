@@ -0,0 +1,114 @@
+// bench/bench_session_reads.cpp
+// Чтение абонентов одновременно с записью: потоки смешивают get_session (как /check_subscriber)
+// и touch_session (как путь приёма) в заданной пропорции. Сравнивается хранилище, которое читается
+// под мьютексом шарда (in_memory), и плоская таблица с чтением без блокировок (flat).
+// Кроме пропускной способности печатается p99 задержки записи — насколько чтения тормозят подключения.
+//
+// Запуск: bench_session_reads [ops_per_thread=200000] [sessions=65536] [max_threads=8] [shards=16]
+#include "pgw/flat_session_store.hpp"
+#include "pgw/in_memory_session_store.hpp"
+#include "pgw/session_manager.hpp"
+
+#include <spdlog/spdlog.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace pgw;
+using clock_type = std::chrono::steady_clock;
+
+struct Result {
+    double ops_per_sec = 0;
+    double write_p99_us = 0;
+};
+
+static Result run(SessionManager& sessions, const std::vector<Imsi>& imsis,
+                  size_t threads, size_t ops, unsigned read_pct) {
+    std::vector<std::vector<uint32_t>> write_ns(threads);
+    std::vector<std::thread> pool;
+    std::atomic<size_t> found_total{0};  // Чтобы компилятор не выбросил чтения
+    auto t0 = clock_type::now();
+    for (size_t t = 0; t < threads; ++t) {
+        pool.emplace_back([&, t] {
+            std::mt19937_64 rng(t + 1);
+            auto& lat = write_ns[t];
+            lat.reserve(ops * (100 - read_pct) / 100 + 1024);
+            size_t found = 0;
+            for (size_t n = 0; n < ops; ++n) {
+                uint64_t r = rng();
+                Imsi imsi = imsis[(r >> 8) % imsis.size()];
+                if (r % 100 < read_pct) {
+                    found += sessions.get_session(imsi).has_value();
+                } else {
+                    auto w0 = clock_type::now();
+                    sessions.touch_session(imsi);
+                    lat.push_back(uint32_t(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                        clock_type::now() - w0).count()));
+                }
+            }
+            found_total.fetch_add(found, std::memory_order_relaxed);
+        });
+    }
+    for (auto& th : pool) th.join();
+    double sec = std::chrono::duration<double>(clock_type::now() - t0).count();
+
+    std::vector<uint32_t> all;
+    for (auto& v : write_ns) all.insert(all.end(), v.begin(), v.end());
+    Result res;
+    res.ops_per_sec = double(threads * ops) / sec;
+    if (!all.empty()) {
+        auto p99 = all.begin() + ptrdiff_t(all.size() * 99 / 100);
+        std::nth_element(all.begin(), p99, all.end());
+        res.write_p99_us = *p99 / 1000.0;
+    }
+    return res;
+}
+
+int main(int argc, char** argv) {
+    size_t ops         = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 200000;
+    size_t count       = argc > 2 ? std::strtoul(argv[2], nullptr, 10) : 65536;
+    size_t max_threads = argc > 3 ? std::strtoul(argv[3], nullptr, 10) : 8;
+    size_t shards      = argc > 4 ? std::strtoul(argv[4], nullptr, 10) : 16;
+
+    // Логирование каждой операции измеряло бы spdlog, а не менеджер
+    spdlog::set_level(spdlog::level::warn);
+
+    std::vector<Imsi> imsis;
+    imsis.reserve(count);
+    for (size_t i = 0; i < count; ++i) {
+        imsis.push_back(Imsi::from_string(std::to_string(1010000000000ull + i)));
+    }
+
+    const std::string cdr_path = "bench_session_reads_cdr.csv";
+    {
+        CdrWriter cdr(cdr_path);
+        SessionStoreFactory locked = [](size_t) { return std::make_unique<InMemorySessionStore>(); };
+        SessionStoreFactory flat   = [&](size_t) { return std::make_unique<FlatSessionStore>(count / shards * 2); };
+
+        std::printf("%-6s %-8s %16s %16s %16s %16s\n", "reads", "threads",
+                    "in_memory op/s", "write p99 us", "flat op/s", "write p99 us");
+        for (unsigned read_pct : { 90u, 50u }) {
+            for (size_t threads = 1; threads <= max_threads; threads *= 2) {
+                Result r[2];
+                for (int k = 0; k < 2; ++k) {
+                    SessionManager sessions(std::chrono::seconds(300), k == 0 ? locked : flat, shards, cdr);
+                    for (Imsi imsi : imsis) {
+                        sessions.touch_session(imsi);
+                    }
+                    r[k] = run(sessions, imsis, threads, ops, read_pct);
+                }
+                std::printf("%-6u %-8zu %16.0f %16.2f %16.0f %16.2f\n", read_pct, threads,
+                            r[0].ops_per_sec, r[0].write_p99_us, r[1].ops_per_sec, r[1].write_p99_us);
+            }
+        }
+    }
+    std::filesystem::remove(cdr_path);
+    return 0;
+}
@@ -0,0 +1,73 @@
+// bench/bench_session_snapshot.cpp
+// Тёплый перезапуск: менеджер с заданным числом сессий пишет снимок, новый менеджер
+// восстанавливает его. Печатаются время записи, размер файла и время восстановления
+// для разного числа потоков.
+//
+// Запуск: bench_session_snapshot [sessions=5000000] [store=in_memory|flat] [max_threads=8] [shards=16]
+#include "pgw/flat_session_store.hpp"
+#include "pgw/in_memory_session_store.hpp"
+#include "pgw/session_manager.hpp"
+
+#include <spdlog/spdlog.h>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+using namespace pgw;
+using clock_type = std::chrono::steady_clock;
+
+static double ms_since(clock_type::time_point t0) {
+    return std::chrono::duration<double, std::milli>(clock_type::now() - t0).count();
+}
+
+int main(int argc, char** argv) {
+    size_t      count       = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 5000000;
+    std::string store       = argc > 2 ? argv[2] : "in_memory";
+    size_t      max_threads = argc > 3 ? std::strtoul(argv[3], nullptr, 10) : 8;
+    size_t      shards      = argc > 4 ? std::strtoul(argv[4], nullptr, 10) : 16;
+
+    // Логирование каждой сессии измеряло бы spdlog, а не снимок
+    spdlog::set_level(spdlog::level::warn);
+
+    const size_t per_shard = count / shards + count / shards / 8 + 1024;
+    SessionStoreFactory factory;
+    if (store == "flat")
+        factory = [&](size_t) { return std::make_unique<FlatSessionStore>(per_shard); };
+    else
+        factory = [&](size_t) { return std::make_unique<InMemorySessionStore>(per_shard); };
+
+    const std::string cdr_path  = "bench_session_snapshot_cdr.csv";
+    const std::string snap_path = "bench_sessions.snap";
+    {
+        CdrWriter cdr(cdr_path);
+        {
+            SessionManager sessions(std::chrono::seconds(600), factory, shards, cdr);
+            std::vector<Imsi> batch;
+            for (size_t i = 0; i < count; i += batch.size()) {
+                batch.clear();
+                for (size_t k = i; k < count && batch.size() < 256; ++k) {
+                    batch.push_back(Imsi::from_string(std::to_string(1010000000000ull + k)));
+                }
+                sessions.touch_batch(batch);
+            }
+
+            auto t0 = clock_type::now();
+            size_t written = sessions.save_snapshot(snap_path);
+            std::printf("store %s, %zu sessions: snapshot written in %.0f ms, %.1f MB\n", store.c_str(),
+                        written, ms_since(t0), double(std::filesystem::file_size(snap_path)) / 1e6);
+        }
+
+        for (size_t threads = 1; threads <= max_threads; threads *= 2) {
+            SessionManager sessions(std::chrono::seconds(600), factory, shards, cdr);
+            auto t0 = clock_type::now();
+            size_t restored = sessions.restore_snapshot(snap_path, threads);
+            std::printf("  restore with %zu threads: %zu sessions in %.0f ms\n", threads, restored, ms_since(t0));
+        }
+    }
+    std::filesystem::remove(snap_path);
+    std::filesystem::remove(cdr_path);
+    return 0;
+}
@@ -0,0 +1,104 @@
+// bench/bench_session_store.cpp
+// Хранилища сессий в памяти: прежнее (unordered_map) против плоской таблицы с открытой адресацией.
+// Для каждого размера — вставка всех сессий, поиск существующих и отсутствующих IMSI в случайном
+// порядке, сканирование просроченных (половина сессий) и их удаление.
+//
+// Запуск: bench_session_store [sizes=1000000,10000000] [huge_pages=0]
+#include "pgw/flat_session_store.hpp"
+#include "pgw/in_memory_session_store.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+using namespace pgw;
+using clock_type = std::chrono::steady_clock;
+
+static double ns_per_op(clock_type::time_point t0, size_t ops) {
+    return std::chrono::duration<double, std::nano>(clock_type::now() - t0).count() / double(ops);
+}
+
+static double ms_since(clock_type::time_point t0) {
+    return std::chrono::duration<double, std::milli>(clock_type::now() - t0).count();
+}
+
+static void run(const char* name, ISessionStore& store, const std::vector<StoredSession>& sessions,
+                const std::vector<Imsi>& hits, const std::vector<Imsi>& misses, EpochMs now) {
+    auto t0 = clock_type::now();
+    for (auto& s : sessions) {
+        store.upsert(s);
+    }
+    double insert_ns = ns_per_op(t0, sessions.size());
+
+    size_t found = 0;
+    t0 = clock_type::now();
+    for (Imsi imsi : hits) {
+        found += store.get_session(imsi).has_value();
+    }
+    double hit_ns = ns_per_op(t0, hits.size());
+
+    t0 = clock_type::now();
+    for (Imsi imsi : misses) {
+        found += store.get_session(imsi).has_value();
+    }
+    double miss_ns = ns_per_op(t0, misses.size());
+
+    t0 = clock_type::now();
+    size_t expired = store.load_expired_sessions(now).size();
+    double scan_ms = ms_since(t0);
+
+    t0 = clock_type::now();
+    store.cleanup_expired_sessions(now);
+    double cleanup_ms = ms_since(t0);
+
+    std::printf("  %-10s insert %7.1f ns  hit %7.1f ns  miss %7.1f ns  scan %8.1f ms  cleanup %8.1f ms"
+                "  (found %zu, expired %zu)\n",
+                name, insert_ns, hit_ns, miss_ns, scan_ms, cleanup_ms, found, expired);
+}
+
+int main(int argc, char** argv) {
+    std::vector<size_t> sizes;
+    std::stringstream list(argc > 1 ? argv[1] : "1000000,10000000");
+    for (std::string item; std::getline(list, item, ',');) {
+        sizes.push_back(std::strtoull(item.c_str(), nullptr, 10));
+    }
+    bool huge = argc > 2 && std::atoi(argv[2]) != 0;
+
+    const EpochMs now = 1'700'000'000'000;
+    for (size_t count : sizes) {
+        std::mt19937_64 rng(1);
+        std::vector<StoredSession> sessions(count);
+        for (size_t i = 0; i < count; ++i) {
+            // Половина сессий уже просрочена к моменту now
+            EpochMs expires = now + ((i & 1) ? 30000 : -1000);
+            sessions[i] = { Imsi::from_string(std::to_string(250010000000000ull + i)), now - 60000, expires };
+        }
+        std::shuffle(sessions.begin(), sessions.end(), rng);
+
+        const size_t lookups = std::min<size_t>(count, 1000000);
+        std::vector<Imsi> hits(lookups), misses(lookups);
+        for (size_t i = 0; i < lookups; ++i) {
+            hits[i]   = sessions[rng() % count].imsi;
+            misses[i] = Imsi::from_string(std::to_string(250020000000000ull + rng() % count));
+        }
+
+        // Плоская таблица — первой: после освобождения миллионов узлов unordered_map куча glibc
+        // фрагментирована, и рост вектора результата сканирования заметно замедляется
+        std::printf("sessions %zu, lookups %zu\n", count, lookups);
+        {
+            FlatSessionStore store(count, huge);
+            run(store.huge_pages() ? "flat/huge" : "flat", store, sessions, hits, misses, now);
+        }
+        {
+            InMemorySessionStore store;
+            run("in_memory", store, sessions, hits, misses, now);
+        }
+    }
+    return 0;
+}
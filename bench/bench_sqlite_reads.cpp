@@ -0,0 +1,132 @@
+// bench/bench_sqlite_reads.cpp
+// SessionManager поверх SQLite-файла: потоки смешивают get_session (как /check_subscriber) и
+// touch_session (как путь приёма) в заданной пропорции. Сравнивается чтение через соединение
+// писателя под общим мьютексом (read_connections=0) и через пул соединений только для чтения.
+// Кроме пропускной способности печатаются p99 задержки чтения и записи.
+//
+// Запуск: bench_sqlite_reads [ops_per_thread=20000] [sessions=20000] [max_threads=8] [read_connections=4]
+//                            [db=bench_sqlite_reads.db] [commit_interval_ms=0]
+#include "pgw/session_manager.hpp"
+#include "pgw/sqlite_session_store.hpp"
+
+#include <spdlog/spdlog.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace pgw;
+using clock_type = std::chrono::steady_clock;
+
+struct Result {
+    double ops_per_sec  = 0;
+    double read_p99_us  = 0;
+    double write_p99_us = 0;
+};
+
+static double p99_us(std::vector<std::vector<uint32_t>>& per_thread) {
+    std::vector<uint32_t> all;
+    for (auto& v : per_thread) all.insert(all.end(), v.begin(), v.end());
+    if (all.empty()) return 0;
+    auto p99 = all.begin() + ptrdiff_t(all.size() * 99 / 100);
+    std::nth_element(all.begin(), p99, all.end());
+    return *p99 / 1000.0;
+}
+
+static Result run(SessionManager& sessions, const std::vector<Imsi>& imsis,
+                  size_t threads, size_t ops, unsigned read_pct) {
+    std::vector<std::vector<uint32_t>> read_ns(threads), write_ns(threads);
+    std::vector<std::thread> pool;
+    std::atomic<size_t> found_total{0};  // Чтобы компилятор не выбросил чтения
+    auto t0 = clock_type::now();
+    for (size_t t = 0; t < threads; ++t) {
+        pool.emplace_back([&, t] {
+            std::mt19937_64 rng(t + 1);
+            read_ns[t].reserve(ops * read_pct / 100 + 1024);
+            write_ns[t].reserve(ops * (100 - read_pct) / 100 + 1024);
+            size_t found = 0;
+            for (size_t n = 0; n < ops; ++n) {
+                uint64_t r = rng();
+                Imsi imsi = imsis[(r >> 8) % imsis.size()];
+                bool read = r % 100 < read_pct;
+                auto op0 = clock_type::now();
+                if (read) {
+                    found += sessions.get_session(imsi).has_value();
+                } else {
+                    sessions.touch_session(imsi);
+                }
+                auto ns = uint32_t(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                    clock_type::now() - op0).count());
+                (read ? read_ns : write_ns)[t].push_back(ns);
+            }
+            found_total.fetch_add(found, std::memory_order_relaxed);
+        });
+    }
+    for (auto& th : pool) th.join();
+    double sec = std::chrono::duration<double>(clock_type::now() - t0).count();
+
+    Result res;
+    res.ops_per_sec  = double(threads * ops) / sec;
+    res.read_p99_us  = p99_us(read_ns);
+    res.write_p99_us = p99_us(write_ns);
+    return res;
+}
+
+int main(int argc, char** argv) {
+    size_t      ops         = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 20000;
+    size_t      count       = argc > 2 ? std::strtoul(argv[2], nullptr, 10) : 20000;
+    size_t      max_threads = argc > 3 ? std::strtoul(argv[3], nullptr, 10) : 8;
+    size_t      readers     = argc > 4 ? std::strtoul(argv[4], nullptr, 10) : 4;
+    std::string db_path     = argc > 5 ? argv[5] : "bench_sqlite_reads.db";
+    auto        interval    = std::chrono::milliseconds(argc > 6 ? std::strtoul(argv[6], nullptr, 10) : 0);
+
+    // Логирование каждой операции измеряло бы spdlog, а не хранилище
+    spdlog::set_level(spdlog::level::warn);
+
+    std::vector<Imsi> imsis;
+    imsis.reserve(count);
+    for (size_t i = 0; i < count; ++i) {
+        imsis.push_back(Imsi::from_string(std::to_string(1010000000000ull + i)));
+    }
+
+    std::printf("%zu sessions, db %s, commit interval %lld ms, %zu read connections\n",
+                count, db_path.c_str(), static_cast<long long>(interval.count()), readers);
+    std::printf("%-6s %-8s %14s %12s %12s %14s %12s %12s\n", "reads", "threads",
+                "writer op/s", "read p99 us", "write p99 us", "pool op/s", "read p99 us", "write p99 us");
+
+    const std::string cdr_path = "bench_sqlite_reads_cdr.csv";
+    {
+        CdrWriter cdr(cdr_path);
+        for (unsigned read_pct : { 90u, 50u }) {
+            for (size_t threads = 1; threads <= max_threads; threads *= 2) {
+                Result r[2];
+                for (int k = 0; k < 2; ++k) {
+                    std::filesystem::remove(db_path);
+                    SqliteStoreOptions options;
+                    options.commit_interval  = interval;
+                    options.read_connections = k == 0 ? 0 : readers;
+                    // Как в main.cpp: хранилище SQLite — один шард
+                    SessionManager sessions(std::chrono::seconds(300),
+                                            [&](size_t) { return std::make_unique<SqliteSessionStore>(db_path, options); },
+                                            1, cdr);
+                    for (Imsi imsi : imsis) {
+                        sessions.touch_session(imsi);
+                    }
+                    r[k] = run(sessions, imsis, threads, ops, read_pct);
+                }
+                std::printf("%-6u %-8zu %14.0f %12.2f %12.2f %14.0f %12.2f %12.2f\n", read_pct, threads,
+                            r[0].ops_per_sec, r[0].read_p99_us, r[0].write_p99_us,
+                            r[1].ops_per_sec, r[1].read_p99_us, r[1].write_p99_us);
+            }
+        }
+    }
+    std::filesystem::remove(cdr_path);
+    std::filesystem::remove(db_path);
+    return 0;
+}
@@ -0,0 +1,140 @@
+// bench/bench_sqlite_store.cpp
+// SessionManager поверх SQLite: путь touch_session (создание новых сессий и продление существующих),
+// точечный поиск и завершение сессий. После прогона — счётчики подготовленных запросов хранилища
+// (сколько раз выполнен каждый запрос и сколько времени в среднем занял).
+//
+// По умолчанию база в памяти (":memory:"), чтобы измерять разбор и выполнение запросов, а не fsync
+// журнала на каждой транзакции; путь к файлу — вторым аргументом. Для файла сравниваются режимы
+// записи: journal_mode, synchronous и окно отложенной записи (0 — транзакция на каждую запись);
+// с отложенной записью выводятся размер и длительность групповых фиксаций.
+//
+// store=tiered — то же поверх многоуровневого хранилища (таблица в памяти, обратная запись в SQLite
+// раз в commit_interval_ms, по умолчанию 100): выводится, сколько изменений слилось до записи.
+//
+// Запуск: bench_sqlite_store [sessions=100000] [db=:memory:] [commit_interval_ms=0] [journal_mode=wal]
+//                            [synchronous=normal] [store=sqlite|tiered]
+#include "pgw/session_manager.hpp"
+#include "pgw/sqlite_session_store.hpp"
+#include "pgw/tiered_session_store.hpp"
+
+#include <spdlog/spdlog.h>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+using namespace pgw;
+using clock_type = std::chrono::steady_clock;
+
+template <typename Op>
+static double ns_per_op(const std::vector<Imsi>& imsis, Op op) {
+    auto t0 = clock_type::now();
+    for (Imsi imsi : imsis) {
+        op(imsi);
+    }
+    return std::chrono::duration<double, std::nano>(clock_type::now() - t0).count() / double(imsis.size());
+}
+
+int main(int argc, char** argv) {
+    size_t      count   = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 100000;
+    std::string db_path = argc > 2 ? argv[2] : ":memory:";
+
+    SqliteStoreOptions options;
+    options.commit_interval = std::chrono::milliseconds(argc > 3 ? std::strtoul(argv[3], nullptr, 10) : 0);
+    if (argc > 4) options.journal_mode = argv[4];
+    if (argc > 5) options.synchronous  = argv[5];
+    const bool tiered = argc > 6 && std::string(argv[6]) == "tiered";
+
+    // Логирование каждой операции измеряло бы spdlog, а не хранилище
+    spdlog::set_level(spdlog::level::warn);
+
+    std::vector<Imsi> imsis;
+    imsis.reserve(count);
+    for (size_t i = 0; i < count; ++i) {
+        imsis.push_back(Imsi::from_string(std::to_string(1010000000000ull + i)));
+    }
+
+    if (db_path != ":memory:") {
+        std::filesystem::remove(db_path);
+    }
+
+    // В многоуровневом хранилище окно — у обратной записи, сама база пишет сразу
+    std::shared_ptr<SessionWriteBack> writeback;
+    if (tiered) {
+        TieredStoreOptions tiered_options;
+        if (options.commit_interval.count() > 0)
+            tiered_options.writeback_interval = options.commit_interval;
+        options.commit_interval = std::chrono::milliseconds(0);
+        writeback = std::make_shared<SessionWriteBack>(std::make_unique<SqliteSessionStore>(db_path, options),
+                                                       1, tiered_options);
+        options.commit_interval = tiered_options.writeback_interval;
+    }
+
+    const std::string cdr_path = "bench_sqlite_store_cdr.csv";
+    {
+        CdrWriter cdr(cdr_path);
+        SqliteSessionStore* store = tiered ? &writeback->cold() : nullptr;
+        auto make_store = [&](size_t) -> std::unique_ptr<ISessionStore> {
+            if (tiered)
+                return std::make_unique<TieredSessionStore>(writeback, 0);
+            auto s = std::make_unique<SqliteSessionStore>(db_path, options);
+            store  = s.get();
+            return s;
+        };
+        SessionManager sessions(std::chrono::seconds(300), make_store, 1, cdr);
+
+        size_t ok = 0;
+        double create_ns  = ns_per_op(imsis, [&](Imsi imsi) { ok += sessions.touch_session(imsi); });
+        double refresh_ns = ns_per_op(imsis, [&](Imsi imsi) { ok += sessions.touch_session(imsi); });
+        double get_ns     = ns_per_op(imsis, [&](Imsi imsi) { ok += sessions.get_session(imsi).has_value(); });
+        double end_ns     = ns_per_op(imsis, [&](Imsi imsi) { ok += sessions.end_session(imsi); });
+        if (ok != 4 * count) {
+            std::fprintf(stderr, "Unexpected result: %zu of %zu operations succeeded\n", ok, 4 * count);
+        }
+
+        std::printf("%zu sessions, %s store, db %s, journal_mode=%s, synchronous=%s, commit interval %lld ms\n",
+                    count, tiered ? "tiered" : "sqlite", db_path.c_str(), options.journal_mode.c_str(),
+                    options.synchronous.c_str(), static_cast<long long>(options.commit_interval.count()));
+        std::printf("  touch (create)   %8.0f ns/op\n", create_ns);
+        std::printf("  touch (refresh)  %8.0f ns/op\n", refresh_ns);
+        std::printf("  get_session      %8.0f ns/op\n", get_ns);
+        std::printf("  end_session      %8.0f ns/op\n", end_ns);
+
+        if (tiered) {
+            writeback->flush();
+            auto w = writeback->stats();
+            std::printf("  changes %llu, rows written %llu in %llu flushes, flush avg %.2f ms max %.2f ms\n",
+                        static_cast<unsigned long long>(w.changes),
+                        static_cast<unsigned long long>(w.rows),
+                        static_cast<unsigned long long>(w.flushes),
+                        w.flushes ? double(w.total_flush_ns) / double(w.flushes) / 1e6 : 0.0,
+                        double(w.max_flush_ns) / 1e6);
+        } else if (options.commit_interval.count() > 0) {
+            auto c = store->commit_stats();
+            std::printf("  commits %llu, rows/commit avg %llu max %llu, commit avg %.2f ms max %.2f ms\n",
+                        static_cast<unsigned long long>(c.commits),
+                        static_cast<unsigned long long>(c.commits ? c.rows / c.commits : 0),
+                        static_cast<unsigned long long>(c.max_batch_rows),
+                        c.commits ? double(c.total_commit_ns) / double(c.commits) / 1e6 : 0.0,
+                        double(c.max_commit_ns) / 1e6);
+        }
+
+        std::printf("\n  %-16s %10s %8s %10s %12s\n", "statement", "calls", "errors", "avg ns", "max ns");
+        for (const auto& s : store->statement_stats()) {
+            if (s.calls == 0) continue;
+            std::printf("  %-16s %10llu %8llu %10llu %12llu\n", s.name.c_str(),
+                        static_cast<unsigned long long>(s.calls),
+                        static_cast<unsigned long long>(s.errors),
+                        static_cast<unsigned long long>(s.total_ns / s.calls),
+                        static_cast<unsigned long long>(s.max_ns));
+        }
+    }
+    writeback.reset();
+    std::filesystem::remove(cdr_path);
+    if (db_path != ":memory:") {
+        std::filesystem::remove(db_path);
+    }
+    return 0;
+}
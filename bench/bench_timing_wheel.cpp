@@ -0,0 +1,111 @@
+// bench/bench_timing_wheel.cpp
+// Колесо таймеров на миллионах сессий: стоимость постановки и перевзвода, затем истечение
+// в реальном времени — поток спит до next_event(), снимает наступившие сроки и считает,
+// насколько позже своего тика каждая сессия была снята (та же гистограмма, что в GET /stats).
+//
+// Запуск: bench_timing_wheel [sessions=10000000] [spread_sec=30] [tick_ms=10]
+#include "pgw/session_manager.hpp"
+#include "pgw/timing_wheel.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <thread>
+#include <vector>
+
+using namespace pgw;
+using clock_type = std::chrono::steady_clock;
+
+int main(int argc, char** argv) {
+    size_t   count  = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 10000000;
+    uint64_t spread = argc > 2 ? std::strtoul(argv[2], nullptr, 10) : 30;
+    uint64_t tick   = argc > 3 ? std::strtoul(argv[3], nullptr, 10) : 10;
+
+    const auto tick_len = std::chrono::milliseconds(tick);
+    const uint64_t first = 1000 / tick;                  // Первые сроки — через секунду
+    const uint64_t width = spread * 1000 / tick;         // Сроки равномерно на spread секунд
+
+    std::vector<Imsi> imsis(count);
+    for (size_t i = 0; i < count; ++i) {
+        imsis[i] = Imsi::from_string(std::to_string(250010000000000ull + i));
+    }
+    std::mt19937_64 rng(1);
+    std::vector<uint64_t> deadlines(count);
+
+    TimingWheel wheel;
+    wheel.reserve(count);
+    const auto epoch = clock_type::now();
+    auto now_tick = [&] { return uint64_t((clock_type::now() - epoch) / tick_len); };
+
+    // 1) Постановка
+    for (auto& d : deadlines) d = first + rng() % width;
+    uint64_t base = now_tick();
+    auto t0 = clock_type::now();
+    for (size_t i = 0; i < count; ++i) {
+        wheel.schedule(imsis[i], base + deadlines[i]);
+    }
+    double insert_ns = std::chrono::duration<double, std::nano>(clock_type::now() - t0).count() / double(count);
+
+    // 2) Перевзвод (продление каждой сессии на новый случайный срок).
+    //    Сроки отсчитываются от конца перевзвода, чтобы к началу истечения ни один не был просрочен.
+    //    Колесо сначала догоняет текущее время — как в менеджере сессий, где его двигает поток очистки
+    std::vector<TimingWheel::Expired> due;
+    wheel.advance(now_tick(), due);
+    double lead_ms = insert_ns * double(count) * 1.5 / 1e6;
+    base = now_tick() + uint64_t(lead_ms) / tick;
+    for (auto& d : deadlines) d = base + first + rng() % width;
+    t0 = clock_type::now();
+    for (size_t i = 0; i < count; ++i) {
+        wheel.schedule(imsis[i], deadlines[i]);
+    }
+    double rearm_ns = std::chrono::duration<double, std::nano>(clock_type::now() - t0).count() / double(count);
+    if (now_tick() >= base + first) {
+        std::printf("warning: re-arm took longer than the lead, early deadlines are already overdue\n");
+    }
+
+    std::printf("sessions %zu, tick %llu ms\n", count, (unsigned long long)tick);
+    std::printf("schedule %8.1f ns/op\n", insert_ns);
+    std::printf("re-arm   %8.1f ns/op\n", rearm_ns);
+
+    // 3) Истечение в реальном времени
+    ExpiryStats st;
+    uint64_t wakeups = 0;
+    double   busy_ns = 0;
+    due.reserve(count / width * 4 + 1024);
+    while (wheel.size() > 0) {
+        uint64_t next = wheel.next_event();
+        std::this_thread::sleep_until(epoch + tick_len * int64_t(next));
+        ++wakeups;
+
+        auto w0 = clock_type::now();
+        due.clear();
+        wheel.advance(now_tick(), due);
+        auto w1 = clock_type::now();
+        busy_ns += std::chrono::duration<double, std::nano>(w1 - w0).count();
+
+        for (auto& e : due) {
+            auto lag = std::chrono::duration_cast<std::chrono::microseconds>(
+                w1 - (epoch + tick_len * int64_t(e.deadline))).count();
+            uint64_t us = uint64_t(std::max<int64_t>(0, lag));
+            size_t b = 0;
+            while (b + 1 < ExpiryStats::kBuckets && us > uint64_t(ExpiryStats::kLagBoundsMs[b]) * 1000) ++b;
+            ++st.lag[b];
+            st.max_lag_us = std::max(st.max_lag_us, us);
+            ++st.expired;
+        }
+    }
+
+    std::printf("expired  %llu in %llu wake-ups, advance %.1f ns per expired session\n",
+                (unsigned long long)st.expired, (unsigned long long)wakeups, busy_ns / double(st.expired));
+    std::printf("max lag  %llu us\n", (unsigned long long)st.max_lag_us);
+    std::printf("lag histogram (ms):\n");
+    for (size_t b = 0; b < ExpiryStats::kBuckets; ++b) {
+        if (b + 1 < ExpiryStats::kBuckets)
+            std::printf("  <= %4u  %10llu\n", ExpiryStats::kLagBoundsMs[b], (unsigned long long)st.lag[b]);
+        else
+            std::printf("   > %4u  %10llu\n", ExpiryStats::kLagBoundsMs[b - 1], (unsigned long long)st.lag[b]);
+    }
+    return 0;
+}
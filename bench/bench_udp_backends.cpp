@@ -0,0 +1,146 @@
+// bench/bench_udp_backends.cpp
+// Сравнение бэкендов приёма UDP (blocking / epoll / io_uring) на loopback.
+// Клиент держит в полёте не более window запросов, отправляет их sendmmsg и читает ответы recvmmsg.
+// Логирование отключено, сессии хранятся в памяти.
+//
+// Запуск: bench_udp_backends [packets=200000] [workers=1] [window=128] [backend...]
+#include "pgw/udp_server.hpp"
+#include "pgw/in_memory_session_store.hpp"
+
+#include <spdlog/spdlog.h>
+#include <arpa/inet.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+using namespace pgw;
+
+static constexpr size_t   kBatch       = 32;      // Датаграмм на один sendmmsg/recvmmsg клиента
+static constexpr uint32_t kSubscribers = 100000;  // Число различных IMSI (далее сессии продлеваются)
+
+// BCD-кодирование 15-значного IMSI 00101XXXXXXXXXX (последняя цифра в младшем полубайте, старший — 0xF)
+static std::array<uint8_t, 8> make_imsi(uint64_t n) {
+    char digits[16];
+    std::snprintf(digits, sizeof(digits), "00101%010llu", static_cast<unsigned long long>(n));
+    std::array<uint8_t, 8> bcd{};
+    for (int i = 0; i < 15; i += 2) {
+        uint8_t lo = uint8_t(digits[i] - '0');
+        uint8_t hi = i + 1 < 15 ? uint8_t(digits[i + 1] - '0') : 0x0F;
+        bcd[i / 2] = uint8_t(hi << 4 | lo);
+    }
+    return bcd;
+}
+
+struct Result {
+    size_t   replies = 0;
+    size_t   lost    = 0;
+    double   seconds = 0;
+    UdpStats stats;
+};
+
+static Result run(UdpBackend backend, uint16_t port, size_t packets, size_t workers, size_t window) {
+    auto cdr_path = std::filesystem::temp_directory_path() / "bench_udp_backends_cdr.log";
+    CdrWriter cdr{cdr_path.string()};
+    Blacklist blacklist{{}};
+    SessionManager sessions{std::chrono::seconds(300), std::make_unique<InMemorySessionStore>(), cdr};
+
+    UdpServerOptions options;
+    options.backend = backend;
+    options.workers = workers;
+    UdpServer server{"127.0.0.1", port, blacklist, sessions, options};
+    server.start();
+
+    int sock = ::socket(AF_INET, SOCK_DGRAM, 0);
+    sockaddr_in addr{};
+    addr.sin_family = AF_INET;
+    addr.sin_port   = htons(port);
+    inet_pton(AF_INET, "127.0.0.1", &addr.sin_addr);
+    ::connect(sock, reinterpret_cast<sockaddr*>(&addr), sizeof(addr));
+    int rcvbuf = 1 << 22;
+    ::setsockopt(sock, SOL_SOCKET, SO_RCVBUF, &rcvbuf, sizeof(rcvbuf));
+    timeval tv{0, 200000};  // Ответ, не пришедший за 200 мс, считаем потерянным
+    ::setsockopt(sock, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+
+    std::vector<std::array<uint8_t, 8>> tx_data(kBatch);
+    std::vector<std::array<char, 32>>   rx_data(kBatch);
+    std::vector<iovec>   tx_iov(kBatch), rx_iov(kBatch);
+    std::vector<mmsghdr> tx_msgs(kBatch), rx_msgs(kBatch);
+    for (size_t i = 0; i < kBatch; ++i) {
+        tx_iov[i] = {tx_data[i].data(), tx_data[i].size()};
+        rx_iov[i] = {rx_data[i].data(), rx_data[i].size()};
+        tx_msgs[i].msg_hdr.msg_iov = &tx_iov[i];
+        tx_msgs[i].msg_hdr.msg_iovlen = 1;
+        rx_msgs[i].msg_hdr.msg_iov = &rx_iov[i];
+        rx_msgs[i].msg_hdr.msg_iovlen = 1;
+    }
+
+    // Даём worker'ам время войти в цикл приёма
+    ::usleep(50000);
+
+    Result r;
+    size_t sent = 0, in_flight = 0;
+    auto t0 = std::chrono::steady_clock::now();
+    while (r.replies + r.lost < packets) {
+        if (sent < packets && in_flight + kBatch <= window) {
+            size_t n = std::min(kBatch, packets - sent);
+            for (size_t i = 0; i < n; ++i) {
+                tx_data[i] = make_imsi((sent + i) % kSubscribers);
+            }
+            int m = ::sendmmsg(sock, tx_msgs.data(), static_cast<unsigned>(n), 0);
+            if (m > 0) {
+                sent += size_t(m);
+                in_flight += size_t(m);
+            }
+            continue;
+        }
+        int m = ::recvmmsg(sock, rx_msgs.data(), kBatch, MSG_WAITFORONE, nullptr);
+        if (m > 0) {
+            r.replies += size_t(m);
+            in_flight -= std::min(in_flight, size_t(m));
+        } else {
+            r.lost += in_flight;
+            in_flight = 0;
+        }
+    }
+    r.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+    r.stats = server.stats();
+
+    ::close(sock);
+    server.stop();
+    server.join();
+    std::filesystem::remove(cdr_path);
+    return r;
+}
+
+int main(int argc, char** argv) {
+    size_t packets = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 200000;
+    size_t workers = argc > 2 ? std::strtoul(argv[2], nullptr, 10) : 1;
+    size_t window  = argc > 3 ? std::strtoul(argv[3], nullptr, 10) : 128;
+    window = std::max(window, kBatch);
+
+    std::vector<UdpBackend> backends;
+    for (int i = 4; i < argc; ++i) {
+        backends.push_back(udp_backend_from_string(argv[i]));
+    }
+    if (backends.empty()) {
+        backends = {UdpBackend::Blocking, UdpBackend::Epoll, UdpBackend::IoUring};
+    }
+
+    spdlog::set_level(spdlog::level::off);
+
+    std::printf("%-10s %10s %8s %12s %10s %10s\n", "backend", "replies", "lost", "pps", "rx/call", "tx/call");
+    uint16_t port = 19700;
+    for (UdpBackend backend : backends) {
+        Result r = run(backend, port++, packets, workers, window);
+        std::printf("%-10s %10zu %8zu %12.0f %10.1f %10.1f\n", to_string(backend), r.replies, r.lost,
+                    double(r.replies) / r.seconds, r.stats.rx_packets_per_syscall(), r.stats.tx_packets_per_syscall());
+    }
+    return 0;
+}
@@ -2,6 +2,7 @@
 
 #pragma once
 
+#include "pgw/imsi.hpp"
 #include <string>
 #include <unordered_set>
 #include <vector>
@@ -16,6 +17,7 @@ class Blacklist {
 public:
     /** 
      * Конструктор, инициализирующий чёрный список из вектора IMSI.
+     * Строки, не являющиеся IMSI (не цифры или длиннее 15 знаков), пропускаются с предупреждением.
      * 
      * @param imsi_list Вектор строк, содержащий IMSI для добавления в чёрный список.
      */
@@ -27,11 +29,11 @@ public:
      * @param imsi IMSI, который нужно проверить.
      * @return true, если IMSI найден в чёрном списке, иначе false.
      */
-    bool is_blocked(const std::string& imsi) const noexcept;
+    bool is_blocked(Imsi imsi) const noexcept;
 
 private:
     /** Множество для хранения IMSI, находящихся в чёрном списке. */
-    std::unordered_set<std::string> blocked_;
+    std::unordered_set<Imsi> blocked_;
 };
 
 } // namespace pgw
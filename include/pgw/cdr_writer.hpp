@@ -1,19 +1,22 @@
 // include/pgw/cdr_write.hpp
 #pragma once
 
+#include "pgw/clock.hpp"
+#include "pgw/imsi.hpp"
 #include <string>
 #include <thread>
 #include <mutex>
 #include <condition_variable>
 #include <queue>
+#include <span>
 
 namespace pgw {
 
 // Структура для представления одной записи CDR (Call Data Record)
 struct CdrRecord {
-    std::string timestamp;  // Временная метка записи CDR
-    std::string imsi;       // IMSI абонента
-    std::string action;     // Действие ("created" - создана сессия, "expired" - сессия завершена)
+    EpochMs     timestamp;  // Временная метка записи CDR (в строку превращается при записи в файл)
+    Imsi        imsi;       // IMSI абонента
+    std::string action;     // Действие ("created" - создана сессия, "expired" - истекла, "deleted" - удалена по запросу)
 };
 
 class CdrWriter {
@@ -27,6 +30,9 @@ public:
     // Метод для помещения записи в очередь для асинхронной записи в файл
     void write(const CdrRecord& rec);
 
+    // Метод для помещения пачки записей в очередь: один захват мьютекса и одно пробуждение потока записи
+    void write_batch(std::span<const CdrRecord> recs);
+
 private:
     // Метод, который выполняет запись в файл в отдельном потоке
     void writer_loop();
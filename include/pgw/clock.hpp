@@ -0,0 +1,65 @@
+// include/pgw/clock.hpp
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <string_view>
+#include <thread>
+
+namespace pgw {
+
+// Unix-время в миллисекундах: так хранятся сроки сессий и метки CDR.
+// Сравнение — целочисленное, без зависимости от часового пояса и перехода на летнее время
+using EpochMs = int64_t;
+
+// Грубые часы: отдельный поток раз в resolution перечитывает системное и монотонное время
+// и публикует их в атомарных переменных. На пути обработки пакета чтение часов — одна загрузка
+// из памяти вместо системного вызова; погрешность — не больше resolution
+class CoarseClock {
+public:
+    explicit CoarseClock(std::chrono::milliseconds resolution = std::chrono::milliseconds(1));
+    ~CoarseClock();
+
+    CoarseClock(const CoarseClock&) = delete;
+    CoarseClock& operator=(const CoarseClock&) = delete;
+
+    // Текущее Unix-время (мс)
+    EpochMs epoch_ms() const noexcept { return epoch_ms_.load(std::memory_order_relaxed); }
+
+    // Текущее монотонное время (совместимо с std::chrono::steady_clock)
+    std::chrono::steady_clock::time_point steady() const noexcept {
+        return std::chrono::steady_clock::time_point(
+            std::chrono::steady_clock::duration(steady_.load(std::memory_order_relaxed)));
+    }
+
+    std::chrono::milliseconds resolution() const noexcept { return resolution_; }
+
+private:
+    void refresh() noexcept;
+    void run();
+
+    const std::chrono::milliseconds resolution_;
+    std::atomic<EpochMs>            epoch_ms_{0};
+    std::atomic<int64_t>            steady_{0};  // steady_clock::duration::count()
+
+    std::mutex              mtx_;
+    std::condition_variable cv_;
+    bool                    stop_ = false;
+    std::thread             thread_;
+};
+
+// Системное время (мс) без кэша — для редких вызовов вне горячего пути
+EpochMs epoch_ms_now() noexcept;
+
+// Форматирует метку как "YYYY-MM-DD HH:MM:SS" местного времени — только на границах вывода
+// (CDR, журнал, HTTP). Строка кэшируется на секунду в каждом потоке: localtime_r вызывается
+// раз в секунду, а не на каждую запись. Результат действителен до следующего вызова в этом потоке
+std::string_view format_timestamp(EpochMs ms);
+
+// Разбирает "YYYY-MM-DD HH:MM:SS" местного времени; false, если строка не в этом формате
+bool parse_timestamp(std::string_view text, EpochMs& out);
+
+} // namespace pgw
@@ -13,9 +13,29 @@ public:
     // Параметры для UDP
     std::string            udp_ip;           // IP-адрес для прослушивания UDP пакетов
     uint16_t               udp_port;         // Порт для UDP соединений
+    std::string            udp_backend;      // Способ приёма UDP: "blocking", "epoll" или "io_uring"
+    uint32_t               udp_batch_size;   // Сколько датаграмм принимать/отправлять за один recvmmsg/sendmmsg
+    uint32_t               udp_workers;      // Число потоков приёма UDP (по сокету SO_REUSEPORT на поток)
+    std::vector<int>       udp_cpu_affinity; // CPU для привязки потоков приёма; пусто — без привязки
+    uint32_t               udp_processing_threads; // Потоки обработки конвейера; 0 — обработка в потоке приёма
+    uint32_t               udp_queue_capacity;     // Ёмкость очередей конвейера
+    double                 udp_rate_limit_pps;     // Ограничение пакетов в секунду с одного IP; 0 — выключено
+    uint32_t               udp_rate_limit_burst;   // Допустимая пачка пакетов с одного IP сверх темпа
+    bool                   udp_rate_limit_reply;   // Отвечать "throttled" вместо молчаливого отбрасывания
+
+    // Защита от перегрузки: в перегрузке новые сессии получают "busy"
+    uint32_t               overload_sample_ms;       // Период выборки сигналов нагрузки; 0 — выключено
+    double                 overload_queue_high;      // Заполнение очереди обработки для входа в перегрузку (0..1)
+    double                 overload_queue_low;       // ... и для выхода из неё
+    double                 overload_backlog_high;    // Заполнение буфера приёма сокета (0..1)
+    double                 overload_backlog_low;
+    uint32_t               overload_latency_high_ms; // Сглаженная задержка хранилища сессий
+    uint32_t               overload_latency_low_ms;
 
     // Параметры сессий
     uint32_t               session_timeout_sec;  // Таймаут сессии в секундах
+    uint32_t               session_shards;       // Число шардов менеджера сессий (для in_memory и flat)
+    uint64_t               max_sessions;         // Предел общего числа сессий на все шарды, память под них выделяется при старте (0 — без предела)
 
     // Параметры для записи CDR и логирования
     std::string            cdr_file;         // Путь к файлу для записи CDR
@@ -24,17 +44,38 @@ public:
 
     // Параметры для HTTP API
     uint16_t               http_port;        // Порт для HTTP API
-    uint32_t               graceful_shutdown_rate;  // Скорость завершения работы сессий
+    uint32_t               graceful_shutdown_rate;  // Скорость завершения работы сессий в секунду (0 — без ограничения)
 
     // Чёрный список IMSI
     std::vector<std::string> blacklist;      // Список IMSI, для которых запросы отклоняются
 
     // Выбор хранилища сессий
-    //   "in_memory" - для хранения в памяти или "sqlite" - для использования SQLite базы данных
+    //   "in_memory" - для хранения в памяти, "flat" - плоская хеш-таблица в памяти,
+    //   "sqlite" - для использования SQLite базы данных
+    //   или "tiered" - таблица в памяти с фоновой записью в SQLite (sqlite_db_path)
     std::string            session_store;    // Тип хранилища сессий (например, "in_memory" или "sqlite")
 
+    // Параметры плоской таблицы (используются, если session_store == "flat")
+    uint64_t               flat_store_capacity;    // Сколько сессий принять без перестроения (на все шарды)
+    bool                   flat_store_huge_pages;  // Размещать таблицы на огромных страницах
+
+    // Снимок сессий для тёплого перезапуска (для in_memory и flat)
+    std::string            snapshot_path;             // Файл снимка; пусто — снимки выключены
+    uint32_t               snapshot_interval_sec;     // Период записи снимка
+    uint32_t               snapshot_restore_threads;  // Потоки восстановления при старте (0 — по числу ядер)
+
     // Путь к базе данных SQLite (используется, если session_store == "sqlite")
     std::string            sqlite_db_path;   // Путь к файлу SQLite базы данных
+    std::string            sqlite_journal_mode;        // PRAGMA journal_mode ("wal", "delete", ...)
+    std::string            sqlite_synchronous;         // PRAGMA synchronous ("normal", "full", ...)
+    uint32_t               sqlite_commit_interval_ms;  // Окно отложенной записи (0 — каждая запись сразу)
+    uint32_t               sqlite_commit_rows;         // Досрочная фиксация по накоплении строк
+    uint32_t               sqlite_expire_chunk_rows;   // Истёкшие удаляются порциями не больше стольких строк
+    uint32_t               sqlite_read_connections;    // Соединения только для чтения (0 — чтение через писателя)
+
+    // Обратная запись многоуровневого хранилища (session_store == "tiered")
+    uint32_t               tiered_writeback_interval_ms;  // Окно долговечности
+    uint32_t               tiered_writeback_rows;         // Досрочная запись по накоплении строк в шарде
 
     // Статический метод для загрузки конфигурации из файла
     static Config load_from_file(const std::string& path);  // Загрузка конфигурации из JSON файла
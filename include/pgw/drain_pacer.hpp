@@ -0,0 +1,53 @@
+// include/pgw/drain_pacer.hpp
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace pgw {
+
+// Темп выгрузки сессий при graceful stop: маркерная корзина с наносекундным расписанием
+//
+// Вместо сна на 1000 / rate мс после каждой сессии (округление до миллисекунд, накопление
+// опозданий) корзина помнит момент, когда она была пуста, а маркеры прибывают строго через
+// 1 / rate. Выгрузка ждёт до момента готовности целой пачки и забирает её разом; проспав лишнее,
+// она догоняет расписание — средний темп точный, а каждая пачка выходит с точностью до
+// пробуждения потока. Ёмкость корзины — одна пачка, так что после паузы выгрузка не выбрасывает
+// больше пачки подряд.
+//
+// Не потокобезопасен: им пользуется один поток выгрузки
+class DrainPacer {
+public:
+    static constexpr size_t kMaxBatch = 256;
+
+    // rate — сессий в секунду; batch — сколько сессий выпускать за раз (ёмкость корзины).
+    // Первый маркер готов сразу. Бросает std::invalid_argument при rate <= 0 или batch == 0
+    DrainPacer(double rate, size_t batch, uint64_t now_ns);
+
+    // Пачка для темпа rate: то, что набегает за миллисекунду (от 1 до kMaxBatch) — при высоком
+    // темпе блокировки шардов и CDR идут пачками, при низком сессии выходят по одной
+    static size_t batch_for(double rate) noexcept;
+
+    // Сколько маркеров готово к моменту now_ns (не больше пачки)
+    size_t available(uint64_t now_ns) const noexcept;
+
+    // Когда будут готовы n маркеров (n не больше пачки)
+    uint64_t ready_at(size_t n) const noexcept;
+
+    // Забирает n маркеров (готовых к now_ns)
+    void take(size_t n, uint64_t now_ns) noexcept;
+
+    // Возвращает n маркеров, которые не понадобились (сессия уже исчезла)
+    void give_back(size_t n) noexcept;
+
+    size_t batch() const noexcept { return batch_; }
+
+private:
+    // Время отсчитывается от origin_ns_ в double: интервал при любом темпе дробный, без округления
+    double   interval_ns_;
+    size_t   batch_;
+    uint64_t origin_ns_;
+    double   empty_at_;  // Момент, когда корзина была (или будет) пуста
+};
+
+} // namespace pgw
@@ -0,0 +1,47 @@
+// include/pgw/event_loop.hpp
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <unordered_map>
+
+namespace pgw {
+
+// Цикл событий на epoll с пробуждением через eventfd
+// Позволяет ждать готовности нескольких дескрипторов (UDP сокет, таймеры, HTTP)
+// без опроса по таймеру; stop() будит поток мгновенно
+class EventLoop {
+public:
+    // Обработчик событий дескриптора; получает маску событий epoll (EPOLLIN, EPOLLERR, ...)
+    using Handler = std::function<void(uint32_t events)>;
+
+    // Создаёт epoll и eventfd; при ошибке бросает std::runtime_error
+    EventLoop();
+
+    // Закрывает epoll и eventfd (зарегистрированные дескрипторы не закрываются)
+    ~EventLoop();
+
+    EventLoop(const EventLoop&) = delete;
+    EventLoop& operator=(const EventLoop&) = delete;
+
+    // Регистрирует дескриптор с маской событий; вызывать до run() или из обработчика
+    void add(int fd, uint32_t events, Handler handler);
+
+    // Снимает дескриптор с наблюдения
+    void remove(int fd);
+
+    // Обрабатывает события, пока не будет вызван stop()
+    void run();
+
+    // Потокобезопасная остановка: будит run() через eventfd
+    void stop();
+
+private:
+    int  epoll_fd_ = -1;  // Дескриптор epoll
+    int  wake_fd_  = -1;  // eventfd для пробуждения при остановке
+    std::atomic<bool> stop_{false};  // Флаг остановки цикла
+    std::unordered_map<int, Handler> handlers_;  // Обработчики по дескрипторам
+};
+
+} // namespace pgw
@@ -0,0 +1,140 @@
+// include/pgw/flat_session_store.hpp
+#pragma once
+
+#include "pgw/session_store.hpp"
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+
+namespace pgw {
+
+// Хранилище сессий в памяти на плоской хеш-таблице с открытой адресацией (Robin Hood)
+//
+// Сессия — запись фиксированного размера (упакованный IMSI и два срока, 24 байта) прямо в массиве
+// слотов: ни выделения памяти на сессию, ни указателей. Поиск — линейное пробирование от
+// «домашнего» слота ключа; по правилу Robin Hood запись, ушедшая от дома дальше, вытесняет более
+// близкую, поэтому цепочки короткие, а поиск отсутствующего IMSI обрывается досрочно.
+// Удаление — обратным сдвигом хвоста цепочки, без надгробий: поток создания и истечения
+// сессий не засоряет таблицу. Сканирование сроков (load_*, cleanup) идёт подряд по массиву.
+//
+// Массив выделяется через mmap, по желанию — на огромных страницах (2 МБ): сначала MAP_HUGETLB,
+// а если пул huge pages не настроен — прозрачные огромные страницы (madvise). На миллионах сессий
+// это убирает промахи TLB при случайном доступе.
+// При заполнении больше 7/8 таблица удваивается (пауза на перестроение); чтобы её не было,
+// ёмкость задаётся заранее.
+//
+// Чтение не берёт мьютекс и не задерживает запись. Слоты разбиты на группы по 64, у каждой —
+// счётчик версий (seqlock): запись делает счётчик затронутых групп нечётным на время изменения,
+// читатель копирует нужные слоты и повторяет чтение, если версия группы изменилась. Писатели
+// между собой по-прежнему упорядочены мьютексом. При росте публикуется новая таблица, а старая
+// живёт до разрушения хранилища (читатель мог успеть взять на неё указатель); вместе прежние
+// таблицы меньше текущей. Обход всех сессий (load_*) согласован внутри группы, но не между
+// группами: сессия, сдвинутая через границу групп во время обхода, может выпасть из снимка
+// или попасть в него дважды
+class FlatSessionStore : public ISessionStore {
+public:
+    // capacity — сколько сессий таблица примет без перестроения (0 — минимальный размер);
+    // huge_pages — размещать таблицу на огромных страницах (размер округляется до 2 МБ).
+    // Бросает std::system_error, если память не выделена
+    explicit FlatSessionStore(size_t capacity = 0, bool huge_pages = false);
+    ~FlatSessionStore() override;
+
+    FlatSessionStore(const FlatSessionStore&) = delete;
+    FlatSessionStore& operator=(const FlatSessionStore&) = delete;
+
+    std::vector<StoredSession> load_sessions(EpochMs now) override;
+    bool save_session(const StoredSession& s) override;
+    bool delete_session(Imsi imsi) override;
+    bool session_exists(Imsi imsi) override;
+    std::optional<StoredSession> get_session(Imsi imsi) override;
+    void cleanup_expired_sessions(EpochMs now) override;
+    std::vector<StoredSession> load_expired_sessions(EpochMs now) override;
+
+    UpsertResult upsert(const StoredSession& s) override;
+    std::vector<UpsertResult> upsert_batch(std::span<const StoredSession> sessions) override;
+    size_t delete_batch(std::span<const Imsi> imsis) override;
+    std::vector<std::optional<StoredSession>> lookup_batch(std::span<const Imsi> imsis) override;
+
+    // Чтение без мьютекса (load_sessions, get_session, session_exists, lookup_batch,
+    // load_expired_sessions) — вызывающему не нужно блокировать хранилище для чтения
+    bool concurrent_reads() const noexcept override { return true; }
+
+    // Память всех таблиц (выделено) и записей сессий (занято)
+    MemoryUsage memory_usage() override;
+
+    // Число сессий
+    size_t size() const noexcept { return size_.load(std::memory_order_relaxed); }
+
+    // Число слотов таблицы
+    size_t slot_count() const noexcept { return table_.load(std::memory_order_acquire)->mask + 1; }
+
+    // Лежит ли таблица на огромных страницах (MAP_HUGETLB или принятый madvise)
+    bool huge_pages() const noexcept { return table_.load(std::memory_order_acquire)->huge; }
+
+private:
+    // Слот таблицы; key == 0 (невалидный IMSI) — слот пуст, поэтому свежие нулевые страницы mmap
+    // уже являются пустой таблицей. Поля, которые читаются без мьютекса, пишутся атомарно
+    // (std::atomic_ref, relaxed): согласованность записи целиком обеспечивает seqlock группы
+    struct Slot {
+        uint64_t key;
+        EpochMs  created_at;
+        EpochMs  expires_at;
+    };
+    static_assert(sizeof(Slot) == 24, "Slot must stay a 24-byte POD record");
+
+    static constexpr size_t   kNotFound  = SIZE_MAX;
+    static constexpr unsigned kGroupBits = 6;  // 64 слота на счётчик версий
+
+    // Массив слотов и счётчики версий его групп
+    struct Table {
+        Slot*    slots = nullptr;
+        size_t   bytes = 0;       // Размер отображения
+        bool     huge  = false;
+        size_t   mask  = 0;       // Число слотов - 1 (степень двойки)
+        unsigned shift = 64;      // 64 - log2(число слотов)
+        size_t   group_mask = 0;  // Число групп - 1
+        std::unique_ptr<std::atomic<uint32_t>[]> seq;
+
+        ~Table();
+
+        // Домашний слот ключа: старшие биты перемешанного хеша. Младшие биты std::hash<Imsi>
+        // у всех сессий одного шарда менеджера совпадают — по ним индексировать нельзя
+        size_t home(uint64_t key) const noexcept {
+            return size_t((std::hash<Imsi>{}(Imsi::from_packed(key)) * 0x9E3779B97F4A7C15ull) >> shift);
+        }
+        // Насколько запись в слоте i ушла от своего домашнего слота
+        size_t distance(uint64_t key, size_t i) const noexcept { return (i - home(key)) & mask; }
+        size_t group(size_t i) const noexcept { return (i >> kGroupBits) & group_mask; }
+    };
+
+    // Чтение без мьютекса: слот по ключу (пусто, если нет)
+    std::optional<Slot> read(uint64_t key) const noexcept;
+    // Чтение без мьютекса: все записи, для которых keep(запись) истинно
+    template <typename Pred>
+    std::vector<StoredSession> read_all(Pred keep) const;
+
+    // Далее — под захваченным мьютексом
+    size_t find(uint64_t key) const noexcept;
+    void   insert_new(Table& t, Slot rec, bool shared) noexcept;  // Ключа в таблице нет, место есть
+    void   erase_at(size_t i) noexcept;
+    bool   reserve_one();                  // Место под ещё одну запись (при необходимости — удвоение)
+    UpsertResult upsert_locked(const StoredSession& s);
+    void   rehash(size_t slots);
+
+    // Открывает (делает нечётными) и закрывает счётчики групп, покрывающих len слотов от first
+    static void write_begin(Table& t, size_t first, size_t len) noexcept;
+    static void write_end(Table& t, size_t first, size_t len) noexcept;
+
+    std::unique_ptr<Table> allocate(size_t slots);
+
+    mutable std::mutex mtx_;                    // Упорядочивает писателей
+    const bool         want_huge_;
+    std::atomic<Table*> table_{nullptr};        // Текущая таблица (для читателей)
+    std::vector<std::unique_ptr<Table>> tables_;  // Все выделенные таблицы; back() — текущая
+    std::atomic<size_t> size_{0};
+    size_t             max_load_ = 0;           // Порог удвоения: 7/8 слотов
+};
+
+} // namespace pgw
@@ -0,0 +1,177 @@
+// include/pgw/gtpv2.hpp
+#pragma once
+
+#include "pgw/imsi.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <optional>
+#include <span>
+#include <unordered_map>
+
+namespace pgw {
+
+// Разбор и формирование сообщений GTPv2-C (3GPP TS 29.274) на пути приёма UDP
+//
+// Разбор не копирует и не выделяет память: заголовок и нужные PGW поля IE декодируются в GtpMessage,
+// остальное доступно как std::span внутри буфера приёма. Ответы пишутся в буфер вызывающего.
+
+// Типы сообщений (TS 29.274, 8.1), которые обрабатывает сервер
+enum class GtpMessageType : uint8_t {
+    EchoRequest           = 1,
+    EchoResponse          = 2,
+    CreateSessionRequest  = 32,
+    CreateSessionResponse = 33,
+    ModifyBearerRequest   = 34,
+    ModifyBearerResponse  = 35,
+    DeleteSessionRequest  = 36,
+    DeleteSessionResponse = 37,
+};
+
+// Типы IE (TS 29.274, 8.1)
+enum class GtpIeType : uint8_t {
+    Imsi          = 1,
+    Cause         = 2,
+    Recovery      = 3,
+    Ebi           = 73,
+    FTeid         = 87,
+    BearerContext = 93,
+};
+
+// Значения Cause (TS 29.274, 8.4)
+enum class GtpCause : uint8_t {
+    RequestAccepted      = 16,
+    ContextNotFound      = 64,
+    InvalidLength        = 67,
+    NoResourcesAvailable = 73,
+    MandatoryIeIncorrect = 69,
+    MandatoryIeMissing   = 70,
+    RequestRejected      = 94,
+};
+
+// Тип интерфейса в F-TEID: S5/S8 PGW GTP-C (TS 29.274, 8.22)
+static constexpr uint8_t kGtpFTeidS5S8PgwGtpc = 7;
+
+// Заголовок с TEID: флаги, тип, длина, TEID, 3 байта sequence, запасной байт
+static constexpr size_t kGtpHeaderSize       = 12;
+// Заголовок без TEID (Echo)
+static constexpr size_t kGtpShortHeaderSize  = 8;
+// Заголовок IE: тип, длина (2 байта), запасные биты + instance
+static constexpr size_t kGtpIeHeaderSize     = 4;
+// Наибольший ответ, который строит build_gtpv2_response (Create Session Response)
+static constexpr size_t kGtpMaxResponseSize  = 64;
+
+// Один IE; value — данные IE внутри пакета
+struct GtpIe {
+    uint8_t                  type     = 0;
+    uint8_t                  instance = 0;
+    std::span<const uint8_t> value;
+};
+
+// Последовательный обход IE без копирования
+// next() возвращает false в конце списка или когда IE выходит за границу буфера (тогда malformed())
+class GtpIeReader {
+public:
+    explicit GtpIeReader(std::span<const uint8_t> ies) noexcept : rest_(ies) {}
+
+    bool next(GtpIe& ie) noexcept {
+        if (rest_.empty())
+            return false;
+        if (rest_.size() < kGtpIeHeaderSize) {
+            malformed_ = true;
+            return false;
+        }
+        size_t len = (size_t(rest_[1]) << 8) | rest_[2];
+        if (rest_.size() < kGtpIeHeaderSize + len) {
+            malformed_ = true;
+            return false;
+        }
+        ie.type     = rest_[0];
+        ie.instance = rest_[3] & 0x0F;
+        ie.value    = rest_.subspan(kGtpIeHeaderSize, len);
+        rest_       = rest_.subspan(kGtpIeHeaderSize + len);
+        return true;
+    }
+
+    bool malformed() const noexcept { return malformed_; }
+
+private:
+    std::span<const uint8_t> rest_;
+    bool                     malformed_ = false;
+};
+
+// Результат разбора
+enum class GtpParseStatus {
+    Ok,             // Сообщение разобрано
+    InvalidHeader,  // Не GTPv2-C или длина в заголовке больше датаграммы — ответить нельзя
+    InvalidLength,  // Заголовок верный, но IE выходит за границу сообщения — ответ с Cause "Invalid Length"
+};
+
+// Разобранное сообщение: заголовок и IE, нужные PGW
+// Все поля, кроме ies, — значения; ies указывает в буфер приёма и действителен, пока жив буфер
+struct GtpMessage {
+    uint8_t  type     = 0;      // GtpMessageType
+    bool     has_teid = false;  // Флаг T: заголовок содержит TEID
+    uint32_t teid     = 0;      // TEID получателя (наш) из заголовка
+    uint32_t sequence = 0;      // 24-битный номер транзакции, повторяется в ответе
+
+    std::span<const uint8_t> ies;  // IE сообщения
+
+    Imsi     imsi;                  // IE IMSI (Create Session); невалиден, если IE нет или он испорчен
+    bool     has_imsi        = false;
+    bool     has_sender_teid = false;
+    uint32_t sender_teid     = 0;   // TEID из Sender F-TEID for Control Plane — TEID заголовка наших ответов
+    uint8_t  ebi             = 0;   // EBI: из Bearer Context (Create/Modify) или Linked EBI (Delete)
+};
+
+// Похожа ли датаграмма на GTPv2-C: прежний протокол — голый BCD IMSI не длиннее 8 байт
+inline bool looks_like_gtpv2(const uint8_t* data, size_t len) noexcept {
+    return len >= kGtpShortHeaderSize + 1 && (data[0] >> 5) == 2;
+}
+
+// Разбирает датаграмму GTPv2-C; GtpMessage заполняется при Ok и InvalidLength
+GtpParseStatus parse_gtpv2(const uint8_t* data, size_t len, GtpMessage& msg) noexcept;
+
+// Поля ответа, которые решает обработчик
+struct GtpResponse {
+    GtpCause cause       = GtpCause::RequestAccepted;
+    uint32_t peer_teid   = 0;  // TEID в заголовке ответа (TEID управления пира; 0 — неизвестен)
+    uint32_t local_teid  = 0;  // Наш TEID управления для Sender F-TEID (Create Session Response)
+    uint32_t local_ipv4  = 0;  // Наш IPv4 для Sender F-TEID, в сетевом порядке байт
+};
+
+// Формирует ответ на запрос req в out (не меньше kGtpMaxResponseSize байт), возвращает длину;
+// 0 — на сообщение такого типа сервер не отвечает
+size_t build_gtpv2_response(const GtpMessage& req, const GtpResponse& resp, uint8_t* out) noexcept;
+
+// Туннели управления: наш TEID ↔ IMSI и TEID пира
+// Create Session выделяет TEID (повторный запрос того же IMSI переиспользует его),
+// Modify Bearer и Delete Session находят абонента по TEID из заголовка.
+// Туннель истёкшей по таймауту сессии удаляется при следующем Modify Bearer / Delete Session
+class GtpTunnelTable {
+public:
+    struct Tunnel {
+        Imsi     imsi;
+        uint32_t peer_teid = 0;
+    };
+
+    // Выделяет (или обновляет) туннель абонента, возвращает наш TEID (никогда не 0)
+    uint32_t open(Imsi imsi, uint32_t peer_teid);
+
+    // Туннель по нашему TEID
+    std::optional<Tunnel> find(uint32_t local_teid) const;
+
+    // Удаляет туннель; false — его не было
+    bool close(uint32_t local_teid);
+
+    // Число открытых туннелей
+    size_t size() const;
+
+private:
+    mutable std::mutex                   mtx_;
+    std::unordered_map<uint32_t, Tunnel> by_teid_;
+    std::unordered_map<Imsi, uint32_t>   by_imsi_;
+    uint32_t                             next_teid_ = 1;
+};
+
+} // namespace pgw
@@ -1,11 +1,20 @@
 // include/pgw/http_api.hpp
 #pragma once
 
+#include <atomic>
 #include <cstdint>
 #include <thread>
 #include <functional>
+#include <map>
+#include <mutex>
+#include <string>
+#include <nlohmann/json.hpp>
 #include "pgw/session_manager.hpp"
 
+namespace httplib {
+class Server;
+}
+
 namespace pgw {
 
 // Класс, представляющий HTTP API для взаимодействия с сервером PGW
@@ -17,6 +26,11 @@ public:
             SessionManager& sessions,  // Менеджер сессий, с которым будет работать API
             std::function<void()> udp_stop_cb,  // Callback для остановки UDP сервера
             size_t graceful_rate);  // Скорость завершения сессий при остановке
+    ~HttpApi();
+
+    // Регистрирует источник статистики, который отдаётся в GET /stats под ключом name
+    // Вызывать до start(): обработчики читают список источников без синхронизации
+    void add_stats_source(std::string name, std::function<nlohmann::json()> source);
 
     // Метод для запуска HTTP сервера
     void start();
@@ -27,6 +41,12 @@ public:
     // Метод для ожидания завершения работы потока сервера
     void join();
 
+    // Останов, как по GET /stop: UDP-сервер останавливается сразу, сессии выгружаются в фоне,
+    // после выгрузки останавливается HTTP-сервер и поток сервера завершается (join() возвращает).
+    // Процесс не завершается: main выходит штатно, и деструкторы хранилищ и CdrWriter записывают
+    // всё, что накопили. false — останов уже запрошен
+    bool request_stop();
+
 private:
     // Вспомогательный метод для запуска HTTP сервера в отдельном потоке
     void run_server();
@@ -35,7 +55,13 @@ private:
     SessionManager&       sessions_;  // Ссылка на объект менеджера сессий
     size_t                graceful_rate_;  // Скорость завершения сессий при остановке
     std::function<void()> udp_stop_cb_;  // Callback-функция для остановки UDP сервера
+    std::map<std::string, std::function<nlohmann::json()>> stats_sources_;  // Источники данных для /stats
     std::thread           thread_;  // Поток для работы HTTP сервера
+    std::thread           drain_thread_;  // Поток graceful stop, запущенный /stop
+    std::mutex            drain_mtx_;     // Защищает drain_thread_ и server_
+    std::atomic<bool>     stop_requested_{false};  // Ставится под drain_mtx_
+    std::atomic<bool>     listen_done_{true};  // run_server вышел из цикла listen (или не запущен)
+    httplib::Server*      server_ = nullptr;  // Сервер, который слушает run_server (под drain_mtx_)
     bool                  running_ = false;  // Флаг, показывающий, что сервер работает
 };
 
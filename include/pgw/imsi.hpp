@@ -0,0 +1,163 @@
+// include/pgw/imsi.hpp
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <string>
+#include <string_view>
+#include <spdlog/fmt/fmt.h>
+
+namespace pgw {
+
+// IMSI абонента, упакованный в одно 64-битное значение
+// Младшие 60 бит — до 15 цифр по 4 бита (первая цифра в старшем полубайте, как в записи 0x001010123456789),
+// старшие 4 бита — число цифр. Ведущие нули значимы: "00101…" и "101…" — разные IMSI.
+// Значение 0 (ноль цифр) — невалидный IMSI.
+// Строка получается только на границах: в логах, CDR-файле, SQLite и HTTP
+class Imsi {
+public:
+    static constexpr size_t kMaxDigits = 15;
+
+    // Невалидный IMSI
+    constexpr Imsi() noexcept = default;
+
+    // Из упакованного значения (см. packed())
+    static constexpr Imsi from_packed(uint64_t packed) noexcept { return Imsi(packed); }
+
+    // Из BCD (TBCD) с провода: младший полубайт — первая цифра, 0xF — заполнитель.
+    // IMSI занимает не больше 8 байт; при более длинных данных, недопустимой цифре или пустом
+    // номере — невалидный IMSI
+    static Imsi from_bcd(const uint8_t* data, size_t len) noexcept {
+        if (len == 0 || len > 8)
+            return Imsi();
+
+        // Недостающие байты заполняем 0xFF, чтобы они считались заполнителем
+        uint8_t bytes[8];
+        std::memset(bytes, 0xFF, sizeof(bytes));
+        std::memcpy(bytes, data, len);
+        return from_bcd8(bytes);
+    }
+
+    // Из ровно 8 байт BCD (короткий номер дополнен 0xFF) — без ветвлений по цифрам
+    // Скалярный вариант ядра decode_bcd_batch (см. imsi_batch.hpp), результаты совпадают побитно
+    static Imsi from_bcd8(const uint8_t* bcd) noexcept {
+        uint64_t le;
+        std::memcpy(&le, bcd, sizeof(le));
+
+        // Первый байт — в старший, затем полубайты местами: цифры встают в порядке записи
+        uint64_t x = __builtin_bswap64(le);
+        x = ((x & 0x0F0F0F0F0F0F0F0Full) << 4) | ((x >> 4) & 0x0F0F0F0F0F0F0F0Full);
+
+        // Маска заполнителя: хвост из полубайтов 0xF (fill полубайтов)
+        uint64_t not_f  = nibble_nonzero(~x);              // Бит 4i: полубайт i не равен 0xF
+        uint64_t lowest = not_f & (0 - not_f);             // Младший полубайт-не-заполнитель
+        uint64_t filler = lowest - 1;                      // Все биты ниже него (при not_f == 0 — все 64)
+        unsigned fill_bits = unsigned(__builtin_popcountll(filler));
+
+        uint64_t bad = nibble_above_9(x) & ~filler;
+        if (bad != 0 || fill_bits < 4 || fill_bits == 64)
+            return Imsi();
+        uint64_t digits = (64 - fill_bits) / 4;
+        return Imsi((digits << 60) | (x >> fill_bits));
+    }
+
+    // Из строки цифр (конфигурация, HTTP, SQLite); при ошибке — невалидный IMSI
+    static Imsi from_string(std::string_view s) noexcept {
+        if (s.empty() || s.size() > kMaxDigits)
+            return Imsi();
+        uint64_t value = 0;
+        for (char c : s) {
+            if (c < '0' || c > '9')
+                return Imsi();
+            value = (value << 4) | uint64_t(c - '0');
+        }
+        return Imsi((uint64_t(s.size()) << 60) | value);
+    }
+
+    constexpr bool     valid()  const noexcept { return packed_ != 0; }
+    constexpr uint64_t packed() const noexcept { return packed_; }
+    constexpr size_t   digits() const noexcept { return size_t(packed_ >> 60); }
+
+    // Пишет цифры в out (не меньше kMaxDigits байт), возвращает их число; без завершающего нуля
+    size_t to_chars(char* out) const noexcept {
+        size_t n = digits();
+        for (size_t i = 0; i < n; ++i) {
+            out[i] = char('0' + ((packed_ >> ((n - 1 - i) * 4)) & 0xF));
+        }
+        return n;
+    }
+
+    std::string to_string() const {
+        char buf[kMaxDigits];
+        return std::string(buf, to_chars(buf));
+    }
+
+    // Пишет BCD (TBCD) в out (не меньше 8 байт), возвращает число значащих байт
+    // Неиспользуемые полубайты заполняются 0xF; операция обратна from_bcd8
+    size_t to_bcd(uint8_t* out) const noexcept {
+        size_t   n = digits();
+        if (n == 0)
+            return 0;
+        unsigned fill_bits = unsigned(64 - 4 * n);
+        uint64_t x = (packed_ & kDigitsMask) << fill_bits;
+        x |= (uint64_t(1) << fill_bits) - 1;
+        x = ((x & 0x0F0F0F0F0F0F0F0Full) << 4) | ((x >> 4) & 0x0F0F0F0F0F0F0F0Full);
+        uint64_t le = __builtin_bswap64(x);
+        std::memcpy(out, &le, sizeof(le));
+        return (n + 1) / 2;
+    }
+
+    friend constexpr bool operator==(Imsi a, Imsi b) noexcept { return a.packed_ == b.packed_; }
+    friend constexpr bool operator!=(Imsi a, Imsi b) noexcept { return a.packed_ != b.packed_; }
+    friend constexpr bool operator<(Imsi a, Imsi b) noexcept { return a.packed_ < b.packed_; }
+
+private:
+    constexpr explicit Imsi(uint64_t packed) noexcept : packed_(packed) {}
+
+    static constexpr uint64_t kDigitsMask = (uint64_t(1) << 60) - 1;
+
+    // Бит 4i выставлен, если полубайт i не нулевой
+    static constexpr uint64_t nibble_nonzero(uint64_t x) noexcept {
+        return (x | (x >> 1) | (x >> 2) | (x >> 3)) & 0x1111111111111111ull;
+    }
+
+    // Бит 4i выставлен, если полубайт i больше 9: у таких выставлен бит 3 и хотя бы один из битов 2, 1
+    static constexpr uint64_t nibble_above_9(uint64_t x) noexcept {
+        uint64_t b3 = (x >> 3) & 0x1111111111111111ull;
+        uint64_t b2 = (x >> 2) & 0x1111111111111111ull;
+        uint64_t b1 = (x >> 1) & 0x1111111111111111ull;
+        return b3 & (b2 | b1);
+    }
+
+    uint64_t packed_ = 0;
+};
+
+} // namespace pgw
+
+namespace std {
+
+// Хеш для unordered-контейнеров: перемешиваем биты, т.к. соседние IMSI различаются младшими цифрами
+template <>
+struct hash<pgw::Imsi> {
+    size_t operator()(pgw::Imsi imsi) const noexcept {
+        uint64_t x = imsi.packed();
+        x ^= x >> 33;
+        x *= 0xFF51AFD7ED558CCDull;
+        x ^= x >> 33;
+        return size_t(x);
+    }
+};
+
+} // namespace std
+
+// Форматирование в spdlog/fmt без промежуточной std::string
+template <>
+struct fmt::formatter<pgw::Imsi> : fmt::formatter<std::string_view> {
+    template <typename FormatContext>
+    auto format(const pgw::Imsi& imsi, FormatContext& ctx) const {
+        char buf[pgw::Imsi::kMaxDigits];
+        return fmt::formatter<std::string_view>::format(std::string_view(buf, imsi.to_chars(buf)), ctx);
+    }
+};
@@ -0,0 +1,31 @@
+// include/pgw/imsi_batch.hpp
+#pragma once
+
+#include "pgw/imsi.hpp"
+#include <cstddef>
+#include <cstdint>
+
+namespace pgw {
+
+// Реализация пакетного разбора BCD
+enum class BcdKernel {
+    Scalar,  // По одному IMSI (Imsi::from_bcd8)
+    Avx2     // По четыре IMSI за итерацию в 256-битных регистрах
+};
+
+// Ядро, выбранное по возможностям процессора (определяется один раз при первом вызове)
+BcdKernel bcd_batch_kernel() noexcept;
+
+// Имя ядра для логов и бенчмарка
+const char* to_string(BcdKernel kernel) noexcept;
+
+// Разбирает count IMSI из подряд лежащих 8-байтовых BCD-полей (bcd[8 * i .. 8 * i + 7];
+// короткий номер дополнен 0xFF). out[i] — упакованный IMSI или невалидный при недесятичном полубайте;
+// valid_mask (ceil(count / 64) слов) получает бит i для каждого валидного IMSI.
+// Возвращает число валидных IMSI
+size_t decode_bcd_batch(const uint8_t* bcd, size_t count, Imsi* out, uint64_t* valid_mask) noexcept;
+
+// То же с явным выбором ядра (для тестов и бенчмарка); Avx2 без поддержки процессора — Scalar
+size_t decode_bcd_batch(BcdKernel kernel, const uint8_t* bcd, size_t count, Imsi* out, uint64_t* valid_mask) noexcept;
+
+} // namespace pgw
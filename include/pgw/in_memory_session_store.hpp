@@ -9,15 +9,18 @@ namespace pgw {
 
 // Класс для хранения сессий в памяти, реализующий интерфейс ISessionStore
 // Этот класс управляет сессиями в оперативной памяти (в отличие от других возможных вариантов, таких как база данных)
+// Узлы хеш-таблицы берутся из собственного пула (SlabPool), а не из malloc: каждая сессия
+// занимает ровно один узел фиксированного размера
 class InMemorySessionStore : public ISessionStore {
 public:
-    InMemorySessionStore() = default;  // Конструктор по умолчанию для инициализации объекта
+    // capacity — сколько сессий разместить заранее (узлы пула и корзины таблицы); 0 — по мере роста
+    explicit InMemorySessionStore(size_t capacity = 0);
     ~InMemorySessionStore() override = default;  // Деструктор для правильного освобождения ресурсов
 
     // Метод для загрузки активных сессий
     // Этот метод возвращает все сессии, которые считаются активными на данный момент
     // Параметр 'now' может быть использован для фильтрации сессий по времени
-    std::vector<StoredSession> load_sessions(const std::string& now) override;
+    std::vector<StoredSession> load_sessions(EpochMs now) override;
 
     // Метод для сохранения или обновления сессии
     // Сохраняет новую сессию или обновляет существующую в контейнере
@@ -25,25 +28,46 @@ public:
 
     // Метод для удаления сессии
     // Удаляет сессию из контейнера по уникальному IMSI
-    bool delete_session(const std::string& imsi) override;
+    bool delete_session(Imsi imsi) override;
 
     // Метод для проверки существования сессии
     // Проверяет, есть ли сессия с данным IMSI в хранилище
-    bool session_exists(const std::string& imsi) override;
+    bool session_exists(Imsi imsi) override;
+
+    // Метод для получения сессии по IMSI
+    // Один поиск в хеш-таблице, без копирования остальных сессий
+    std::optional<StoredSession> get_session(Imsi imsi) override;
 
     // Метод для удаления просроченных сессий
     // Удаляет сессии, которые истекли, но не возвращает их для дальнейшей обработки
-    void cleanup_expired_sessions(const std::string& now) override;
+    void cleanup_expired_sessions(EpochMs now) override;
 
     // Метод для загрузки всех просроченных сессий
     // Возвращает все сессии, которые просрочены, для последующего логирования
-    std::vector<StoredSession> load_expired_sessions(const std::string& now) override;
+    std::vector<StoredSession> load_expired_sessions(EpochMs now) override;
+
+    // Метод для создания или продления сессии одним поиском в хеш-таблице
+    UpsertResult upsert(const StoredSession& s) override;
+
+    // Пакетные методы: вся пачка обрабатывается под одним захватом мьютекса
+    std::vector<UpsertResult> upsert_batch(std::span<const StoredSession> sessions) override;
+    size_t delete_batch(std::span<const Imsi> imsis) override;
+    std::vector<std::optional<StoredSession>> lookup_batch(std::span<const Imsi> imsis) override;
+
+    // Память пула узлов и массива корзин
+    MemoryUsage memory_usage() override;
 
 private:
+    // upsert без блокировки (мьютекс захвачен вызывающим)
+    UpsertResult upsert_locked(const StoredSession& s);
+
     std::mutex mtx_;  // Мьютекс для синхронизации доступа к данным (сессиям) между потоками
     // Контейнер для хранения сессий в памяти
-    // Ключом является IMSI абонента, а значением — структура StoredSession, представляющая саму сессию
-    std::unordered_map<std::string, StoredSession> sessions_;
+    // Ключом является упакованный IMSI абонента, а значением — структура StoredSession, представляющая саму сессию
+    using Map = std::unordered_map<Imsi, StoredSession, std::hash<Imsi>, std::equal_to<Imsi>,
+                                   SlabAllocator<std::pair<const Imsi, StoredSession>>>;
+    SlabPool pool_;  // Узлы таблицы (объявлен раньше таблицы — живёт дольше)
+    Map      sessions_;
 };
 
 } // namespace pgw
@@ -0,0 +1,93 @@
+// include/pgw/io_uring.hpp
+#pragma once
+
+#include <linux/io_uring.h>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace pgw {
+
+// Минимальная обёртка над io_uring поверх системных вызовов (без liburing)
+// Даёт ровно то, что нужно UDP серверу: очередь отправки (SQ), очередь завершений (CQ)
+// и группу предоставленных буферов (IORING_OP_PROVIDE_BUFFERS) для multishot recvmsg.
+// Объект используется одним потоком.
+class IoUring {
+public:
+    // user_data служебных SQE возврата буферов; CQE с ним приходит только при ошибке
+    static constexpr uint64_t kProvideBuffersUserData = ~0ull;
+
+    // Создаёт кольцо на entries SQE и cq_entries CQE
+    // При отсутствии поддержки в ядре бросает std::system_error с кодом errno
+    IoUring(unsigned entries, unsigned cq_entries);
+    ~IoUring();
+
+    IoUring(const IoUring&) = delete;
+    IoUring& operator=(const IoUring&) = delete;
+
+    // Свободный SQE (обнулённый) или nullptr, если очередь отправки заполнена
+    io_uring_sqe* get_sqe() noexcept;
+
+    // Передаёт ядру подготовленные SQE и ждёт не менее wait_nr завершений
+    // Возвращает число отправленных SQE или -errno
+    int submit_and_wait(unsigned wait_nr) noexcept;
+
+    // Число готовых CQE
+    unsigned cq_ready() const noexcept;
+
+    // i-й готовый CQE (0 <= i < cq_ready())
+    io_uring_cqe* cqe_at(unsigned i) noexcept;
+
+    // Освобождает n обработанных CQE
+    void cq_advance(unsigned n) noexcept;
+
+    // Выделяет count буферов по buf_size байт и передаёт их ядру в группе group_id
+    // Вызывается до постановки других запросов; при ошибке бросает std::system_error
+    void setup_buffers(uint16_t group_id, unsigned count, unsigned buf_size);
+
+    // Адрес буфера с идентификатором bid
+    uint8_t* buffer(uint16_t bid) noexcept { return buf_base_ + size_t(bid) * buf_size_; }
+
+    // Помечает буфер как свободный (вернётся ядру при commit_buffers())
+    void recycle_buffer(uint16_t bid);
+
+    // Ставит в очередь SQE возврата свободных буферов; подряд идущие bid объединяются в один SQE
+    // Уходят ядру при следующем submit_and_wait()
+    void commit_buffers() noexcept;
+
+    // Дескриптор кольца
+    int fd() const noexcept { return ring_fd_; }
+
+private:
+    int      ring_fd_ = -1;  // Дескриптор io_uring
+
+    // Отображения колец в память
+    void*    sq_ring_ = nullptr;
+    size_t   sq_ring_size_ = 0;
+    void*    cq_ring_ = nullptr;
+    size_t   cq_ring_size_ = 0;
+    io_uring_sqe* sqes_ = nullptr;
+    size_t   sqes_size_ = 0;
+
+    // Очередь отправки
+    unsigned* sq_head_ = nullptr;
+    unsigned* sq_tail_ = nullptr;
+    unsigned  sq_mask_ = 0;
+    unsigned  sq_entries_ = 0;
+    unsigned  sqe_tail_ = 0;       // Локальный хвост (подготовленные, но не опубликованные SQE)
+
+    // Очередь завершений
+    unsigned* cq_head_ = nullptr;
+    unsigned* cq_tail_ = nullptr;
+    unsigned  cq_mask_ = 0;
+    io_uring_cqe* cqes_ = nullptr;
+
+    // Предоставленные буферы
+    uint8_t* buf_base_ = nullptr;  // Начало области буферов
+    size_t   buf_area_size_ = 0;   // Размер отображения
+    unsigned buf_size_ = 0;
+    uint16_t buf_group_ = 0;
+    std::vector<uint16_t> buf_free_;  // Освобождённые, но ещё не возвращённые ядру bid
+};
+
+} // namespace pgw
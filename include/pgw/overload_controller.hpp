@@ -0,0 +1,102 @@
+// include/pgw/overload_controller.hpp
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <nlohmann/json.hpp>
+
+namespace pgw {
+
+// Пороги перегрузки: вход — при превышении любого high, выход — когда все сигналы ниже low
+// (гистерезис, чтобы состояние не переключалось на каждой выборке)
+struct OverloadThresholds {
+    double queue_high   = 0.75;  // Заполнение очереди обработки конвейера (доля ёмкости)
+    double queue_low    = 0.25;
+    double backlog_high = 0.75;  // Заполнение приёмного буфера сокета (доля rcvbuf, наибольшая по worker'ам)
+    double backlog_low  = 0.25;
+    std::chrono::microseconds latency_high{20000};  // Сглаженная задержка хранилища сессий
+    std::chrono::microseconds latency_low{5000};
+};
+
+// Одна выборка сигналов нагрузки
+struct OverloadSample {
+    double   queue_fill    = 0;  // 0..1
+    double   backlog_fill  = 0;  // 0..1
+    uint64_t socket_drops  = 0;  // Датаграмм, отброшенных ядром из-за полного буфера (накопительно)
+};
+
+// Снимок состояния для HTTP
+struct OverloadState {
+    bool        overloaded       = false;
+    std::string reason;                  // Какой сигнал перевёл в перегрузку ("" — норма)
+    double      queue_fill       = 0;
+    double      backlog_fill     = 0;
+    uint64_t    socket_drops     = 0;
+    uint64_t    store_latency_us = 0;
+    uint64_t    transitions      = 0;    // Сколько раз сервер входил в перегрузку
+    uint64_t    shed             = 0;    // Новых подключений отклонено ответом "busy"
+    OverloadThresholds thresholds;
+};
+
+// Функция для сериализации состояния контроллера перегрузки в JSON
+inline void to_json(nlohmann::json& j, const OverloadState& s) {
+    j = {
+        {"overloaded", s.overloaded},
+        {"reason", s.reason},
+        {"queue_fill", s.queue_fill},
+        {"backlog_fill", s.backlog_fill},
+        {"socket_drops", s.socket_drops},
+        {"store_latency_us", s.store_latency_us},
+        {"transitions", s.transitions},
+        {"shed", s.shed},
+        {"thresholds", {
+            {"queue_high", s.thresholds.queue_high},
+            {"queue_low", s.thresholds.queue_low},
+            {"backlog_high", s.thresholds.backlog_high},
+            {"backlog_low", s.thresholds.backlog_low},
+            {"latency_high_us", s.thresholds.latency_high.count()},
+            {"latency_low_us", s.thresholds.latency_low.count()}
+        }}
+    };
+}
+
+// Контроллер перегрузки: по выборкам глубины очереди, заполнения буфера сокета, потерь в ядре
+// и задержки хранилища решает, принимать ли новые сессии.
+// Выборки делает отдельный поток (update()), путь обработки читает только атомарный флаг overloaded()
+class OverloadController {
+public:
+    explicit OverloadController(OverloadThresholds thresholds);
+
+    // Учитывает задержку одного обращения к хранилищу (экспоненциальное сглаживание, вес 1/16)
+    void record_store_latency(std::chrono::nanoseconds latency) noexcept;
+
+    // Новая выборка сигналов; возвращает состояние после неё
+    bool update(const OverloadSample& sample);
+
+    // Перегружен ли сервер — новые подключения получают "busy"
+    bool overloaded() const noexcept { return overloaded_.load(std::memory_order_relaxed); }
+
+    // Учитывает отклонённое подключение
+    void count_shed() noexcept { shed_.fetch_add(1, std::memory_order_relaxed); }
+
+    // Снимок состояния для HTTP
+    OverloadState state() const;
+
+private:
+    const OverloadThresholds thresholds_;
+
+    std::atomic<bool>     overloaded_{false};
+    std::atomic<uint64_t> latency_ewma_ns_{0};
+    std::atomic<uint64_t> shed_{0};
+
+    mutable std::mutex mtx_;  // Защищает последнюю выборку (update() против state())
+    OverloadSample     last_;
+    bool               have_sample_ = false;
+    std::string        reason_;
+    uint64_t           transitions_ = 0;
+};
+
+} // namespace pgw
@@ -0,0 +1,84 @@
+// include/pgw/rate_limiter.hpp
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+namespace pgw {
+
+// Ограничение частоты запросов по IPv4-адресу источника
+//
+// Каждый источник — маркерная корзина в форме GCRA: вместо числа маркеров хранится теоретическое
+// время прихода следующего пакета (TAT). Пакет пропускается, если TAT опережает текущее время
+// не больше чем на (burst - 1) интервалов, после чего TAT сдвигается на один интервал 1 / rate.
+//
+// Таблица фиксированного размера, 4-входовая ассоциативная: набор из четырёх записей занимает
+// одну кэш-линию, так что проверка — один хеш и одна линия. Старение бесплатное: запись с TAT
+// в прошлом — полная корзина, при нехватке места вытесняется запись с самым старым TAT
+// (новый источник начинает с полной корзиной).
+//
+// Не потокобезопасен: у каждого потока приёма свой экземпляр
+class RateLimiter {
+public:
+    static constexpr size_t kWays = 4;
+
+    // rate — пакетов в секунду на источник, burst — сколько пакетов подряд можно принять сверх темпа;
+    // entries — число отслеживаемых источников (округляется вверх до степени двойки, не меньше kWays).
+    // Бросает std::invalid_argument при rate <= 0 или burst == 0
+    RateLimiter(double rate, uint32_t burst, size_t entries = 4096);
+
+    // Проверяет и учитывает пакет источника ip (сетевой порядок байт); now_ns — монотонное время
+    bool allow(uint32_t ip, uint64_t now_ns) noexcept {
+        Set& set = sets_[index(ip)];
+
+        Entry* victim = &set.way[0];
+        for (Entry& e : set.way) {
+            if (e.ip == ip && e.tat != 0)
+                return admit(e, now_ns);
+            if (e.tat < victim->tat)
+                victim = &e;
+        }
+
+        // Источника нет в таблице: занимаем пустую или самую давно неактивную запись
+        victim->ip  = ip;
+        victim->tat = now_ns;
+        return admit(*victim, now_ns);
+    }
+
+    // Монотонное время для allow(); берётся один раз на пачку датаграмм
+    static uint64_t now_ns() noexcept;
+
+    // Число записей таблицы
+    size_t capacity() const noexcept { return (mask_ + 1) * kWays; }
+
+private:
+    struct Entry {
+        uint32_t ip  = 0;
+        uint64_t tat = 0;  // 0 — запись свободна
+    };
+
+    struct alignas(64) Set {
+        Entry way[kWays];
+    };
+
+    size_t index(uint32_t ip) const noexcept {
+        return size_t((ip * 0x9E3779B1u) >> shift_) & mask_;
+    }
+
+    bool admit(Entry& e, uint64_t now_ns) const noexcept {
+        uint64_t tat = e.tat > now_ns ? e.tat : now_ns;
+        if (tat - now_ns > tolerance_ns_)
+            return false;
+        e.tat = tat + interval_ns_;
+        return true;
+    }
+
+    uint64_t               interval_ns_;   // Интервал между пакетами при заданном темпе
+    uint64_t               tolerance_ns_;  // (burst - 1) интервалов
+    size_t                 mask_;
+    unsigned               shift_;
+    std::unique_ptr<Set[]> sets_;
+};
+
+} // namespace pgw
@@ -0,0 +1,38 @@
+// include/pgw/reuseport.hpp
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace pgw {
+
+// Распределение датаграмм между сокетами группы SO_REUSEPORT по IMSI
+//
+// Ядро по умолчанию выбирает сокет по хешу 4-tuple, поэтому пакеты одного абонента
+// с разных портов клиента попадают в разные потоки. CBPF-программа, прикреплённая через
+// SO_ATTACH_REUSEPORT_CBPF, хеширует байты BCD IMSI из полезной нагрузки UDP, так что
+// все пакеты абонента всегда обрабатывает один и тот же worker.
+//
+// Хеш: w0 — первые 4 байта, w1 — последние 4 байта нагрузки (big-endian),
+// h = ((w1 * K1) ^ w0) * K2, индекс = (h >> 16) % workers.
+// Для нагрузки короче 4 байт выбирается сокет 0.
+
+// Индекс worker'а для датаграммы; точное повторение CBPF-программы в пространстве пользователя
+inline uint32_t imsi_steering_index(const uint8_t* payload, size_t len, uint32_t workers) noexcept {
+    if (workers <= 1 || len < 4)
+        return 0;
+    auto be32 = [](const uint8_t* p) {
+        return (uint32_t(p[0]) << 24) | (uint32_t(p[1]) << 16) | (uint32_t(p[2]) << 8) | uint32_t(p[3]);
+    };
+    uint32_t w0 = be32(payload);
+    uint32_t w1 = be32(payload + len - 4);
+    uint32_t h  = ((w1 * 0x9E3779B1u) ^ w0) * 0x85EBCA6Bu;
+    return (h >> 16) % workers;
+}
+
+// Прикрепляет CBPF-программу выбора сокета к группе SO_REUSEPORT, в которую входит fd
+// Индекс сокета в группе определяется порядком bind(), поэтому сокеты привязываются по порядку.
+// Возвращает false (errno выставлен), если ядро не поддерживает SO_ATTACH_REUSEPORT_CBPF
+bool attach_imsi_steering(int fd, uint32_t workers) noexcept;
+
+} // namespace pgw
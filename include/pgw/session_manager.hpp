@@ -3,18 +3,118 @@
 
 #include "pgw/session_store.hpp"  // Подключение интерфейса ISessionStore и структуры StoredSession
 #include "pgw/cdr_writer.hpp"  // Подключение CdrWriter для записи данных CDR
+#include "pgw/clock.hpp"  // Грубые часы для меток времени сессий
+#include "pgw/timing_wheel.hpp"  // Колесо таймеров для истечения сессий
 #include <mutex>
 #include <thread>
 #include <condition_variable>
 #include <chrono>
 #include <memory>
 #include <atomic>
+#include <functional>
+#include <optional>
+#include <span>
+#include <string>
+#include <vector>
+#include <nlohmann/json.hpp>
 
 namespace pgw {
 
+// Статистика истечения сессий для HTTP: сколько сессий ждёт на колёсах таймеров и насколько
+// позже своего срока они были сняты (гистограмма по границам kLagBoundsMs, последняя корзина — всё дольше)
+struct ExpiryStats {
+    static constexpr size_t   kBuckets = 11;
+    static constexpr uint32_t kLagBoundsMs[kBuckets - 1] = {1, 2, 5, 10, 20, 50, 100, 200, 500, 1000};
+
+    uint64_t sessions   = 0;  // Назначено на колёсах всех шардов
+    uint64_t expired    = 0;  // Истекло по таймауту
+    uint64_t max_lag_us = 0;  // Наибольшее опоздание истечения
+    uint64_t tick_ms    = 0;  // Шаг колеса
+    uint64_t lag[kBuckets] = {};
+};
+
+// Функция для сериализации статистики истечения сессий в JSON
+inline void to_json(nlohmann::json& j, const ExpiryStats& s) {
+    nlohmann::json lag = nlohmann::json::object();
+    for (size_t i = 0; i + 1 < ExpiryStats::kBuckets; ++i) {
+        lag[std::to_string(ExpiryStats::kLagBoundsMs[i])] = s.lag[i];
+    }
+    lag["+Inf"] = s.lag[ExpiryStats::kBuckets - 1];
+    j = {
+        {"sessions", s.sessions},
+        {"expired", s.expired},
+        {"max_lag_us", s.max_lag_us},
+        {"tick_ms", s.tick_ms},
+        {"lag_ms", lag}
+    };
+}
+
+// Ход graceful stop для HTTP: сколько сессий выгружено, сколько осталось и когда выгрузка закончится
+struct DrainProgress {
+    bool     active      = false;  // Выгрузка идёт
+    uint64_t rate        = 0;      // Сессий в секунду (0 — без ограничения)
+    uint64_t total       = 0;      // Сессий на момент начала
+    uint64_t released    = 0;      // Выгружено
+    uint64_t remaining   = 0;      // Осталось в менеджере
+    uint64_t elapsed_ms  = 0;
+    uint64_t eta_ms      = 0;      // Оценка при текущем темпе
+};
+
+// Функция для сериализации хода выгрузки в JSON
+inline void to_json(nlohmann::json& j, const DrainProgress& p) {
+    j = {
+        {"active", p.active},
+        {"rate", p.rate},
+        {"total", p.total},
+        {"released", p.released},
+        {"remaining", p.remaining},
+        {"elapsed_ms", p.elapsed_ms},
+        {"eta_ms", p.eta_ms}
+    };
+}
+
+// Память сессий для HTTP: хранилища и колёса таймеров всех шардов, предел числа сессий
+struct MemoryStats {
+    uint64_t    max_sessions      = 0;  // Предел (0 — без предела)
+    uint64_t    sessions          = 0;
+    uint64_t    rejected          = 0;  // Новых сессий, отклонённых из-за предела
+    MemoryUsage store;                  // Хранилища всех шардов
+    MemoryUsage wheel;                  // Колёса таймеров всех шардов
+    uint64_t    bytes_per_session = 0;  // Занято на одну сессию (хранилище и колесо)
+    double      fragmentation     = 0;  // Доля выделенной памяти, не занятой сессиями
+    uint64_t    rss_bytes         = 0;  // Резидентная память процесса
+};
+
+// Функция для сериализации статистики памяти в JSON
+inline void to_json(nlohmann::json& j, const MemoryStats& m) {
+    j = {
+        {"max_sessions", m.max_sessions},
+        {"sessions", m.sessions},
+        {"rejected", m.rejected},
+        {"store", m.store},
+        {"wheel", m.wheel},
+        {"bytes_per_session", m.bytes_per_session},
+        {"fragmentation", m.fragmentation},
+        {"rss_bytes", m.rss_bytes}
+    };
+}
+
+// Фабрика хранилищ: создаёт раздел хранилища для шарда с заданным номером
+using SessionStoreFactory = std::function<std::unique_ptr<ISessionStore>(size_t shard)>;
+
 // Класс, управляющий сессиями, проверяющий их активность и поддерживающий "graceful shutdown"
+//
+// Сессии разбиты на шарды по хешу IMSI: у каждого шарда свой мьютекс, свой раздел хранилища
+// и своё колесо таймеров, так что потоки, работающие с разными абонентами, не ждут друг друга.
+// Операции над всеми сессиями (список, graceful stop, очистка) обходят шарды по очереди.
+// Поток очистки спит до ближайшего срока на колёсах и снимает только наступившие сроки.
+// Graceful stop проходит сессии курсором по снимку IMSI шарда (один обход, а не поиск каждой
+// следующей сессии заново) и выпускает их пачками в темпе маркерной корзины (DrainPacer)
 class SessionManager {
 public:
+    // Шаг колеса таймеров: точность истечения сессий
+    static constexpr std::chrono::milliseconds kExpiryTick{10};
+
     // Конструктор, инициализирующий параметры для управления сессиями
     // session_timeout — таймаут для сессии
     // store — хранилище сессий
@@ -23,36 +123,177 @@ public:
                    std::unique_ptr<ISessionStore> store,
                    CdrWriter& cdr_writer);
 
+    // Конструктор с шардированием: shards разделов (округляется вверх до степени двойки),
+    // каждый создаётся make_store(номер шарда). Бросает std::invalid_argument при shards == 0
+    // max_sessions — предел общего числа сессий (0 — без предела): новая сессия сверх него
+    // отклоняется, продление существующих работает всегда. Колёса таймеров сразу резервируют
+    // память под равную долю предела — это только оценка размера, шард может занять и больше
+    SessionManager(std::chrono::seconds session_timeout,
+                   const SessionStoreFactory& make_store,
+                   size_t shards,
+                   CdrWriter& cdr_writer,
+                   size_t max_sessions = 0);
+
     // Деструктор
     ~SessionManager();
 
     // Метод для создания новой сессии или продления существующей
-    // Возвращает true, если сессия была только что создана
-    bool touch_session(const std::string& imsi);
+    // Возвращает false, если сессию не удалось записать или достигнут предел max_sessions
+    bool touch_session(Imsi imsi);
+
+    // Метод для создания или продления пачки сессий (IMSI из одного recvmmsg): IMSI группируются
+    // по шардам, каждый шард блокируется и обращается к хранилищу один раз (upsert_batch).
+    // Возвращает итог для каждого IMSI в порядке входа; "created" CDR пишется для созданных
+    std::vector<UpsertResult> touch_batch(std::span<const Imsi> imsis);
+
+    // Метод для продления только существующей сессии (GTPv2-C Modify Bearer)
+    // Возвращает false, если сессии нет
+    bool refresh_session(Imsi imsi);
+
+    // Метод для завершения сессии по запросу (GTPv2-C Delete Session), пишет CDR "deleted"
+    // Возвращает false, если сессии нет
+    bool end_session(Imsi imsi);
 
     // Метод для проверки, активна ли сессия с данным IMSI
-    bool is_active(const std::string& imsi) const;
+    bool is_active(Imsi imsi) const;
 
-    // Метод для дозированного удаления сессий в секунду (для graceful stop)
-    void offload_rate(size_t sessions_per_sec);
+    // Метод для получения активной сессии со сроками (точечный поиск в шарде абонента)
+    // Возвращает пусто, если сессии нет или её срок уже наступил
+    std::optional<StoredSession> get_session(Imsi imsi) const;
 
-    // Метод для graceful shutdown: дозированное удаление сессий
-    // Удаляет сессии с заданной частотой
+    // Метод для дозированного удаления сессий: не больше sessions_per_sec сессий за секунду
+    // (выгрузка останавливается, выпустив это число). Возвращает число выгруженных сессий
+    size_t offload_rate(size_t sessions_per_sec);
+
+    // Метод для graceful shutdown: выгружает все сессии с заданной частотой (0 — без ограничения),
+    // пишет им CDR "expired". Блокирует вызывающего до конца выгрузки; ход — drain_progress()
     void graceful_stop(size_t sessions_per_sec);
 
+    // Ход текущей (или последней) выгрузки
+    DrainProgress drain_progress() const;
+
+    // Тёплый перезапуск для хранилищ в памяти: двоичный снимок всех сессий (session_snapshot.hpp)
+    //
+    // Пишет снимок в path: сессии шарда копируются под его мьютексом (или без него, если хранилище
+    // читается без блокировок), а в файл пишутся уже без блокировки — приём не останавливается.
+    // Возвращает число записанных сессий; ошибки ввода-вывода — std::system_error
+    size_t save_snapshot(const std::string& path);
+
+    // Запускает фоновый поток, который пишет снимок в path каждые interval. После graceful stop
+    // пишется пустой снимок, чтобы выгруженные сессии не вернулись при следующем старте
+    void enable_snapshots(std::string path, std::chrono::seconds interval);
+
+    // Восстанавливает сессии из снимка path в threads потоков (0 — по числу ядер): потоки читают
+    // свои куски отображённого файла и раскладывают записи по шардам, затем разбирают шарды и
+    // заполняют их пачками с постановкой на колёса. Сумма проверяется до изменения шардов.
+    // Сессии, чей срок прошёл, пока сервер не работал, не восстанавливаются и получают CDR
+    // "expired" (если сессия истекла уже после снимка, но до остановки, CDR окажется повторным).
+    // Изменения после последнего снимка теряются. Возвращает число восстановленных сессий;
+    // бросает std::runtime_error (файл повреждён) или std::system_error (не открыть)
+    size_t restore_snapshot(const std::string& path, size_t threads = 0);
+
+    // Метод для получения всех активных сессий (обходит шарды по очереди)
+    std::vector<StoredSession> list_sessions() const;
+
+    // Число шардов
+    size_t shard_count() const noexcept { return shards_.size(); }
+
+    // Статистика истечения сессий для HTTP
+    ExpiryStats expiry_stats() const;
+
+    // Память сессий для HTTP (обходит шарды, ненадолго захватывая мьютекс каждого)
+    MemoryStats memory_stats() const;
+
 private:
+    // Шард: раздел хранилища и мьютекс, защищающий его. Выровнен по кэш-линии,
+    // чтобы мьютексы соседних шардов не делили одну линию
+    //
+    // Если хранилище читается без блокировок (concurrent_reads), запросы абонентов и списки
+    // обходятся без мьютекса шарда и не задерживают путь приёма
+    struct alignas(64) Shard {
+        mutable std::mutex             mtx;
+        std::unique_ptr<ISessionStore> store;
+        TimingWheel                    wheel;  // Сроки истечения сессий шарда
+        bool                           lock_free_reads = false;
+        std::atomic<uint64_t>          armed{0};  // wheel.size() для статистики без мьютекса
+    };
+
+    // Шард владеет новым хранилищем
+    void attach_store(Shard& shard, std::unique_ptr<ISessionStore> store);
+
+    // Публикует wheel.size() в armed и переносит изменение в общий счётчик live_
+    // (мьютекс шарда захвачен; после каждого изменения колеса)
+    void sync_armed_locked(Shard& shard) noexcept;
+
+    // Занимает в пределе max_sessions место под n новых сессий, возвращает сколько удалось
+    // (без предела — n). Занятое место возвращается release_sessions после постановки
+    // сессий на колесо: до этого конкурирующие шарды его уже не получат
+    size_t reserve_sessions(size_t n) noexcept;
+    void release_sessions(size_t n) noexcept;
+
+    // Шард, которому принадлежит IMSI
+    Shard& shard_for(Imsi imsi) const noexcept {
+        return *shards_[std::hash<Imsi>{}(imsi) & shard_mask_];
+    }
+
+    // Восстанавливает сессии из хранилища и запускает фоновую очистку
+    void start();
+
     // Метод для цикла очистки сессий по таймауту
     void cleaner_loop();
 
-    // Метод для истечения срока действия сессии с заданным IMSI
-    void expire_session_locked(const std::string& imsi);
+    // Выгрузка для graceful stop: не больше limit сессий в темпе rate в секунду (0 — без ограничения).
+    // Возвращает число выгруженных; прерывается разрушением менеджера
+    size_t drain(size_t rate, size_t limit);
+
+    // Выгружает пачку IMSI шарда: снимает с колеса и из хранилища, пишет CDR. Возвращает число снятых
+    size_t release_batch(Shard& shard, std::span<const Imsi> imsis, std::vector<CdrRecord>& cdrs);
+
+    // Цикл фонового потока снимков
+    void snapshot_loop();
+
+    // Сессий на колёсах всех шардов (без блокировок)
+    uint64_t armed_total() const noexcept;
+
+    // Ставит сессию на колесо шарда (мьютекс шарда захвачен) и будит очистку, если срок раньше её пробуждения
+    void arm_locked(Shard& shard, Imsi imsi, std::chrono::steady_clock::time_point expires);
+
+    // Перевод между монотонным временем и тиками колеса
+    uint64_t current_tick() const noexcept;
+    uint64_t deadline_tick(std::chrono::steady_clock::time_point tp) const noexcept;
+    std::chrono::steady_clock::time_point tick_time(uint64_t tick) const noexcept;
+
+    // Учитывает опоздание истечения в гистограмме (пишет только поток очистки)
+    void record_lag(std::chrono::steady_clock::duration lag) noexcept;
 
     std::chrono::seconds                    timeout_;  // Таймаут для сессий
-    std::unique_ptr<ISessionStore>          store_;    // Хранилище сессий
+    CoarseClock                             clock_;    // Время для меток сессий (обновляется отдельным потоком)
+    std::chrono::steady_clock::time_point   epoch_;    // Нулевой тик колёс
+    std::vector<std::unique_ptr<Shard>>     shards_;   // Шарды сессий
+    size_t                                  shard_mask_ = 0;  // Число шардов - 1
+    size_t                                  max_sessions_ = 0;  // Предел числа сессий (0 — нет)
+    alignas(64) std::atomic<uint64_t>       live_{0};  // Сессии на колёсах + занятые reserve_sessions места (при пределе)
+    std::atomic<uint64_t>                   rejected_{0};       // Отклонено из-за предела
     CdrWriter&                              cdr_;      // Объект для записи CDR
-    mutable std::mutex                      mtx_;      // Мьютекс для синхронизации доступа
-    std::condition_variable                 cv_;       // Условная переменная для синхронизации touch_session
+    std::mutex                              stop_mtx_; // Мьютекс для ожидания потока очистки
+    std::condition_variable                 cv_;       // Условная переменная для пробуждения очистки
+    std::condition_variable                 drain_cv_; // Ожидание маркеров выгрузки (будит деструктор)
+    std::atomic<uint64_t>                   wake_tick_{TimingWheel::kNever};  // Когда проснётся очистка
+    std::atomic<uint64_t>                   expired_{0};      // Статистика истечения
+    std::atomic<uint64_t>                   max_lag_us_{0};
+    std::atomic<uint64_t>                   lag_[ExpiryStats::kBuckets] = {};
+    std::atomic<bool>                       drain_active_{false};  // Ход выгрузки (drain_progress)
+    std::atomic<uint64_t>                   drain_rate_{0};
+    std::atomic<uint64_t>                   drain_total_{0};
+    std::atomic<uint64_t>                   drain_released_{0};
+    std::atomic<int64_t>                    drain_started_ns_{0};
+    std::atomic<int64_t>                    drain_finished_ns_{0};
     std::thread                             cleaner_thread_;  // Поток для очистки сессий
+    std::string                             snapshot_path_;   // Куда писать снимки (пусто — не писать)
+    std::chrono::seconds                    snapshot_interval_{0};
+    std::mutex                              snapshot_mtx_;    // Упорядочивает запись снимков
+    std::condition_variable                 snapshot_cv_;     // Ожидание следующего снимка (будит деструктор)
+    std::thread                             snapshot_thread_;
     std::atomic<bool>                       stop_{false};  // Флаг остановки работы менеджера сессий
 };
 
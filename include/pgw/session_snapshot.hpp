@@ -0,0 +1,88 @@
+// include/pgw/session_snapshot.hpp
+#pragma once
+
+#include "pgw/session_store.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <string>
+#include <vector>
+
+namespace pgw {
+
+// Двоичный снимок сессий для тёплого перезапуска
+//
+// Файл — заголовок и подряд записи фиксированного размера (упакованный IMSI и два срока,
+// 24 байта, порядок байт хоста), так что файл можно отобразить в память и читать записи
+// по индексу из нескольких потоков без разбора. Контрольная сумма — сумма хешей записей
+// по модулю 2^64: не зависит от порядка, поэтому части файла проверяются параллельно и
+// складываются. Снимок пишется во временный файл рядом и подменяет прежний через rename —
+// упавшая запись не портит последний целый снимок.
+struct SnapshotHeader {
+    char     magic[8];     // "PGWSNAP" и ноль
+    uint32_t version;      // kSnapshotVersion
+    uint32_t record_size;  // Размер записи (сверяется при чтении)
+    uint64_t count;        // Число записей
+    EpochMs  written_at;   // Когда снимок записан
+    uint64_t checksum;     // Сумма snapshot_record_hash всех записей
+};
+static_assert(sizeof(SnapshotHeader) == 40, "Snapshot header layout is part of the file format");
+
+inline constexpr uint32_t kSnapshotVersion = 1;
+
+// Хеш записи для контрольной суммы снимка
+uint64_t snapshot_record_hash(const StoredSession& s) noexcept;
+
+// Запись снимка: append() пачками (например, шард за шардом), commit() дописывает заголовок,
+// сбрасывает файл на диск и подменяет им прежний снимок. Без commit() временный файл удаляется.
+// Ошибки ввода-вывода — std::system_error
+class SnapshotWriter {
+public:
+    explicit SnapshotWriter(std::string path);
+    ~SnapshotWriter();
+
+    SnapshotWriter(const SnapshotWriter&) = delete;
+    SnapshotWriter& operator=(const SnapshotWriter&) = delete;
+
+    void append(std::span<const StoredSession> sessions);
+
+    // Возвращает число записанных сессий
+    size_t commit(EpochMs now);
+
+private:
+    void flush_buffer();
+
+    std::string          path_;
+    std::string          tmp_path_;
+    int                  fd_ = -1;
+    std::vector<uint8_t> buffer_;
+    uint64_t             count_    = 0;
+    uint64_t             checksum_ = 0;
+};
+
+// Снимок, отображённый в память только для чтения. Бросает std::runtime_error, если файл
+// не снимок, другой версии или обрезан, и std::system_error, если его не открыть.
+// Контрольную сумму проверяет читатель (см. SessionManager::restore_snapshot), складывая
+// snapshot_record_hash прочитанных записей
+class SnapshotFile {
+public:
+    explicit SnapshotFile(const std::string& path);
+    ~SnapshotFile();
+
+    SnapshotFile(const SnapshotFile&) = delete;
+    SnapshotFile& operator=(const SnapshotFile&) = delete;
+
+    size_t   size() const noexcept { return static_cast<size_t>(header_.count); }
+    uint64_t checksum() const noexcept { return header_.checksum; }
+    EpochMs  written_at() const noexcept { return header_.written_at; }
+
+    // Запись с номером i (i < size())
+    StoredSession at(size_t i) const noexcept;
+
+private:
+    SnapshotHeader header_{};
+    const uint8_t* data_  = nullptr;  // Начало отображения
+    size_t         bytes_ = 0;
+};
+
+} // namespace pgw
@@ -1,33 +1,81 @@
 // mini-pgw/include/pgw/session_store.hpp
 #pragma once
 
-#include <string>
+#include "pgw/clock.hpp"
+#include "pgw/imsi.hpp"
+#include "pgw/slab_pool.hpp"
+#include <optional>
+#include <span>
 #include <vector>
 
 namespace pgw {
 
+// Сроки — Unix-время в миллисекундах; в строку превращаются только на границах вывода
 struct StoredSession {
-    std::string imsi;
-    std::string created_at;
-    std::string expires_at;
+    Imsi    imsi;
+    EpochMs created_at = 0;
+    EpochMs expires_at = 0;
 };
 
+// Итог upsert: сессия создана, продлена (created_at сохранён, обновлён только expires_at) или не записана
+enum class UpsertResult {
+    Created,
+    Refreshed,
+    Failed
+};
+
+// Число шардов менеджера сессий: запрошенное число, округлённое вверх до степени двойки
+inline size_t session_shard_count(size_t shards) noexcept {
+    size_t count = 1;
+    while (count < shards)
+        count <<= 1;
+    return count;
+}
+
+// Шард IMSI при shard_count шардах (степень двойки) — так раскладывает SessionManager. Нужно
+// хранилищам, у которых один файл на все шарды: каждый шард при старте берёт свои строки
+inline size_t session_shard(Imsi imsi, size_t shard_count) noexcept {
+    return std::hash<Imsi>{}(imsi) & (shard_count - 1);
+}
+
 class ISessionStore {
 public:
     virtual ~ISessionStore() = default;
 
     /// Возвращает все сессии, у которых expires_at > now
-    virtual std::vector<StoredSession> load_sessions(const std::string& now) = 0;
+    virtual std::vector<StoredSession> load_sessions(EpochMs now) = 0;
     /// Сохраняет новую или обновляет существующую сессию
     virtual bool save_session(const StoredSession& s) = 0;
     /// Удаляет сессию по IMSI
-    virtual bool delete_session(const std::string& imsi) = 0;
+    virtual bool delete_session(Imsi imsi) = 0;
     /// Проверяет, есть ли сессия с данным IMSI
-    virtual bool session_exists(const std::string& imsi) = 0;
+    virtual bool session_exists(Imsi imsi) = 0;
+    /// Возвращает сессию по IMSI (вместе со сроками) или пусто, если её нет; просрочку не проверяет
+    virtual std::optional<StoredSession> get_session(Imsi imsi) = 0;
     /// Удаляет все «просроченные» сессии (expires_at <= now)
-    virtual void cleanup_expired_sessions(const std::string& now) = 0;
+    virtual void cleanup_expired_sessions(EpochMs now) = 0;
     
-    virtual std::vector<StoredSession> load_expired_sessions(const std::string& now) = 0;
+    virtual std::vector<StoredSession> load_expired_sessions(EpochMs now) = 0;
+
+    /// Создаёт сессию или продлевает существующую за одно обращение (вместо session_exists + save_session)
+    virtual UpsertResult upsert(const StoredSession& s) = 0;
+
+    // Пакетные формы: пачка приёма или тик истечения обращается к хранилищу один раз.
+    // Элементы обрабатываются по порядку, повтор IMSI в пачке видит результат предыдущего
+    /// upsert для каждой сессии; результаты — в порядке входа
+    virtual std::vector<UpsertResult> upsert_batch(std::span<const StoredSession> sessions) = 0;
+    /// Удаляет сессии по IMSI; возвращает, сколько действительно было удалено
+    virtual size_t delete_batch(std::span<const Imsi> imsis) = 0;
+    /// get_session для каждого IMSI; результаты — в порядке входа
+    virtual std::vector<std::optional<StoredSession>> lookup_batch(std::span<const Imsi> imsis) = 0;
+
+    /// true — методы чтения (load_sessions, get_session, session_exists, lookup_batch) можно вызывать
+    /// без внешней блокировки одновременно с записью, и они не задерживают писателей
+    virtual bool concurrent_reads() const noexcept { return false; }
+
+    /// Память, которую хранилище держит под сессии (для статистики); хранилище на диске
+    /// ничего не сообщает
+    virtual MemoryUsage memory_usage() { return {}; }
 };
 
 } // namespace pgw
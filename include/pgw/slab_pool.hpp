@@ -0,0 +1,157 @@
+// include/pgw/slab_pool.hpp
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <vector>
+#include <nlohmann/json.hpp>
+
+namespace pgw {
+
+// Учёт памяти компонента: выделено (с запасом и свободными местами) и занято живыми записями
+struct MemoryUsage {
+    uint64_t bytes_reserved = 0;
+    uint64_t bytes_in_use   = 0;
+
+    MemoryUsage& operator+=(const MemoryUsage& other) noexcept {
+        bytes_reserved += other.bytes_reserved;
+        bytes_in_use   += other.bytes_in_use;
+        return *this;
+    }
+};
+
+// Функция для сериализации учёта памяти в JSON
+inline void to_json(nlohmann::json& j, const MemoryUsage& m) {
+    j = {
+        {"bytes_reserved", m.bytes_reserved},
+        {"bytes_in_use", m.bytes_in_use}
+    };
+}
+
+// Учёт памяти пула для HTTP
+struct SlabStats {
+    uint64_t object_size    = 0;  // Байт на объект (размер узла контейнера)
+    uint64_t objects        = 0;  // Выдано объектов
+    uint64_t capacity       = 0;  // Объектов во всех плитах
+    uint64_t slabs          = 0;
+    uint64_t bytes_reserved = 0;  // Выделено под плиты
+    uint64_t bytes_in_use   = 0;  // Занято выданными объектами
+};
+
+// Функция для сериализации статистики пула в JSON
+inline void to_json(nlohmann::json& j, const SlabStats& s) {
+    j = {
+        {"object_size", s.object_size},
+        {"objects", s.objects},
+        {"capacity", s.capacity},
+        {"slabs", s.slabs},
+        {"bytes_reserved", s.bytes_reserved},
+        {"bytes_in_use", s.bytes_in_use}
+    };
+}
+
+// Пул объектов одного размера (slab-аллокатор)
+//
+// Память берётся плитами по kSlabBytes, каждая нарезается на объекты фиксированного размера;
+// освобождённый объект уходит в список свободных (указатель хранится в самом объекте) и выдаётся
+// следующим. Ни заголовков malloc на каждый объект, ни фрагментации по размерам: память на сессию
+// постоянна, а общий объём — число плит. reserve() выделяет плиты заранее, и до этого числа
+// объектов пул к системному аллокатору не обращается. Плиты возвращаются только при разрушении.
+//
+// Не потокобезопасен: пул принадлежит контейнеру, который защищён мьютексом владельца
+class SlabPool {
+public:
+    static constexpr size_t kSlabBytes = 1 << 20;
+    // Узлы контейнеров сессий (IMSI и сроки — 64-битные поля) выровнены по 8; объекты со
+    // строже выровненными полями SlabAllocator отдаёт обычной куче
+    static constexpr size_t kAlign     = alignof(uint64_t);
+
+    // object_size — размер объекта (округляется вверх до kAlign); 0 — размер задаёт первое
+    // выделение одиночного объекта (так пул узнаёт размер узла контейнера, см. slab_node_size)
+    explicit SlabPool(size_t object_size = 0);
+    ~SlabPool();
+
+    SlabPool(const SlabPool&) = delete;
+    SlabPool& operator=(const SlabPool&) = delete;
+
+    // Объект размером не больше object_size(); бросает std::bad_alloc, если память не выделена
+    void* allocate();
+    void  deallocate(void* p) noexcept;
+
+    // Выделяет плиты заранее, чтобы вместить n объектов. Бросает std::logic_error, если размер
+    // объекта ещё не известен
+    void reserve(size_t n);
+
+    // Задаёт размер объекта пулу без размера (возвращает false, если размер уже другой)
+    bool adopt(size_t object_size) noexcept;
+
+    size_t    object_size() const noexcept { return object_size_; }
+    SlabStats stats() const noexcept;
+
+private:
+    void add_slab();
+
+    struct FreeNode {
+        FreeNode* next;
+    };
+
+    size_t    object_size_ = 0;
+    size_t    per_slab_    = 0;  // Объектов в плите
+    FreeNode* free_        = nullptr;
+    size_t    in_use_      = 0;
+    std::vector<std::unique_ptr<std::byte[]>> slabs_;
+};
+
+// Аллокатор для узловых контейнеров (std::unordered_map, std::list) поверх SlabPool:
+// одиночные объекты, которые помещаются в объект пула, берутся из пула, остальное
+// (массив корзин хеш-таблицы) — из обычной кучи
+template <typename T>
+class SlabAllocator {
+public:
+    using value_type = T;
+
+    explicit SlabAllocator(SlabPool& pool) noexcept : pool_(&pool) {}
+    template <typename U>
+    SlabAllocator(const SlabAllocator<U>& other) noexcept : pool_(other.pool()) {}
+
+    T* allocate(size_t n) {
+        if (n == 1 && alignof(T) <= SlabPool::kAlign) {
+            if (pool_->object_size() == 0)
+                pool_->adopt(sizeof(T));
+            if (sizeof(T) <= pool_->object_size())
+                return static_cast<T*>(pool_->allocate());
+        }
+        return std::allocator<T>{}.allocate(n);
+    }
+
+    void deallocate(T* p, size_t n) noexcept {
+        if (n == 1 && alignof(T) <= SlabPool::kAlign && sizeof(T) <= pool_->object_size())
+            pool_->deallocate(p);
+        else
+            std::allocator<T>{}.deallocate(p, n);
+    }
+
+    SlabPool* pool() const noexcept { return pool_; }
+
+    template <typename U>
+    bool operator==(const SlabAllocator<U>& other) const noexcept { return pool_ == other.pool(); }
+
+private:
+    SlabPool* pool_;
+};
+
+// Размер узла, который контейнер Container (с SlabAllocator) берёт из пула: временный контейнер
+// на пуле без размера вставляет один элемент, и пул запоминает размер его узла
+template <typename Container, typename Value>
+size_t slab_node_size(Value value) {
+    SlabPool probe;
+    {
+        Container c{ typename Container::allocator_type(probe) };
+        c.insert(std::move(value));
+    }
+    return probe.object_size();
+}
+
+} // namespace pgw
@@ -1,52 +1,332 @@
 // include/pgw/sqlite_session_store.hpp
 #pragma once
 
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
 #include <string>
+#include <string_view>
+#include <thread>
+#include <memory>
+#include <unordered_map>
 #include <vector>
 #include <mutex>
 #include <sqlite3.h>
+#include <nlohmann/json.hpp>
 #include "pgw/session_store.hpp"  // Интерфейс для хранения сессий
 #include "pgw/session.hpp"  // Структуры данных для сессий
 
 namespace pgw {
 
+// Счётчики одного подготовленного запроса: сколько раз выполнен, сколько раз с ошибкой и время
+// выполнения (шаги и сброс, без ожидания мьютекса хранилища)
+struct SqliteStatementStats {
+    std::string name;
+    uint64_t calls    = 0;
+    uint64_t errors   = 0;
+    uint64_t total_ns = 0;
+    uint64_t max_ns   = 0;
+};
+
+// Функция для сериализации счётчиков запроса в JSON
+inline void to_json(nlohmann::json& j, const SqliteStatementStats& s) {
+    j = {
+        {"name", s.name},
+        {"calls", s.calls},
+        {"errors", s.errors},
+        {"total_ns", s.total_ns},
+        {"avg_ns", s.calls ? s.total_ns / s.calls : 0},
+        {"max_ns", s.max_ns}
+    };
+}
+
+// Режим записи SQLite
+struct SqliteStoreOptions {
+    // PRAGMA journal_mode: в "wal" фиксация дописывает журнал, а чтение не ждёт записи
+    std::string journal_mode = "wal";
+    // PRAGMA synchronous: "normal" в режиме WAL сбрасывает файл на диск только при контрольной
+    // точке — сбой питания может потерять последние транзакции, но не испортить базу
+    std::string synchronous  = "normal";
+
+    // Отложенная запись: изменения копятся в памяти и фиксируются одной транзакцией раз в
+    // commit_interval или по накоплении commit_rows строк — что раньше. commit_interval — окно
+    // долговечности: столько последних изменений теряется при аварийном завершении.
+    // 0 — каждая запись сразу своей транзакцией
+    std::chrono::milliseconds commit_interval{0};
+    size_t                    commit_rows = 1024;
+
+    // Истёкшие сессии удаляются порциями не больше expire_chunk_rows строк — каждая своей
+    // короткой транзакцией, чтобы очистка большой таблицы не держала запись новых сессий
+    size_t expire_chunk_rows = 1000;
+
+    // Пул соединений только для чтения (поиск по IMSI и выборки по сроку): в режиме WAL читатели
+    // не ждут писателя и друг друга. 0 — всё через одно соединение писателя под общим мьютексом.
+    // Пул открывается только для файла в режиме WAL
+    size_t read_connections = 0;
+};
+
+// Счётчики отложенной записи
+struct SqliteCommitStats {
+    uint64_t interval_ms     = 0;  // Окно долговечности
+    uint64_t commit_rows     = 0;  // Порог строк для досрочной фиксации
+    uint64_t pending         = 0;  // Изменений ждут фиксации
+    uint64_t commits         = 0;
+    uint64_t failed_commits  = 0;  // Неудачные фиксации (изменения остаются в памяти до следующей)
+    uint64_t rows            = 0;  // Строк зафиксировано
+    uint64_t last_batch_rows = 0;
+    uint64_t max_batch_rows  = 0;
+    uint64_t total_commit_ns = 0;  // Время транзакций (BEGIN … COMMIT)
+    uint64_t max_commit_ns   = 0;
+};
+
+// Функция для сериализации счётчиков отложенной записи в JSON
+inline void to_json(nlohmann::json& j, const SqliteCommitStats& s) {
+    j = {
+        {"interval_ms", s.interval_ms},
+        {"commit_rows", s.commit_rows},
+        {"pending", s.pending},
+        {"commits", s.commits},
+        {"failed_commits", s.failed_commits},
+        {"rows", s.rows},
+        {"last_batch_rows", s.last_batch_rows},
+        {"max_batch_rows", s.max_batch_rows},
+        {"avg_batch_rows", s.commits ? s.rows / s.commits : 0},
+        {"avg_commit_ns", s.commits ? s.total_commit_ns / s.commits : 0},
+        {"max_commit_ns", s.max_commit_ns}
+    };
+}
+
+// Счётчики пула соединений чтения
+struct SqliteReadPoolStats {
+    uint64_t connections = 0;
+    uint64_t reads       = 0;  // Чтений через пул
+    uint64_t waits       = 0;  // Из них ждали освободившееся соединение (все были заняты)
+};
+
+// Функция для сериализации счётчиков пула чтения в JSON
+inline void to_json(nlohmann::json& j, const SqliteReadPoolStats& s) {
+    j = {
+        {"connections", s.connections},
+        {"reads", s.reads},
+        {"waits", s.waits}
+    };
+}
+
+// Отложенное изменение строки сессии: итоговое состояние одного IMSI за окно записи
+enum class SessionWriteOp : uint8_t {
+    Put,      // REPLACE всей строки (created_at и expires_at)
+    Refresh,  // Продление: UPDATE expires_at, а если строки нет — INSERT
+    Delete
+};
+
+struct SessionWrite {
+    SessionWriteOp op;
+    EpochMs        created_at;
+    EpochMs        expires_at;
+};
+
+using SessionWrites = std::unordered_map<Imsi, SessionWrite>;
+
+// Добавляет к накопленным изменениям более позднее изменение того же IMSI: сколько бы раз
+// сессию ни продлевали за окно, в базу уходит одна строка
+void merge_write(SessionWrites& writes, Imsi imsi, const SessionWrite& newer);
+
 // Класс для хранения сессий в базе данных SQLite, реализующий интерфейс ISessionStore
+//
+// Схема версионирована (PRAGMA user_version): IMSI — упакованное целое и ключ таблицы, сроки —
+// Unix-время в миллисекундах, по expires_at есть индекс. Файл в прежнем текстовом формате
+// переводится в новую схему при открытии, одной транзакцией.
+//
+// Все запросы готовятся один раз в конструкторе и переиспользуются: вызов только привязывает
+// параметры, выполняет запрос и сбрасывает его, без разбора SQL на каждый пакет.
+//
+// С отложенной записью (commit_interval > 0) изменения ложатся в таблицу в памяти (последнее
+// состояние каждого IMSI), и фоновый поток фиксирует её одной транзакцией: один fsync на
+// пачку вместо одного на сессию. Чтение по IMSI сначала смотрит в эту таблицу, выборки по
+// сроку сначала фиксируют её. Деструктор фиксирует всё, что не успело записаться.
+//
+// С пулом чтения (read_connections > 0) запись идёт через одно соединение под mtx_, а чтение —
+// через свободное соединение пула, каждое со своими подготовленными запросами, без mtx_
 class SqliteSessionStore : public ISessionStore {
 public:
-    // Конструктор, принимающий путь к файлу базы данных
-    explicit SqliteSessionStore(const std::string& db_path);
+    // Конструктор, принимающий путь к файлу базы данных. Бросает std::invalid_argument,
+    // если journal_mode или synchronous не из списка SQLite или expire_chunk_rows равен нулю
+    explicit SqliteSessionStore(const std::string& db_path, SqliteStoreOptions options = {});
     
     // Деструктор для очистки ресурсов
     ~SqliteSessionStore();
 
+    SqliteSessionStore(const SqliteSessionStore&) = delete;
+    SqliteSessionStore& operator=(const SqliteSessionStore&) = delete;
+
     // Реализация интерфейса ISessionStore
     // Метод для загрузки всех сессий, актуальных на данный момент
-    std::vector<StoredSession> load_sessions(const std::string& now) override;
+    std::vector<StoredSession> load_sessions(EpochMs now) override;
 
     // Метод для сохранения сессии в базе данных
     bool save_session(const StoredSession& s) override;
 
     // Метод для удаления сессии по IMSI
-    bool delete_session(const std::string& imsi) override;
+    bool delete_session(Imsi imsi) override;
 
     // Метод для проверки существования сессии в базе данных
-    bool session_exists(const std::string& imsi) override;
+    bool session_exists(Imsi imsi) override;
+
+    // Метод для получения сессии по IMSI (поиск по первичному ключу)
+    std::optional<StoredSession> get_session(Imsi imsi) override;
 
-    // Метод для удаления просроченных сессий
-    void cleanup_expired_sessions(const std::string& now) override;
+    // Метод для удаления просроченных сессий (порциями по expire_chunk_rows)
+    void cleanup_expired_sessions(EpochMs now) override;
 
     // Новый метод для загрузки всех просроченных сессий, чье время истекло
-    std::vector<StoredSession> load_expired_sessions(const std::string& now);
+    std::vector<StoredSession> load_expired_sessions(EpochMs now);
+
+    // Метод для создания или продления сессии: UPDATE срока, при отсутствии строки — INSERT
+    UpsertResult upsert(const StoredSession& s) override;
+
+    // Пакетные методы: каждый запрос готовится один раз на пачку, вся пачка — одна транзакция
+    std::vector<UpsertResult> upsert_batch(std::span<const StoredSession> sessions) override;
+    size_t delete_batch(std::span<const Imsi> imsis) override;
+    std::vector<std::optional<StoredSession>> lookup_batch(std::span<const Imsi> imsis) override;
+
+    // С пулом чтения методы чтения не берут мьютекс писателя
+    bool concurrent_reads() const noexcept override { return !readers_.empty(); }
+
+    // Счётчики подготовленных запросов (для GET /stats); соединения пула — вместе с писателем
+    std::vector<SqliteStatementStats> statement_stats();
+
+    // Счётчики пула чтения (для GET /stats)
+    SqliteReadPoolStats read_pool_stats();
+
+    // Фиксирует отложенные изменения сейчас; false, если транзакция не удалась
+    bool flush();
+
+    // Записывает готовую пачку изменений одной транзакцией (в обход отложенной записи);
+    // учитывается в commit_stats(). false — транзакция откатена
+    bool apply_writes(const SessionWrites& writes);
+
+    // Счётчики отложенной записи (для GET /stats)
+    SqliteCommitStats commit_stats();
+
+    // План выполнения подготовленного запроса по имени из statement_stats() — строки
+    // EXPLAIN QUERY PLAN через '\n'. Бросает std::invalid_argument для неизвестного имени
+    std::string query_plan(std::string_view name);
 
 private:
+    // Подготовленные запросы; SQL и имена — в sqlite_session_store.cpp
+    enum Query : size_t {
+        kReplace,
+        kUpdateExpires,
+        kInsert,
+        kDelete,
+        kExists,
+        kSelect,
+        kLoadLive,
+        kLoadExpired,
+        kDeleteExpired,
+        kBegin,
+        kCommit,
+        kRollback,
+        kQueryCount
+    };
+
+    struct Prepared {
+        sqlite3_stmt* stmt     = nullptr;
+        uint64_t      calls    = 0;
+        uint64_t      errors   = 0;
+        uint64_t      total_ns = 0;
+        uint64_t      max_ns   = 0;
+    };
+
+    using Statements = std::array<Prepared, kQueryCount>;
+
+    // Соединение пула чтения: занято одним чтением за раз (mtx)
+    struct Reader {
+        std::mutex mtx;
+        sqlite3*   db = nullptr;
+        Statements queries{};  // Подготовлены только запросы чтения
+        uint64_t   reads = 0;
+        uint64_t   waits = 0;
+    };
+
+    // Одно выполнение подготовленного запроса и аренда соединения пула (определены в .cpp)
+    class Call;
+    class ReadLease;
+
+    // Готовит запросы на соединении db (reads_only — только запросы чтения); false, если хоть
+    // один не подготовлен (ошибка в журнале)
+    static bool prepare_statements(sqlite3* db, Statements& queries, bool reads_only);
+
+    // Открывает read_connections соединений только для чтения; при ошибке пул остаётся пустым
+    void open_readers(const std::string& db_path);
+    void close_readers();
+
+    // Выполняет fn(db, queries) на свободном соединении пула, а без пула — на писателе под mtx_
+    template <typename Fn>
+    auto read(Fn&& fn);
+
+    // Выполняет запрос без параметров и результата (BEGIN/COMMIT/ROLLBACK)
+    static bool exec(sqlite3* db, Statements& queries, Query q);
+    bool exec(Query q);
+
+    // Запросы к таблице по одной строке; запись вызывается под mtx_
+    UpsertResult upsert_row(const StoredSession& s);
+    bool replace_row(Imsi imsi, EpochMs created_at, EpochMs expires_at);
+    bool update_row(Imsi imsi, EpochMs expires_at);
+    bool delete_row(Imsi imsi);
+    static bool exists_row(Statements& queries, Imsi imsi);
+    static std::optional<StoredSession> select_row(Statements& queries, Imsi imsi);
+    static std::vector<StoredSession> load_rows(Statements& queries, Query q, EpochMs now);
+
+    bool write_behind() const noexcept { return options_.commit_interval.count() > 0; }
+
+    // Работа с таблицей отложенных изменений; вызываются под mtx_
+    void         defer(Imsi imsi, const SessionWrite& w);
+    UpsertResult upsert_deferred(const StoredSession& s);
+    size_t       delete_deferred(Imsi imsi);
+
+    // Отложенное изменение IMSI, если есть (берёт mtx_)
+    std::optional<SessionWrite> pending_write(Imsi imsi);
+    // Сессия из базы с поправкой на отложенное изменение p
+    static std::optional<StoredSession> with_pending(Statements& queries, Imsi imsi,
+                                                     const std::optional<SessionWrite>& p);
+
+    // Записывает изменения одной транзакцией и учитывает её в commit_stats_
+    bool commit_locked(const SessionWrites& writes);
+
+    // Фиксирует отложенные изменения одной транзакцией; при ошибке они остаются для следующей
+    bool flush_locked();
+
+    // Поток отложенной записи: фиксирует раз в commit_interval или по сигналу о commit_rows строк
+    void flush_loop();
+
     // Метод для сохранения сессии с указанием времени создания и истечения
-    bool save_session(const std::string& imsi, const std::string& created_at, const std::string& expires_at);
+    bool save_session(Imsi imsi, EpochMs created_at, EpochMs expires_at);
+
+    // Создаёт схему или переводит файл на текущую версию; false — база непригодна (ошибка в журнале)
+    bool init_schema();
 
-    // Метод для инициализации схемы таблицы в базе данных (если она ещё не существует)
-    void init_schema();
+    // Перенос таблицы версии 0 (текстовые IMSI и сроки) в текущую схему; внутри транзакции init_schema
+    bool migrate_text_schema();
+
+    // Включает journal_mode и synchronous из options_; возвращает действующий режим журнала
+    std::string apply_pragmas();
 
     sqlite3* db_;  // Указатель на объект базы данных SQLite
     std::mutex mtx_;  // Мьютекс для синхронизации доступа к базе данных
+    Statements queries_{};  // Под mtx_
+    bool ready_ = false;  // База открыта и все запросы подготовлены
+
+    SqliteStoreOptions                options_;
+    SessionWrites                     pending_;       // Под mtx_
+    SqliteCommitStats                 commit_stats_;  // Под mtx_
+    std::condition_variable           flush_cv_;
+    bool                              stop_ = false;
+    std::thread                       flusher_;
+
+    std::vector<std::unique_ptr<Reader>> readers_;  // Состав не меняется после конструктора
+    std::atomic<size_t>                  next_reader_{0};
 };
 
 } // namespace pgw
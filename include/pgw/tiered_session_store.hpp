@@ -0,0 +1,164 @@
+// include/pgw/tiered_session_store.hpp
+#pragma once
+
+#include "pgw/in_memory_session_store.hpp"
+#include "pgw/sqlite_session_store.hpp"
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include <nlohmann/json.hpp>
+
+namespace pgw {
+
+class TieredSessionStore;
+
+// Параметры обратной записи многоуровневого хранилища
+struct TieredStoreOptions {
+    // Изменения уходят в SQLite раз в writeback_interval или по накоплении writeback_rows строк
+    // в одном шарде — что раньше. writeback_interval — окно долговечности: столько последних
+    // изменений теряется при аварийном завершении
+    std::chrono::milliseconds writeback_interval{100};
+    size_t                    writeback_rows = 4096;
+};
+
+// Счётчики обратной записи
+struct WriteBackStats {
+    uint64_t interval_ms     = 0;
+    uint64_t writeback_rows  = 0;
+    uint64_t dirty           = 0;  // IMSI ждут записи
+    uint64_t changes         = 0;  // Изменений сессий принято шардами
+    uint64_t flushes         = 0;
+    uint64_t failed_flushes  = 0;  // Неудачные записи (изменения ждут следующей)
+    uint64_t rows            = 0;  // Строк записано (changes - rows — сколько слилось в памяти)
+    uint64_t last_batch_rows = 0;
+    uint64_t max_batch_rows  = 0;
+    uint64_t total_flush_ns  = 0;  // Время сбора пачки и транзакции
+    uint64_t max_flush_ns    = 0;
+};
+
+// Функция для сериализации счётчиков обратной записи в JSON
+inline void to_json(nlohmann::json& j, const WriteBackStats& s) {
+    j = {
+        {"interval_ms", s.interval_ms},
+        {"writeback_rows", s.writeback_rows},
+        {"dirty", s.dirty},
+        {"changes", s.changes},
+        {"flushes", s.flushes},
+        {"failed_flushes", s.failed_flushes},
+        {"rows", s.rows},
+        {"coalesced", s.changes > s.rows + s.dirty ? s.changes - s.rows - s.dirty : 0},
+        {"last_batch_rows", s.last_batch_rows},
+        {"max_batch_rows", s.max_batch_rows},
+        {"avg_flush_ns", s.flushes ? s.total_flush_ns / s.flushes : 0},
+        {"max_flush_ns", s.max_flush_ns}
+    };
+}
+
+// Общая для всех шардов часть многоуровневого хранилища: база SQLite и поток обратной записи.
+//
+// Поток раз в окно забирает у каждого шарда набор изменённых IMSI (обмен таблиц под мьютексом
+// шарда) и записывает их все одной транзакцией. При старте строки базы читаются один раз и
+// раздаются шардам по session_shard. Деструктор записывает всё, что осталось
+class SessionWriteBack {
+public:
+    // shards — число шардов менеджера сессий (округляется, как в SessionManager).
+    // Бросает std::invalid_argument при writeback_interval или writeback_rows, равных нулю
+    SessionWriteBack(std::unique_ptr<SqliteSessionStore> cold, size_t shards, TieredStoreOptions options = {});
+    ~SessionWriteBack();
+
+    SessionWriteBack(const SessionWriteBack&) = delete;
+    SessionWriteBack& operator=(const SessionWriteBack&) = delete;
+
+    // Строки базы для шарда shard (включая истёкшие — их удалит запуск менеджера); каждая
+    // выдаётся один раз
+    std::vector<StoredSession> take_initial(size_t shard);
+
+    // Записывает изменения всех шардов сейчас; false, если транзакция не удалась
+    bool flush();
+
+    WriteBackStats stats();
+
+    SqliteSessionStore& cold() noexcept { return *cold_; }
+    const TieredStoreOptions& options() const noexcept { return options_; }
+
+private:
+    friend class TieredSessionStore;
+
+    void attach(TieredSessionStore* store);
+    // Шард уходит: его незаписанные изменения переходят в общий остаток
+    void detach(TieredSessionStore* store);
+    // Шард накопил writeback_rows изменений — записать, не дожидаясь окна
+    void wake() noexcept;
+
+    bool flush_once();
+    void run();
+
+    std::unique_ptr<SqliteSessionStore> cold_;
+    const size_t                        shard_count_;
+    const TieredStoreOptions            options_;
+
+    std::mutex                              initial_mtx_;
+    bool                                    initial_loaded_ = false;
+    std::vector<std::vector<StoredSession>> initial_;  // Под initial_mtx_
+
+    std::mutex                       flush_mtx_;  // Одна запись за раз
+    std::mutex                       mtx_;        // stores_, leftover_, stats_, stop_
+    std::vector<TieredSessionStore*> stores_;
+    SessionWrites                    leftover_;   // Не записанное прежде — старше изменений шардов
+    WriteBackStats                   stats_;
+    std::condition_variable          flush_cv_;
+    bool                             stop_ = false;
+    std::atomic<bool>                wake_{false};
+    std::thread                      thread_;
+};
+
+// Многоуровневое хранилище сессий: таблица в памяти + SQLite для восстановления после сбоя
+//
+// Чтение, поиск и решения об истечении — только по таблице в памяти (InMemorySessionStore);
+// каждое изменение отмечает IMSI в наборе изменённых шарда, и SessionWriteBack в фоне переносит
+// набор в SQLite. Набор хранит итог по IMSI, поэтому сессия, продлённая сто раз за окно, — одна
+// запись в базу. При создании шард загружает из базы свои строки
+class TieredSessionStore : public ISessionStore {
+public:
+    // capacity — как у InMemorySessionStore
+    TieredSessionStore(std::shared_ptr<SessionWriteBack> backend, size_t shard, size_t capacity = 0);
+    ~TieredSessionStore() override;
+
+    std::vector<StoredSession> load_sessions(EpochMs now) override;
+    bool save_session(const StoredSession& s) override;
+    bool delete_session(Imsi imsi) override;
+    bool session_exists(Imsi imsi) override;
+    std::optional<StoredSession> get_session(Imsi imsi) override;
+    void cleanup_expired_sessions(EpochMs now) override;
+    std::vector<StoredSession> load_expired_sessions(EpochMs now) override;
+    UpsertResult upsert(const StoredSession& s) override;
+
+    std::vector<UpsertResult> upsert_batch(std::span<const StoredSession> sessions) override;
+    size_t delete_batch(std::span<const Imsi> imsis) override;
+    std::vector<std::optional<StoredSession>> lookup_batch(std::span<const Imsi> imsis) override;
+
+    MemoryUsage memory_usage() override { return hot_.memory_usage(); }
+
+private:
+    friend class SessionWriteBack;
+
+    // Отмечает изменение IMSI для обратной записи
+    void mark(Imsi imsi, const SessionWrite& w);
+    void mark_result(const StoredSession& s, UpsertResult r);
+
+    // Отдаёт накопленные изменения потоку записи (вызывается из SessionWriteBack)
+    SessionWrites take_dirty(uint64_t& changes);
+
+    InMemorySessionStore              hot_;
+    std::shared_ptr<SessionWriteBack> backend_;
+
+    std::mutex    dirty_mtx_;
+    SessionWrites dirty_;        // Под dirty_mtx_
+    uint64_t      changes_ = 0;  // Под dirty_mtx_: отмечено с последнего take_dirty
+};
+
+} // namespace pgw
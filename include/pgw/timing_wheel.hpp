@@ -0,0 +1,105 @@
+// include/pgw/timing_wheel.hpp
+#pragma once
+
+#include "pgw/imsi.hpp"
+#include "pgw/slab_pool.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <unordered_map>
+#include <vector>
+
+namespace pgw {
+
+// Иерархическое колесо таймеров для истечения сессий
+//
+// Время — целые тики. Четыре уровня по 64 слота: уровень 0 — по одному тику на слот,
+// каждый следующий — в 64 раза крупнее (всего 2^24 тиков; более далёкие сроки кладутся
+// в последний слот верхнего уровня и перекладываются, когда до них дойдёт очередь).
+// Слот — массив номеров узлов из общего пула; узел помнит свою позицию в нём, так что постановка,
+// перевзвод и отмена — O(1) (удаление — перестановкой последнего элемента на место удаляемого).
+// Массив, а не связный список: перекладка и снятие слота идут подряд по памяти с предвыборкой
+// узлов, а не прыжками по указателям — на миллионах сессий это и есть стоимость тика.
+// advance() перекладывает слот верхнего уровня вниз, когда колесо доходит до его начала,
+// и снимает только сессии из слотов уровня 0, чей тик наступил. Пустые тики пропускаются
+// по битовым маскам занятых слотов, next_event() говорит, когда просыпаться в следующий раз.
+// Узлы индекса IMSI берутся из собственного пула (SlabPool): память на сессию постоянна,
+// а reserve() выделяет всё заранее.
+//
+// Не потокобезопасен: у каждого шарда менеджера сессий своё колесо под его мьютексом
+class TimingWheel {
+public:
+    static constexpr unsigned kLevels   = 4;
+    static constexpr unsigned kSlotBits = 6;
+    static constexpr unsigned kSlots    = 1u << kSlotBits;
+    static constexpr uint64_t kNever    = std::numeric_limits<uint64_t>::max();
+
+    // Снятая с колеса сессия и тик, на который она была назначена
+    struct Expired {
+        Imsi     imsi;
+        uint64_t deadline;
+    };
+
+    // start_tick — первый тик, который обработает advance()
+    explicit TimingWheel(uint64_t start_tick = 0);
+
+    // Назначает (или переназначает) истечение сессии на тик deadline.
+    // Срок в прошлом истекает при ближайшем advance()
+    void schedule(Imsi imsi, uint64_t deadline);
+
+    // Снимает сессию с колеса; false, если её не было
+    bool cancel(Imsi imsi);
+
+    // Обрабатывает все тики до now включительно и дописывает в out наступившие сроки
+    void advance(uint64_t now, std::vector<Expired>& out);
+
+    // Ближайший тик, на котором advance() может что-то сделать (истечение или перекладка слота);
+    // kNever, если колесо пусто. Для уровня 0 точен, для старших — нижняя граница
+    uint64_t next_event() const noexcept;
+
+    // Резервирует место под n сессий (без перестроек индекса и выделений памяти при росте)
+    void reserve(size_t n);
+
+    // Память колеса: узлы, индекс IMSI и массивы слотов
+    MemoryUsage memory_usage() const noexcept;
+
+    // Число назначенных сессий
+    size_t size() const noexcept { return index_.size(); }
+
+    // Следующий необработанный тик
+    uint64_t current() const noexcept { return current_; }
+
+private:
+    static constexpr uint32_t kNil = std::numeric_limits<uint32_t>::max();
+
+    struct Node {
+        Imsi     imsi;
+        uint64_t deadline = 0;
+        uint32_t pos      = 0;   // Позиция в массиве слота
+        uint16_t slot     = 0;   // Номер слота: уровень * kSlots + слот
+    };
+
+    // Кладёт узел в слот по его сроку относительно current_
+    void place(uint32_t n);
+    void link(uint32_t n, unsigned slot);
+    void unlink(uint32_t n);
+
+    // Перекладывает слот уровня level, на начало которого пришёл current_
+    void cascade(unsigned level);
+
+    // Обрабатывает тик current_ и переходит к следующему
+    void process_tick(std::vector<Expired>& out);
+
+    uint64_t                           current_;
+    std::vector<uint32_t>              slots_[kLevels * kSlots];
+    uint64_t                           occupied_[kLevels] = {};  // Битовые маски непустых слотов
+    std::vector<uint32_t>              scratch_;  // Слот, который сейчас перекладывается или снимается
+    std::vector<Node>                  nodes_;
+    std::vector<uint32_t>              free_;
+    using Index = std::unordered_map<Imsi, uint32_t, std::hash<Imsi>, std::equal_to<Imsi>,
+                                     SlabAllocator<std::pair<const Imsi, uint32_t>>>;
+    SlabPool                           index_pool_;  // Узлы индекса (объявлен раньше индекса — живёт дольше)
+    Index                              index_;       // IMSI → узел
+};
+
+} // namespace pgw
@@ -3,41 +3,276 @@
 
 #include "blacklist.hpp"  // Подключение чёрного списка для проверки IMSI
 #include "session_manager.hpp"  // Подключение менеджера сессий для работы с сессиями
+#include "event_loop.hpp"  // Цикл событий epoll для неблокирующего приёма
+#include "imsi.hpp"  // Упакованный 64-битный IMSI
+#include "gtpv2.hpp"  // Разбор и ответы GTPv2-C
+#include "rate_limiter.hpp"  // Ограничение частоты по адресу источника
+#include "overload_controller.hpp"  // Защита от перегрузки
+#include <chrono>
+#include <span>
 #include <string>
 #include <thread>
 #include <atomic>
+#include <memory>
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <nlohmann/json.hpp>
 
 namespace pgw {
 
+// Счётчики одной стадии конвейера приём → обработка → отправка
+struct PipelineStageStats {
+    uint64_t queue_depth    = 0;  // Сколько элементов сейчас ждёт во входной очереди стадии
+    uint64_t queue_capacity = 0;  // Ёмкость входной очереди стадии
+    uint64_t processed      = 0;  // Сколько элементов стадия передала дальше
+    uint64_t dropped        = 0;  // Сколько элементов стадия отбросила (следующая очередь полна / ошибка отправки)
+};
+
+// Функция для сериализации счётчиков стадии в JSON
+inline void to_json(nlohmann::json& j, const PipelineStageStats& s) {
+    j = {
+        {"queue_depth", s.queue_depth},
+        {"queue_capacity", s.queue_capacity},
+        {"processed", s.processed},
+        {"dropped", s.dropped}
+    };
+}
+
+// Снимок счётчиков UDP сервера
+// Позволяет оценить, сколько датаграмм в среднем приходится на один системный вызов
+struct UdpStats {
+    uint64_t rx_packets  = 0;  // Принято датаграмм
+    uint64_t rx_syscalls = 0;  // Вызовов приёма (recvmmsg / io_uring_enter), вернувших хотя бы одну датаграмму
+    uint64_t tx_packets  = 0;  // Отправлено ответов
+    uint64_t tx_syscalls = 0;  // Вызовов отправки (sendmmsg / io_uring_enter с ответами)
+    std::vector<uint64_t> worker_rx_packets;  // Принято датаграмм каждым worker'ом
+    uint64_t gtp_messages = 0;  // Из них сообщений GTPv2-C
+    uint64_t gtp_invalid  = 0;  // Сообщений GTPv2-C с неверным заголовком (отброшены без ответа)
+    uint64_t throttled    = 0;  // Датаграмм, не прошедших ограничение частоты по источнику
+
+    // Конвейер (если включён): у "rx" входная очередь — сокет, поэтому её глубина не считается
+    bool               pipeline = false;
+    PipelineStageStats rx_stage;
+    PipelineStageStats process_stage;
+    PipelineStageStats tx_stage;
+
+    // Среднее число датаграмм на один вызов приёма
+    double rx_packets_per_syscall() const {
+        return rx_syscalls ? double(rx_packets) / double(rx_syscalls) : 0.0;
+    }
+
+    // Среднее число ответов на один вызов отправки
+    double tx_packets_per_syscall() const {
+        return tx_syscalls ? double(tx_packets) / double(tx_syscalls) : 0.0;
+    }
+};
+
+// Функция для сериализации счётчиков UDP сервера в JSON
+inline void to_json(nlohmann::json& j, const UdpStats& s) {
+    j = {
+        {"rx_packets", s.rx_packets},
+        {"rx_syscalls", s.rx_syscalls},
+        {"rx_packets_per_syscall", s.rx_packets_per_syscall()},
+        {"tx_packets", s.tx_packets},
+        {"tx_syscalls", s.tx_syscalls},
+        {"tx_packets_per_syscall", s.tx_packets_per_syscall()},
+        {"worker_rx_packets", s.worker_rx_packets},
+        {"gtp_messages", s.gtp_messages},
+        {"gtp_invalid", s.gtp_invalid},
+        {"throttled", s.throttled}
+    };
+    if (s.pipeline) {
+        j["pipeline"] = {
+            {"rx", s.rx_stage},
+            {"process", s.process_stage},
+            {"tx", s.tx_stage}
+        };
+    }
+}
+
+// Способ приёма датаграмм
+enum class UdpBackend {
+    Blocking,  // Блокирующий recvmmsg с таймаутом
+    Epoll,     // Неблокирующий сокет в цикле epoll
+    IoUring    // io_uring: multishot recvmsg в предоставленные буферы; при отсутствии поддержки — epoll
+};
+
+// Разбор имени бэкенда из конфигурации ("blocking" | "epoll" | "io_uring"); бросает std::invalid_argument
+UdpBackend udp_backend_from_string(const std::string& name);
+
+// Имя бэкенда для логов
+const char* to_string(UdpBackend backend) noexcept;
+
+// Параметры приёма UDP
+struct UdpServerOptions {
+    UdpBackend       backend    = UdpBackend::Epoll;  // Способ приёма датаграмм
+    size_t           batch_size = 32;  // Сколько датаграмм принимать/отправлять за один системный вызов
+    size_t           workers    = 1;   // Число потоков приёма, у каждого свой сокет SO_REUSEPORT
+    std::vector<int> cpu_affinity;     // CPU для привязки worker'ов (i-й worker → cpu_affinity[i % size]); пусто — без привязки
+
+    // Конвейер: потоки приёма только декодируют IMSI и кладут запрос в очередь, пул обработчиков
+    // проверяет чёрный список и продлевает сессии, отдельный поток отправляет ответы.
+    // У каждого обработчика своя очередь, абонент закреплён за одной из них по хешу IMSI —
+    // его сообщения обрабатываются по порядку. 0 — обработка и ответ прямо в потоке приёма
+    size_t           processing_threads = 0;
+    size_t           queue_capacity     = 4096;  // Ёмкость каждой очереди конвейера (округляется до степени двойки)
+
+    // Ограничение частоты по IP источника, проверяется до разбора датаграммы; 0 — выключено.
+    // У каждого worker'а своя таблица, темп и запас делятся между worker'ами поровну
+    double           rate_limit_pps     = 0;     // Пакетов в секунду на источник
+    uint32_t         rate_limit_burst   = 20;    // Сколько пакетов подряд источник может прислать сверх темпа
+    bool             rate_limit_reply   = false; // true — отвечать "throttled" (GTPv2-C всё равно отбрасывается)
+
+    // Защита от перегрузки: раз в overload_sample_interval оцениваются очередь обработки, буферы сокетов
+    // и задержка хранилища; в перегрузке новые сессии получают "busy", продление существующих работает.
+    // 0 — выключено
+    std::chrono::milliseconds overload_sample_interval{0};
+    OverloadThresholds        overload;
+};
+
 // Класс для работы с UDP сервером
-// Обрабатывает прием UDP пакетов и взаимодействует с черным списком и менеджером сессий
+// Обрабатывает прием UDP пакетов и взаимодействует с черным списком и менеджером сессий.
+// Принимает два протокола: голый BCD IMSI с текстовым ответом и GTPv2-C
+// (Echo, Create Session, Modify Bearer, Delete Session) — их различает looks_like_gtpv2.
+// Приём ведут несколько worker'ов, каждый со своим сокетом в группе SO_REUSEPORT;
+// CBPF-программа направляет все пакеты одного IMSI в один и тот же worker.
+// При processing_threads > 0 медленное хранилище сессий не задерживает чтение сокета:
+// стадии связаны ограниченными lock-free очередями, при переполнении запрос отбрасывается
 class UdpServer {
 public:
+    // Максимальное число датаграмм за один вызов recvmmsg/sendmmsg (ограничение ядра UIO_MAXIOV)
+    static constexpr size_t kMaxBatchSize = 1024;
+
     // Конструктор для инициализации сервера с указанием параметров IP, порта, чёрного списка и менеджера сессий
     UdpServer(const std::string& ip,  // IP-адрес для прослушивания
               uint16_t port,         // Порт для прослушивания
               Blacklist& blacklist,  // Чёрный список для проверки IMSI
-              SessionManager& sessions);  // Менеджер сессий для управления активными сессиями
+              SessionManager& sessions,  // Менеджер сессий для управления активными сессиями
+              UdpServerOptions options = {});  // Пакетный приём, число worker'ов и привязка к CPU
+
+    // Деструктор: останавливает worker'ов и закрывает сокеты
+    virtual ~UdpServer();
 
-    // Метод для запуска UDP сервера, который будет работать в фоновом потоке
+    // Метод для запуска UDP сервера: открывает сокеты и запускает потоки worker'ов
     virtual void start();
 
-    // Метод для ожидания завершения работы потока
+    // Метод для ожидания завершения работы потоков
     virtual void join();
 
-    // Метод для остановки приёма новых пакетов
+    // Метод для остановки приёма новых пакетов; будит потоки приёма немедленно
     virtual void stop();
 
+    // Текущие значения счётчиков приёма/отправки (сумма по worker'ам)
+    UdpStats stats() const;
+
+    // Контроллер перегрузки (nullptr — защита выключена)
+    const OverloadController* overload() const noexcept { return overload_.get(); }
+
 private:
-    // Основной цикл обработки UDP пакетов
-    void run_loop();
+    // Состояние одного потока приёма (определено в udp_server.cpp)
+    struct Worker;
+
+    // Буферы recvmmsg/sendmmsg на одну пачку (определены в udp_server.cpp)
+    struct BatchBuffers;
+
+    // Очереди и потоки конвейера (определены в udp_server.cpp)
+    struct Pipeline;
+
+    // Создаёт сокет worker'а в группе SO_REUSEPORT и привязывает его к адресу
+    int open_socket();
+
+    // Основной цикл обработки UDP пакетов одного worker'а: выбирает бэкенд
+    void run_loop(Worker& w);
+
+    // Бэкенд "blocking": recvmmsg с MSG_WAITFORONE на блокирующем сокете
+    void run_blocking_loop(Worker& w);
+
+    // Бэкенд "epoll": неблокирующий сокет в цикле событий
+    void run_epoll_loop(Worker& w);
+
+    // Бэкенд "io_uring"; возвращает false, если ядро его не поддерживает
+    bool run_uring_loop(Worker& w);
+
+    // Принимает и обрабатывает одну пачку датаграмм (recvmmsg + sendmmsg)
+    // Возвращает число принятых датаграмм (0 — очередь сокета пуста)
+    size_t process_batch(Worker& w, BatchBuffers& b, int recv_flags);
+
+    // Отправляет count ответов через сокет worker'а (sendmmsg с досылкой остатка), возвращает число отправленных
+    size_t send_replies(Worker& w, mmsghdr* msgs, size_t count);
+
+    // Обработка одной датаграммы (BCD IMSI), возвращает текст ответа
+    const char* handle_datagram(const uint8_t* data, size_t len);
+
+    // Разбор и обработка датаграммы GTPv2-C: ответ пишется в out (kGtpMaxResponseSize байт)
+    // Возвращает длину ответа; 0 — отвечать не нужно
+    size_t handle_gtp_datagram(Worker& w, const uint8_t* data, size_t len, uint8_t* out);
+
+    // Обработка разобранного сообщения GTPv2-C: сессия и туннель, ответ в out; возвращает длину ответа
+    size_t handle_gtp(const GtpMessage& req, GtpParseStatus status, uint8_t* out);
+
+    // Стадия приёма конвейера: ставит разобранный IMSI в очередь обработки
+    // Возвращает false, если очередь заполнена и запрос отброшен
+    bool enqueue_request(Worker& w, Imsi imsi, const sockaddr_in& from);
+
+    // То же для датаграммы GTPv2-C: разбирает её в потоке приёма и ставит в очередь разобранные поля
+    bool enqueue_gtp(Worker& w, const uint8_t* data, size_t len, const sockaddr_in& from);
+
+    // Стадия приёма конвейера: ставит готовый текстовый ответ прямо в очередь отправки
+    bool enqueue_reply(Worker& w, const char* text, const sockaddr_in& from);
+
+    // Проверяет ограничение частоты для источника датаграммы; true — датаграмма отбрасывается
+    bool is_throttled(Worker& w, const sockaddr_in& from, uint64_t now_ns);
+
+    // Будит обработчиков, в чьи очереди w положил запросы пачки enqueue_request
+    void notify_processors(Worker& w);
+
+    // Стадия обработки: чёрный список + сессия, ответ в очередь отправки; lane — своя очередь запросов
+    void run_processor(size_t lane);
+
+    // Стадия отправки: sendmmsg ответов через сокет принявшего worker'а
+    void run_sender();
+
+    // Обработка одного IMSI: чёрный список + создание/продление сессии, возвращает текст ответа
+    const char* handle_imsi(Imsi imsi);
+
+    // Результат обработки запроса на подключение
+    enum class Admission {
+        Accepted,  // Сессия создана или продлена
+        Rejected,  // Чёрный список или отказ менеджера сессий
+        Busy       // Перегрузка: новая сессия не создана
+    };
+
+    // Чёрный список + создание/продление сессии; в перегрузке — только продление
+    Admission admit_imsi(Imsi imsi);
+
+    // То же для пачки валидных IMSI одного recvmmsg: сессии создаются одним touch_batch
+    // (по одному обращению к хранилищу на шард); out[i] — итог для imsis[i]
+    void admit_batch(std::span<const Imsi> imsis, Admission* out);
+
+    // Текст ответа клиенту по итогу обработки
+    static const char* admission_reply(Admission a) noexcept;
+
+    // Поток выборки сигналов перегрузки
+    void run_overload_monitor();
+
+    // Текущие сигналы нагрузки: очередь конвейера и буферы сокетов (SO_MEMINFO)
+    OverloadSample sample_load() const;
 
     std::string ip_;  // IP-адрес для прослушивания UDP пакетов
     uint16_t port_;   // Порт для прослушивания UDP пакетов
     Blacklist& blacklist_;  // Ссылка на объект чёрного списка
     SessionManager& sessions_;  // Ссылка на объект менеджера сессий
+    UdpServerOptions options_;  // Параметры приёма
+    uint32_t local_ipv4_ = 0;   // Адрес сервера для Sender F-TEID (сетевой порядок байт)
+    GtpTunnelTable tunnels_;    // Туннели GTPv2-C: наш TEID → абонент
 
-    std::thread      thread_;  // Поток для выполнения приёма данных
+    std::vector<std::unique_ptr<Worker>> workers_;  // Потоки приёма
+    std::unique_ptr<Pipeline> pipeline_;  // Конвейер обработки (nullptr — обработка в потоке приёма)
+    std::unique_ptr<OverloadController> overload_;  // Защита от перегрузки (nullptr — выключена)
+    std::thread overload_thread_;  // Поток выборки сигналов перегрузки
     std::atomic<bool> running_{false};  // Флаг, указывающий на состояние сервера (работает или нет)
 };
 
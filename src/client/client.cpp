@@ -1,4 +1,5 @@
 #include "client.h"
+#include "pgw/imsi.hpp"
 #include <arpa/inet.h>
 #include <sys/socket.h>
 #include <unistd.h>
@@ -29,14 +30,11 @@ std::string generate_imsi() {
 }
 
 // Функция для преобразования IMSI в BCD (Binary-Coded Decimal) формат
+// Кодирование то же, что разбирает сервер (pgw::Imsi); для строки, не являющейся IMSI, — пустой вектор
 std::vector<uint8_t> imsi_to_bcd(const std::string& imsi) {
-    std::vector<uint8_t> bcd;
-    for (size_t i = 0; i < imsi.size(); i += 2) {
-        uint8_t low  = imsi[i]   - '0';  // Низкий 4 бита
-        uint8_t high = (i + 1 < imsi.size()) ? imsi[i + 1] - '0' : 0xF;  // Высокий 4 бита
-        bcd.push_back((high << 4) | low);  // Объединяем 2 цифры в 1 байт
-    }
-    return bcd;
+    uint8_t bcd[8];
+    size_t len = pgw::Imsi::from_string(imsi).to_bcd(bcd);
+    return std::vector<uint8_t>(bcd, bcd + len);
 }
 
 // Функция для отправки данных через сокет
@@ -73,6 +71,11 @@ int request_session(const std::string& imsi, const std::string& server_ip, uint1
 
     // Отправляем IMSI
     auto payload = imsi_to_bcd(imsi);  // Закодированный IMSI в BCD
+    if (payload.empty()) {
+        spdlog::error("Invalid IMSI: {}", imsi);  // Логирование ошибки при неверном IMSI
+        ::close(sock);
+        return EXIT_FAILURE;
+    }
     if (send_data(sock, payload.data(), payload.size(), serv) != EXIT_SUCCESS) {
         ::close(sock);
         return EXIT_FAILURE;
@@ -91,6 +94,8 @@ int request_session(const std::string& imsi, const std::string& server_ip, uint1
     std::string response(buf);  // Ответ от сервера
     if (response == "created") {
         spdlog::info("IMSI {}: Session created", imsi);  // Логирование успешного создания сессии
+    } else if (response == "busy" || response == "throttled") {
+        spdlog::warn("IMSI {}: Server is {}, retry later", imsi, response);  // Сервер перегружен или ограничил частоту
     } else {
         spdlog::warn("IMSI {}: Unknown response: {}", imsi, response);  // Логирование неизвестного ответа от сервера
     }
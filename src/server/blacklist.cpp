@@ -6,12 +6,17 @@ namespace pgw {
 Blacklist::Blacklist(const std::vector<std::string>& imsi_list) {
     blocked_.reserve(imsi_list.size());
     for (const auto& imsi : imsi_list) {
-        blocked_.insert(imsi);
+        Imsi packed = Imsi::from_string(imsi);
+        if (!packed.valid()) {
+            spdlog::warn("Skipping invalid blacklist entry '{}'", imsi);
+            continue;
+        }
+        blocked_.insert(packed);
     }
     spdlog::info("Loaded blacklist: {} entries", blocked_.size());
 }
 
-bool Blacklist::is_blocked(const std::string& imsi) const noexcept {
+bool Blacklist::is_blocked(Imsi imsi) const noexcept {
     // В чёрном списке? — логируем на уровне debug, чтобы потом не шуметь в инфо
     bool blocked = (blocked_.find(imsi) != blocked_.end());
     if (blocked) {
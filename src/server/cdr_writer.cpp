@@ -32,26 +32,44 @@ void CdrWriter::write(const CdrRecord& rec) {
     cv_.notify_one();
 }
 
+void CdrWriter::write_batch(std::span<const CdrRecord> recs) {
+    if (recs.empty())
+        return;
+    {
+        std::lock_guard<std::mutex> lk(mtx_);
+        for (const auto& rec : recs) {
+            queue_.push(rec);
+        }
+    }
+    cv_.notify_one();
+}
+
 void CdrWriter::writer_loop() {
     std::ofstream out(path_, std::ios::app);
     if (!out.is_open()) {
         spdlog::critical("Failed to open CDR file: {}", path_);
         return;
     }
+    std::queue<CdrRecord> pending;
     while (true) {
         std::unique_lock<std::mutex> lk(mtx_);
         cv_.wait(lk, [&]{ return stop_ || !queue_.empty(); });
         if (stop_ && queue_.empty())
             break;
 
-        CdrRecord rec = std::move(queue_.front());
-        queue_.pop();
+        // Забираем всё накопленное разом: пачка записей (например, выгрузка при graceful stop)
+        // пишется и сбрасывается на диск один раз
+        pending.swap(queue_);
         lk.unlock();
 
-        // Запись строки: timestamp,imsi,action\n
-        out << rec.timestamp << "," 
-            << rec.imsi      << "," 
-            << rec.action    << "\n";
+        for (; !pending.empty(); pending.pop()) {
+            // Запись строки: timestamp,imsi,action\n (метка и IMSI превращаются в строки только здесь)
+            const CdrRecord& rec = pending.front();
+            char imsi[Imsi::kMaxDigits];
+            out << format_timestamp(rec.timestamp) << ",";
+            out.write(imsi, static_cast<std::streamsize>(rec.imsi.to_chars(imsi)));
+            out << "," << rec.action << "\n";
+        }
         out.flush();
     }
     out.close();
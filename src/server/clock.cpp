@@ -0,0 +1,88 @@
+// src/server/clock.cpp
+#include "pgw/clock.hpp"
+
+#include <climits>
+#include <cstdio>
+#include <ctime>
+#include <stdexcept>
+#include <string>
+
+namespace pgw {
+
+CoarseClock::CoarseClock(std::chrono::milliseconds resolution)
+  : resolution_(resolution)
+{
+    if (resolution_.count() <= 0) {
+        throw std::invalid_argument("Clock resolution must be positive");
+    }
+    refresh();
+    thread_ = std::thread(&CoarseClock::run, this);
+}
+
+CoarseClock::~CoarseClock() {
+    {
+        std::lock_guard<std::mutex> lk(mtx_);
+        stop_ = true;
+    }
+    cv_.notify_all();
+    if (thread_.joinable())
+        thread_.join();
+}
+
+void CoarseClock::refresh() noexcept {
+    epoch_ms_.store(epoch_ms_now(), std::memory_order_relaxed);
+    steady_.store(std::chrono::steady_clock::now().time_since_epoch().count(), std::memory_order_relaxed);
+}
+
+void CoarseClock::run() {
+    std::unique_lock<std::mutex> lk(mtx_);
+    while (!cv_.wait_for(lk, resolution_, [this] { return stop_; })) {
+        refresh();
+    }
+}
+
+EpochMs epoch_ms_now() noexcept {
+    return std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+std::string_view format_timestamp(EpochMs ms) {
+    struct Cache {
+        int64_t sec = INT64_MIN;
+        char    buf[32];
+        size_t  len = 0;
+    };
+    thread_local Cache cache;
+
+    // Округление вниз и для меток до 1970 года
+    int64_t sec = ms / 1000 - (ms % 1000 < 0 ? 1 : 0);
+    if (sec != cache.sec) {
+        std::time_t t = static_cast<std::time_t>(sec);
+        std::tm tm{};
+        localtime_r(&t, &tm);
+        cache.len = std::strftime(cache.buf, sizeof(cache.buf), "%F %T", &tm);
+        cache.sec = sec;
+    }
+    return std::string_view(cache.buf, cache.len);
+}
+
+bool parse_timestamp(std::string_view text, EpochMs& out) {
+    std::tm tm{};
+    char    tail;
+    std::string s(text);
+    if (std::sscanf(s.c_str(), "%4d-%2d-%2d %2d:%2d:%2d%c",
+                    &tm.tm_year, &tm.tm_mon, &tm.tm_mday,
+                    &tm.tm_hour, &tm.tm_min, &tm.tm_sec, &tail) != 6) {
+        return false;
+    }
+    tm.tm_year -= 1900;
+    tm.tm_mon  -= 1;
+    tm.tm_isdst = -1;  // Летнее время определяет mktime по правилам часового пояса
+    std::time_t t = std::mktime(&tm);
+    if (t == static_cast<std::time_t>(-1))
+        return false;
+    out = static_cast<EpochMs>(t) * 1000;
+    return true;
+}
+
+} // namespace pgw
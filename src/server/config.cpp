@@ -30,7 +30,25 @@ Config Config::load_from_file(const std::string& path) {
     try {
         cfg.udp_ip                  = j.at("udp_ip").get<std::string>();
         cfg.udp_port                = j.at("udp_port").get<uint16_t>();
+        cfg.udp_backend             = j.value("udp_backend", std::string("epoll"));
+        cfg.udp_batch_size          = j.value("udp_batch_size", 32u);
+        cfg.udp_workers             = j.value("udp_workers", 1u);
+        cfg.udp_cpu_affinity        = j.value("udp_cpu_affinity", std::vector<int>{});
+        cfg.udp_processing_threads  = j.value("udp_processing_threads", 0u);
+        cfg.udp_queue_capacity      = j.value("udp_queue_capacity", 4096u);
+        cfg.udp_rate_limit_pps      = j.value("udp_rate_limit_pps", 0.0);
+        cfg.udp_rate_limit_burst    = j.value("udp_rate_limit_burst", 20u);
+        cfg.udp_rate_limit_reply    = j.value("udp_rate_limit_reply", false);
+        cfg.overload_sample_ms       = j.value("overload_sample_ms", 0u);
+        cfg.overload_queue_high      = j.value("overload_queue_high", 0.75);
+        cfg.overload_queue_low       = j.value("overload_queue_low", 0.25);
+        cfg.overload_backlog_high    = j.value("overload_backlog_high", 0.75);
+        cfg.overload_backlog_low     = j.value("overload_backlog_low", 0.25);
+        cfg.overload_latency_high_ms = j.value("overload_latency_high_ms", 20u);
+        cfg.overload_latency_low_ms  = j.value("overload_latency_low_ms", 5u);
         cfg.session_timeout_sec     = j.at("session_timeout_sec").get<uint32_t>();
+        cfg.session_shards          = j.value("session_shards", 16u);
+        cfg.max_sessions            = j.value("max_sessions", uint64_t(0));
         cfg.cdr_file                = j.at("cdr_file").get<std::string>();
         cfg.http_port               = j.at("http_port").get<uint16_t>();
         cfg.graceful_shutdown_rate  = j.at("graceful_shutdown_rate").get<uint32_t>();
@@ -39,6 +57,19 @@ Config Config::load_from_file(const std::string& path) {
         cfg.blacklist               = j.at("blacklist").get<std::vector<std::string>>();
         cfg.session_store          = j.value("session_store", std::string("in_memory"));
         cfg.sqlite_db_path         = j.value("sqlite_db_path", std::string("sessions.db"));
+        cfg.sqlite_journal_mode       = j.value("sqlite_journal_mode", std::string("wal"));
+        cfg.sqlite_synchronous        = j.value("sqlite_synchronous", std::string("normal"));
+        cfg.sqlite_commit_interval_ms = j.value("sqlite_commit_interval_ms", 0u);
+        cfg.sqlite_commit_rows        = j.value("sqlite_commit_rows", 1024u);
+        cfg.sqlite_expire_chunk_rows  = j.value("sqlite_expire_chunk_rows", 1000u);
+        cfg.sqlite_read_connections   = j.value("sqlite_read_connections", 0u);
+        cfg.tiered_writeback_interval_ms = j.value("tiered_writeback_interval_ms", 100u);
+        cfg.tiered_writeback_rows        = j.value("tiered_writeback_rows", 4096u);
+        cfg.flat_store_capacity    = j.value("flat_store_capacity", uint64_t(0));
+        cfg.flat_store_huge_pages  = j.value("flat_store_huge_pages", false);
+        cfg.snapshot_path            = j.value("snapshot_path", std::string());
+        cfg.snapshot_interval_sec    = j.value("snapshot_interval_sec", 60u);
+        cfg.snapshot_restore_threads = j.value("snapshot_restore_threads", 0u);
 
     } catch (const json::type_error& e) {
         throw std::runtime_error(std::string("Config type error: ") + e.what());
@@ -49,10 +80,42 @@ Config Config::load_from_file(const std::string& path) {
     // Логирование успешной загрузки
     spdlog::info("Config loaded from {}", path);
     spdlog::info(" UDP: {}:{}", cfg.udp_ip, cfg.udp_port);
+    spdlog::info(" UDP backend: {}, batch size: {}", cfg.udp_backend, cfg.udp_batch_size);
+    spdlog::info(" UDP workers: {}, pinned CPUs: {}", cfg.udp_workers, cfg.udp_cpu_affinity.size());
+    spdlog::info(" UDP processing threads: {}, queue capacity: {}", cfg.udp_processing_threads, cfg.udp_queue_capacity);
+    if (cfg.udp_rate_limit_pps > 0) {
+        spdlog::info(" UDP rate limit: {} packets/sec per source, burst {}", cfg.udp_rate_limit_pps, cfg.udp_rate_limit_burst);
+    }
+    if (cfg.overload_sample_ms > 0) {
+        spdlog::info(" Overload protection: every {} ms, queue {}/{}, backlog {}/{}, store latency {}/{} ms",
+                     cfg.overload_sample_ms, cfg.overload_queue_high, cfg.overload_queue_low,
+                     cfg.overload_backlog_high, cfg.overload_backlog_low,
+                     cfg.overload_latency_high_ms, cfg.overload_latency_low_ms);
+    }
     spdlog::info(" Session timeout: {} sec", cfg.session_timeout_sec);
-    spdlog::info(" Session store: {}", cfg.session_store);
-    if (cfg.session_store == "sqlite") {
+    spdlog::info(" Session store: {}, shards: {}", cfg.session_store, cfg.session_shards);
+    if (cfg.max_sessions > 0) {
+        spdlog::info(" Max sessions: {}", cfg.max_sessions);
+    }
+    if (cfg.session_store == "sqlite" || cfg.session_store == "tiered") {
         spdlog::info(" SQLite DB path: {}", cfg.sqlite_db_path);
+        spdlog::info(" SQLite journal mode: {}, synchronous: {}, commit every {} ms or {} rows",
+                     cfg.sqlite_journal_mode, cfg.sqlite_synchronous,
+                     cfg.sqlite_commit_interval_ms, cfg.sqlite_commit_rows);
+        spdlog::info(" SQLite expired sessions deleted in chunks of {} rows", cfg.sqlite_expire_chunk_rows);
+        spdlog::info(" SQLite read connections: {}", cfg.sqlite_read_connections);
+    }
+    if (cfg.session_store == "tiered") {
+        spdlog::info(" Tiered write-back: every {} ms or {} rows per shard",
+                     cfg.tiered_writeback_interval_ms, cfg.tiered_writeback_rows);
+    }
+    if (cfg.session_store == "flat") {
+        spdlog::info(" Flat store capacity: {} sessions, huge pages: {}",
+                     cfg.flat_store_capacity, cfg.flat_store_huge_pages);
+    }
+    if (!cfg.snapshot_path.empty()) {
+        spdlog::info(" Session snapshot: {} every {} sec, restore threads: {}",
+                     cfg.snapshot_path, cfg.snapshot_interval_sec, cfg.snapshot_restore_threads);
     }
     spdlog::info(" HTTP port: {}", cfg.http_port);
     spdlog::info(" Graceful shutdown rate: {} sessions/sec", cfg.graceful_shutdown_rate);
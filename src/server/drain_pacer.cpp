@@ -0,0 +1,61 @@
+// src/server/drain_pacer.cpp
+#include "pgw/drain_pacer.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+namespace pgw {
+
+DrainPacer::DrainPacer(double rate, size_t batch, uint64_t now_ns)
+    : origin_ns_(now_ns)
+{
+    if (!(rate > 0.0) || rate > 1e9) {
+        throw std::invalid_argument("Drain rate must be between 0 and 1e9 sessions per second");
+    }
+    if (batch == 0) {
+        throw std::invalid_argument("Drain batch must be positive");
+    }
+    interval_ns_ = 1e9 / rate;
+    batch_       = batch;
+    empty_at_    = -interval_ns_;  // Один маркер готов сразу
+}
+
+size_t DrainPacer::batch_for(double rate) noexcept {
+    if (!(rate >= 1000.0))
+        return 1;
+    return std::min(kMaxBatch, static_cast<size_t>(rate / 1000.0));
+}
+
+size_t DrainPacer::available(uint64_t now_ns) const noexcept {
+    double now = static_cast<double>(now_ns - origin_ns_);
+    if (now <= empty_at_)
+        return 0;
+    double tokens = std::floor((now - empty_at_) / interval_ns_);
+    size_t n = tokens >= double(batch_) ? batch_ : static_cast<size_t>(tokens);
+    // Согласуем с ready_at: маркер, готовый к округлённому вверх моменту, уже готов
+    if (n < batch_ && ready_at(n + 1) <= now_ns)
+        ++n;
+    return n;
+}
+
+uint64_t DrainPacer::ready_at(size_t n) const noexcept {
+    double at = empty_at_ + double(std::min(n, batch_)) * interval_ns_;
+    return origin_ns_ + static_cast<uint64_t>(std::max(0.0, std::ceil(at)));
+}
+
+void DrainPacer::take(size_t n, uint64_t now_ns) noexcept {
+    // Корзина не копит больше пачки: после паузы расписание начинается не раньше now - пачка.
+    // Допуск в наносекунду — округление ready_at вверх не должно сдвигать расписание
+    double now   = static_cast<double>(now_ns - origin_ns_);
+    double floor = now - double(batch_) * interval_ns_;
+    if (floor > empty_at_ + 1.0)
+        empty_at_ = floor;
+    empty_at_ += double(n) * interval_ns_;
+}
+
+void DrainPacer::give_back(size_t n) noexcept {
+    empty_at_ -= double(n) * interval_ns_;
+}
+
+} // namespace pgw
@@ -0,0 +1,98 @@
+// src/server/event_loop.cpp
+#include "pgw/event_loop.hpp"
+#include <spdlog/spdlog.h>
+
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+
+namespace pgw {
+
+// Сколько событий забирать за один вызов epoll_wait
+static constexpr int kMaxEvents = 64;
+
+EventLoop::EventLoop() {
+    epoll_fd_ = ::epoll_create1(EPOLL_CLOEXEC);
+    if (epoll_fd_ < 0) {
+        throw std::runtime_error(std::string("epoll_create1 failed: ") + std::strerror(errno));
+    }
+
+    wake_fd_ = ::eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (wake_fd_ < 0) {
+        int err = errno;
+        ::close(epoll_fd_);
+        throw std::runtime_error(std::string("eventfd failed: ") + std::strerror(err));
+    }
+
+    epoll_event ev{};
+    ev.events  = EPOLLIN;
+    ev.data.fd = wake_fd_;
+    if (::epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, wake_fd_, &ev) < 0) {
+        int err = errno;
+        ::close(wake_fd_);
+        ::close(epoll_fd_);
+        throw std::runtime_error(std::string("epoll_ctl(eventfd) failed: ") + std::strerror(err));
+    }
+}
+
+EventLoop::~EventLoop() {
+    if (wake_fd_ >= 0) ::close(wake_fd_);
+    if (epoll_fd_ >= 0) ::close(epoll_fd_);
+}
+
+void EventLoop::add(int fd, uint32_t events, Handler handler) {
+    epoll_event ev{};
+    ev.events  = events;
+    ev.data.fd = fd;
+    if (::epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, fd, &ev) < 0) {
+        throw std::runtime_error(std::string("epoll_ctl(ADD) failed: ") + std::strerror(errno));
+    }
+    handlers_[fd] = std::move(handler);
+}
+
+void EventLoop::remove(int fd) {
+    ::epoll_ctl(epoll_fd_, EPOLL_CTL_DEL, fd, nullptr);
+    handlers_.erase(fd);
+}
+
+void EventLoop::run() {
+    epoll_event events[kMaxEvents];
+
+    while (!stop_.load(std::memory_order_acquire)) {
+        // Без таймаута: поток спит, пока не придут данные или stop()
+        int n = ::epoll_wait(epoll_fd_, events, kMaxEvents, -1);
+        if (n < 0) {
+            if (errno == EINTR)
+                continue;
+            spdlog::critical("epoll_wait failed: {}", std::strerror(errno));
+            return;
+        }
+
+        for (int i = 0; i < n; ++i) {
+            int fd = events[i].data.fd;
+            if (fd == wake_fd_) {
+                uint64_t value;
+                while (::read(wake_fd_, &value, sizeof(value)) > 0) {}
+                continue;
+            }
+            auto it = handlers_.find(fd);
+            if (it != handlers_.end()) {
+                it->second(events[i].events);
+            }
+        }
+    }
+}
+
+void EventLoop::stop() {
+    stop_.store(true, std::memory_order_release);
+    uint64_t one = 1;
+    if (::write(wake_fd_, &one, sizeof(one)) < 0 && errno != EAGAIN) {
+        spdlog::error("Failed to wake event loop: {}", std::strerror(errno));
+    }
+}
+
+} // namespace pgw
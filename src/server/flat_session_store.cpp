@@ -0,0 +1,469 @@
+// src/server/flat_session_store.cpp
+#include "pgw/flat_session_store.hpp"
+
+#include <spdlog/spdlog.h>
+#include <sys/mman.h>
+#include <algorithm>
+#include <cerrno>
+#include <system_error>
+#include <utility>
+
+namespace pgw {
+
+static constexpr size_t kMinSlots       = 16;
+static constexpr size_t kHugePageSize   = size_t(2) << 20;
+static constexpr size_t kPrefetchAhead  = 4;  // На сколько элементов пачки вперёд подгружать слоты
+static constexpr size_t kMaxReadGroups  = 8;  // Сколько групп читатель проверяет за один поиск
+
+// Слотов на capacity записей при заполнении не больше 7/8, степень двойки
+static size_t slots_for(size_t capacity) {
+    size_t need  = capacity + capacity / 7 + 1;
+    size_t slots = kMinSlots;
+    while (slots < need)
+        slots <<= 1;
+    return slots;
+}
+
+// Поля слота читаются без мьютекса — пишем и читаем их атомарно (на x86 это обычные mov)
+template <typename T>
+static T load_relaxed(const T& field) noexcept {
+    return std::atomic_ref<T>(const_cast<T&>(field)).load(std::memory_order_relaxed);
+}
+
+template <typename T>
+static void store_relaxed(T& field, T value) noexcept {
+    std::atomic_ref<T>(field).store(value, std::memory_order_relaxed);
+}
+
+static inline void cpu_relax() noexcept {
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_ia32_pause();
+#endif
+}
+
+FlatSessionStore::Table::~Table() {
+    if (slots)
+        ::munmap(slots, bytes);
+}
+
+FlatSessionStore::FlatSessionStore(size_t capacity, bool huge_pages)
+  : want_huge_(huge_pages)
+{
+    rehash(slots_for(capacity));
+    if (want_huge_ && !tables_.back()->huge) {
+        spdlog::warn("Huge pages are not available, session table uses regular pages");
+    }
+}
+
+FlatSessionStore::~FlatSessionStore() = default;
+
+std::unique_ptr<FlatSessionStore::Table> FlatSessionStore::allocate(size_t slots) {
+    auto t = std::make_unique<Table>();
+    t->bytes = slots * sizeof(Slot);
+    void* p = MAP_FAILED;
+    if (want_huge_) {
+        t->bytes = (t->bytes + kHugePageSize - 1) & ~(kHugePageSize - 1);
+        p = ::mmap(nullptr, t->bytes, PROT_READ | PROT_WRITE,
+                   MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+        t->huge = p != MAP_FAILED;
+        // Пул huge pages не настроен (vm.nr_hugepages) — обычные страницы с просьбой о THP
+    }
+    if (p == MAP_FAILED) {
+        p = ::mmap(nullptr, t->bytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (p == MAP_FAILED) {
+            throw std::system_error(errno, std::generic_category(), "Failed to allocate session table");
+        }
+        if (want_huge_) {
+            t->huge = ::madvise(p, t->bytes, MADV_HUGEPAGE) == 0;
+        }
+    }
+    t->slots = static_cast<Slot*>(p);
+    t->mask  = slots - 1;
+    t->shift = 64 - unsigned(__builtin_ctzll(slots));
+
+    size_t groups = std::max<size_t>(1, slots >> kGroupBits);
+    t->group_mask = groups - 1;
+    t->seq = std::make_unique<std::atomic<uint32_t>[]>(groups);
+    return t;
+}
+
+void FlatSessionStore::rehash(size_t slots) {
+    auto fresh = allocate(slots);
+
+    // Новая таблица ещё не видна читателям — заполняем её без seqlock
+    size_t moved = 0;
+    if (!tables_.empty()) {
+        const Table& old = *tables_.back();
+        for (size_t i = 0; i <= old.mask; ++i) {
+            if (old.slots[i].key) {
+                insert_new(*fresh, old.slots[i], false);
+                ++moved;
+            }
+        }
+    }
+    max_load_ = slots - slots / 8;
+    size_.store(moved, std::memory_order_relaxed);
+
+    // Прежняя таблица остаётся в tables_: читатель мог взять её указатель до публикации новой
+    tables_.push_back(std::move(fresh));
+    table_.store(tables_.back().get(), std::memory_order_release);
+}
+
+// Сколько групп покрывают len слотов от first. Диапазон, почти обходящий таблицу, может зайти
+// в начальную группу повторно — тогда открываем все
+static size_t touched_groups(size_t first, size_t len, size_t slots, size_t group_mask, unsigned group_bits) {
+    if (len + (size_t(1) << group_bits) >= slots)
+        return group_mask + 1;
+    size_t g_first = (first >> group_bits) & group_mask;
+    size_t g_last  = ((first + len - 1) >> group_bits) & group_mask;
+    return ((g_last - g_first) & group_mask) + 1;
+}
+
+void FlatSessionStore::write_begin(Table& t, size_t first, size_t len) noexcept {
+    size_t count = touched_groups(first, len, t.mask + 1, t.group_mask, kGroupBits);
+    for (size_t k = 0, g = t.group(first); k < count; ++k, g = (g + 1) & t.group_mask) {
+        t.seq[g].store(t.seq[g].load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    }
+    // Нечётные счётчики должны стать видны раньше изменённых слотов
+    std::atomic_thread_fence(std::memory_order_release);
+}
+
+void FlatSessionStore::write_end(Table& t, size_t first, size_t len) noexcept {
+    size_t count = touched_groups(first, len, t.mask + 1, t.group_mask, kGroupBits);
+    for (size_t k = 0, g = t.group(first); k < count; ++k, g = (g + 1) & t.group_mask) {
+        t.seq[g].store(t.seq[g].load(std::memory_order_relaxed) + 1, std::memory_order_release);
+    }
+}
+
+std::optional<FlatSessionStore::Slot> FlatSessionStore::read(uint64_t key) const noexcept {
+    for (;;) {
+        const Table& t = *table_.load(std::memory_order_acquire);
+        size_t   groups[kMaxReadGroups];
+        uint32_t versions[kMaxReadGroups];
+        size_t   used  = 0;
+        bool     retry = false, overflow = false;
+        std::optional<Slot> found;
+
+        size_t i = t.home(key);
+        for (size_t dist = 0; dist <= t.mask; ++dist, i = (i + 1) & t.mask) {
+            size_t g = t.group(i);
+            if (used == 0 || groups[used - 1] != g) {
+                if (used == kMaxReadGroups) {
+                    overflow = true;
+                    break;
+                }
+                uint32_t v = t.seq[g].load(std::memory_order_acquire);
+                if (v & 1) {
+                    retry = true;  // Группа сейчас меняется
+                    break;
+                }
+                groups[used]   = g;
+                versions[used] = v;
+                ++used;
+            }
+            Slot s{ load_relaxed(t.slots[i].key),
+                    load_relaxed(t.slots[i].created_at),
+                    load_relaxed(t.slots[i].expires_at) };
+            if (s.key == key) {
+                found = s;
+                break;
+            }
+            if (s.key == 0 || t.distance(s.key, i) < dist)
+                break;
+        }
+
+        if (overflow) {
+            // Цепочка длиннее kMaxReadGroups групп на практике не встречается; если всё же
+            // встретилась — ищем под мьютексом, как писатель
+            std::lock_guard<std::mutex> lk(mtx_);
+            size_t j = find(key);
+            if (j == kNotFound)
+                return std::nullopt;
+            return tables_.back()->slots[j];
+        }
+        if (!retry) {
+            // Прочитанные слоты должны быть получены до повторной проверки версий
+            std::atomic_thread_fence(std::memory_order_acquire);
+            for (size_t k = 0; k < used && !retry; ++k) {
+                retry = t.seq[groups[k]].load(std::memory_order_relaxed) != versions[k];
+            }
+        }
+        if (!retry)
+            return found;
+        cpu_relax();
+    }
+}
+
+template <typename Pred>
+std::vector<StoredSession> FlatSessionStore::read_all(Pred keep) const {
+    const Table& t = *table_.load(std::memory_order_acquire);
+    const size_t group_size = std::min<size_t>(t.mask + 1, size_t(1) << kGroupBits);
+
+    std::vector<StoredSession> out;
+    Slot copy[size_t(1) << kGroupBits];
+    for (size_t g = 0; g <= t.group_mask; ++g) {
+        const Slot* base = t.slots + g * group_size;
+        size_t n;
+        for (;;) {
+            uint32_t v = t.seq[g].load(std::memory_order_acquire);
+            if (v & 1) {
+                cpu_relax();
+                continue;
+            }
+            n = 0;
+            for (size_t i = 0; i < group_size; ++i) {
+                Slot s{ load_relaxed(base[i].key),
+                        load_relaxed(base[i].created_at),
+                        load_relaxed(base[i].expires_at) };
+                if (s.key && keep(s))
+                    copy[n++] = s;
+            }
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (t.seq[g].load(std::memory_order_relaxed) == v)
+                break;
+        }
+        for (size_t i = 0; i < n; ++i) {
+            out.push_back({ Imsi::from_packed(copy[i].key), copy[i].created_at, copy[i].expires_at });
+        }
+    }
+    return out;
+}
+
+size_t FlatSessionStore::find(uint64_t key) const noexcept {
+    const Table& t = *tables_.back();
+    size_t i = t.home(key);
+    for (size_t dist = 0;; ++dist, i = (i + 1) & t.mask) {
+        const Slot& s = t.slots[i];
+        if (s.key == key)
+            return i;
+        // Пустой слот или запись ближе к своему дому, чем искомая была бы к своему, — ключа нет
+        if (s.key == 0 || t.distance(s.key, i) < dist)
+            return kNotFound;
+    }
+}
+
+void FlatSessionStore::insert_new(Table& t, Slot rec, bool shared) noexcept {
+    const size_t first = t.home(rec.key);
+
+    // Вставка меняет слоты от домашнего до первого пустого — их группы и открываем
+    size_t len = 1;
+    if (shared) {
+        for (size_t i = first; t.slots[i].key != 0; i = (i + 1) & t.mask)
+            ++len;
+        write_begin(t, first, len);
+    }
+
+    size_t i = first;
+    for (size_t dist = 0;; ++dist, i = (i + 1) & t.mask) {
+        Slot& s = t.slots[i];
+        if (s.key == 0) {
+            store_relaxed(s.created_at, rec.created_at);
+            store_relaxed(s.expires_at, rec.expires_at);
+            store_relaxed(s.key, rec.key);
+            break;
+        }
+        // Robin Hood: занимаем место записи, которая ушла от дома меньше, и несём её дальше
+        size_t d = t.distance(s.key, i);
+        if (d < dist) {
+            Slot displaced = s;
+            store_relaxed(s.key, rec.key);
+            store_relaxed(s.created_at, rec.created_at);
+            store_relaxed(s.expires_at, rec.expires_at);
+            rec  = displaced;
+            dist = d;
+        }
+    }
+
+    if (shared) {
+        write_end(t, first, len);
+        size_.fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+void FlatSessionStore::erase_at(size_t i) noexcept {
+    Table& t = *tables_.back();
+
+    // Обратный сдвиг: записи хвоста цепочки переезжают на слот ближе к дому
+    size_t len = 1;
+    for (size_t j = (i + 1) & t.mask; t.slots[j].key != 0 && t.distance(t.slots[j].key, j) != 0;
+         j = (j + 1) & t.mask)
+        ++len;
+    write_begin(t, i, len);
+
+    const size_t first = i;
+    size_t next = (i + 1) & t.mask;
+    for (size_t k = 1; k < len; ++k) {
+        const Slot& src = t.slots[next];
+        store_relaxed(t.slots[i].key, src.key);
+        store_relaxed(t.slots[i].created_at, src.created_at);
+        store_relaxed(t.slots[i].expires_at, src.expires_at);
+        i    = next;
+        next = (next + 1) & t.mask;
+    }
+    store_relaxed(t.slots[i].key, uint64_t(0));
+
+    write_end(t, first, len);
+    size_.fetch_sub(1, std::memory_order_relaxed);
+}
+
+bool FlatSessionStore::reserve_one() {
+    if (size_.load(std::memory_order_relaxed) < max_load_)
+        return true;
+    const size_t slots = (tables_.back()->mask + 1) * 2;
+    try {
+        spdlog::warn("Session table is full ({} sessions), growing to {} slots", size(), slots);
+        rehash(slots);
+        return true;
+    } catch (const std::system_error& e) {
+        spdlog::error("Failed to grow session table: {}", e.what());
+        return false;
+    }
+}
+
+UpsertResult FlatSessionStore::upsert_locked(const StoredSession& s) {
+    const uint64_t key = s.imsi.packed();
+    if (key == 0)
+        return UpsertResult::Failed;
+    size_t i = find(key);
+    if (i != kNotFound) {
+        Table& t = *tables_.back();
+        write_begin(t, i, 1);
+        store_relaxed(t.slots[i].expires_at, s.expires_at);
+        write_end(t, i, 1);
+        return UpsertResult::Refreshed;
+    }
+    if (!reserve_one())
+        return UpsertResult::Failed;
+    insert_new(*tables_.back(), { key, s.created_at, s.expires_at }, true);
+    return UpsertResult::Created;
+}
+
+std::vector<StoredSession> FlatSessionStore::load_sessions(EpochMs now) {
+    return read_all([now](const Slot& s) { return now < s.expires_at; });
+}
+
+bool FlatSessionStore::save_session(const StoredSession& s) {
+    std::lock_guard<std::mutex> lk(mtx_);
+    const uint64_t key = s.imsi.packed();
+    if (key == 0)
+        return false;
+    size_t i = find(key);
+    if (i != kNotFound) {
+        Table& t = *tables_.back();
+        write_begin(t, i, 1);
+        store_relaxed(t.slots[i].created_at, s.created_at);
+        store_relaxed(t.slots[i].expires_at, s.expires_at);
+        write_end(t, i, 1);
+        return true;
+    }
+    if (!reserve_one())
+        return false;
+    insert_new(*tables_.back(), { key, s.created_at, s.expires_at }, true);
+    return true;
+}
+
+bool FlatSessionStore::delete_session(Imsi imsi) {
+    std::lock_guard<std::mutex> lk(mtx_);
+    if (!imsi.valid())
+        return false;
+    size_t i = find(imsi.packed());
+    if (i == kNotFound)
+        return false;
+    erase_at(i);
+    return true;
+}
+
+bool FlatSessionStore::session_exists(Imsi imsi) {
+    return imsi.valid() && read(imsi.packed()).has_value();
+}
+
+std::optional<StoredSession> FlatSessionStore::get_session(Imsi imsi) {
+    if (!imsi.valid())
+        return std::nullopt;
+    auto s = read(imsi.packed());
+    if (!s)
+        return std::nullopt;
+    return StoredSession{ imsi, s->created_at, s->expires_at };
+}
+
+void FlatSessionStore::cleanup_expired_sessions(EpochMs now) {
+    std::lock_guard<std::mutex> lk(mtx_);
+    const Table& t = *tables_.back();
+    // После удаления в слот i сдвигается следующая запись — её тоже надо проверить.
+    // Сдвиг затрагивает только слоты не левее i (и уже проверенные в начале массива при переносе
+    // цепочки через его конец), так что ни одна запись не пропускается
+    for (size_t i = 0; i <= t.mask; ) {
+        if (t.slots[i].key && t.slots[i].expires_at <= now)
+            erase_at(i);
+        else
+            ++i;
+    }
+}
+
+std::vector<StoredSession> FlatSessionStore::load_expired_sessions(EpochMs now) {
+    return read_all([now](const Slot& s) { return s.expires_at <= now; });
+}
+
+UpsertResult FlatSessionStore::upsert(const StoredSession& s) {
+    std::lock_guard<std::mutex> lk(mtx_);
+    return upsert_locked(s);
+}
+
+std::vector<UpsertResult> FlatSessionStore::upsert_batch(std::span<const StoredSession> sessions) {
+    std::vector<UpsertResult> result;
+    result.reserve(sessions.size());
+    std::lock_guard<std::mutex> lk(mtx_);
+    for (size_t k = 0; k < sessions.size(); ++k) {
+        if (k + kPrefetchAhead < sessions.size()) {
+            const Table& t = *tables_.back();
+            __builtin_prefetch(&t.slots[t.home(sessions[k + kPrefetchAhead].imsi.packed())]);
+        }
+        result.push_back(upsert_locked(sessions[k]));
+    }
+    return result;
+}
+
+size_t FlatSessionStore::delete_batch(std::span<const Imsi> imsis) {
+    std::lock_guard<std::mutex> lk(mtx_);
+    const Table& t = *tables_.back();
+    size_t removed = 0;
+    for (size_t k = 0; k < imsis.size(); ++k) {
+        if (k + kPrefetchAhead < imsis.size())
+            __builtin_prefetch(&t.slots[t.home(imsis[k + kPrefetchAhead].packed())]);
+        if (!imsis[k].valid())
+            continue;
+        size_t i = find(imsis[k].packed());
+        if (i != kNotFound) {
+            erase_at(i);
+            ++removed;
+        }
+    }
+    return removed;
+}
+
+std::vector<std::optional<StoredSession>> FlatSessionStore::lookup_batch(std::span<const Imsi> imsis) {
+    std::vector<std::optional<StoredSession>> result(imsis.size());
+    const Table& t = *table_.load(std::memory_order_acquire);
+    for (size_t k = 0; k < imsis.size(); ++k) {
+        if (k + kPrefetchAhead < imsis.size())
+            __builtin_prefetch(&t.slots[t.home(imsis[k + kPrefetchAhead].packed())]);
+        if (!imsis[k].valid())
+            continue;
+        if (auto s = read(imsis[k].packed()))
+            result[k] = StoredSession{ imsis[k], s->created_at, s->expires_at };
+    }
+    return result;
+}
+
+MemoryUsage FlatSessionStore::memory_usage() {
+    std::lock_guard<std::mutex> lk(mtx_);
+    MemoryUsage m;
+    // Прежние таблицы после роста тоже держат память (их могут читать без блокировки)
+    for (auto& t : tables_) {
+        m.bytes_reserved += t->bytes + (t->group_mask + 1) * sizeof(std::atomic<uint32_t>);
+    }
+    m.bytes_in_use = size() * sizeof(Slot);
+    return m;
+}
+
+} // namespace pgw
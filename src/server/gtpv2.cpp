@@ -0,0 +1,205 @@
+// src/server/gtpv2.cpp
+#include "pgw/gtpv2.hpp"
+
+#include <cstring>
+
+namespace pgw {
+
+static uint32_t load_be32(const uint8_t* p) noexcept {
+    return (uint32_t(p[0]) << 24) | (uint32_t(p[1]) << 16) | (uint32_t(p[2]) << 8) | uint32_t(p[3]);
+}
+
+static uint8_t* store_be16(uint8_t* p, uint16_t v) noexcept {
+    p[0] = uint8_t(v >> 8);
+    p[1] = uint8_t(v);
+    return p + 2;
+}
+
+static uint8_t* store_be32(uint8_t* p, uint32_t v) noexcept {
+    p[0] = uint8_t(v >> 24);
+    p[1] = uint8_t(v >> 16);
+    p[2] = uint8_t(v >> 8);
+    p[3] = uint8_t(v);
+    return p + 4;
+}
+
+// Заголовок IE; возвращает указатель на начало значения
+static uint8_t* put_ie_header(uint8_t* p, GtpIeType type, uint16_t len) noexcept {
+    p[0] = uint8_t(type);
+    store_be16(p + 1, len);
+    p[3] = 0;  // instance 0
+    return p + kGtpIeHeaderSize;
+}
+
+static uint8_t* put_cause(uint8_t* p, GtpCause cause) noexcept {
+    p = put_ie_header(p, GtpIeType::Cause, 2);
+    p[0] = uint8_t(cause);
+    p[1] = 0;  // Флаги PCE/BCE/CS
+    return p + 2;
+}
+
+// EBI из вложенных IE Bearer Context; false — вложенные IE испорчены
+static bool parse_bearer_context(std::span<const uint8_t> value, GtpMessage& msg) noexcept {
+    GtpIeReader reader(value);
+    GtpIe ie;
+    while (reader.next(ie)) {
+        if (ie.type == uint8_t(GtpIeType::Ebi) && ie.instance == 0 && !ie.value.empty())
+            msg.ebi = ie.value[0] & 0x0F;
+    }
+    return !reader.malformed();
+}
+
+GtpParseStatus parse_gtpv2(const uint8_t* data, size_t len, GtpMessage& msg) noexcept {
+    msg = GtpMessage{};
+    if (len < kGtpShortHeaderSize || (data[0] >> 5) != 2)
+        return GtpParseStatus::InvalidHeader;
+
+    // Длина в заголовке не включает первые 4 байта; за сообщением может следовать piggyback-сообщение
+    size_t msg_len = 4 + ((size_t(data[2]) << 8) | data[3]);
+    msg.has_teid = (data[0] & 0x08) != 0;
+    size_t header_len = msg.has_teid ? kGtpHeaderSize : kGtpShortHeaderSize;
+    if (msg_len < header_len || msg_len > len)
+        return GtpParseStatus::InvalidHeader;
+
+    msg.type = data[1];
+    const uint8_t* p = data + 4;
+    if (msg.has_teid) {
+        msg.teid = load_be32(p);
+        p += 4;
+    }
+    msg.sequence = (uint32_t(p[0]) << 16) | (uint32_t(p[1]) << 8) | uint32_t(p[2]);
+    msg.ies = std::span<const uint8_t>(data + header_len, msg_len - header_len);
+
+    // Нужные PGW IE верхнего уровня (instance 0); остальные пропускаются
+    GtpIeReader reader(msg.ies);
+    GtpIe ie;
+    bool ok = true;
+    while (reader.next(ie)) {
+        if (ie.instance != 0)
+            continue;
+        switch (GtpIeType(ie.type)) {
+        case GtpIeType::Imsi:
+            msg.has_imsi = true;
+            // IE длиннее 8 байт — не IMSI (from_bcd вернёт невалидный)
+            msg.imsi = Imsi::from_bcd(ie.value.data(), ie.value.size());
+            break;
+        case GtpIeType::FTeid:
+            // Флаги и тип интерфейса, TEID/GRE key, затем адреса
+            if (ie.value.size() >= 5) {
+                msg.has_sender_teid = true;
+                msg.sender_teid = load_be32(ie.value.data() + 1);
+            }
+            break;
+        case GtpIeType::BearerContext:
+            ok &= parse_bearer_context(ie.value, msg);
+            break;
+        case GtpIeType::Ebi:
+            // Linked EBI в Delete Session Request
+            if (!ie.value.empty())
+                msg.ebi = ie.value[0] & 0x0F;
+            break;
+        default:
+            break;
+        }
+    }
+
+    if (reader.malformed() || !ok)
+        return GtpParseStatus::InvalidLength;
+    return GtpParseStatus::Ok;
+}
+
+size_t build_gtpv2_response(const GtpMessage& req, const GtpResponse& resp, uint8_t* out) noexcept {
+    GtpMessageType type;
+    switch (GtpMessageType(req.type)) {
+    case GtpMessageType::EchoRequest:          type = GtpMessageType::EchoResponse; break;
+    case GtpMessageType::CreateSessionRequest: type = GtpMessageType::CreateSessionResponse; break;
+    case GtpMessageType::ModifyBearerRequest:  type = GtpMessageType::ModifyBearerResponse; break;
+    case GtpMessageType::DeleteSessionRequest: type = GtpMessageType::DeleteSessionResponse; break;
+    default: return 0;
+    }
+
+    // Echo Response — без TEID, с Recovery; остальные ответы — с TEID пира и Cause
+    bool with_teid = type != GtpMessageType::EchoResponse;
+    uint8_t* p = out;
+    *p++ = with_teid ? 0x48 : 0x40;  // Версия 2, флаг T
+    *p++ = uint8_t(type);
+    p += 2;  // Длина — после заполнения IE
+    if (with_teid)
+        p = store_be32(p, resp.peer_teid);
+    *p++ = uint8_t(req.sequence >> 16);
+    *p++ = uint8_t(req.sequence >> 8);
+    *p++ = uint8_t(req.sequence);
+    *p++ = 0;
+
+    if (type == GtpMessageType::EchoResponse) {
+        p = put_ie_header(p, GtpIeType::Recovery, 1);
+        *p++ = 0;  // Restart counter: сервер не хранит его между перезапусками
+    } else {
+        p = put_cause(p, resp.cause);
+    }
+
+    // Принятый Create Session: наш Sender F-TEID и Bearer Context с EBI из запроса
+    if (type == GtpMessageType::CreateSessionResponse && resp.cause == GtpCause::RequestAccepted) {
+        p = put_ie_header(p, GtpIeType::FTeid, 9);
+        *p++ = 0x80 | kGtpFTeidS5S8PgwGtpc;  // Флаг V4 + тип интерфейса
+        p = store_be32(p, resp.local_teid);
+        std::memcpy(p, &resp.local_ipv4, 4);
+        p += 4;
+
+        if (req.ebi != 0) {
+            p = put_ie_header(p, GtpIeType::BearerContext, kGtpIeHeaderSize + 1 + kGtpIeHeaderSize + 2);
+            p = put_ie_header(p, GtpIeType::Ebi, 1);
+            *p++ = req.ebi;
+            p = put_cause(p, GtpCause::RequestAccepted);
+        }
+    }
+
+    size_t len = size_t(p - out);
+    store_be16(out + 2, uint16_t(len - 4));
+    return len;
+}
+
+uint32_t GtpTunnelTable::open(Imsi imsi, uint32_t peer_teid) {
+    std::lock_guard<std::mutex> lk(mtx_);
+
+    auto it = by_imsi_.find(imsi);
+    if (it != by_imsi_.end()) {
+        by_teid_[it->second].peer_teid = peer_teid;
+        return it->second;
+    }
+
+    // TEID 0 зарезервирован; после переполнения счётчика пропускаем занятые значения
+    uint32_t teid = next_teid_;
+    while (teid == 0 || by_teid_.count(teid))
+        ++teid;
+    next_teid_ = teid + 1;
+
+    by_teid_.emplace(teid, Tunnel{imsi, peer_teid});
+    by_imsi_.emplace(imsi, teid);
+    return teid;
+}
+
+std::optional<GtpTunnelTable::Tunnel> GtpTunnelTable::find(uint32_t local_teid) const {
+    std::lock_guard<std::mutex> lk(mtx_);
+    auto it = by_teid_.find(local_teid);
+    if (it == by_teid_.end())
+        return std::nullopt;
+    return it->second;
+}
+
+bool GtpTunnelTable::close(uint32_t local_teid) {
+    std::lock_guard<std::mutex> lk(mtx_);
+    auto it = by_teid_.find(local_teid);
+    if (it == by_teid_.end())
+        return false;
+    by_imsi_.erase(it->second.imsi);
+    by_teid_.erase(it);
+    return true;
+}
+
+size_t GtpTunnelTable::size() const {
+    std::lock_guard<std::mutex> lk(mtx_);
+    return by_teid_.size();
+}
+
+} // namespace pgw
@@ -1,6 +1,9 @@
 #include "pgw/http_api.hpp"
 #include <httplib.h>
 #include <spdlog/spdlog.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
 #include <future>  // Для использования std::async
 
 namespace pgw {
@@ -15,8 +18,25 @@ HttpApi::HttpApi(uint16_t port,
     , udp_stop_cb_(std::move(udp_stop_cb))
 { }
 
+HttpApi::~HttpApi() {
+    // Поток выгрузки, запущенный после того, как run_server уже вышел (ошибка listen);
+    // ждём без мьютекса — поток берёт его
+    std::thread drain;
+    {
+        std::lock_guard<std::mutex> lk(drain_mtx_);
+        drain = std::move(drain_thread_);
+    }
+    if (drain.joinable())
+        drain.join();
+}
+
+void HttpApi::add_stats_source(std::string name, std::function<nlohmann::json()> source) {
+    stats_sources_[std::move(name)] = std::move(source);
+}
+
 void HttpApi::start() {
     running_ = true;
+    listen_done_ = false;
     thread_ = std::thread(&HttpApi::run_server, this);
     spdlog::info("HTTP API listening on port {}", port_);
 }
@@ -36,46 +56,82 @@ void HttpApi::join() {
         thread_.join();
 }
 
+bool HttpApi::request_stop() {
+    std::lock_guard<std::mutex> lk(drain_mtx_);
+    if (stop_requested_.exchange(true))
+        return false;
+
+    // 1) Останавливаем UDP-сервер
+    if (udp_stop_cb_) {
+        udp_stop_cb_();
+        spdlog::info("UDP server stop callback invoked");
+    }
+
+    // 2) Graceful offload сессий и остановка HTTP-сервера — в фоне
+    spdlog::info("Starting graceful stop of sessions");
+    drain_thread_ = std::thread([this] {
+        sessions_.graceful_stop(graceful_rate_);
+        spdlog::info("All sessions offloaded, HTTP API shutting down");
+        spdlog::info("Stopping HTTP server...");
+        // stop() до того, как listen() занял порт, ничего не делает, и listen() потом ждал бы
+        // запросов вечно: повторяем, пока run_server не выйдет из цикла прослушивания
+        while (!listen_done_) {
+            {
+                std::lock_guard<std::mutex> lk(drain_mtx_);
+                if (server_)
+                    server_->stop();
+            }
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        }
+    });
+    return true;
+}
+
 void HttpApi::run_server() {
     httplib::Server server;
+    {
+        std::lock_guard<std::mutex> lk(drain_mtx_);
+        server_ = &server;
+    }
 
-    // Флаг для остановки сервера
-    bool stop_requested = false;
-
-    // GET /check_subscriber?imsi=…
+    // GET /check_subscriber?imsi=…[&format=json]
+    // Точечный поиск в шарде абонента — частый опрос мониторингом не задевает остальные сессии.
+    // С format=json возвращает и сроки сессии (время форматируется только здесь, на выходе)
     server.Get("/check_subscriber", [this](const httplib::Request& req, httplib::Response& res) {
         auto imsi = req.get_param_value("imsi");
-        bool active = sessions_.is_active(imsi);
-        res.set_content(active ? "active" : "not active", "text/plain");
+        Imsi packed = Imsi::from_string(imsi);
+        auto session = packed.valid() ? sessions_.get_session(packed) : std::nullopt;
+        bool active = session.has_value();
+
+        if (req.get_param_value("format") == "json") {
+            nlohmann::json j = {{"imsi", imsi}, {"active", active}};
+            if (session) {
+                j["created_at"]    = std::string(format_timestamp(session->created_at));
+                j["expires_at"]    = std::string(format_timestamp(session->expires_at));
+                j["expires_in_ms"] = std::max<EpochMs>(0, session->expires_at - epoch_ms_now());
+            }
+            res.set_content(j.dump(), "application/json");
+        } else {
+            res.set_content(active ? "active" : "not active", "text/plain");
+        }
         spdlog::info("HTTP /check_subscriber imsi={} -> {}", imsi, active ? "active" : "not active");
     });
 
-    // GET /stop
-    server.Get("/stop", [this, &server, &stop_requested](const httplib::Request&, httplib::Response& res) {
-        spdlog::info("HTTP /stop called via GET");
-
-        // 1) Останавливаем UDP-сервер
-        if (udp_stop_cb_) {
-            udp_stop_cb_();
-            spdlog::info("UDP server stop callback invoked");
-        }
-
-        // 2) Устанавливаем флаг на остановку
-        stop_requested = true;
-        spdlog::info("Stop flag set, server will stop after handling current requests.");
-
-        // 3) Graceful offload сессий
-        spdlog::info("Starting graceful stop of sessions");
-        sessions_.graceful_stop(graceful_rate_);
-        spdlog::info("All sessions offloaded, HTTP API shutting down");
-
-        // 4) Останавливаем HTTP-сервер
-        if (stop_requested) {
-            spdlog::info("Stopping HTTP server...");
-            server.stop();
+    // GET /stats — счётчики всех зарегистрированных компонентов в виде JSON
+    server.Get("/stats", [this](const httplib::Request&, httplib::Response& res) {
+        nlohmann::json j = nlohmann::json::object();
+        for (const auto& [name, source] : stats_sources_) {
+            j[name] = source();
         }
+        res.set_content(j.dump(), "application/json");
+    });
 
-        res.set_content("shutting down", "text/plain");
+    // GET /stop
+    // Обработчик не ждёт выгрузки сессий: она идёт в отдельном потоке, а ход виден в GET /stats
+    // (раздел "drain"). По окончании выгрузки тот же поток останавливает HTTP-сервер
+    server.Get("/stop", [this](const httplib::Request&, httplib::Response& res) {
+        spdlog::info("HTTP /stop called via GET");
+        res.set_content(request_stop() ? "shutting down" : "already stopping", "text/plain");
     });
 
     // GET запрос на /test
@@ -85,7 +141,7 @@ void HttpApi::run_server() {
     });
 
     // Ожидаем запросы, пока флаг не будет установлен
-    while (!stop_requested) {
+    while (!stop_requested_) {
         try {
             server.set_error_handler([](const httplib::Request&, httplib::Response& res) {
                 res.set_content("Internal Server Error", "text/plain");
@@ -98,11 +154,25 @@ void HttpApi::run_server() {
             break;
         }
     }
-
+    listen_done_ = true;
+
+    // Поток выгрузки сам останавливает сервер; дожидаемся его, пока server ещё жив. Поток
+    // запущен под тем же мьютексом, что ставит stop_requested_, поэтому здесь он уже сохранён.
+    // Ждём без мьютекса — поток берёт его, чтобы остановить сервер
+    std::thread drain;
+    {
+        std::lock_guard<std::mutex> lk(drain_mtx_);
+        drain = std::move(drain_thread_);
+    }
+    if (drain.joinable())
+        drain.join();
+    {
+        std::lock_guard<std::mutex> lk(drain_mtx_);
+        server_ = nullptr;
+    }
+    // Процесс не завершаем: main дождётся потоков и выйдет штатно — деструкторы хранилищ
+    // и CdrWriter запишут отложенные изменения и последние CDR
     spdlog::info("Server has been stopped.");
-
-    // Завершаем программу
-    std::exit(0); // Завершаем программу после остановки сервера
 }
 
 
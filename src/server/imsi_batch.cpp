@@ -0,0 +1,144 @@
+// src/server/imsi_batch.cpp
+#include "pgw/imsi_batch.hpp"
+
+#include <cstring>
+#include <type_traits>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define PGW_HAVE_AVX2_KERNEL 1
+#endif
+
+namespace pgw {
+
+static_assert(sizeof(Imsi) == sizeof(uint64_t) && std::is_trivially_copyable_v<Imsi>,
+              "Imsi must be a plain 64-bit value");
+
+// Обнуляет маску валидности на count бит
+static void clear_mask(uint64_t* valid_mask, size_t count) noexcept {
+    std::memset(valid_mask, 0, ((count + 63) / 64) * sizeof(uint64_t));
+}
+
+// Скалярный разбор IMSI с from по count
+static size_t decode_scalar(const uint8_t* bcd, size_t from, size_t count, Imsi* out, uint64_t* valid_mask) noexcept {
+    size_t valid = 0;
+    for (size_t i = from; i < count; ++i) {
+        out[i] = Imsi::from_bcd8(bcd + 8 * i);
+        if (out[i].valid()) {
+            valid_mask[i / 64] |= uint64_t(1) << (i % 64);
+            ++valid;
+        }
+    }
+    return valid;
+}
+
+#ifdef PGW_HAVE_AVX2_KERNEL
+
+// Тот же алгоритм, что в Imsi::from_bcd8, для четырёх IMSI сразу (по одному в 64-битной дорожке)
+__attribute__((target("avx2")))
+static size_t decode_avx2(const uint8_t* bcd, size_t count, Imsi* out, uint64_t* valid_mask) noexcept {
+    // Разворот байтов внутри каждой 64-битной дорожки: первый байт BCD становится старшим
+    const __m256i bswap = _mm256_setr_epi8(7, 6, 5, 4, 3, 2, 1, 0, 15, 14, 13, 12, 11, 10, 9, 8,
+                                           7, 6, 5, 4, 3, 2, 1, 0, 15, 14, 13, 12, 11, 10, 9, 8);
+    // Число единичных бит в полубайте — для подсчёта длины заполнителя
+    const __m256i popcnt = _mm256_setr_epi8(0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4,
+                                            0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4);
+    const __m256i low4  = _mm256_set1_epi8(0x0F);
+    const __m256i ones  = _mm256_set1_epi64x(0x1111111111111111ll);
+    const __m256i all   = _mm256_set1_epi8(-1);
+    const __m256i zero  = _mm256_setzero_si256();
+    const __m256i one   = _mm256_set1_epi64x(1);
+    const __m256i three = _mm256_set1_epi64x(3);
+    const __m256i sixty_four = _mm256_set1_epi64x(64);
+
+    size_t valid = 0;
+    size_t i = 0;
+    for (; i + 4 <= count; i += 4) {
+        __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(bcd + 8 * i));
+        v = _mm256_shuffle_epi8(v, bswap);
+
+        // Меняем полубайты местами: цифры встают в порядке записи
+        __m256i x = _mm256_or_si256(_mm256_slli_epi16(_mm256_and_si256(v, low4), 4),
+                                    _mm256_and_si256(_mm256_srli_epi16(v, 4), low4));
+
+        // Маска заполнителя: все биты ниже младшего полубайта, не равного 0xF
+        __m256i nx    = _mm256_xor_si256(x, all);
+        __m256i not_f = _mm256_and_si256(
+            _mm256_or_si256(_mm256_or_si256(nx, _mm256_srli_epi64(nx, 1)),
+                            _mm256_or_si256(_mm256_srli_epi64(nx, 2), _mm256_srli_epi64(nx, 3))),
+            ones);
+        __m256i lowest = _mm256_and_si256(not_f, _mm256_sub_epi64(zero, not_f));
+        __m256i filler = _mm256_sub_epi64(lowest, one);
+
+        // Длина заполнителя в битах: popcount по полубайтам, затем сумма байтов дорожки (SAD с нулём)
+        __m256i pc = _mm256_add_epi8(_mm256_shuffle_epi8(popcnt, _mm256_and_si256(filler, low4)),
+                                     _mm256_shuffle_epi8(popcnt, _mm256_and_si256(_mm256_srli_epi16(filler, 4), low4)));
+        __m256i fill_bits = _mm256_sad_epu8(pc, zero);
+
+        // Полубайты больше 9 вне заполнителя
+        __m256i b3  = _mm256_and_si256(_mm256_srli_epi64(x, 3), ones);
+        __m256i b2  = _mm256_and_si256(_mm256_srli_epi64(x, 2), ones);
+        __m256i b1  = _mm256_and_si256(_mm256_srli_epi64(x, 1), ones);
+        __m256i bad = _mm256_andnot_si256(filler, _mm256_and_si256(b3, _mm256_or_si256(b2, b1)));
+
+        // Валиден: нет плохих полубайтов, заполнитель от 1 до 15 полубайтов
+        __m256i ok = _mm256_and_si256(_mm256_cmpeq_epi64(bad, zero),
+                                      _mm256_and_si256(_mm256_cmpgt_epi64(fill_bits, three),
+                                                       _mm256_cmpgt_epi64(sixty_four, fill_bits)));
+
+        // (цифр << 60) | (x >> fill_bits); цифр = (64 - fill_bits) / 4
+        __m256i packed = _mm256_or_si256(_mm256_slli_epi64(_mm256_sub_epi64(sixty_four, fill_bits), 58),
+                                         _mm256_srlv_epi64(x, fill_bits));
+        packed = _mm256_and_si256(packed, ok);
+
+        uint64_t lanes[4];
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(lanes), packed);
+        std::memcpy(out + i, lanes, sizeof(lanes));
+
+        auto bits = static_cast<unsigned>(_mm256_movemask_pd(_mm256_castsi256_pd(ok)));
+        valid_mask[i / 64] |= uint64_t(bits) << (i % 64);
+        valid += static_cast<size_t>(__builtin_popcount(bits));
+    }
+
+    return valid + decode_scalar(bcd, i, count, out, valid_mask);
+}
+
+#endif
+
+static bool avx2_supported() noexcept {
+#ifdef PGW_HAVE_AVX2_KERNEL
+    return __builtin_cpu_supports("avx2");
+#else
+    return false;
+#endif
+}
+
+BcdKernel bcd_batch_kernel() noexcept {
+    static const BcdKernel kernel = avx2_supported() ? BcdKernel::Avx2 : BcdKernel::Scalar;
+    return kernel;
+}
+
+const char* to_string(BcdKernel kernel) noexcept {
+    switch (kernel) {
+    case BcdKernel::Scalar: return "scalar";
+    case BcdKernel::Avx2:   return "avx2";
+    }
+    return "unknown";
+}
+
+size_t decode_bcd_batch(const uint8_t* bcd, size_t count, Imsi* out, uint64_t* valid_mask) noexcept {
+    return decode_bcd_batch(bcd_batch_kernel(), bcd, count, out, valid_mask);
+}
+
+size_t decode_bcd_batch(BcdKernel kernel, const uint8_t* bcd, size_t count, Imsi* out, uint64_t* valid_mask) noexcept {
+    clear_mask(valid_mask, count);
+#ifdef PGW_HAVE_AVX2_KERNEL
+    if (kernel == BcdKernel::Avx2 && avx2_supported())
+        return decode_avx2(bcd, count, out, valid_mask);
+#else
+    (void)kernel;
+#endif
+    return decode_scalar(bcd, 0, count, out, valid_mask);
+}
+
+} // namespace pgw
@@ -2,16 +2,21 @@
 
 namespace pgw {
 
-// Функция, которая сравнивает строки с датами (если они в формате строк)
-bool is_before(const std::string& time1, const std::string& time2) {
-    return time1 < time2;
+InMemorySessionStore::InMemorySessionStore(size_t capacity)
+    : pool_(slab_node_size<Map>(std::pair<const Imsi, StoredSession>{}))
+    , sessions_(Map::allocator_type(pool_))
+{
+    if (capacity) {
+        sessions_.reserve(capacity);
+        pool_.reserve(capacity);
+    }
 }
 
-std::vector<StoredSession> InMemorySessionStore::load_sessions(const std::string& now) {
+std::vector<StoredSession> InMemorySessionStore::load_sessions(EpochMs now) {
     std::lock_guard<std::mutex> lk(mtx_);
     std::vector<StoredSession> out;
     for (auto& [k, s] : sessions_) {
-        if (is_before(now, s.expires_at)) {
+        if (now < s.expires_at) {
             out.push_back(s);
         }
     }
@@ -24,20 +29,28 @@ bool InMemorySessionStore::save_session(const StoredSession& s) {
     return true;
 }
 
-bool InMemorySessionStore::delete_session(const std::string& imsi) {
+bool InMemorySessionStore::delete_session(Imsi imsi) {
     std::lock_guard<std::mutex> lk(mtx_);
     return sessions_.erase(imsi) > 0;
 }
 
-bool InMemorySessionStore::session_exists(const std::string& imsi) {
+bool InMemorySessionStore::session_exists(Imsi imsi) {
     std::lock_guard<std::mutex> lk(mtx_);
     return sessions_.find(imsi) != sessions_.end();
 }
 
-void InMemorySessionStore::cleanup_expired_sessions(const std::string& now) {
+std::optional<StoredSession> InMemorySessionStore::get_session(Imsi imsi) {
+    std::lock_guard<std::mutex> lk(mtx_);
+    auto it = sessions_.find(imsi);
+    if (it == sessions_.end())
+        return std::nullopt;
+    return it->second;
+}
+
+void InMemorySessionStore::cleanup_expired_sessions(EpochMs now) {
     std::lock_guard<std::mutex> lk(mtx_);
     for (auto it = sessions_.begin(); it != sessions_.end(); ) {
-        if (is_before(it->second.expires_at, now)) {
+        if (it->second.expires_at <= now) {
             it = sessions_.erase(it);
         } else {
             ++it;
@@ -45,15 +58,68 @@ void InMemorySessionStore::cleanup_expired_sessions(const std::string& now) {
     }
 }
 
-std::vector<StoredSession> InMemorySessionStore::load_expired_sessions(const std::string& now) {
+std::vector<StoredSession> InMemorySessionStore::load_expired_sessions(EpochMs now) {
     std::lock_guard<std::mutex> lk(mtx_);
     std::vector<StoredSession> expired;
     for (auto& [k, s] : sessions_) {
-        if (is_before(s.expires_at, now)) {
+        if (s.expires_at <= now) {
             expired.push_back(s);
         }
     }
     return expired;
 }
 
+UpsertResult InMemorySessionStore::upsert(const StoredSession& s) {
+    std::lock_guard<std::mutex> lk(mtx_);
+    return upsert_locked(s);
+}
+
+UpsertResult InMemorySessionStore::upsert_locked(const StoredSession& s) {
+    auto [it, inserted] = sessions_.try_emplace(s.imsi, s);
+    if (inserted)
+        return UpsertResult::Created;
+    it->second.expires_at = s.expires_at;
+    return UpsertResult::Refreshed;
+}
+
+std::vector<UpsertResult> InMemorySessionStore::upsert_batch(std::span<const StoredSession> sessions) {
+    std::vector<UpsertResult> result;
+    result.reserve(sessions.size());
+    std::lock_guard<std::mutex> lk(mtx_);
+    for (auto& s : sessions) {
+        result.push_back(upsert_locked(s));
+    }
+    return result;
+}
+
+size_t InMemorySessionStore::delete_batch(std::span<const Imsi> imsis) {
+    std::lock_guard<std::mutex> lk(mtx_);
+    size_t removed = 0;
+    for (Imsi imsi : imsis) {
+        removed += sessions_.erase(imsi);
+    }
+    return removed;
+}
+
+std::vector<std::optional<StoredSession>> InMemorySessionStore::lookup_batch(std::span<const Imsi> imsis) {
+    std::vector<std::optional<StoredSession>> result;
+    result.reserve(imsis.size());
+    std::lock_guard<std::mutex> lk(mtx_);
+    for (Imsi imsi : imsis) {
+        auto it = sessions_.find(imsi);
+        if (it == sessions_.end())
+            result.emplace_back();
+        else
+            result.emplace_back(it->second);
+    }
+    return result;
+}
+
+MemoryUsage InMemorySessionStore::memory_usage() {
+    std::lock_guard<std::mutex> lk(mtx_);
+    const SlabStats pool    = pool_.stats();
+    const size_t    buckets = sessions_.bucket_count() * sizeof(void*);
+    return { pool.bytes_reserved + buckets, pool.bytes_in_use + buckets };
+}
+
 } // namespace pgw
@@ -0,0 +1,207 @@
+// src/server/io_uring.cpp
+#include "pgw/io_uring.hpp"
+
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <system_error>
+
+namespace pgw {
+
+static int sys_io_uring_setup(unsigned entries, io_uring_params* p) {
+    return static_cast<int>(::syscall(__NR_io_uring_setup, entries, p));
+}
+
+static int sys_io_uring_enter(int fd, unsigned to_submit, unsigned min_complete, unsigned flags) {
+    return static_cast<int>(::syscall(__NR_io_uring_enter, fd, to_submit, min_complete, flags, nullptr, 0));
+}
+
+// Смещение внутри отображения кольца
+template <typename T>
+static T* ring_ptr(void* base, uint32_t offset) {
+    return reinterpret_cast<T*>(static_cast<uint8_t*>(base) + offset);
+}
+
+IoUring::IoUring(unsigned entries, unsigned cq_entries) {
+    io_uring_params p{};
+    p.flags      = IORING_SETUP_CQSIZE;
+    p.cq_entries = cq_entries;
+
+    ring_fd_ = sys_io_uring_setup(entries, &p);
+    if (ring_fd_ < 0) {
+        throw std::system_error(errno, std::generic_category(), "io_uring_setup");
+    }
+
+    sq_ring_size_ = p.sq_off.array + p.sq_entries * sizeof(unsigned);
+    cq_ring_size_ = p.cq_off.cqes + p.cq_entries * sizeof(io_uring_cqe);
+    bool single_mmap = (p.features & IORING_FEAT_SINGLE_MMAP) != 0;
+    if (single_mmap) {
+        sq_ring_size_ = cq_ring_size_ = std::max(sq_ring_size_, cq_ring_size_);
+    }
+
+    sq_ring_ = ::mmap(nullptr, sq_ring_size_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                      ring_fd_, IORING_OFF_SQ_RING);
+    if (sq_ring_ == MAP_FAILED) {
+        int err = errno;
+        sq_ring_ = nullptr;
+        ::close(ring_fd_);
+        throw std::system_error(err, std::generic_category(), "mmap(IORING_OFF_SQ_RING)");
+    }
+
+    if (single_mmap) {
+        cq_ring_ = sq_ring_;
+    } else {
+        cq_ring_ = ::mmap(nullptr, cq_ring_size_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                          ring_fd_, IORING_OFF_CQ_RING);
+        if (cq_ring_ == MAP_FAILED) {
+            int err = errno;
+            cq_ring_ = nullptr;
+            ::munmap(sq_ring_, sq_ring_size_);
+            ::close(ring_fd_);
+            throw std::system_error(err, std::generic_category(), "mmap(IORING_OFF_CQ_RING)");
+        }
+    }
+
+    sqes_size_ = p.sq_entries * sizeof(io_uring_sqe);
+    void* sqes = ::mmap(nullptr, sqes_size_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                        ring_fd_, IORING_OFF_SQES);
+    if (sqes == MAP_FAILED) {
+        int err = errno;
+        if (cq_ring_ != sq_ring_) ::munmap(cq_ring_, cq_ring_size_);
+        ::munmap(sq_ring_, sq_ring_size_);
+        ::close(ring_fd_);
+        throw std::system_error(err, std::generic_category(), "mmap(IORING_OFF_SQES)");
+    }
+    sqes_ = static_cast<io_uring_sqe*>(sqes);
+
+    sq_head_    = ring_ptr<unsigned>(sq_ring_, p.sq_off.head);
+    sq_tail_    = ring_ptr<unsigned>(sq_ring_, p.sq_off.tail);
+    sq_mask_    = *ring_ptr<unsigned>(sq_ring_, p.sq_off.ring_mask);
+    sq_entries_ = p.sq_entries;
+    sqe_tail_   = *sq_tail_;
+
+    // Индексный массив SQ заполняется тождественно: SQE i всегда лежит в слоте i
+    unsigned* sq_array = ring_ptr<unsigned>(sq_ring_, p.sq_off.array);
+    for (unsigned i = 0; i < sq_entries_; ++i) {
+        sq_array[i] = i;
+    }
+
+    cq_head_ = ring_ptr<unsigned>(cq_ring_, p.cq_off.head);
+    cq_tail_ = ring_ptr<unsigned>(cq_ring_, p.cq_off.tail);
+    cq_mask_ = *ring_ptr<unsigned>(cq_ring_, p.cq_off.ring_mask);
+    cqes_    = ring_ptr<io_uring_cqe>(cq_ring_, p.cq_off.cqes);
+}
+
+IoUring::~IoUring() {
+    if (buf_base_) ::munmap(buf_base_, buf_area_size_);
+    if (sqes_) ::munmap(sqes_, sqes_size_);
+    if (cq_ring_ && cq_ring_ != sq_ring_) ::munmap(cq_ring_, cq_ring_size_);
+    if (sq_ring_) ::munmap(sq_ring_, sq_ring_size_);
+    if (ring_fd_ >= 0) ::close(ring_fd_);
+}
+
+io_uring_sqe* IoUring::get_sqe() noexcept {
+    unsigned head = __atomic_load_n(sq_head_, __ATOMIC_ACQUIRE);
+    if (sqe_tail_ - head >= sq_entries_)
+        return nullptr;
+    io_uring_sqe* sqe = &sqes_[sqe_tail_ & sq_mask_];
+    ++sqe_tail_;
+    std::memset(sqe, 0, sizeof(*sqe));
+    return sqe;
+}
+
+int IoUring::submit_and_wait(unsigned wait_nr) noexcept {
+    unsigned to_submit = sqe_tail_ - *sq_tail_;
+    __atomic_store_n(sq_tail_, sqe_tail_, __ATOMIC_RELEASE);
+
+    unsigned flags = wait_nr ? IORING_ENTER_GETEVENTS : 0;
+    int ret = sys_io_uring_enter(ring_fd_, to_submit, wait_nr, flags);
+    return ret < 0 ? -errno : ret;
+}
+
+unsigned IoUring::cq_ready() const noexcept {
+    return __atomic_load_n(cq_tail_, __ATOMIC_ACQUIRE) - *cq_head_;
+}
+
+io_uring_cqe* IoUring::cqe_at(unsigned i) noexcept {
+    return &cqes_[(*cq_head_ + i) & cq_mask_];
+}
+
+void IoUring::cq_advance(unsigned n) noexcept {
+    __atomic_store_n(cq_head_, *cq_head_ + n, __ATOMIC_RELEASE);
+}
+
+void IoUring::setup_buffers(uint16_t group_id, unsigned count, unsigned buf_size) {
+    if (count == 0 || count > 65536 || buf_size == 0) {
+        throw std::system_error(EINVAL, std::generic_category(), "provided buffers size");
+    }
+
+    buf_area_size_ = size_t(count) * buf_size;
+    void* mem = ::mmap(nullptr, buf_area_size_, PROT_READ | PROT_WRITE,
+                       MAP_PRIVATE | MAP_ANONYMOUS | MAP_POPULATE, -1, 0);
+    if (mem == MAP_FAILED) {
+        throw std::system_error(errno, std::generic_category(), "mmap(provided buffers)");
+    }
+    buf_base_  = static_cast<uint8_t*>(mem);
+    buf_size_  = buf_size;
+    buf_group_ = group_id;
+    buf_free_.reserve(count);
+
+    // Первая передача буферов синхронная, чтобы сразу увидеть отказ ядра
+    io_uring_sqe* sqe = get_sqe();
+    if (!sqe) {
+        throw std::system_error(EBUSY, std::generic_category(), "IORING_OP_PROVIDE_BUFFERS");
+    }
+    sqe->opcode    = IORING_OP_PROVIDE_BUFFERS;
+    sqe->fd        = static_cast<int32_t>(count);
+    sqe->addr      = reinterpret_cast<uint64_t>(buf_base_);
+    sqe->len       = buf_size;
+    sqe->off       = 0;
+    sqe->buf_group = group_id;
+    sqe->user_data = kProvideBuffersUserData;
+
+    int ret = submit_and_wait(1);
+    if (ret < 0) {
+        throw std::system_error(-ret, std::generic_category(), "io_uring_enter");
+    }
+    int res = cqe_at(0)->res;
+    cq_advance(1);
+    if (res < 0) {
+        throw std::system_error(-res, std::generic_category(), "IORING_OP_PROVIDE_BUFFERS");
+    }
+}
+
+void IoUring::recycle_buffer(uint16_t bid) {
+    buf_free_.push_back(bid);
+}
+
+void IoUring::commit_buffers() noexcept {
+    size_t i = 0;
+    while (i < buf_free_.size()) {
+        io_uring_sqe* sqe = get_sqe();
+        if (!sqe)
+            break;  // Остаток вернём при следующем вызове
+
+        // Буферы обычно освобождаются в порядке выдачи — объединяем подряд идущие bid
+        size_t j = i + 1;
+        while (j < buf_free_.size() && buf_free_[j] == buf_free_[j - 1] + 1) {
+            ++j;
+        }
+
+        sqe->opcode    = IORING_OP_PROVIDE_BUFFERS;
+        sqe->fd        = static_cast<int32_t>(j - i);
+        sqe->addr      = reinterpret_cast<uint64_t>(buffer(buf_free_[i]));
+        sqe->len       = buf_size_;
+        sqe->off       = buf_free_[i];
+        sqe->buf_group = buf_group_;
+        sqe->flags     = IOSQE_CQE_SKIP_SUCCESS;
+        sqe->user_data = kProvideBuffersUserData;
+        i = j;
+    }
+    buf_free_.erase(buf_free_.begin(), buf_free_.begin() + static_cast<std::ptrdiff_t>(i));
+}
+
+} // namespace pgw
@@ -4,7 +4,9 @@
 #include "pgw/blacklist.hpp"
 #include "pgw/session_manager.hpp"
 #include "pgw/in_memory_session_store.hpp"
+#include "pgw/flat_session_store.hpp"
 #include "pgw/sqlite_session_store.hpp"
+#include "pgw/tiered_session_store.hpp"
 #include "pgw/session_store.hpp"
 #include "pgw/udp_server.hpp"
 #include "pgw/http_api.hpp"
@@ -12,6 +14,7 @@
 #include <spdlog/spdlog.h>
 #include <spdlog/sinks/stdout_color_sinks.h>
 #include <spdlog/sinks/basic_file_sink.h>
+#include <algorithm>
 #include <filesystem>
 #include <vector>
 #include <memory>
@@ -49,25 +52,119 @@ int main(int argc, char* argv[]) {
     pgw::Blacklist blacklist{ cfg.blacklist };
 
     // 4. Инициализация хранилища сессий
-    std::unique_ptr<pgw::ISessionStore> store;
+    //    In-memory и плоское хранилища делятся на разделы по шардам менеджера сессий;
+    //    SQLite — один файл с одной блокировкой записи, поэтому для него шард один.
+    //    Многоуровневое делится на шарды в памяти, а в SQLite пишет один общий поток
+    pgw::SessionStoreFactory make_store;
+    pgw::SqliteSessionStore* sqlite_store = nullptr;  // Для счётчиков запросов в /stats
+    std::shared_ptr<pgw::SessionWriteBack> writeback;  // Только для "tiered"
+    size_t session_shards = cfg.session_shards;
+    // Предел сессий общий; каждый раздел сразу выделяет память под равную долю — это оценка, не квота
+    const size_t shards        = std::max<size_t>(session_shards, 1);
+    const size_t max_per_shard = static_cast<size_t>((cfg.max_sessions + shards - 1) / shards);
+
+    pgw::SqliteStoreOptions sqlite_options;
+    sqlite_options.journal_mode      = cfg.sqlite_journal_mode;
+    sqlite_options.synchronous       = cfg.sqlite_synchronous;
+    sqlite_options.commit_interval   = std::chrono::milliseconds(cfg.sqlite_commit_interval_ms);
+    sqlite_options.commit_rows       = cfg.sqlite_commit_rows;
+    sqlite_options.expire_chunk_rows = cfg.sqlite_expire_chunk_rows;
+    sqlite_options.read_connections  = cfg.sqlite_read_connections;
 
     if (cfg.session_store == "sqlite") {
         spdlog::info("Using SQLite session store: {}", cfg.sqlite_db_path);
-        store = std::make_unique<pgw::SqliteSessionStore>(cfg.sqlite_db_path);
+        make_store = [&cfg, &sqlite_store, sqlite_options](size_t) {
+            auto store   = std::make_unique<pgw::SqliteSessionStore>(cfg.sqlite_db_path, sqlite_options);
+            sqlite_store = store.get();
+            return store;
+        };
+        session_shards = 1;
+    } else if (cfg.session_store == "tiered") {
+        spdlog::info("Using tiered session store: in-memory shards written back to {}", cfg.sqlite_db_path);
+        // Пачки обратной записи уже групповые — своя отложенная запись SQLite не нужна; читается
+        // база только при запуске, поэтому и пул чтения не нужен
+        sqlite_options.commit_interval  = std::chrono::milliseconds(0);
+        sqlite_options.read_connections = 0;
+        pgw::TieredStoreOptions tiered_options;
+        tiered_options.writeback_interval = std::chrono::milliseconds(cfg.tiered_writeback_interval_ms);
+        tiered_options.writeback_rows     = cfg.tiered_writeback_rows;
+        try {
+            writeback = std::make_shared<pgw::SessionWriteBack>(
+                std::make_unique<pgw::SqliteSessionStore>(cfg.sqlite_db_path, sqlite_options),
+                shards, tiered_options);
+        } catch (const std::exception& ex) {
+            spdlog::critical("Invalid tiered session store configuration: {}", ex.what());
+            return EXIT_FAILURE;
+        }
+        sqlite_store = &writeback->cold();
+        make_store = [writeback, max_per_shard](size_t shard) {
+            return std::make_unique<pgw::TieredSessionStore>(writeback, shard, max_per_shard);
+        };
+    } else if (cfg.session_store == "flat") {
+        // Ёмкость делится поровну между шардами: у каждого своя таблица
+        size_t per_shard = std::max(static_cast<size_t>((cfg.flat_store_capacity + shards - 1) / shards),
+                                    max_per_shard);
+        spdlog::info("Using flat in-memory session store, {} sessions per shard", per_shard);
+        make_store = [per_shard, huge = cfg.flat_store_huge_pages](size_t) {
+            return std::make_unique<pgw::FlatSessionStore>(per_shard, huge);
+        };
     } else {
         spdlog::info("Using in-memory session store");
-        store = std::make_unique<pgw::InMemorySessionStore>();
+        make_store = [max_per_shard](size_t) { return std::make_unique<pgw::InMemorySessionStore>(max_per_shard); };
     }
 
     // 5. Создание SessionManager
-    pgw::SessionManager sessions{
-        std::chrono::seconds(cfg.session_timeout_sec),
-        std::move(store),
-        cdr
-    };
+    std::unique_ptr<pgw::SessionManager> session_manager;
+    try {
+        session_manager = std::make_unique<pgw::SessionManager>(
+            std::chrono::seconds(cfg.session_timeout_sec), make_store, session_shards, cdr, cfg.max_sessions);
+    } catch (const std::exception& ex) {
+        spdlog::critical("Invalid session configuration: {}", ex.what());
+        return EXIT_FAILURE;
+    }
+    pgw::SessionManager& sessions = *session_manager;
+
+    // Тёплый перезапуск: сессии из последнего снимка, затем периодические снимки.
+    // SQLite и многоуровневое хранилище сами хранят сессии на диске — снимок им не нужен
+    if (!cfg.snapshot_path.empty()) {
+        if (cfg.session_store == "sqlite" || cfg.session_store == "tiered") {
+            spdlog::warn("Session snapshots are ignored with the {} session store", cfg.session_store);
+        } else {
+            if (std::filesystem::exists(cfg.snapshot_path)) {
+                try {
+                    sessions.restore_snapshot(cfg.snapshot_path, cfg.snapshot_restore_threads);
+                } catch (const std::exception& ex) {
+                    spdlog::error("Failed to restore session snapshot, starting without sessions: {}", ex.what());
+                }
+            }
+            sessions.enable_snapshots(cfg.snapshot_path, std::chrono::seconds(cfg.snapshot_interval_sec));
+        }
+    }
 
     // 6. Инициализация и запуск серверов
-    pgw::UdpServer udp{ cfg.udp_ip, cfg.udp_port, blacklist, sessions };
+    pgw::UdpServerOptions udp_options;
+    try {
+        udp_options.backend = pgw::udp_backend_from_string(cfg.udp_backend);
+    } catch (const std::exception& ex) {
+        spdlog::critical("Invalid UDP configuration: {}", ex.what());
+        return EXIT_FAILURE;
+    }
+    udp_options.batch_size         = cfg.udp_batch_size;
+    udp_options.workers            = cfg.udp_workers;
+    udp_options.cpu_affinity       = cfg.udp_cpu_affinity;
+    udp_options.processing_threads = cfg.udp_processing_threads;
+    udp_options.queue_capacity     = cfg.udp_queue_capacity;
+    udp_options.rate_limit_pps     = cfg.udp_rate_limit_pps;
+    udp_options.rate_limit_burst   = cfg.udp_rate_limit_burst;
+    udp_options.rate_limit_reply   = cfg.udp_rate_limit_reply;
+    udp_options.overload_sample_interval = std::chrono::milliseconds(cfg.overload_sample_ms);
+    udp_options.overload.queue_high   = cfg.overload_queue_high;
+    udp_options.overload.queue_low    = cfg.overload_queue_low;
+    udp_options.overload.backlog_high = cfg.overload_backlog_high;
+    udp_options.overload.backlog_low  = cfg.overload_backlog_low;
+    udp_options.overload.latency_high = std::chrono::milliseconds(cfg.overload_latency_high_ms);
+    udp_options.overload.latency_low  = std::chrono::milliseconds(cfg.overload_latency_low_ms);
+    pgw::UdpServer udp{ cfg.udp_ip, cfg.udp_port, blacklist, sessions, udp_options };
 
     // Передаем в HttpApi порт, SessionManager, callback для UDP‑stop и скорость graceful‑shutdown
     pgw::HttpApi http{
@@ -82,6 +179,40 @@ int main(int argc, char* argv[]) {
         cfg.graceful_shutdown_rate
     };
 
+    // Счётчики UDP (пакетов на системный вызов) доступны через GET /stats
+    http.add_stats_source("udp", [&udp]() { return nlohmann::json(udp.stats()); });
+
+    // Число сессий на колёсах таймеров и гистограмма опоздания их истечения
+    http.add_stats_source("sessions", [&sessions]() { return nlohmann::json(sessions.expiry_stats()); });
+
+    // Память сессий: выделено и занято хранилищами и колёсами, байт на сессию, RSS процесса
+    http.add_stats_source("memory", [&sessions]() { return nlohmann::json(sessions.memory_stats()); });
+
+    // Ход graceful stop после /stop: выгружено, осталось, оценка времени до конца
+    http.add_stats_source("drain", [&sessions]() { return nlohmann::json(sessions.drain_progress()); });
+
+    // Число выполнений и время каждого подготовленного запроса SQLite, размер и задержка групповых фиксаций,
+    // загрузка пула чтения
+    if (sqlite_store) {
+        http.add_stats_source("sqlite", [sqlite_store]() {
+            return nlohmann::json{
+                {"statements", sqlite_store->statement_stats()},
+                {"commits", sqlite_store->commit_stats()},
+                {"read_pool", sqlite_store->read_pool_stats()}
+            };
+        });
+    }
+
+    // Обратная запись многоуровневого хранилища: сколько изменений слилось в памяти, размер и время пачек
+    if (writeback) {
+        http.add_stats_source("tiered", [writeback]() { return nlohmann::json(writeback->stats()); });
+    }
+
+    // Состояние защиты от перегрузки — для подбора порогов по реальному трафику
+    if (udp.overload()) {
+        http.add_stats_source("overload", [&udp]() { return nlohmann::json(udp.overload()->state()); });
+    }
+
     udp.start();
     http.start();
 
@@ -89,6 +220,9 @@ int main(int argc, char* argv[]) {
     http.join();
     udp.join();
 
+    // Выход из main разрушает объекты в обратном порядке: менеджер сессий и хранилища фиксируют
+    // отложенную запись SQLite и обратную запись многоуровневого хранилища (в том числе удаления
+    // выгруженных сессий), затем CdrWriter дописывает последние CDR
     spdlog::info("PGW server stopped");
     return 0;
 }
@@ -0,0 +1,84 @@
+// src/server/overload_controller.cpp
+#include "pgw/overload_controller.hpp"
+#include <spdlog/spdlog.h>
+
+namespace pgw {
+
+OverloadController::OverloadController(OverloadThresholds thresholds)
+    : thresholds_(thresholds)
+{ }
+
+void OverloadController::record_store_latency(std::chrono::nanoseconds latency) noexcept {
+    // Несколько обработчиков могут обновить среднее одновременно и потерять одно из значений —
+    // для сглаженного сигнала это допустимо и дешевле CAS-цикла
+    auto sample = static_cast<int64_t>(latency.count());
+    auto ewma   = static_cast<int64_t>(latency_ewma_ns_.load(std::memory_order_relaxed));
+    ewma += (sample - ewma) / 16;
+    latency_ewma_ns_.store(static_cast<uint64_t>(ewma < 0 ? 0 : ewma), std::memory_order_relaxed);
+}
+
+bool OverloadController::update(const OverloadSample& sample) {
+    std::lock_guard<std::mutex> lk(mtx_);
+
+    auto latency = std::chrono::nanoseconds(latency_ewma_ns_.load(std::memory_order_relaxed));
+    bool new_drops = have_sample_ && sample.socket_drops > last_.socket_drops;
+
+    // Первый превышенный порог — причина перегрузки
+    const char* trigger = nullptr;
+    if (sample.queue_fill >= thresholds_.queue_high)
+        trigger = "queue";
+    else if (sample.backlog_fill >= thresholds_.backlog_high)
+        trigger = "socket_backlog";
+    else if (new_drops)
+        trigger = "socket_drops";
+    else if (latency >= thresholds_.latency_high)
+        trigger = "store_latency";
+
+    bool was = overloaded_.load(std::memory_order_relaxed);
+    bool now = trigger != nullptr;
+    if (!now && was) {
+        // Выходим из перегрузки, только когда все сигналы опустились ниже нижних порогов
+        now = sample.queue_fill >= thresholds_.queue_low ||
+              sample.backlog_fill >= thresholds_.backlog_low ||
+              latency >= thresholds_.latency_low;
+    }
+
+    if (now && !was) {
+        ++transitions_;
+        spdlog::warn("Overload detected ({}): queue {:.2f}, socket backlog {:.2f}, socket drops {}, store latency {} us",
+                     trigger, sample.queue_fill, sample.backlog_fill, sample.socket_drops,
+                     std::chrono::duration_cast<std::chrono::microseconds>(latency).count());
+    } else if (!now && was) {
+        spdlog::info("Overload cleared: queue {:.2f}, socket backlog {:.2f}, store latency {} us",
+                     sample.queue_fill, sample.backlog_fill,
+                     std::chrono::duration_cast<std::chrono::microseconds>(latency).count());
+    }
+
+    if (!now)
+        reason_.clear();
+    else if (trigger)
+        reason_ = trigger;
+
+    last_ = sample;
+    have_sample_ = true;
+    overloaded_.store(now, std::memory_order_relaxed);
+    return now;
+}
+
+OverloadState OverloadController::state() const {
+    OverloadState s;
+    s.overloaded       = overloaded();
+    s.store_latency_us = latency_ewma_ns_.load(std::memory_order_relaxed) / 1000;
+    s.shed             = shed_.load(std::memory_order_relaxed);
+    s.thresholds       = thresholds_;
+
+    std::lock_guard<std::mutex> lk(mtx_);
+    s.reason       = reason_;
+    s.queue_fill   = last_.queue_fill;
+    s.backlog_fill = last_.backlog_fill;
+    s.socket_drops = last_.socket_drops;
+    s.transitions  = transitions_;
+    return s;
+}
+
+} // namespace pgw
@@ -0,0 +1,41 @@
+// src/server/rate_limiter.cpp
+#include "pgw/rate_limiter.hpp"
+
+#include <chrono>
+#include <stdexcept>
+
+namespace pgw {
+
+RateLimiter::RateLimiter(double rate, uint32_t burst, size_t entries) {
+    if (!(rate > 0.0) || rate > 1e9) {
+        throw std::invalid_argument("Rate limit must be between 0 and 1e9 packets per second");
+    }
+    if (burst == 0) {
+        throw std::invalid_argument("Rate limit burst must be positive");
+    }
+
+    interval_ns_  = static_cast<uint64_t>(1e9 / rate);
+    if (interval_ns_ == 0)
+        interval_ns_ = 1;
+    tolerance_ns_ = interval_ns_ * (burst - 1);
+
+    // Число наборов — степень двойки; индекс берётся из старших бит мультипликативного хеша
+    size_t sets = 1;
+    unsigned bits = 0;
+    while (sets * kWays < entries && bits < 31) {
+        sets <<= 1;
+        ++bits;
+    }
+    mask_  = sets - 1;
+    shift_ = 32 - bits;
+    if (bits == 0)
+        shift_ = 31;  // Один набор: сдвиг на 32 для uint32_t не определён, маска всё равно даёт 0
+    sets_  = std::make_unique<Set[]>(sets);
+}
+
+uint64_t RateLimiter::now_ns() noexcept {
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count());
+}
+
+} // namespace pgw
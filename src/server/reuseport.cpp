@@ -0,0 +1,51 @@
+// src/server/reuseport.cpp
+#include "pgw/reuseport.hpp"
+
+#include <linux/filter.h>
+#include <sys/socket.h>
+#include <cerrno>
+
+#ifndef SO_ATTACH_REUSEPORT_CBPF
+#define SO_ATTACH_REUSEPORT_CBPF 51
+#endif
+
+namespace pgw {
+
+bool attach_imsi_steering(int fd, uint32_t workers) noexcept {
+    if (workers == 0) {
+        errno = EINVAL;
+        return false;
+    }
+
+    // Для SO_REUSEPORT ядро запускает программу со смещениями относительно нагрузки UDP
+    // (заголовок UDP уже снят), длина пакета — длина нагрузки
+    sock_filter code[] = {
+        // A = len; if (A < 4) return 0
+        BPF_STMT(BPF_LD  | BPF_W   | BPF_LEN, 0),
+        BPF_JUMP(BPF_JMP | BPF_JGE | BPF_K, 4, 1, 0),
+        BPF_STMT(BPF_RET | BPF_K, 0),
+        // X = len - 4; A = w1 = load32(X); A *= K1; M[0] = A
+        BPF_STMT(BPF_ALU | BPF_SUB | BPF_K, 4),
+        BPF_STMT(BPF_MISC | BPF_TAX, 0),
+        BPF_STMT(BPF_LD  | BPF_W   | BPF_IND, 0),
+        BPF_STMT(BPF_ALU | BPF_MUL | BPF_K, 0x9E3779B1u),
+        BPF_STMT(BPF_ST, 0),
+        // A = w0 = load32(0); A ^= M[0]; A *= K2
+        BPF_STMT(BPF_LD  | BPF_W   | BPF_ABS, 0),
+        BPF_STMT(BPF_LDX | BPF_W   | BPF_MEM, 0),
+        BPF_STMT(BPF_ALU | BPF_XOR | BPF_X, 0),
+        BPF_STMT(BPF_ALU | BPF_MUL | BPF_K, 0x85EBCA6Bu),
+        // return (A >> 16) % workers
+        BPF_STMT(BPF_ALU | BPF_RSH | BPF_K, 16),
+        BPF_STMT(BPF_ALU | BPF_MOD | BPF_K, workers),
+        BPF_STMT(BPF_RET | BPF_A, 0),
+    };
+
+    sock_fprog prog{};
+    prog.len    = static_cast<unsigned short>(sizeof(code) / sizeof(code[0]));
+    prog.filter = code;
+
+    return ::setsockopt(fd, SOL_SOCKET, SO_ATTACH_REUSEPORT_CBPF, &prog, sizeof(prog)) == 0;
+}
+
+} // namespace pgw
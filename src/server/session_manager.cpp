@@ -1,150 +1,758 @@
 // src/server/session_manager.cpp
 #include "pgw/session_manager.hpp"
+#include "pgw/drain_pacer.hpp"
+#include "pgw/session_snapshot.hpp"
 #include <spdlog/spdlog.h>
 #include <algorithm>
-#include <ctime>
-#include <iomanip>
-#include <sstream>
+#include <cstdint>
+#include <cstdio>
+#include <optional>
+#include <stdexcept>
 #include <thread>
+#include <unordered_set>
+#include <unistd.h>
 
 namespace pgw {
 
 using clock = std::chrono::steady_clock;
 
-// helper: текущее время как "YYYY-MM-DD HH:MM:SS"
-static std::string now_str() {
-    auto t = std::time(nullptr);
-    std::ostringstream ts;
-    ts << std::put_time(std::localtime(&t), "%F %T");
-    return ts.str();
-}
-
-// helper: вычисляем время истечения: now + timeout → строка
-static std::string expires_str(std::chrono::seconds timeout) {
-    auto tp = std::chrono::system_clock::now() + timeout;
-    std::time_t t = std::chrono::system_clock::to_time_t(tp);
-    std::ostringstream ts;
-    ts << std::put_time(std::localtime(&t), "%F %T");
-    return ts.str();
-}
-
 SessionManager::SessionManager(std::chrono::seconds session_timeout,
                                std::unique_ptr<ISessionStore> store,
                                CdrWriter& cdr_writer)
   : timeout_(session_timeout)
-  , store_(std::move(store))
+  , epoch_(clock::now())
+  , cdr_(cdr_writer)
+{
+    // Одно хранилище — один шард
+    shards_.push_back(std::make_unique<Shard>());
+    attach_store(*shards_.front(), std::move(store));
+    start();
+}
+
+SessionManager::SessionManager(std::chrono::seconds session_timeout,
+                               const SessionStoreFactory& make_store,
+                               size_t shards,
+                               CdrWriter& cdr_writer,
+                               size_t max_sessions)
+  : timeout_(session_timeout)
+  , epoch_(clock::now())
+  , max_sessions_(max_sessions)
   , cdr_(cdr_writer)
 {
-    // Восстанавливаем существующие сессии (непросроченные)
-    auto existing = store_->load_sessions(now_str());
-    for (auto& s : existing) {
-        spdlog::info("Restored session {} (expires at {})", s.imsi, s.expires_at);
+    if (shards == 0) {
+        throw std::invalid_argument("Session shard count must be positive");
+    }
+    // Степень двойки: шард выбирается маской по хешу IMSI (session_shard)
+    const size_t count = session_shard_count(shards);
+    shard_mask_ = count - 1;
+    // Предел общий; шарду резервируем равную долю — при равномерном хеше этого хватает
+    const size_t per_shard = (max_sessions + count - 1) / count;
+
+    shards_.reserve(count);
+    for (size_t i = 0; i < count; ++i) {
+        shards_.push_back(std::make_unique<Shard>());
+        if (per_shard)
+            shards_.back()->wheel.reserve(per_shard);
+        auto store = make_store(i);
+        if (!store) {
+            throw std::invalid_argument("Session store factory returned null");
+        }
+        attach_store(*shards_.back(), std::move(store));
+    }
+    start();
+}
+
+void SessionManager::attach_store(Shard& shard, std::unique_ptr<ISessionStore> store) {
+    shard.lock_free_reads = store && store->concurrent_reads();
+    shard.store = std::move(store);
+}
+
+void SessionManager::start() {
+    const EpochMs now = clock_.epoch_ms();
+    for (auto& shard : shards_) {
+        // Строки, истёкшие пока сервер не работал, удаляем сразу — колесо о них не знает
+        auto stale = shard->store->load_expired_sessions(now);
+        if (!stale.empty()) {
+            shard->store->cleanup_expired_sessions(now);
+            for (auto& s : stale) {
+                cdr_.write({ now, s.imsi, "expired" });
+                spdlog::info("Session expired for IMSI {}", s.imsi);
+            }
+        }
+
+        // Восстанавливаем существующие сессии (непросроченные) и ставим их на колесо
+        std::lock_guard<std::mutex> lk(shard->mtx);
+        for (auto& s : shard->store->load_sessions(now)) {
+            arm_locked(*shard, s.imsi, clock_.steady() + std::chrono::milliseconds(s.expires_at - now));
+            spdlog::info("Restored session {} (expires at {})", s.imsi, format_timestamp(s.expires_at));
+        }
+    }
+    if (shards_.size() > 1) {
+        spdlog::info("Session manager uses {} shards", shards_.size());
     }
     // Запускаем фоновую очистку
     cleaner_thread_ = std::thread(&SessionManager::cleaner_loop, this);
 }
 
 SessionManager::~SessionManager() {
-    stop_ = true;
+    {
+        std::lock_guard<std::mutex> lk(stop_mtx_);
+        stop_ = true;
+    }
     cv_.notify_all();
+    drain_cv_.notify_all();
+    snapshot_cv_.notify_all();
     if (cleaner_thread_.joinable())
         cleaner_thread_.join();
+    if (snapshot_thread_.joinable())
+        snapshot_thread_.join();
 }
 
-bool SessionManager::touch_session(const std::string& imsi) {
-    auto now     = now_str();
-    auto expires = expires_str(timeout_);
+bool SessionManager::touch_session(Imsi imsi) {
+    const EpochMs now     = clock_.epoch_ms();
+    const EpochMs expires = now + std::chrono::milliseconds(timeout_).count();
 
-    std::lock_guard<std::mutex> lk(mtx_);
+    Shard& shard = shard_for(imsi);
+    std::lock_guard<std::mutex> lk(shard.mtx);
+    // Место под возможную новую сессию занимаем до записи; его нет — пропускаем только продление
+    const size_t reserved = reserve_sessions(1);
+    if (!reserved && !shard.store->session_exists(imsi)) {
+        rejected_.fetch_add(1, std::memory_order_relaxed);
+        spdlog::warn("Session limit reached, rejecting IMSI {}", imsi);
+        return false;
+    }
+
+    // Одно обращение к хранилищу: создаёт сессию или продлевает существующую
+    UpsertResult r = shard.store->upsert({ imsi, now, expires });
+    if (r != UpsertResult::Failed)
+        arm_locked(shard, imsi, clock_.steady() + timeout_);
+    release_sessions(reserved);
+    if (r == UpsertResult::Failed) {
+        spdlog::error("Failed to store session for IMSI {}", imsi);
+        return false;
+    }
 
-    // Если сессия уже есть — пролонгируем
-    if (store_->session_exists(imsi)) {
-        StoredSession s{ imsi, now, expires };
-        store_->save_session(s);
-        spdlog::info("Session {} refreshed, expires at {}", imsi, expires);
+    if (r == UpsertResult::Refreshed) {
+        spdlog::info("Session {} refreshed, expires at {}", imsi, format_timestamp(expires));
         return true;
     }
+    cdr_.write({ now, imsi, "created" });
+    spdlog::info("Session created for IMSI {}, expires at {}", imsi, format_timestamp(expires));
+    return true;
+}
+
+std::vector<UpsertResult> SessionManager::touch_batch(std::span<const Imsi> imsis) {
+    std::vector<UpsertResult> result(imsis.size(), UpsertResult::Failed);
+    if (imsis.empty())
+        return result;
+
+    const EpochMs now      = clock_.epoch_ms();
+    const EpochMs expires  = now + std::chrono::milliseconds(timeout_).count();
+    const auto    deadline = clock_.steady() + timeout_;
+
+    // Упорядочиваем пачку по шардам; сортировка устойчивая, так что повторы IMSI идут в порядке приёма
+    std::vector<size_t>   shard_of(imsis.size());
+    std::vector<uint32_t> order(imsis.size());
+    for (size_t i = 0; i < imsis.size(); ++i) {
+        shard_of[i] = std::hash<Imsi>{}(imsis[i]) & shard_mask_;
+        order[i]    = static_cast<uint32_t>(i);
+    }
+    std::stable_sort(order.begin(), order.end(),
+                     [&](uint32_t a, uint32_t b) { return shard_of[a] < shard_of[b]; });
 
-    // Проверяем лимит
-    //auto all = store_->load_sessions(now);
-    //if (all.size() >= max_sessions_) {
-    //    spdlog::warn("Session limit reached ({}) — rejecting {}", max_sessions_, imsi);
-    //    return false;
-    //}
+    std::vector<StoredSession> part;
+    std::vector<uint32_t>      part_idx;    // Позиции сессий part во входе
+    std::vector<bool>          over_limit;  // Отклонены из-за предела (заводится только при пределе)
+    std::unordered_set<Imsi>   counted;     // Новые IMSI куска, уже занявшие место под пределом
+    for (size_t begin = 0; begin < order.size(); ) {
+        const size_t idx = shard_of[order[begin]];
+        size_t end = begin;
+        part.clear();
+        part_idx.clear();
+        while (end < order.size() && shard_of[order[end]] == idx) {
+            part.push_back({ imsis[order[end]], now, expires });
+            part_idx.push_back(order[end]);
+            ++end;
+        }
+        begin = end;
 
-    // Создаём новую сессию
-    StoredSession new_s{ imsi, now, expires };
-    store_->save_session(new_s);
-    cdr_.write({ now, imsi, "created" });
-    spdlog::info("Session created for IMSI {}, expires at {}", imsi, expires);
+        Shard& shard = *shards_[idx];
+        std::lock_guard<std::mutex> lk(shard.mtx);
+        const size_t reserved = reserve_sessions(part.size());
+        if (reserved < part.size()) {
+            // У предела: новые сессии, которым не хватило места, отклоняем до обращения к хранилищу
+            over_limit.resize(imsis.size());
+            size_t room = reserved;
+            size_t kept = 0;
+            counted.clear();
+            for (size_t k = 0; k < part.size(); ++k) {
+                // Повтор нового IMSI в пачке места не занимает: сессию создаст первый экземпляр
+                if (!shard.store->session_exists(part[k].imsi) && !counted.count(part[k].imsi)) {
+                    if (room == 0) {
+                        over_limit[part_idx[k]] = true;
+                        continue;
+                    }
+                    --room;
+                    counted.insert(part[k].imsi);
+                }
+                part[kept]     = part[k];
+                part_idx[kept] = part_idx[k];
+                ++kept;
+            }
+            part.resize(kept);
+            part_idx.resize(kept);
+        }
 
-    // Уведомляем очистку (чтобы не ждать полного интервала)
-    cv_.notify_one();
+        auto res = shard.store->upsert_batch(part);
+        for (size_t k = 0; k < part.size() && k < res.size(); ++k) {
+            result[part_idx[k]] = res[k];
+            if (res[k] != UpsertResult::Failed)
+                arm_locked(shard, part[k].imsi, deadline);
+        }
+        release_sessions(reserved);
+    }
+
+    // CDR и журнал — уже без блокировок шардов
+    for (size_t i = 0; i < imsis.size(); ++i) {
+        if (!over_limit.empty() && over_limit[i]) {
+            rejected_.fetch_add(1, std::memory_order_relaxed);
+            spdlog::warn("Session limit reached, rejecting IMSI {}", imsis[i]);
+            continue;
+        }
+        switch (result[i]) {
+        case UpsertResult::Created:
+            cdr_.write({ now, imsis[i], "created" });
+            spdlog::info("Session created for IMSI {}, expires at {}", imsis[i], format_timestamp(expires));
+            break;
+        case UpsertResult::Refreshed:
+            spdlog::info("Session {} refreshed, expires at {}", imsis[i], format_timestamp(expires));
+            break;
+        case UpsertResult::Failed:
+            spdlog::error("Failed to store session for IMSI {}", imsis[i]);
+            break;
+        }
+    }
+    return result;
+}
+
+bool SessionManager::refresh_session(Imsi imsi) {
+    const EpochMs now     = clock_.epoch_ms();
+    const EpochMs expires = now + std::chrono::milliseconds(timeout_).count();
+
+    Shard& shard = shard_for(imsi);
+    std::lock_guard<std::mutex> lk(shard.mtx);
+    // Продлеваем только существующую сессию; время создания остаётся прежним, как и при touch_session
+    auto s = shard.store->get_session(imsi);
+    if (!s)
+        return false;
+
+    s->expires_at = expires;
+    if (shard.store->upsert(*s) == UpsertResult::Failed) {
+        spdlog::error("Failed to store session for IMSI {}", imsi);
+        return false;
+    }
+    arm_locked(shard, imsi, clock_.steady() + timeout_);
+    spdlog::info("Session {} refreshed, expires at {}", imsi, format_timestamp(expires));
     return true;
 }
 
-bool SessionManager::is_active(const std::string& imsi) const {
-    std::lock_guard<std::mutex> lk(mtx_);
-    auto all = store_->load_sessions(now_str());
-    return std::any_of(all.begin(), all.end(),
-                       [&](auto& s){ return s.imsi == imsi; });
+bool SessionManager::end_session(Imsi imsi) {
+    Shard& shard = shard_for(imsi);
+    std::lock_guard<std::mutex> lk(shard.mtx);
+    if (!shard.store->session_exists(imsi))
+        return false;
+
+    shard.store->delete_session(imsi);
+    shard.wheel.cancel(imsi);
+    sync_armed_locked(shard);
+    cdr_.write({ clock_.epoch_ms(), imsi, "deleted" });
+    spdlog::info("Session deleted for IMSI {}", imsi);
+    return true;
 }
 
-void SessionManager::offload_rate(size_t sessions_per_sec) {
-    size_t removed = 0;
-    while (removed < sessions_per_sec) {
-        StoredSession s;
-        {
-            std::lock_guard<std::mutex> lk(mtx_);
-            auto all = store_->load_sessions(now_str());
-            if (all.empty()) break;
-            s = all.front();
+bool SessionManager::is_active(Imsi imsi) const {
+    return get_session(imsi).has_value();
+}
+
+std::optional<StoredSession> SessionManager::get_session(Imsi imsi) const {
+    Shard& shard = shard_for(imsi);
+    std::optional<StoredSession> s;
+    if (shard.lock_free_reads) {
+        s = shard.store->get_session(imsi);
+    } else {
+        std::lock_guard<std::mutex> lk(shard.mtx);
+        s = shard.store->get_session(imsi);
+    }
+    // Сессия с наступившим сроком, которую очистка ещё не сняла, уже не активна
+    if (s && s->expires_at <= clock_.epoch_ms())
+        s.reset();
+    return s;
+}
+
+std::vector<StoredSession> SessionManager::list_sessions() const {
+    const EpochMs now = clock_.epoch_ms();
+    std::vector<StoredSession> result;
+    for (auto& shard : shards_) {
+        std::unique_lock<std::mutex> lk(shard->mtx, std::defer_lock);
+        if (!shard->lock_free_reads)
+            lk.lock();
+        auto part = shard->store->load_sessions(now);
+        result.insert(result.end(),
+                      std::make_move_iterator(part.begin()),
+                      std::make_move_iterator(part.end()));
+    }
+    return result;
+}
+
+size_t SessionManager::offload_rate(size_t sessions_per_sec) {
+    return drain(sessions_per_sec, sessions_per_sec);
+}
+
+void SessionManager::graceful_stop(size_t rate) {
+    spdlog::info("Graceful shutdown: offloading {} sessions at {} per sec", armed_total(), rate);
+    size_t released = drain(rate, SIZE_MAX);
+    spdlog::info("Graceful shutdown: {} sessions offloaded in {} ms", released, drain_progress().elapsed_ms);
+
+    // Выгруженные сессии завершены (и получили CDR) — последний снимок их больше не содержит
+    if (!snapshot_path_.empty()) {
+        try {
+            save_snapshot(snapshot_path_);
+        } catch (const std::exception& e) {
+            spdlog::error("Failed to write session snapshot: {}", e.what());
+        }
+    }
+}
+
+DrainProgress SessionManager::drain_progress() const {
+    DrainProgress p;
+    p.active    = drain_active_.load(std::memory_order_acquire);
+    p.rate      = drain_rate_.load(std::memory_order_relaxed);
+    p.total     = drain_total_.load(std::memory_order_relaxed);
+    p.released  = drain_released_.load(std::memory_order_relaxed);
+    p.remaining = armed_total();
+
+    const int64_t started = drain_started_ns_.load(std::memory_order_relaxed);
+    if (started != 0) {
+        const int64_t until = p.active ? clock::now().time_since_epoch().count()
+                                       : drain_finished_ns_.load(std::memory_order_relaxed);
+        p.elapsed_ms = static_cast<uint64_t>(std::max<int64_t>(0, until - started) / 1000000);
+    }
+    if (p.active && p.rate > 0)
+        p.eta_ms = p.remaining * 1000 / p.rate;
+    return p;
+}
+
+size_t SessionManager::drain(size_t rate, size_t limit) {
+    auto now_ns = [] { return static_cast<uint64_t>(clock::now().time_since_epoch().count()); };
+
+    // Без темпа (rate == 0) сессии выходят максимальными пачками подряд
+    std::optional<DrainPacer> pacer;
+    if (rate > 0)
+        pacer.emplace(double(rate), DrainPacer::batch_for(double(rate)), now_ns());
+    const size_t batch = pacer ? pacer->batch() : DrainPacer::kMaxBatch;
+
+    drain_rate_.store(rate, std::memory_order_relaxed);
+    drain_total_.store(armed_total(), std::memory_order_relaxed);
+    drain_released_.store(0, std::memory_order_relaxed);
+    drain_started_ns_.store(static_cast<int64_t>(now_ns()), std::memory_order_relaxed);
+    drain_active_.store(true, std::memory_order_release);
+
+    // Ждёт маркеров на пачку из want сессий; false — менеджер разрушается
+    auto wait_tokens = [&](size_t want) {
+        std::unique_lock<std::mutex> lk(stop_mtx_);
+        auto ready = clock::time_point(clock::duration(pacer->ready_at(want)));
+        if (drain_cv_.wait_until(lk, ready, [&] { return stop_.load(); }))
+            return false;
+        pacer->take(want, now_ns());
+        return true;
+    };
+
+    size_t released = 0;
+    bool   stopped  = false;
+    std::vector<Imsi>      cursor;
+    std::vector<CdrRecord> cdrs;
+    // Обычно хватает одного прохода; следующий — только если за время прохода появились новые сессии
+    for (bool progress = true; progress && !stopped && released < limit && armed_total() > 0; ) {
+        progress = false;
+        for (auto& shard : shards_) {
+            // Курсор прохода — снимок IMSI шарда; сессии, снятые после снимка очисткой или
+            // абонентом, при выгрузке просто пропускаются
+            cursor.clear();
+            {
+                std::unique_lock<std::mutex> lk(shard->mtx, std::defer_lock);
+                if (!shard->lock_free_reads)
+                    lk.lock();
+                for (auto& s : shard->store->load_sessions(0)) {
+                    cursor.push_back(s.imsi);
+                }
+            }
+
+            for (size_t pos = 0; pos < cursor.size() && released < limit; ) {
+                const size_t want = std::min({ cursor.size() - pos, limit - released, batch });
+                if (pacer && !wait_tokens(want)) {
+                    stopped = true;
+                    break;
+                }
+                size_t n = release_batch(*shard, std::span<const Imsi>(cursor).subspan(pos, want), cdrs);
+                if (pacer)
+                    pacer->give_back(want - n);  // Маркеры исчезнувших сессий не тратим
+                pos      += want;
+                released += n;
+                progress |= n > 0;
+                drain_released_.store(released, std::memory_order_relaxed);
+            }
+            if (stopped || released >= limit)
+                break;
+        }
+    }
+
+    drain_finished_ns_.store(static_cast<int64_t>(now_ns()), std::memory_order_relaxed);
+    drain_active_.store(false, std::memory_order_release);
+    return released;
+}
+
+size_t SessionManager::release_batch(Shard& shard, std::span<const Imsi> imsis, std::vector<CdrRecord>& cdrs) {
+    const EpochMs now = clock_.epoch_ms();
+    cdrs.clear();
+    {
+        std::lock_guard<std::mutex> lk(shard.mtx);
+        for (Imsi imsi : imsis) {
+            // Сессии нет на колесе — её уже сняла очистка или завершил абонент
+            if (shard.wheel.cancel(imsi))
+                cdrs.push_back({ now, imsi, "expired" });
         }
+        if (!cdrs.empty())
+            shard.store->delete_batch(imsis);
+        sync_armed_locked(shard);
+    }
+
+    // CDR — одной пачкой и уже без блокировки шарда
+    cdr_.write_batch(cdrs);
+    for (auto& rec : cdrs) {
+        spdlog::info("Session expired for IMSI {}", rec.imsi);
+    }
+    return cdrs.size();
+}
+
+size_t SessionManager::save_snapshot(const std::string& path) {
+    std::lock_guard<std::mutex> guard(snapshot_mtx_);
+    const auto    t0  = clock::now();
+    const EpochMs now = clock_.epoch_ms();
+
+    SnapshotWriter writer(path);
+    for (auto& shard : shards_) {
+        std::vector<StoredSession> part;
         {
-            std::lock_guard<std::mutex> lk(mtx_);
-            expire_session_locked(s.imsi);
+            std::unique_lock<std::mutex> lk(shard->mtx, std::defer_lock);
+            if (!shard->lock_free_reads)
+                lk.lock();
+            part = shard->store->load_sessions(now);
         }
-        ++removed;
-        std::this_thread::sleep_for(std::chrono::milliseconds(1000 / sessions_per_sec));
+        writer.append(part);
     }
+    size_t count = writer.commit(now);
+    spdlog::info("Session snapshot: {} sessions written to {} in {} ms", count, path,
+                 std::chrono::duration_cast<std::chrono::milliseconds>(clock::now() - t0).count());
+    return count;
 }
 
-void SessionManager::graceful_stop(size_t rate) {
-    spdlog::info("Graceful shutdown: offloading all sessions at {} per sec", rate);
+void SessionManager::enable_snapshots(std::string path, std::chrono::seconds interval) {
+    if (snapshot_thread_.joinable() || path.empty() || interval.count() <= 0)
+        return;
+    snapshot_path_     = std::move(path);
+    snapshot_interval_ = interval;
+    snapshot_thread_   = std::thread(&SessionManager::snapshot_loop, this);
+}
+
+void SessionManager::snapshot_loop() {
     while (true) {
-        std::vector<StoredSession> all;
         {
-            std::lock_guard<std::mutex> lk(mtx_);
-            all = store_->load_sessions(now_str());
+            std::unique_lock<std::mutex> lk(stop_mtx_);
+            if (snapshot_cv_.wait_for(lk, snapshot_interval_, [&] { return stop_.load(); }))
+                return;
+        }
+        try {
+            save_snapshot(snapshot_path_);
+        } catch (const std::exception& e) {
+            spdlog::error("Failed to write session snapshot: {}", e.what());
         }
-        if (all.empty()) break;
-        offload_rate(rate);
     }
 }
 
-void SessionManager::expire_session_locked(const std::string& imsi) {
-    store_->delete_session(imsi);
-    cdr_.write({ now_str(), imsi, "expired" });
-    spdlog::info("Session expired for IMSI {}", imsi);
+namespace {
+
+// Запускает fn(0..n-1) в n потоках (нулевой — в вызывающем)
+template <typename Fn>
+void run_parallel(size_t n, Fn&& fn) {
+    std::vector<std::thread> pool;
+    pool.reserve(n - 1);
+    for (size_t t = 1; t < n; ++t) {
+        pool.emplace_back(fn, t);
+    }
+    fn(size_t(0));
+    for (auto& th : pool) th.join();
+}
+
+} // namespace
+
+size_t SessionManager::restore_snapshot(const std::string& path, size_t threads) {
+    const auto t0 = clock::now();
+    SnapshotFile file(path);
+    const size_t count = file.size();
+
+    // Поток на кусок не меньше kMinChunk записей: маленький снимок не стоит запуска потоков
+    constexpr size_t kMinChunk = 65536;
+    if (threads == 0)
+        threads = std::max(1u, std::thread::hardware_concurrency());
+    threads = std::clamp<size_t>(count / kMinChunk, 1, threads);
+    const size_t chunk = (count + threads - 1) / threads;
+
+    const EpochMs now      = clock_.epoch_ms();
+    const auto    steady   = clock_.steady();
+    const size_t  nshards  = shards_.size();
+
+    // 1) Куски файла: сумма хешей и раскладка живых сессий по шардам
+    struct Part {
+        std::vector<std::vector<StoredSession>> shards;
+        std::vector<CdrRecord>                  stale;
+        uint64_t                                sum = 0;
+    };
+    std::vector<Part> parts(threads);
+    run_parallel(threads, [&](size_t t) {
+        Part& part = parts[t];
+        part.shards.resize(nshards);
+        for (auto& v : part.shards) {
+            v.reserve(chunk / nshards + chunk / nshards / 8 + 16);
+        }
+        const size_t end = std::min(count, (t + 1) * chunk);
+        for (size_t i = t * chunk; i < end; ++i) {
+            StoredSession s = file.at(i);
+            part.sum += snapshot_record_hash(s);
+            if (!s.imsi.valid())
+                continue;
+            if (s.expires_at <= now)
+                part.stale.push_back({ now, s.imsi, "expired" });
+            else
+                part.shards[std::hash<Imsi>{}(s.imsi) & shard_mask_].push_back(s);
+        }
+    });
+    uint64_t sum = 0;
+    for (auto& part : parts) {
+        sum += part.sum;
+    }
+    if (sum != file.checksum()) {
+        throw std::runtime_error("Session snapshot " + path + " checksum mismatch");
+    }
+
+    // 2) Шарды: каждый заполняется одним потоком под своим мьютексом
+    std::atomic<size_t>   next_shard{0};
+    std::atomic<uint64_t> restored{0};
+    std::atomic<uint64_t> over_limit{0};
+    run_parallel(threads, [&](size_t) {
+        for (size_t idx; (idx = next_shard.fetch_add(1)) < nshards; ) {
+            Shard& shard = *shards_[idx];
+            std::lock_guard<std::mutex> lk(shard.mtx);
+            for (auto& part : parts) {
+                auto& batch = part.shards[idx];
+                const size_t room = reserve_sessions(batch.size());
+                if (batch.size() > room) {
+                    over_limit.fetch_add(batch.size() - room, std::memory_order_relaxed);
+                    batch.resize(room);
+                }
+                auto res = shard.store->upsert_batch(batch);
+                for (size_t k = 0; k < batch.size() && k < res.size(); ++k) {
+                    if (res[k] == UpsertResult::Failed)
+                        continue;
+                    arm_locked(shard, batch[k].imsi, steady + std::chrono::milliseconds(batch[k].expires_at - now));
+                    restored.fetch_add(1, std::memory_order_relaxed);
+                }
+                release_sessions(room);
+                std::vector<StoredSession>().swap(batch);
+            }
+        }
+    });
+
+    size_t stale = 0;
+    for (auto& part : parts) {
+        cdr_.write_batch(part.stale);
+        stale += part.stale.size();
+    }
+    if (over_limit.load())
+        spdlog::warn("Session snapshot holds more sessions than max_sessions, {} dropped", over_limit.load());
+    spdlog::info("Restored {} sessions from snapshot {} ({} expired while stopped) in {} ms using {} threads",
+                 restored.load(), path, stale,
+                 std::chrono::duration_cast<std::chrono::milliseconds>(clock::now() - t0).count(), threads);
+    return restored.load();
+}
+
+MemoryStats SessionManager::memory_stats() const {
+    MemoryStats m;
+    m.max_sessions = max_sessions_;
+    m.rejected     = rejected_.load(std::memory_order_relaxed);
+    for (auto& shard : shards_) {
+        std::lock_guard<std::mutex> lk(shard->mtx);
+        m.sessions += shard->wheel.size();
+        m.wheel    += shard->wheel.memory_usage();
+        m.store    += shard->store->memory_usage();
+    }
+
+    const uint64_t reserved = m.store.bytes_reserved + m.wheel.bytes_reserved;
+    const uint64_t in_use   = m.store.bytes_in_use + m.wheel.bytes_in_use;
+    if (m.sessions)
+        m.bytes_per_session = in_use / m.sessions;
+    if (reserved)
+        m.fragmentation = 1.0 - double(in_use) / double(reserved);
+
+    // Вторая колонка /proc/self/statm — резидентные страницы
+    if (std::FILE* f = std::fopen("/proc/self/statm", "r")) {
+        unsigned long long size = 0, resident = 0;
+        if (std::fscanf(f, "%llu %llu", &size, &resident) == 2)
+            m.rss_bytes = resident * static_cast<uint64_t>(::sysconf(_SC_PAGESIZE));
+        std::fclose(f);
+    }
+    return m;
+}
+
+void SessionManager::sync_armed_locked(Shard& shard) noexcept {
+    const uint64_t size = shard.wheel.size();
+    const uint64_t prev = shard.armed.exchange(size, std::memory_order_relaxed);
+    // Общий счётчик нужен только пределу; продление размер колеса не меняет
+    if (max_sessions_ && size != prev)
+        live_.fetch_add(size - prev, std::memory_order_relaxed);  // Уменьшение — через переполнение
+}
+
+size_t SessionManager::reserve_sessions(size_t n) noexcept {
+    if (!max_sessions_)
+        return n;
+    uint64_t cur = live_.load(std::memory_order_relaxed);
+    for (;;) {
+        uint64_t take = std::min<uint64_t>(n, cur < max_sessions_ ? max_sessions_ - cur : 0);
+        if (take == 0)
+            return 0;
+        if (live_.compare_exchange_weak(cur, cur + take, std::memory_order_relaxed))
+            return static_cast<size_t>(take);
+    }
+}
+
+void SessionManager::release_sessions(size_t n) noexcept {
+    if (max_sessions_ && n)
+        live_.fetch_sub(n, std::memory_order_relaxed);
+}
+
+uint64_t SessionManager::armed_total() const noexcept {
+    uint64_t total = 0;
+    for (auto& shard : shards_) {
+        total += shard->armed.load(std::memory_order_relaxed);
+    }
+    return total;
+}
+
+ExpiryStats SessionManager::expiry_stats() const {
+    ExpiryStats st;
+    st.sessions   = armed_total();
+    st.expired    = expired_.load(std::memory_order_relaxed);
+    st.max_lag_us = max_lag_us_.load(std::memory_order_relaxed);
+    st.tick_ms    = static_cast<uint64_t>(kExpiryTick.count());
+    for (size_t i = 0; i < ExpiryStats::kBuckets; ++i) {
+        st.lag[i] = lag_[i].load(std::memory_order_relaxed);
+    }
+    return st;
+}
+
+void SessionManager::arm_locked(Shard& shard, Imsi imsi, clock::time_point expires) {
+    uint64_t tick = deadline_tick(expires);
+    shard.wheel.schedule(imsi, tick);
+    sync_armed_locked(shard);
+
+    // Обычно срок позже уже запланированного пробуждения: тогда очистку не трогаем
+    if (tick < wake_tick_.load(std::memory_order_relaxed)) {
+        std::lock_guard<std::mutex> lk(stop_mtx_);
+        if (tick < wake_tick_.load(std::memory_order_relaxed)) {
+            wake_tick_.store(tick, std::memory_order_relaxed);
+            cv_.notify_one();
+        }
+    }
+}
+
+uint64_t SessionManager::current_tick() const noexcept {
+    auto elapsed = clock::now() - epoch_;
+    return static_cast<uint64_t>(elapsed / kExpiryTick);
+}
+
+uint64_t SessionManager::deadline_tick(clock::time_point tp) const noexcept {
+    // Округляем вверх: сессия не истекает раньше своего срока
+    if (tp <= epoch_)
+        return 0;
+    const int64_t ns      = std::chrono::duration_cast<std::chrono::nanoseconds>(tp - epoch_).count();
+    const int64_t tick_ns = std::chrono::nanoseconds(kExpiryTick).count();
+    return static_cast<uint64_t>((ns + tick_ns - 1) / tick_ns);
+}
+
+clock::time_point SessionManager::tick_time(uint64_t tick) const noexcept {
+    return epoch_ + kExpiryTick * static_cast<int64_t>(tick);
+}
+
+void SessionManager::record_lag(clock::duration lag) noexcept {
+    auto us = static_cast<uint64_t>(std::max<int64_t>(
+        0, std::chrono::duration_cast<std::chrono::microseconds>(lag).count()));
+
+    size_t bucket = 0;
+    while (bucket + 1 < ExpiryStats::kBuckets && us > uint64_t(ExpiryStats::kLagBoundsMs[bucket]) * 1000)
+        ++bucket;
+    lag_[bucket].fetch_add(1, std::memory_order_relaxed);
+    expired_.fetch_add(1, std::memory_order_relaxed);
+    if (us > max_lag_us_.load(std::memory_order_relaxed))
+        max_lag_us_.store(us, std::memory_order_relaxed);
 }
 
 void SessionManager::cleaner_loop() {
+    std::vector<TimingWheel::Expired> due;
+    std::vector<Imsi>                 due_imsis;
     while (!stop_) {
-        auto now = now_str();
+        // Пока обходим шарды, любой новый срок опускает wake_tick_ — он не потеряется
+        wake_tick_.store(TimingWheel::kNever, std::memory_order_relaxed);
 
-        // 1) Сначала получаем список строго просроченных — чтобы написать CDR
-        auto expired = store_->load_expired_sessions(now);
-        for (auto& s : expired) {
-            cdr_.write({ now, s.imsi, "expired" });
-            spdlog::info("Session expired for IMSI {}", s.imsi);
-        }
+        uint64_t now  = current_tick();
+        uint64_t next = TimingWheel::kNever;
+        for (auto& shard : shards_) {
+            // 1) Под мьютексом шарда снимаем с колеса наступившие сроки и удаляем эти сессии
+            //    одним обращением к хранилищу
+            due.clear();
+            {
+                std::lock_guard<std::mutex> lk(shard->mtx);
+                shard->wheel.advance(now, due);
+                if (!due.empty()) {
+                    due_imsis.clear();
+                    for (auto& e : due) {
+                        due_imsis.push_back(e.imsi);
+                    }
+                    shard->store->delete_batch(due_imsis);
+                }
+                sync_armed_locked(*shard);
+                next = std::min(next, shard->wheel.next_event());
+            }
+            if (due.empty())
+                continue;
 
-        // 2) Потом удаляем их из хранилища одним запросом/итерацией
-        store_->cleanup_expired_sessions(now);
+            // 2) CDR пишем уже без блокировки шарда
+            auto ts     = epoch_ms_now();
+            auto now_tp = clock::now();
+            for (auto& e : due) {
+                record_lag(now_tp - tick_time(e.deadline));
+                cdr_.write({ ts, e.imsi, "expired" });
+                spdlog::info("Session expired for IMSI {}", e.imsi);
+            }
+        }
 
-        // 3) Ждём до следующей итерации
-        std::unique_lock<std::mutex> lk(mtx_);
-        cv_.wait_for(lk, std::chrono::seconds(1));
+        // 3) Спим до ближайшего срока; если сессий нет — пока не появится первая
+        std::unique_lock<std::mutex> lk(stop_mtx_);
+        uint64_t wake = std::min(next, wake_tick_.load(std::memory_order_relaxed));
+        wake_tick_.store(wake, std::memory_order_relaxed);
+        auto woken = [&] { return stop_.load() || wake_tick_.load(std::memory_order_relaxed) < wake; };
+        if (wake == TimingWheel::kNever)
+            cv_.wait(lk, woken);
+        else
+            cv_.wait_until(lk, tick_time(wake), woken);
     }
 }
 
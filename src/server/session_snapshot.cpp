@@ -0,0 +1,188 @@
+// src/server/session_snapshot.cpp
+#include "pgw/session_snapshot.hpp"
+
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <stdexcept>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <system_error>
+#include <unistd.h>
+
+namespace pgw {
+
+namespace {
+
+constexpr char   kMagic[8]    = { 'P', 'G', 'W', 'S', 'N', 'A', 'P', '\0' };
+constexpr size_t kRecordSize  = 24;           // IMSI, created_at, expires_at
+constexpr size_t kBufferBytes = 1 << 20;      // Запись файла кусками по мегабайту
+
+void encode(uint8_t* out, const StoredSession& s) noexcept {
+    const uint64_t key = s.imsi.packed();
+    std::memcpy(out, &key, 8);
+    std::memcpy(out + 8, &s.created_at, 8);
+    std::memcpy(out + 16, &s.expires_at, 8);
+}
+
+[[noreturn]] void throw_errno(const std::string& what) {
+    throw std::system_error(errno, std::generic_category(), what);
+}
+
+// Пишет буфер целиком (write может записать часть)
+void write_all(int fd, const uint8_t* data, size_t len, const std::string& path) {
+    while (len > 0) {
+        ssize_t n = ::write(fd, data, len);
+        if (n < 0) {
+            if (errno == EINTR)
+                continue;
+            throw_errno("Failed to write session snapshot " + path);
+        }
+        data += n;
+        len  -= static_cast<size_t>(n);
+    }
+}
+
+} // namespace
+
+uint64_t snapshot_record_hash(const StoredSession& s) noexcept {
+    // Перемешивание splitmix64 поверх трёх полей
+    uint64_t x = s.imsi.packed() * 0x9E3779B97F4A7C15ull
+               ^ static_cast<uint64_t>(s.created_at) * 0xC2B2AE3D27D4EB4Full
+               ^ static_cast<uint64_t>(s.expires_at) * 0x165667B19E3779F9ull;
+    x ^= x >> 30;
+    x *= 0xBF58476D1CE4E5B9ull;
+    x ^= x >> 27;
+    x *= 0x94D049BB133111EBull;
+    x ^= x >> 31;
+    return x;
+}
+
+SnapshotWriter::SnapshotWriter(std::string path)
+    : path_(std::move(path))
+    , tmp_path_(path_ + ".tmp")
+{
+    fd_ = ::open(tmp_path_.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd_ < 0)
+        throw_errno("Failed to create session snapshot " + tmp_path_);
+    buffer_.reserve(kBufferBytes);
+    // Место под заголовок; он пишется в commit(), когда известны число записей и сумма
+    buffer_.resize(sizeof(SnapshotHeader));
+}
+
+SnapshotWriter::~SnapshotWriter() {
+    if (fd_ >= 0) {
+        ::close(fd_);
+        ::unlink(tmp_path_.c_str());
+    }
+}
+
+void SnapshotWriter::append(std::span<const StoredSession> sessions) {
+    for (const auto& s : sessions) {
+        if (buffer_.size() + kRecordSize > kBufferBytes)
+            flush_buffer();
+        size_t at = buffer_.size();
+        buffer_.resize(at + kRecordSize);
+        encode(buffer_.data() + at, s);
+        checksum_ += snapshot_record_hash(s);
+        ++count_;
+    }
+}
+
+void SnapshotWriter::flush_buffer() {
+    write_all(fd_, buffer_.data(), buffer_.size(), tmp_path_);
+    buffer_.clear();
+}
+
+size_t SnapshotWriter::commit(EpochMs now) {
+    flush_buffer();
+
+    SnapshotHeader h{};
+    std::memcpy(h.magic, kMagic, sizeof(kMagic));
+    h.version     = kSnapshotVersion;
+    h.record_size = kRecordSize;
+    h.count       = count_;
+    h.written_at  = now;
+    h.checksum    = checksum_;
+    if (::pwrite(fd_, &h, sizeof(h), 0) != static_cast<ssize_t>(sizeof(h)))
+        throw_errno("Failed to write session snapshot header " + tmp_path_);
+
+    // Сначала данные на диске, потом подмена: после сбоя остаётся либо старый, либо новый снимок
+    if (::fsync(fd_) != 0)
+        throw_errno("Failed to sync session snapshot " + tmp_path_);
+    ::close(fd_);
+    fd_ = -1;
+    if (::rename(tmp_path_.c_str(), path_.c_str()) != 0) {
+        int err = errno;
+        ::unlink(tmp_path_.c_str());
+        errno = err;
+        throw_errno("Failed to replace session snapshot " + path_);
+    }
+    return static_cast<size_t>(count_);
+}
+
+SnapshotFile::SnapshotFile(const std::string& path) {
+    int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+        throw_errno("Failed to open session snapshot " + path);
+
+    struct stat st {};
+    if (::fstat(fd, &st) != 0) {
+        int err = errno;
+        ::close(fd);
+        errno = err;
+        throw_errno("Failed to stat session snapshot " + path);
+    }
+    bytes_ = static_cast<size_t>(st.st_size);
+    if (bytes_ < sizeof(SnapshotHeader)) {
+        ::close(fd);
+        throw std::runtime_error("Session snapshot " + path + " is truncated");
+    }
+
+    void* p = ::mmap(nullptr, bytes_, PROT_READ, MAP_PRIVATE, fd, 0);
+    int err = errno;
+    ::close(fd);
+    if (p == MAP_FAILED) {
+        errno = err;
+        throw_errno("Failed to map session snapshot " + path);
+    }
+    data_ = static_cast<const uint8_t*>(p);
+    // Восстановление читает файл несколькими потоками подряд — подгружаем его заранее
+    ::madvise(p, bytes_, MADV_WILLNEED);
+
+    std::memcpy(&header_, data_, sizeof(header_));
+    const char* problem = nullptr;
+    if (std::memcmp(header_.magic, kMagic, sizeof(kMagic)) != 0)
+        problem = "is not a session snapshot";
+    else if (header_.version != kSnapshotVersion)
+        problem = "has unsupported version";
+    else if (header_.record_size != kRecordSize)
+        problem = "has unexpected record size";
+    else if (header_.count > (bytes_ - sizeof(SnapshotHeader)) / kRecordSize
+             || sizeof(SnapshotHeader) + header_.count * kRecordSize != bytes_)
+        problem = "is truncated";
+    if (problem) {
+        ::munmap(const_cast<uint8_t*>(data_), bytes_);
+        data_ = nullptr;
+        throw std::runtime_error("Session snapshot " + path + " " + problem);
+    }
+}
+
+SnapshotFile::~SnapshotFile() {
+    if (data_)
+        ::munmap(const_cast<uint8_t*>(data_), bytes_);
+}
+
+StoredSession SnapshotFile::at(size_t i) const noexcept {
+    const uint8_t* rec = data_ + sizeof(SnapshotHeader) + i * kRecordSize;
+    uint64_t key;
+    StoredSession s;
+    std::memcpy(&key, rec, 8);
+    std::memcpy(&s.created_at, rec + 8, 8);
+    std::memcpy(&s.expires_at, rec + 16, 8);
+    s.imsi = Imsi::from_packed(key);
+    return s;
+}
+
+} // namespace pgw
@@ -0,0 +1,75 @@
+// src/server/slab_pool.cpp
+#include "pgw/slab_pool.hpp"
+
+#include <algorithm>
+#include <stdexcept>
+
+namespace pgw {
+
+SlabPool::SlabPool(size_t object_size) {
+    if (object_size)
+        adopt(object_size);
+}
+
+SlabPool::~SlabPool() = default;
+
+bool SlabPool::adopt(size_t object_size) noexcept {
+    // Объект должен вмещать указатель списка свободных и сохранять выравнивание соседей
+    size_t size = std::max(object_size, sizeof(FreeNode));
+    size = (size + kAlign - 1) / kAlign * kAlign;
+    if (object_size_)
+        return object_size_ == size;
+    object_size_ = size;
+    per_slab_    = std::max<size_t>(1, kSlabBytes / size);
+    return true;
+}
+
+void SlabPool::add_slab() {
+    auto slab = std::make_unique<std::byte[]>(per_slab_ * object_size_);
+    // Нарезаем плиту с конца, чтобы объекты выдавались по возрастанию адресов
+    for (size_t i = per_slab_; i-- > 0;) {
+        auto* node = reinterpret_cast<FreeNode*>(slab.get() + i * object_size_);
+        node->next = free_;
+        free_      = node;
+    }
+    slabs_.push_back(std::move(slab));
+}
+
+void* SlabPool::allocate() {
+    if (!free_) {
+        if (!object_size_)
+            throw std::logic_error("Slab pool object size is not set");
+        add_slab();
+    }
+    FreeNode* node = free_;
+    free_ = node->next;
+    ++in_use_;
+    return node;
+}
+
+void SlabPool::deallocate(void* p) noexcept {
+    auto* node = static_cast<FreeNode*>(p);
+    node->next = free_;
+    free_      = node;
+    --in_use_;
+}
+
+void SlabPool::reserve(size_t n) {
+    if (!object_size_)
+        throw std::logic_error("Slab pool object size is not set");
+    while (slabs_.size() * per_slab_ < n)
+        add_slab();
+}
+
+SlabStats SlabPool::stats() const noexcept {
+    SlabStats s;
+    s.object_size    = object_size_;
+    s.objects        = in_use_;
+    s.capacity       = slabs_.size() * per_slab_;
+    s.slabs          = slabs_.size();
+    s.bytes_reserved = s.capacity * object_size_;
+    s.bytes_in_use   = in_use_ * object_size_;
+    return s;
+}
+
+} // namespace pgw
@@ -1,137 +1,875 @@
 // src/server/sqlite_session_store.cpp
 #include "pgw/sqlite_session_store.hpp"
 #include <spdlog/spdlog.h>
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <string_view>
+#include <iterator>
+#include <stdexcept>
 
 namespace pgw {
 
-SqliteSessionStore::SqliteSessionStore(const std::string& db_path) {
+namespace {
+
+// SQL и имена подготовленных запросов — в порядке SqliteSessionStore::Query
+struct QueryText {
+    const char* name;
+    const char* sql;
+    bool        read;  // Готовится и на соединениях пула чтения
+};
+
+constexpr QueryText kQueries[] = {
+    { "replace",        "REPLACE INTO sessions (imsi, created_at, expires_at) VALUES (?, ?, ?);", false },
+    // UPDATE + INSERT вместо INSERT ... ON CONFLICT: по sqlite3_changes() видно, создана ли сессия
+    { "update_expires", "UPDATE sessions SET expires_at = ? WHERE imsi = ?;", false },
+    { "insert",         "INSERT INTO sessions (imsi, created_at, expires_at) VALUES (?, ?, ?);", false },
+    { "delete",         "DELETE FROM sessions WHERE imsi = ?;", false },
+    { "exists",         "SELECT 1 FROM sessions WHERE imsi = ? LIMIT 1;", true },
+    { "select",         "SELECT created_at, expires_at FROM sessions WHERE imsi = ?;", true },
+    { "load_live",      "SELECT imsi, created_at, expires_at FROM sessions WHERE expires_at > ?;", true },
+    { "load_expired",   "SELECT imsi, created_at, expires_at FROM sessions WHERE expires_at <= ?;", true },
+    // Не больше ? строк за раз, самые старые первыми: каждая порция — своя короткая транзакция
+    { "delete_expired", "DELETE FROM sessions WHERE imsi IN "
+                        "(SELECT imsi FROM sessions WHERE expires_at <= ? ORDER BY expires_at LIMIT ?);", false },
+    { "begin",          "BEGIN;", true },
+    { "commit",         "COMMIT;", true },
+    { "rollback",       "ROLLBACK;", true },
+};
+
+// Версии схемы (PRAGMA user_version):
+//   0 — исходная: imsi TEXT, сроки TEXT "YYYY-MM-DD HH:MM:SS" в местном времени, без индекса по сроку;
+//   1 — imsi INTEGER PRIMARY KEY (упакованный IMSI, Imsi::packed), сроки INTEGER (Unix-время, мс),
+//       индекс по expires_at для выборок и удаления истёкших
+constexpr int kSchemaVersion = 1;
+
+constexpr const char* kCreateSchema =
+    "CREATE TABLE sessions ("
+    "imsi INTEGER PRIMARY KEY,"
+    "created_at INTEGER NOT NULL,"
+    "expires_at INTEGER NOT NULL);"
+    "CREATE INDEX sessions_expires_at ON sessions (expires_at);"
+    "PRAGMA user_version = 1;";
+
+// IMSI хранится упакованным (ключ таблицы — сам rowid); старший полубайт — число цифр, поэтому
+// значение может не влезать в знаковое целое SQLite и хранится побитно
+void bind(sqlite3_stmt* stmt, int index, Imsi imsi) {
+    sqlite3_bind_int64(stmt, index, static_cast<sqlite3_int64>(imsi.packed()));
+}
+
+void bind(sqlite3_stmt* stmt, int index, EpochMs ms) {
+    sqlite3_bind_int64(stmt, index, ms);
+}
+
+Imsi column_imsi(sqlite3_stmt* stmt, int index) {
+    return Imsi::from_packed(static_cast<uint64_t>(sqlite3_column_int64(stmt, index)));
+}
+
+EpochMs column_time(sqlite3_stmt* stmt, int index) {
+    return sqlite3_column_int64(stmt, index);
+}
+
+// Выполняет SQL без результата; ошибка — в журнал
+bool exec_sql(sqlite3* db, const char* sql) {
+    char* err_msg = nullptr;
+    if (sqlite3_exec(db, sql, nullptr, nullptr, &err_msg) != SQLITE_OK) {
+        spdlog::error("Failed to execute {}: {}", sql, err_msg ? err_msg : "");
+        sqlite3_free(err_msg);
+        return false;
+    }
+    return true;
+}
+
+// Первый столбец первой строки запроса как целое; -1 при ошибке
+int64_t query_int(sqlite3* db, const char* sql) {
+    sqlite3_stmt* stmt = nullptr;
+    int64_t value = -1;
+    if (sqlite3_prepare_v2(db, sql, -1, &stmt, nullptr) == SQLITE_OK) {
+        int rc = sqlite3_step(stmt);
+        if (rc == SQLITE_ROW)
+            value = sqlite3_column_int64(stmt, 0);
+        else if (rc == SQLITE_DONE)
+            value = 0;
+    }
+    if (value < 0)
+        spdlog::error("Failed to execute {}: {}", sql, sqlite3_errmsg(db));
+    sqlite3_finalize(stmt);
+    return value;
+}
+
+} // namespace
+
+// Одно выполнение подготовленного запроса: засекает время, по выходу сбрасывает запрос и
+// отвязывает параметры (на запросе не остаётся указателей на буферы вызывающего), затем
+// добавляет время к счётчикам запроса. Вызывается под mtx_
+class SqliteSessionStore::Call {
+public:
+    explicit Call(Prepared& q) noexcept
+        : q_(q)
+        , started_(std::chrono::steady_clock::now())
+    {}
+
+    ~Call() {
+        sqlite3_reset(q_.stmt);
+        sqlite3_clear_bindings(q_.stmt);
+        auto ns = static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now() - started_).count());
+        ++q_.calls;
+        q_.total_ns += ns;
+        q_.max_ns    = std::max(q_.max_ns, ns);
+    }
+
+    Call(const Call&) = delete;
+    Call& operator=(const Call&) = delete;
+
+    sqlite3_stmt* stmt() const noexcept { return q_.stmt; }
+
+    // sqlite3_step с учётом ошибок (всё, кроме SQLITE_ROW и SQLITE_DONE)
+    int step() noexcept {
+        int rc = sqlite3_step(q_.stmt);
+        if (rc != SQLITE_ROW && rc != SQLITE_DONE)
+            ++q_.errors;
+        return rc;
+    }
+
+private:
+    Prepared&                             q_;
+    std::chrono::steady_clock::time_point started_;
+};
+
+// Соединение пула чтения на время одного чтения: первое свободное, начиная со следующего по кругу;
+// если заняты все — ожидание одного из них (учитывается в waits)
+class SqliteSessionStore::ReadLease {
+public:
+    explicit ReadLease(SqliteSessionStore& store) {
+        const size_t n     = store.readers_.size();
+        const size_t start = store.next_reader_.fetch_add(1, std::memory_order_relaxed);
+        for (size_t i = 0; i < n && !r_; ++i) {
+            Reader& r = *store.readers_[(start + i) % n];
+            if (r.mtx.try_lock())
+                r_ = &r;
+        }
+        if (!r_) {
+            r_ = store.readers_[start % n].get();
+            r_->mtx.lock();
+            ++r_->waits;
+        }
+        ++r_->reads;
+    }
+
+    ~ReadLease() { r_->mtx.unlock(); }
+
+    ReadLease(const ReadLease&) = delete;
+    ReadLease& operator=(const ReadLease&) = delete;
+
+    Reader& operator*() const noexcept { return *r_; }
+
+private:
+    Reader* r_ = nullptr;
+};
+
+template <typename Fn>
+auto SqliteSessionStore::read(Fn&& fn) {
+    if (readers_.empty()) {
+        std::lock_guard<std::mutex> lock(mtx_);
+        return fn(db_, queries_);
+    }
+    ReadLease lease(*this);
+    return fn((*lease).db, (*lease).queries);
+}
+
+SqliteSessionStore::SqliteSessionStore(const std::string& db_path, SqliteStoreOptions options)
+    : options_(std::move(options))
+{
+    auto lower = [](std::string& v) {
+        std::transform(v.begin(), v.end(), v.begin(), [](unsigned char c) { return std::tolower(c); });
+    };
+    lower(options_.journal_mode);
+    lower(options_.synchronous);
+    static const char* const kJournalModes[] = { "delete", "truncate", "persist", "memory", "wal", "off" };
+    static const char* const kSynchronous[]  = { "off", "normal", "full", "extra" };
+    if (std::find(std::begin(kJournalModes), std::end(kJournalModes), options_.journal_mode) == std::end(kJournalModes)) {
+        throw std::invalid_argument("Unknown SQLite journal mode: " + options_.journal_mode);
+    }
+    if (std::find(std::begin(kSynchronous), std::end(kSynchronous), options_.synchronous) == std::end(kSynchronous)) {
+        throw std::invalid_argument("Unknown SQLite synchronous mode: " + options_.synchronous);
+    }
+    if (write_behind() && options_.commit_rows == 0) {
+        throw std::invalid_argument("SQLite commit rows must be positive");
+    }
+    if (options_.expire_chunk_rows == 0) {
+        throw std::invalid_argument("SQLite expire chunk rows must be positive");
+    }
+    commit_stats_.interval_ms = static_cast<uint64_t>(options_.commit_interval.count());
+    commit_stats_.commit_rows = write_behind() ? options_.commit_rows : 1;
+
     if (sqlite3_open(db_path.c_str(), &db_) != SQLITE_OK) {
         spdlog::error("Failed to open session database: {}", sqlite3_errmsg(db_));
+        sqlite3_close(db_);
         db_ = nullptr;
-    } else {
-        init_schema();
+        return;
+    }
+    // Соединения пула чтения (и другие процессы) ненадолго берут блокировки журнала WAL — запись
+    // ждёт их, а не возвращает SQLITE_BUSY
+    sqlite3_busy_timeout(db_, 1000);
+    std::string mode = apply_pragmas();
+    ready_ = init_schema() && prepare_statements(db_, queries_, false);
+    if (ready_ && options_.read_connections > 0) {
+        // Читатели не ждут писателя только в WAL; база в памяти у каждого соединения своя
+        if (mode == "wal") {
+            open_readers(db_path);
+        } else {
+            spdlog::warn("SQLite read pool needs journal_mode=wal (database uses {}), reads share the writer connection",
+                         mode);
+        }
+    }
+    if (ready_ && write_behind()) {
+        pending_.reserve(options_.commit_rows);
+        flusher_ = std::thread(&SqliteSessionStore::flush_loop, this);
     }
 }
 
 SqliteSessionStore::~SqliteSessionStore() {
+    // Поток отложенной записи фиксирует остаток перед выходом
+    if (flusher_.joinable()) {
+        {
+            std::lock_guard<std::mutex> lock(mtx_);
+            stop_ = true;
+        }
+        flush_cv_.notify_one();
+        flusher_.join();
+    }
+    close_readers();
+    for (auto& q : queries_) sqlite3_finalize(q.stmt);
     if (db_) sqlite3_close(db_);
 }
 
-void SqliteSessionStore::init_schema() {
-    const char* sql =
-        "CREATE TABLE IF NOT EXISTS sessions ("
-        "imsi TEXT PRIMARY KEY,"
-        "created_at TEXT,"
-        "expires_at TEXT);";
+void SqliteSessionStore::open_readers(const std::string& db_path) {
+    for (size_t i = 0; i < options_.read_connections; ++i) {
+        auto r = std::make_unique<Reader>();
+        // NOMUTEX: соединение занимает один поток за раз (ReadLease), свой мьютекс SQLite не нужен
+        int rc = sqlite3_open_v2(db_path.c_str(), &r->db, SQLITE_OPEN_READONLY | SQLITE_OPEN_NOMUTEX, nullptr);
+        if (rc == SQLITE_OK) {
+            // Чтение ждёт только восстановления журнала после сбоя другого процесса
+            sqlite3_busy_timeout(r->db, 1000);
+        }
+        bool ok = rc == SQLITE_OK && prepare_statements(r->db, r->queries, true);
+        readers_.push_back(std::move(r));
+        if (!ok) {
+            spdlog::error("Failed to open SQLite read connection: {}, reads share the writer connection",
+                          sqlite3_errmsg(readers_.back()->db));
+            close_readers();
+            return;
+        }
+    }
+    spdlog::info("SQLite session store: {} read connections", readers_.size());
+}
+
+void SqliteSessionStore::close_readers() {
+    for (auto& r : readers_) {
+        for (auto& q : r->queries) sqlite3_finalize(q.stmt);
+        sqlite3_close(r->db);
+    }
+    readers_.clear();
+}
+
+std::string SqliteSessionStore::apply_pragmas() {
+    // journal_mode возвращает режим, который действительно включён (база в памяти остаётся "memory")
+    std::string sql = "PRAGMA journal_mode=" + options_.journal_mode + ";";
+    std::string mode;
     char* err_msg = nullptr;
-    if (sqlite3_exec(db_, sql, nullptr, nullptr, &err_msg) != SQLITE_OK) {
-        spdlog::error("Failed to create schema: {}", err_msg);
+    auto read_mode = [](void* out, int, char** values, char**) {
+        if (values[0]) *static_cast<std::string*>(out) = values[0];
+        return 0;
+    };
+    if (sqlite3_exec(db_, sql.c_str(), read_mode, &mode, &err_msg) != SQLITE_OK) {
+        spdlog::error("Failed to set SQLite journal mode {}: {}", options_.journal_mode, err_msg ? err_msg : "");
+        sqlite3_free(err_msg);
+    } else if (mode != options_.journal_mode) {
+        spdlog::warn("SQLite journal mode {} requested, database uses {}", options_.journal_mode, mode);
+    }
+
+    sql = "PRAGMA synchronous=" + options_.synchronous + ";";
+    if (sqlite3_exec(db_, sql.c_str(), nullptr, nullptr, &err_msg) != SQLITE_OK) {
+        spdlog::error("Failed to set SQLite synchronous {}: {}", options_.synchronous, err_msg ? err_msg : "");
         sqlite3_free(err_msg);
     }
+    spdlog::info("SQLite session store: journal_mode={}, synchronous={}, commit every {} ms or {} rows",
+                 mode, options_.synchronous, options_.commit_interval.count(),
+                 write_behind() ? options_.commit_rows : 1);
+    return mode;
+}
+
+bool SqliteSessionStore::init_schema() {
+    // IMMEDIATE: другое соединение с тем же файлом не начнёт ту же миграцию одновременно
+    if (!exec_sql(db_, "BEGIN IMMEDIATE;"))
+        return false;
+    int64_t version = query_int(db_, "PRAGMA user_version;");
+    bool ok = version >= 0;
+    if (ok && version > kSchemaVersion) {
+        spdlog::error("Session database schema version {} is newer than supported {}", version, kSchemaVersion);
+        ok = false;
+    } else if (ok && version < kSchemaVersion) {
+        int64_t tables = query_int(db_, "SELECT count(*) FROM sqlite_master WHERE type = 'table' AND name = 'sessions';");
+        ok = tables >= 0 && (tables > 0 ? migrate_text_schema() : exec_sql(db_, kCreateSchema));
+    }
+    if (ok && exec_sql(db_, "COMMIT;"))
+        return true;
+    exec_sql(db_, "ROLLBACK;");
+    spdlog::error("Failed to initialize session database schema");
+    return false;
+}
+
+bool SqliteSessionStore::migrate_text_schema() {
+    // Версия 0 → 1 внутри транзакции init_schema: старая таблица переименовывается, строки
+    // переносятся с разбором текста (тем же parse_timestamp, что читал их прежде), затем удаляется
+    auto t0 = std::chrono::steady_clock::now();
+    if (!exec_sql(db_, "ALTER TABLE sessions RENAME TO sessions_v0;") || !exec_sql(db_, kCreateSchema))
+        return false;
+
+    sqlite3_stmt* select = nullptr;
+    sqlite3_stmt* insert = nullptr;
+    bool ok = sqlite3_prepare_v2(db_, "SELECT imsi, created_at, expires_at FROM sessions_v0;", -1,
+                                 &select, nullptr) == SQLITE_OK &&
+              sqlite3_prepare_v2(db_, "INSERT OR REPLACE INTO sessions (imsi, created_at, expires_at) VALUES (?, ?, ?);",
+                                 -1, &insert, nullptr) == SQLITE_OK;
+    size_t moved = 0, skipped = 0;
+    int rc = SQLITE_DONE;
+    while (ok && (rc = sqlite3_step(select)) == SQLITE_ROW) {
+        auto text = [select](int i) {
+            const char* t = reinterpret_cast<const char*>(sqlite3_column_text(select, i));
+            return std::string_view(t ? t : "");
+        };
+        Imsi imsi = Imsi::from_string(text(0));
+        EpochMs created_at = 0, expires_at = 0;
+        if (!imsi.valid() || !parse_timestamp(text(1), created_at) || !parse_timestamp(text(2), expires_at)) {
+            spdlog::warn("Dropping invalid session row during migration: {} {} {}", text(0), text(1), text(2));
+            ++skipped;
+            continue;
+        }
+        bind(insert, 1, imsi);
+        bind(insert, 2, created_at);
+        bind(insert, 3, expires_at);
+        ok = sqlite3_step(insert) == SQLITE_DONE;
+        sqlite3_reset(insert);
+        ++moved;
+    }
+    ok = ok && rc == SQLITE_DONE;
+    if (!ok) {
+        spdlog::error("Failed to migrate session database: {}", sqlite3_errmsg(db_));
+    }
+    sqlite3_finalize(select);
+    sqlite3_finalize(insert);
+    if (!ok || !exec_sql(db_, "DROP TABLE sessions_v0;"))
+        return false;
+
+    spdlog::info("Migrated session database to schema version {}: {} sessions, {} invalid rows dropped, {} ms",
+                 kSchemaVersion, moved, skipped,
+                 std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - t0).count());
+    return true;
+}
+
+bool SqliteSessionStore::prepare_statements(sqlite3* db, Statements& queries, bool reads_only) {
+    static_assert(std::size(kQueries) == kQueryCount, "Every query needs its SQL");
+    bool ok = true;
+    for (size_t i = 0; i < kQueryCount; ++i) {
+        if (reads_only && !kQueries[i].read)
+            continue;
+        // PERSISTENT: запрос живёт всё время работы хранилища
+        if (sqlite3_prepare_v3(db, kQueries[i].sql, -1, SQLITE_PREPARE_PERSISTENT,
+                               &queries[i].stmt, nullptr) != SQLITE_OK) {
+            spdlog::error("Failed to prepare session query {}: {}", kQueries[i].name, sqlite3_errmsg(db));
+            ok = false;
+        }
+    }
+    return ok;
+}
+
+bool SqliteSessionStore::exec(sqlite3* db, Statements& queries, Query q) {
+    Call call(queries[q]);
+    if (call.step() != SQLITE_DONE) {
+        spdlog::error("Failed to execute {}: {}", kQueries[q].sql, sqlite3_errmsg(db));
+        return false;
+    }
+    return true;
+}
+
+bool SqliteSessionStore::exec(Query q) {
+    return exec(db_, queries_, q);
+}
+
+std::vector<SqliteStatementStats> SqliteSessionStore::statement_stats() {
+    std::vector<SqliteStatementStats> result;
+    result.reserve(kQueryCount);
+    auto add = [&result](const Statements& queries) {
+        for (size_t i = 0; i < kQueryCount; ++i) {
+            const auto& q = queries[i];
+            auto& st = result[i];
+            st.calls    += q.calls;
+            st.errors   += q.errors;
+            st.total_ns += q.total_ns;
+            st.max_ns    = std::max(st.max_ns, q.max_ns);
+        }
+    };
+    for (size_t i = 0; i < kQueryCount; ++i) {
+        result.push_back({ kQueries[i].name });
+    }
+    {
+        std::lock_guard<std::mutex> lock(mtx_);
+        add(queries_);
+    }
+    // Счётчики соединений пула — вместе со счётчиками писателя, по имени запроса
+    for (auto& r : readers_) {
+        std::lock_guard<std::mutex> lock(r->mtx);
+        add(r->queries);
+    }
+    return result;
+}
+
+SqliteReadPoolStats SqliteSessionStore::read_pool_stats() {
+    SqliteReadPoolStats s;
+    s.connections = readers_.size();
+    for (auto& r : readers_) {
+        std::lock_guard<std::mutex> lock(r->mtx);
+        s.reads += r->reads;
+        s.waits += r->waits;
+    }
+    return s;
 }
 
-std::vector<StoredSession> SqliteSessionStore::load_expired_sessions(const std::string& now) {
+SqliteCommitStats SqliteSessionStore::commit_stats() {
     std::lock_guard<std::mutex> lock(mtx_);
+    SqliteCommitStats s = commit_stats_;
+    s.pending = pending_.size();
+    return s;
+}
+
+// --- Запросы к таблице по одной строке ---
+
+bool SqliteSessionStore::replace_row(Imsi imsi, EpochMs created_at, EpochMs expires_at) {
+    Call replace(queries_[kReplace]);
+    bind(replace.stmt(), 1, imsi);
+    bind(replace.stmt(), 2, created_at);
+    bind(replace.stmt(), 3, expires_at);
+    return replace.step() == SQLITE_DONE;
+}
+
+bool SqliteSessionStore::update_row(Imsi imsi, EpochMs expires_at) {
+    Call update(queries_[kUpdateExpires]);
+    bind(update.stmt(), 1, expires_at);
+    bind(update.stmt(), 2, imsi);
+    return update.step() == SQLITE_DONE;
+}
+
+bool SqliteSessionStore::delete_row(Imsi imsi) {
+    Call del(queries_[kDelete]);
+    bind(del.stmt(), 1, imsi);
+    return del.step() == SQLITE_DONE;
+}
+
+bool SqliteSessionStore::exists_row(Statements& queries, Imsi imsi) {
+    Call exists(queries[kExists]);
+    bind(exists.stmt(), 1, imsi);
+    return exists.step() == SQLITE_ROW;
+}
+
+std::optional<StoredSession> SqliteSessionStore::select_row(Statements& queries, Imsi imsi) {
+    Call select(queries[kSelect]);
+    bind(select.stmt(), 1, imsi);
+
+    std::optional<StoredSession> result;
+    if (select.step() == SQLITE_ROW) {
+        result = StoredSession{ imsi, column_time(select.stmt(), 0), column_time(select.stmt(), 1) };
+    }
+    return result;
+}
+
+// Продление срока, а при отсутствии строки — вставка
+UpsertResult SqliteSessionStore::upsert_row(const StoredSession& s) {
+    if (!update_row(s.imsi, s.expires_at))
+        return UpsertResult::Failed;
+    if (sqlite3_changes(db_) > 0)
+        return UpsertResult::Refreshed;
+
+    Call insert(queries_[kInsert]);
+    bind(insert.stmt(), 1, s.imsi);
+    bind(insert.stmt(), 2, s.created_at);
+    bind(insert.stmt(), 3, s.expires_at);
+    return insert.step() == SQLITE_DONE ? UpsertResult::Created : UpsertResult::Failed;
+}
+
+// --- Отложенная запись ---
+
+void merge_write(SessionWrites& writes, Imsi imsi, const SessionWrite& newer) {
+    auto [it, inserted] = writes.try_emplace(imsi, newer);
+    if (inserted)
+        return;
+    SessionWrite& w = it->second;
+    // Продление после записи всей строки остаётся записью всей строки — с новым сроком
+    if (newer.op == SessionWriteOp::Refresh && w.op == SessionWriteOp::Put)
+        w.expires_at = newer.expires_at;
+    else
+        w = newer;
+}
+
+void SqliteSessionStore::defer(Imsi imsi, const SessionWrite& w) {
+    pending_.insert_or_assign(imsi, w);
+    if (pending_.size() >= options_.commit_rows)
+        flush_cv_.notify_one();
+}
+
+UpsertResult SqliteSessionStore::upsert_deferred(const StoredSession& s) {
+    auto it = pending_.find(s.imsi);
+    if (it != pending_.end()) {
+        SessionWrite& p = it->second;
+        if (p.op == SessionWriteOp::Delete) {
+            p = { SessionWriteOp::Put, s.created_at, s.expires_at };
+            return UpsertResult::Created;
+        }
+        p.expires_at = s.expires_at;  // created_at остаётся прежним (или в базе, если Refresh)
+        return UpsertResult::Refreshed;
+    }
+    // Строки нет ни среди отложенных, ни в базе — создаётся; есть — продлевается только срок
+    if (exists_row(queries_, s.imsi)) {
+        defer(s.imsi, { SessionWriteOp::Refresh, s.created_at, s.expires_at });
+        return UpsertResult::Refreshed;
+    }
+    defer(s.imsi, { SessionWriteOp::Put, s.created_at, s.expires_at });
+    return UpsertResult::Created;
+}
+
+size_t SqliteSessionStore::delete_deferred(Imsi imsi) {
+    auto it = pending_.find(imsi);
+    if (it != pending_.end()) {
+        if (it->second.op == SessionWriteOp::Delete)
+            return 0;
+        it->second.op = SessionWriteOp::Delete;
+        return 1;
+    }
+    if (!exists_row(queries_, imsi))
+        return 0;
+    defer(imsi, { SessionWriteOp::Delete, 0, 0 });
+    return 1;
+}
+
+std::optional<SessionWrite> SqliteSessionStore::pending_write(Imsi imsi) {
+    if (!write_behind())
+        return std::nullopt;
+    std::lock_guard<std::mutex> lock(mtx_);
+    auto it = pending_.find(imsi);
+    if (it == pending_.end())
+        return std::nullopt;
+    return it->second;
+}
+
+// Сессия с учётом отложенного изменения: Put и Delete отвечают сами, Refresh меняет срок строки из базы
+std::optional<StoredSession> SqliteSessionStore::with_pending(Statements& queries, Imsi imsi,
+                                                              const std::optional<SessionWrite>& p) {
+    if (!p)
+        return select_row(queries, imsi);
+    switch (p->op) {
+    case SessionWriteOp::Put:
+        return StoredSession{ imsi, p->created_at, p->expires_at };
+    case SessionWriteOp::Refresh: {
+        auto s = select_row(queries, imsi);
+        if (s) s->expires_at = p->expires_at;
+        return s;
+    }
+    case SessionWriteOp::Delete:
+        break;
+    }
+    return std::nullopt;
+}
+
+std::vector<StoredSession> SqliteSessionStore::load_rows(Statements& queries, Query q, EpochMs now) {
     std::vector<StoredSession> result;
-    const char* sql =
-        "SELECT imsi, created_at, expires_at "
-        "FROM sessions "
-        "WHERE expires_at <= ?;";
-    sqlite3_stmt* stmt;
-    if (sqlite3_prepare_v2(db_, sql, -1, &stmt, nullptr) != SQLITE_OK) return result;
-    sqlite3_bind_text(stmt, 1, now.c_str(), -1, SQLITE_TRANSIENT);
-    while (sqlite3_step(stmt) == SQLITE_ROW) {
+    Call select(queries[q]);
+    bind(select.stmt(), 1, now);
+    while (select.step() == SQLITE_ROW) {
         StoredSession s;
-        s.imsi       = reinterpret_cast<const char*>(sqlite3_column_text(stmt, 0));
-        s.created_at = reinterpret_cast<const char*>(sqlite3_column_text(stmt, 1));
-        s.expires_at = reinterpret_cast<const char*>(sqlite3_column_text(stmt, 2));
+        s.imsi       = column_imsi(select.stmt(), 0);
+        s.created_at = column_time(select.stmt(), 1);
+        s.expires_at = column_time(select.stmt(), 2);
         result.push_back(std::move(s));
     }
-    sqlite3_finalize(stmt);
     return result;
 }
 
+bool SqliteSessionStore::commit_locked(const SessionWrites& writes) {
+    auto t0 = std::chrono::steady_clock::now();
+    bool ok = exec(kBegin);
+    if (ok) {
+        for (const auto& [imsi, w] : writes) {
+            switch (w.op) {
+            case SessionWriteOp::Put:
+                ok = replace_row(imsi, w.created_at, w.expires_at);
+                break;
+            case SessionWriteOp::Refresh:
+                ok = upsert_row({ imsi, w.created_at, w.expires_at }) != UpsertResult::Failed;
+                break;
+            case SessionWriteOp::Delete:
+                ok = delete_row(imsi);
+                break;
+            }
+            if (!ok) break;
+        }
+        if (ok) {
+            ok = exec(kCommit);
+        }
+        if (!ok) {
+            exec(kRollback);
+        }
+    }
+    if (!ok) {
+        ++commit_stats_.failed_commits;
+        return false;
+    }
 
-bool SqliteSessionStore::save_session(const StoredSession& s) {
-    return save_session(s.imsi, s.created_at, s.expires_at);
+    auto ns = static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now() - t0).count());
+    uint64_t rows = writes.size();
+    auto& st = commit_stats_;
+    ++st.commits;
+    st.rows            += rows;
+    st.last_batch_rows  = rows;
+    st.max_batch_rows   = std::max(st.max_batch_rows, rows);
+    st.total_commit_ns += ns;
+    st.max_commit_ns    = std::max(st.max_commit_ns, ns);
+    return true;
+}
+
+bool SqliteSessionStore::flush_locked() {
+    if (pending_.empty() || !ready_)
+        return true;
+    if (!commit_locked(pending_)) {
+        spdlog::error("Failed to commit {} pending session writes, keeping them for the next commit: {}",
+                      pending_.size(), sqlite3_errmsg(db_));
+        return false;
+    }
+    pending_.clear();
+    return true;
+}
+
+bool SqliteSessionStore::apply_writes(const SessionWrites& writes) {
+    std::lock_guard<std::mutex> lock(mtx_);
+    if (!ready_) return false;
+    if (writes.empty()) return true;
+    // Более ранние отложенные изменения — в базу первыми
+    if (!flush_locked()) return false;
+    if (!commit_locked(writes)) {
+        spdlog::error("Failed to write {} session changes: {}", writes.size(), sqlite3_errmsg(db_));
+        return false;
+    }
+    return true;
 }
 
-bool SqliteSessionStore::save_session(const std::string& imsi,
-                                      const std::string& created_at,
-                                      const std::string& expires_at) {
+bool SqliteSessionStore::flush() {
     std::lock_guard<std::mutex> lock(mtx_);
-    const char* sql = "REPLACE INTO sessions (imsi, created_at, expires_at) VALUES (?, ?, ?);";
-    sqlite3_stmt* stmt;
-    if (sqlite3_prepare_v2(db_, sql, -1, &stmt, nullptr) != SQLITE_OK) return false;
+    return flush_locked();
+}
+
+void SqliteSessionStore::flush_loop() {
+    std::unique_lock<std::mutex> lock(mtx_);
+    bool failed = false;
+    while (!stop_) {
+        // После неудачной фиксации — повтор через интервал, а не сразу по числу строк
+        flush_cv_.wait_for(lock, options_.commit_interval, [this, failed] {
+            return stop_ || (!failed && pending_.size() >= options_.commit_rows);
+        });
+        failed = !flush_locked();
+    }
+    // Деструктор мог поставить stop_ раньше, чем поток впервые взял mtx_, — тогда цикл не
+    // выполнился ни разу; последняя фиксация — всегда
+    if (!flush_locked()) {
+        spdlog::error("Lost {} pending session writes on shutdown", pending_.size());
+    }
+}
 
-    sqlite3_bind_text(stmt, 1, imsi.c_str(), -1, SQLITE_TRANSIENT);
-    sqlite3_bind_text(stmt, 2, created_at.c_str(), -1, SQLITE_TRANSIENT);
-    sqlite3_bind_text(stmt, 3, expires_at.c_str(), -1, SQLITE_TRANSIENT);
+// --- Интерфейс ISessionStore ---
 
-    bool success = (sqlite3_step(stmt) == SQLITE_DONE);
-    sqlite3_finalize(stmt);
-    return success;
+std::vector<StoredSession> SqliteSessionStore::load_expired_sessions(EpochMs now) {
+    if (!ready_) return {};
+    if (write_behind()) {
+        // Выборка по сроку идёт по таблице — отложенные изменения сначала в неё
+        std::lock_guard<std::mutex> lock(mtx_);
+        flush_locked();
+    }
+    return read([now](sqlite3*, Statements& q) { return load_rows(q, kLoadExpired, now); });
 }
 
-bool SqliteSessionStore::delete_session(const std::string& imsi) {
-    std::lock_guard<std::mutex> lock(mtx_);
-    const char* sql = "DELETE FROM sessions WHERE imsi = ?;";
-    sqlite3_stmt* stmt;
-    if (sqlite3_prepare_v2(db_, sql, -1, &stmt, nullptr) != SQLITE_OK) return false;
 
-    sqlite3_bind_text(stmt, 1, imsi.c_str(), -1, SQLITE_TRANSIENT);
+bool SqliteSessionStore::save_session(const StoredSession& s) {
+    return save_session(s.imsi, s.created_at, s.expires_at);
+}
 
-    bool success = (sqlite3_step(stmt) == SQLITE_DONE);
-    sqlite3_finalize(stmt);
-    return success;
+bool SqliteSessionStore::save_session(Imsi imsi,
+                                      EpochMs created_at,
+                                      EpochMs expires_at) {
+    std::lock_guard<std::mutex> lock(mtx_);
+    if (!ready_) return false;
+    if (write_behind()) {
+        defer(imsi, { SessionWriteOp::Put, created_at, expires_at });
+        return true;
+    }
+    return replace_row(imsi, created_at, expires_at);
 }
 
-bool SqliteSessionStore::session_exists(const std::string& imsi) {
+bool SqliteSessionStore::delete_session(Imsi imsi) {
     std::lock_guard<std::mutex> lock(mtx_);
-    const char* sql = "SELECT 1 FROM sessions WHERE imsi = ? LIMIT 1;";
-    sqlite3_stmt* stmt;
-    if (sqlite3_prepare_v2(db_, sql, -1, &stmt, nullptr) != SQLITE_OK) return false;
+    if (!ready_) return false;
+    if (write_behind()) {
+        delete_deferred(imsi);
+        return true;
+    }
+    return delete_row(imsi);
+}
 
-    sqlite3_bind_text(stmt, 1, imsi.c_str(), -1, SQLITE_TRANSIENT);
+bool SqliteSessionStore::session_exists(Imsi imsi) {
+    if (!ready_) return false;
+    if (auto p = pending_write(imsi))
+        return p->op != SessionWriteOp::Delete;
+    return read([imsi](sqlite3*, Statements& q) { return exists_row(q, imsi); });
+}
 
-    bool exists = (sqlite3_step(stmt) == SQLITE_ROW);
-    sqlite3_finalize(stmt);
-    return exists;
+std::optional<StoredSession> SqliteSessionStore::get_session(Imsi imsi) {
+    if (!ready_) return std::nullopt;
+    auto p = pending_write(imsi);
+    return read([imsi, &p](sqlite3*, Statements& q) { return with_pending(q, imsi, p); });
 }
 
-void SqliteSessionStore::cleanup_expired_sessions(const std::string& now) {
-    std::lock_guard<std::mutex> lock(mtx_);
-    const char* sql = "DELETE FROM sessions WHERE expires_at <= ?;";
-    sqlite3_stmt* stmt;
-    if (sqlite3_prepare_v2(db_, sql, -1, &stmt, nullptr) != SQLITE_OK) return;
+void SqliteSessionStore::cleanup_expired_sessions(EpochMs now) {
+    {
+        std::lock_guard<std::mutex> lock(mtx_);
+        if (!ready_) return;
+        flush_locked();
+    }
+    // Порциями по expire_chunk_rows: между порциями мьютекс и блокировка записи файла свободны,
+    // и запись новых сессий не ждёт удаления всех истёкших разом
+    const auto chunk = static_cast<sqlite3_int64>(options_.expire_chunk_rows);
+    for (;;) {
+        std::lock_guard<std::mutex> lock(mtx_);
+        Call del(queries_[kDeleteExpired]);
+        bind(del.stmt(), 1, now);
+        sqlite3_bind_int64(del.stmt(), 2, chunk);
+        if (del.step() != SQLITE_DONE) {
+            spdlog::error("Failed to delete expired sessions: {}", sqlite3_errmsg(db_));
+            return;
+        }
+        if (sqlite3_changes(db_) < chunk)
+            return;
+    }
+}
 
-    sqlite3_bind_text(stmt, 1, now.c_str(), -1, SQLITE_TRANSIENT);
-    sqlite3_step(stmt);
-    sqlite3_finalize(stmt);
+std::string SqliteSessionStore::query_plan(std::string_view name) {
+    for (size_t i = 0; i < kQueryCount; ++i) {
+        if (name != kQueries[i].name)
+            continue;
+        std::lock_guard<std::mutex> lock(mtx_);
+        if (!ready_) return {};
+        std::string sql = std::string("EXPLAIN QUERY PLAN ") + kQueries[i].sql;
+        sqlite3_stmt* stmt = nullptr;
+        std::string plan;
+        if (sqlite3_prepare_v2(db_, sql.c_str(), -1, &stmt, nullptr) != SQLITE_OK) {
+            spdlog::error("Failed to explain session query {}: {}", name, sqlite3_errmsg(db_));
+            return plan;
+        }
+        // Столбец 3 — описание шага плана ("SEARCH sessions USING INDEX ...")
+        while (sqlite3_step(stmt) == SQLITE_ROW) {
+            const char* detail = reinterpret_cast<const char*>(sqlite3_column_text(stmt, 3));
+            if (!plan.empty()) plan += '\n';
+            plan += detail ? detail : "";
+        }
+        sqlite3_finalize(stmt);
+        return plan;
+    }
+    throw std::invalid_argument("Unknown session query: " + std::string(name));
 }
 
-std::vector<StoredSession> SqliteSessionStore::load_sessions(const std::string& now) {
+UpsertResult SqliteSessionStore::upsert(const StoredSession& s) {
     std::lock_guard<std::mutex> lock(mtx_);
-    std::vector<StoredSession> result;
-    const char* sql = "SELECT imsi, created_at, expires_at FROM sessions WHERE expires_at > ?;";
-    sqlite3_stmt* stmt;
+    if (!ready_) return UpsertResult::Failed;
+    return write_behind() ? upsert_deferred(s) : upsert_row(s);
+}
+
+std::vector<UpsertResult> SqliteSessionStore::upsert_batch(std::span<const StoredSession> sessions) {
+    std::vector<UpsertResult> result(sessions.size(), UpsertResult::Failed);
+    if (sessions.empty()) return result;
 
-    if (sqlite3_prepare_v2(db_, sql, -1, &stmt, nullptr) != SQLITE_OK) {
+    std::lock_guard<std::mutex> lock(mtx_);
+    if (!ready_) return result;
+    if (write_behind()) {
+        for (size_t i = 0; i < sessions.size(); ++i) {
+            result[i] = upsert_deferred(sessions[i]);
+        }
         return result;
     }
+    if (!exec(kBegin)) return result;
+
+    for (size_t i = 0; i < sessions.size(); ++i) {
+        result[i] = upsert_row(sessions[i]);
+    }
+    if (!exec(kCommit)) {
+        exec(kRollback);
+        std::fill(result.begin(), result.end(), UpsertResult::Failed);
+    }
+    return result;
+}
 
-    sqlite3_bind_text(stmt, 1, now.c_str(), -1, SQLITE_TRANSIENT);
+size_t SqliteSessionStore::delete_batch(std::span<const Imsi> imsis) {
+    if (imsis.empty()) return 0;
 
-    while (sqlite3_step(stmt) == SQLITE_ROW) {
-        StoredSession session;
-        session.imsi = reinterpret_cast<const char*>(sqlite3_column_text(stmt, 0));
-        session.created_at = reinterpret_cast<const char*>(sqlite3_column_text(stmt, 1));
-        session.expires_at = reinterpret_cast<const char*>(sqlite3_column_text(stmt, 2));
-        result.push_back(std::move(session));
+    std::lock_guard<std::mutex> lock(mtx_);
+    if (!ready_) return 0;
+    size_t removed = 0;
+    if (write_behind()) {
+        for (Imsi imsi : imsis) {
+            removed += delete_deferred(imsi);
+        }
+        return removed;
     }
+    if (!exec(kBegin)) return 0;
 
-    sqlite3_finalize(stmt);
+    for (Imsi imsi : imsis) {
+        if (delete_row(imsi))
+            removed += static_cast<size_t>(sqlite3_changes(db_));
+    }
+    if (!exec(kCommit)) {
+        exec(kRollback);
+        return 0;
+    }
+    return removed;
+}
+
+std::vector<std::optional<StoredSession>> SqliteSessionStore::lookup_batch(std::span<const Imsi> imsis) {
+    std::vector<std::optional<StoredSession>> result(imsis.size());
+    if (imsis.empty() || !ready_) return result;
+
+    std::vector<std::optional<SessionWrite>> pending(imsis.size());
+    if (write_behind()) {
+        std::lock_guard<std::mutex> lock(mtx_);
+        for (size_t i = 0; i < imsis.size(); ++i) {
+            auto it = pending_.find(imsis[i]);
+            if (it != pending_.end()) pending[i] = it->second;
+        }
+    }
+    read([&](sqlite3* db, Statements& q) {
+        // Чтение в одной транзакции: согласованный снимок и одна блокировка файла на пачку
+        if (!exec(db, q, kBegin)) return;
+        for (size_t i = 0; i < imsis.size(); ++i) {
+            result[i] = with_pending(q, imsis[i], pending[i]);
+        }
+        exec(db, q, kCommit);
+    });
     return result;
 }
 
+std::vector<StoredSession> SqliteSessionStore::load_sessions(EpochMs now) {
+    if (!ready_) return {};
+    if (write_behind()) {
+        std::lock_guard<std::mutex> lock(mtx_);
+        flush_locked();
+    }
+    return read([now](sqlite3*, Statements& q) { return load_rows(q, kLoadLive, now); });
+}
+
 } // namespace pgw
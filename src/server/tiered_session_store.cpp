@@ -0,0 +1,282 @@
+// src/server/tiered_session_store.cpp
+#include "pgw/tiered_session_store.hpp"
+
+#include <spdlog/spdlog.h>
+#include <algorithm>
+#include <stdexcept>
+
+namespace pgw {
+
+// --- SessionWriteBack ---
+
+SessionWriteBack::SessionWriteBack(std::unique_ptr<SqliteSessionStore> cold, size_t shards,
+                                   TieredStoreOptions options)
+    : cold_(std::move(cold))
+    , shard_count_(session_shard_count(shards))
+    , options_(options)
+{
+    if (!cold_) {
+        throw std::invalid_argument("Tiered session store needs a SQLite store");
+    }
+    if (options_.writeback_interval.count() <= 0 || options_.writeback_rows == 0) {
+        throw std::invalid_argument("Tiered write-back interval and rows must be positive");
+    }
+    stats_.interval_ms    = static_cast<uint64_t>(options_.writeback_interval.count());
+    stats_.writeback_rows = options_.writeback_rows;
+    thread_ = std::thread(&SessionWriteBack::run, this);
+}
+
+SessionWriteBack::~SessionWriteBack() {
+    // Поток записывает остаток перед выходом
+    {
+        std::lock_guard<std::mutex> lock(mtx_);
+        stop_ = true;
+    }
+    flush_cv_.notify_one();
+    thread_.join();
+}
+
+std::vector<StoredSession> SessionWriteBack::take_initial(size_t shard) {
+    std::lock_guard<std::mutex> lock(initial_mtx_);
+    if (!initial_loaded_) {
+        // Одно чтение базы на все шарды; истёкшие строки тоже — их удалит запуск менеджера
+        auto t0   = std::chrono::steady_clock::now();
+        auto rows = cold_->load_sessions(0);
+        initial_.resize(shard_count_);
+        for (auto& s : rows) {
+            initial_[session_shard(s.imsi, shard_count_)].push_back(s);
+        }
+        initial_loaded_ = true;
+        spdlog::info("Tiered session store: loaded {} sessions from SQLite in {} ms", rows.size(),
+                     std::chrono::duration_cast<std::chrono::milliseconds>(
+                         std::chrono::steady_clock::now() - t0).count());
+    }
+    if (shard >= initial_.size())
+        return {};
+    return std::move(initial_[shard]);
+}
+
+void SessionWriteBack::attach(TieredSessionStore* store) {
+    std::lock_guard<std::mutex> lock(mtx_);
+    stores_.push_back(store);
+}
+
+void SessionWriteBack::detach(TieredSessionStore* store) {
+    std::lock_guard<std::mutex> lock(mtx_);
+    stores_.erase(std::remove(stores_.begin(), stores_.end(), store), stores_.end());
+    for (const auto& [imsi, w] : store->take_dirty(stats_.changes)) {
+        merge_write(leftover_, imsi, w);
+    }
+}
+
+void SessionWriteBack::wake() noexcept {
+    if (!wake_.exchange(true, std::memory_order_relaxed))
+        flush_cv_.notify_one();
+}
+
+bool SessionWriteBack::flush() {
+    return flush_once();
+}
+
+bool SessionWriteBack::flush_once() {
+    std::lock_guard<std::mutex> flush_lock(flush_mtx_);
+    auto t0 = std::chrono::steady_clock::now();
+
+    // Остаток прошлых записей старше изменений шардов — он первым ложится в пачку
+    SessionWrites batch;
+    {
+        std::lock_guard<std::mutex> lock(mtx_);
+        batch.swap(leftover_);
+        for (TieredSessionStore* store : stores_) {
+            for (const auto& [imsi, w] : store->take_dirty(stats_.changes)) {
+                merge_write(batch, imsi, w);
+            }
+        }
+    }
+    if (batch.empty())
+        return true;
+
+    bool ok = cold_->apply_writes(batch);
+    auto ns = static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now() - t0).count());
+
+    std::lock_guard<std::mutex> lock(mtx_);
+    if (!ok) {
+        // Пачка возвращается в остаток; всё, что ушло в остаток за время записи, новее её
+        for (const auto& [imsi, w] : leftover_) {
+            merge_write(batch, imsi, w);
+        }
+        leftover_.swap(batch);
+        ++stats_.failed_flushes;
+        spdlog::error("Failed to write back {} session changes, retrying in {} ms",
+                      leftover_.size(), options_.writeback_interval.count());
+        return false;
+    }
+    uint64_t rows = batch.size();
+    ++stats_.flushes;
+    stats_.rows            += rows;
+    stats_.last_batch_rows  = rows;
+    stats_.max_batch_rows   = std::max(stats_.max_batch_rows, rows);
+    stats_.total_flush_ns  += ns;
+    stats_.max_flush_ns     = std::max(stats_.max_flush_ns, ns);
+    return true;
+}
+
+void SessionWriteBack::run() {
+    std::unique_lock<std::mutex> lock(mtx_);
+    bool failed = false;
+    while (!stop_) {
+        // После неудачной записи — повтор через интервал, а не сразу по числу строк
+        flush_cv_.wait_for(lock, options_.writeback_interval, [this, failed] {
+            return stop_ || (!failed && wake_.load(std::memory_order_relaxed));
+        });
+        wake_.store(false, std::memory_order_relaxed);
+        lock.unlock();
+        failed = !flush_once();
+        lock.lock();
+    }
+    // Последние шарды могли отдать остаток во время записи выше
+    lock.unlock();
+    flush_once();
+    lock.lock();
+    if (!leftover_.empty()) {
+        spdlog::error("Lost {} session changes on shutdown: SQLite write failed", leftover_.size());
+    }
+}
+
+WriteBackStats SessionWriteBack::stats() {
+    std::lock_guard<std::mutex> lock(mtx_);
+    WriteBackStats s = stats_;
+    s.dirty = leftover_.size();
+    for (TieredSessionStore* store : stores_) {
+        std::lock_guard<std::mutex> dirty_lock(store->dirty_mtx_);
+        s.dirty   += store->dirty_.size();
+        s.changes += store->changes_;
+    }
+    return s;
+}
+
+// --- TieredSessionStore ---
+
+TieredSessionStore::TieredSessionStore(std::shared_ptr<SessionWriteBack> backend, size_t shard, size_t capacity)
+    : hot_(capacity)
+    , backend_(std::move(backend))
+{
+    if (!backend_) {
+        throw std::invalid_argument("Tiered session store needs a write-back backend");
+    }
+    // Строки из базы уже записаны — в набор изменённых не попадают
+    auto initial = backend_->take_initial(shard);
+    hot_.upsert_batch(initial);
+    dirty_.reserve(backend_->options().writeback_rows);
+    backend_->attach(this);
+}
+
+TieredSessionStore::~TieredSessionStore() {
+    backend_->detach(this);
+}
+
+SessionWrites TieredSessionStore::take_dirty(uint64_t& changes) {
+    SessionWrites taken;
+    taken.reserve(backend_->options().writeback_rows);
+    std::lock_guard<std::mutex> lock(dirty_mtx_);
+    taken.swap(dirty_);
+    changes += changes_;
+    changes_ = 0;
+    return taken;
+}
+
+void TieredSessionStore::mark(Imsi imsi, const SessionWrite& w) {
+    bool full;
+    {
+        std::lock_guard<std::mutex> lock(dirty_mtx_);
+        merge_write(dirty_, imsi, w);
+        ++changes_;
+        full = dirty_.size() >= backend_->options().writeback_rows;
+    }
+    if (full)
+        backend_->wake();
+}
+
+void TieredSessionStore::mark_result(const StoredSession& s, UpsertResult r) {
+    switch (r) {
+    case UpsertResult::Created:
+        mark(s.imsi, { SessionWriteOp::Put, s.created_at, s.expires_at });
+        break;
+    case UpsertResult::Refreshed:
+        // created_at строки в базе не меняется; s.created_at — только на случай, если строки там нет
+        mark(s.imsi, { SessionWriteOp::Refresh, s.created_at, s.expires_at });
+        break;
+    case UpsertResult::Failed:
+        break;
+    }
+}
+
+std::vector<StoredSession> TieredSessionStore::load_sessions(EpochMs now) {
+    return hot_.load_sessions(now);
+}
+
+bool TieredSessionStore::save_session(const StoredSession& s) {
+    if (!hot_.save_session(s))
+        return false;
+    mark(s.imsi, { SessionWriteOp::Put, s.created_at, s.expires_at });
+    return true;
+}
+
+bool TieredSessionStore::delete_session(Imsi imsi) {
+    if (!hot_.delete_session(imsi))
+        return false;
+    mark(imsi, { SessionWriteOp::Delete, 0, 0 });
+    return true;
+}
+
+bool TieredSessionStore::session_exists(Imsi imsi) {
+    return hot_.session_exists(imsi);
+}
+
+std::optional<StoredSession> TieredSessionStore::get_session(Imsi imsi) {
+    return hot_.get_session(imsi);
+}
+
+void TieredSessionStore::cleanup_expired_sessions(EpochMs now) {
+    auto expired = hot_.load_expired_sessions(now);
+    hot_.cleanup_expired_sessions(now);
+    for (const auto& s : expired) {
+        mark(s.imsi, { SessionWriteOp::Delete, 0, 0 });
+    }
+}
+
+std::vector<StoredSession> TieredSessionStore::load_expired_sessions(EpochMs now) {
+    return hot_.load_expired_sessions(now);
+}
+
+UpsertResult TieredSessionStore::upsert(const StoredSession& s) {
+    UpsertResult r = hot_.upsert(s);
+    mark_result(s, r);
+    return r;
+}
+
+std::vector<UpsertResult> TieredSessionStore::upsert_batch(std::span<const StoredSession> sessions) {
+    auto result = hot_.upsert_batch(sessions);
+    for (size_t i = 0; i < sessions.size(); ++i) {
+        mark_result(sessions[i], result[i]);
+    }
+    return result;
+}
+
+size_t TieredSessionStore::delete_batch(std::span<const Imsi> imsis) {
+    size_t removed = hot_.delete_batch(imsis);
+    if (removed == 0)
+        return 0;
+    // Каких именно IMSI не было, пачка не сообщает — лишний DELETE в базе безвреден
+    for (Imsi imsi : imsis) {
+        mark(imsi, { SessionWriteOp::Delete, 0, 0 });
+    }
+    return removed;
+}
+
+std::vector<std::optional<StoredSession>> TieredSessionStore::lookup_batch(std::span<const Imsi> imsis) {
+    return hot_.lookup_batch(imsis);
+}
+
+} // namespace pgw
@@ -0,0 +1,189 @@
+// src/server/timing_wheel.cpp
+#include "pgw/timing_wheel.hpp"
+
+#include <algorithm>
+
+namespace pgw {
+
+// Циклический сдвиг вправо: слот с номером idx становится нулевым битом
+static uint64_t rotr(uint64_t x, unsigned idx) noexcept {
+    idx &= 63;
+    return idx ? (x >> idx) | (x << (64 - idx)) : x;
+}
+
+// Сколько узлов вперёд подгружать при обходе слота
+static constexpr size_t kPrefetchDistance = 8;
+
+TimingWheel::TimingWheel(uint64_t start_tick)
+  : current_(start_tick)
+  , index_pool_(slab_node_size<Index>(std::pair<const Imsi, uint32_t>{}))
+  , index_(Index::allocator_type(index_pool_))
+{ }
+
+void TimingWheel::reserve(size_t n) {
+    nodes_.reserve(n);
+    free_.reserve(n);
+    index_.reserve(n);
+    index_pool_.reserve(n);
+}
+
+MemoryUsage TimingWheel::memory_usage() const noexcept {
+    const size_t count = index_.size();
+    MemoryUsage m;
+    size_t slot_capacity = scratch_.capacity();
+    for (auto& list : slots_) {
+        slot_capacity += list.capacity();
+    }
+    const SlabStats pool = index_pool_.stats();
+    const size_t buckets = index_.bucket_count() * sizeof(void*);
+    m.bytes_reserved = nodes_.capacity() * sizeof(Node) + free_.capacity() * sizeof(uint32_t)
+                     + slot_capacity * sizeof(uint32_t) + pool.bytes_reserved + buckets;
+    m.bytes_in_use   = count * (sizeof(Node) + sizeof(uint32_t)) + pool.bytes_in_use + buckets;
+    return m;
+}
+
+void TimingWheel::schedule(Imsi imsi, uint64_t deadline) {
+    auto [it, inserted] = index_.try_emplace(imsi, kNil);
+    uint32_t n;
+    if (inserted) {
+        if (!free_.empty()) {
+            n = free_.back();
+            free_.pop_back();
+        } else {
+            n = static_cast<uint32_t>(nodes_.size());
+            nodes_.emplace_back();
+        }
+        it->second = n;
+        nodes_[n].imsi = imsi;
+    } else {
+        n = it->second;
+        unlink(n);
+    }
+    nodes_[n].deadline = deadline;
+    place(n);
+}
+
+bool TimingWheel::cancel(Imsi imsi) {
+    auto it = index_.find(imsi);
+    if (it == index_.end())
+        return false;
+    unlink(it->second);
+    free_.push_back(it->second);
+    index_.erase(it);
+    return true;
+}
+
+void TimingWheel::place(uint32_t n) {
+    uint64_t deadline = std::max(nodes_[n].deadline, current_);
+    uint64_t delta    = deadline - current_;
+
+    unsigned level = 0;
+    while (level + 1 < kLevels && delta >= (uint64_t(1) << (kSlotBits * (level + 1))))
+        ++level;
+
+    // Дальше последнего уровня — в самый дальний слот, оттуда узел переложится заново
+    const uint64_t span = uint64_t(1) << (kSlotBits * kLevels);
+    if (delta >= span)
+        deadline = current_ + span - 1;
+
+    unsigned slot = unsigned(deadline >> (kSlotBits * level)) & (kSlots - 1);
+    link(n, level * kSlots + slot);
+}
+
+void TimingWheel::link(uint32_t n, unsigned slot) {
+    Node& node = nodes_[n];
+    node.slot = static_cast<uint16_t>(slot);
+    node.pos  = static_cast<uint32_t>(slots_[slot].size());
+    slots_[slot].push_back(n);
+    occupied_[slot / kSlots] |= uint64_t(1) << (slot % kSlots);
+}
+
+void TimingWheel::unlink(uint32_t n) {
+    const Node& node = nodes_[n];
+    auto& list = slots_[node.slot];
+    uint32_t last = list.back();
+    list[node.pos]    = last;
+    nodes_[last].pos  = node.pos;
+    list.pop_back();
+    if (list.empty())
+        occupied_[node.slot / kSlots] &= ~(uint64_t(1) << (node.slot % kSlots));
+}
+
+void TimingWheel::cascade(unsigned level) {
+    unsigned slot = level * kSlots + (unsigned(current_ >> (kSlotBits * level)) & (kSlots - 1));
+
+    // Забираем слот целиком: узел с далёким сроком может вернуться в этот же слот
+    scratch_.swap(slots_[slot]);
+    occupied_[level] &= ~(uint64_t(1) << (slot % kSlots));
+    for (size_t i = 0; i < scratch_.size(); ++i) {
+        if (i + kPrefetchDistance < scratch_.size())
+            __builtin_prefetch(&nodes_[scratch_[i + kPrefetchDistance]]);
+        place(scratch_[i]);
+    }
+    scratch_.clear();
+    // Возвращаем слоту его буфер, чтобы на следующем круге не выделять память заново
+    if (slots_[slot].empty())
+        scratch_.swap(slots_[slot]);
+}
+
+void TimingWheel::process_tick(std::vector<Expired>& out) {
+    // На границе слота старшего уровня сначала перекладываем его содержимое вниз
+    for (unsigned level = 1; level < kLevels; ++level) {
+        if (current_ & ((uint64_t(1) << (kSlotBits * level)) - 1))
+            break;
+        cascade(level);
+    }
+
+    unsigned slot = unsigned(current_) & (kSlots - 1);
+    auto& list = slots_[slot];
+    occupied_[0] &= ~(uint64_t(1) << slot);
+    for (size_t i = 0; i < list.size(); ++i) {
+        if (i + kPrefetchDistance < list.size())
+            __builtin_prefetch(&nodes_[list[i + kPrefetchDistance]]);
+        const Node& node = nodes_[list[i]];
+        out.push_back({node.imsi, node.deadline});
+        index_.erase(node.imsi);
+        free_.push_back(list[i]);
+    }
+    list.clear();
+    ++current_;
+}
+
+void TimingWheel::advance(uint64_t now, std::vector<Expired>& out) {
+    while (current_ <= now) {
+        uint64_t next = next_event();
+        if (next > now) {
+            // До now ни истечений, ни перекладок — тики можно не обходить
+            current_ = now + 1;
+            break;
+        }
+        current_ = next;
+        process_tick(out);
+    }
+}
+
+uint64_t TimingWheel::next_event() const noexcept {
+    uint64_t best = kNever;
+
+    // Уровень 0: все узлы лежат в пределах ближайших kSlots тиков — ответ точный
+    if (uint64_t r = rotr(occupied_[0], unsigned(current_)))
+        best = current_ + uint64_t(__builtin_ctzll(r));
+
+    // Старшие уровни: ближайшее начало непустого слота (тогда он переложится вниз)
+    for (unsigned level = 1; level < kLevels; ++level) {
+        if (!occupied_[level])
+            continue;
+        const unsigned shift = kSlotBits * level;
+        uint64_t base  = current_ >> shift;
+        // Если current_ ровно на границе, перекладка текущего слота ещё не сделана
+        uint64_t start = (current_ & ((uint64_t(1) << shift) - 1)) ? 1 : 0;
+        uint64_t r = rotr(occupied_[level], unsigned(base + start));
+        if (!r)
+            continue;
+        uint64_t tick = (base + start + uint64_t(__builtin_ctzll(r))) << shift;
+        best = std::min(best, tick);
+    }
+    return best;
+}
+
+} // namespace pgw
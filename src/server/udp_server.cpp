@@ -1,49 +1,263 @@
 // src/server/udp_server.cpp
 
 #include "pgw/udp_server.hpp"
+#include "pgw/reuseport.hpp"
+#include "pgw/io_uring.hpp"
+#include "pgw/mpmc_ring.hpp"
+#include "pgw/imsi_batch.hpp"
 #include <spdlog/spdlog.h>
 
 #include <arpa/inet.h>
+#include <linux/sock_diag.h>
+#include <pthread.h>
+#include <sched.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
 #include <sys/socket.h>
 #include <unistd.h>
+#include <cerrno>
+#include <chrono>
 #include <cstring>
+#include <stdexcept>
 #include <thread>
-#include <chrono>
 #include <vector>
+#include <algorithm>
+#include <system_error>
 
 namespace pgw {
 
+// Размер буфера под одну датаграмму: BCD IMSI занимает 8 байт, запросы GTPv2-C — обычно 100–300 байт;
+// более длинное сообщение обрезается и отбрасывается разбором (длина в заголовке больше принятой)
+static constexpr size_t kDatagramSize = 512;
+
+// Как часто блокирующий бэкенд просыпается, чтобы проверить флаг остановки
+static constexpr std::chrono::milliseconds kBlockingPollInterval{100};
+
+// Параметры бэкенда io_uring
+static constexpr unsigned kUringEntries   = 256;   // Размер очереди отправки (SQ)
+static constexpr unsigned kUringCqEntries = 8192;  // Размер очереди завершений (CQ): multishot даёт CQE на каждую датаграмму
+static constexpr unsigned kUringBuffers   = 4096;  // Число предоставленных ядру буферов приёма
+static constexpr uint16_t kUringBufGroup  = 0;     // Группа буферов для recvmsg
+// Буфер multishot recvmsg: заголовок io_uring_recvmsg_out, адрес отправителя, затем данные
+static constexpr unsigned kUringBufSize   = 640;
+static_assert(sizeof(io_uring_recvmsg_out) + sizeof(sockaddr_in) + kDatagramSize <= kUringBufSize);
+
+// Тип операции в старших битах user_data CQE, в младших — номер слота отправки
+enum : uint64_t { kUringRecv = 1ull << 32, kUringSend = 2ull << 32, kUringWake = 3ull << 32, kUringCancel = 4ull << 32 };
+static constexpr uint64_t kUringTagMask = 0xFFFFFFFFull << 32;
+
+// Ответ прежнего протокола источнику, превысившему ограничение частоты
+static constexpr const char* kThrottledReply = "throttled";
+
+// Сколько раз потребитель очереди конвейера проверяет её перед тем, как уснуть
+static constexpr int kPipelineSpinIterations = 64;
+
+UdpBackend udp_backend_from_string(const std::string& name) {
+    if (name == "blocking") return UdpBackend::Blocking;
+    if (name == "epoll")    return UdpBackend::Epoll;
+    if (name == "io_uring") return UdpBackend::IoUring;
+    throw std::invalid_argument("Unknown UDP backend: " + name);
+}
+
+const char* to_string(UdpBackend backend) noexcept {
+    switch (backend) {
+    case UdpBackend::Blocking: return "blocking";
+    case UdpBackend::Epoll:    return "epoll";
+    case UdpBackend::IoUring:  return "io_uring";
+    }
+    return "unknown";
+}
+
+// Состояние одного потока приёма: свой сокет, свой цикл событий и свои счётчики,
+// чтобы worker'ы не делили между собой ни блокировок, ни кэш-линий
+struct UdpServer::Worker {
+    size_t      index = 0;   // Номер worker'а (совпадает с индексом сокета в группе SO_REUSEPORT)
+    int         cpu   = -1;  // CPU для привязки потока (-1 — без привязки)
+    int         sock  = -1;  // Сокет worker'а
+    int         wake_fd = -1;  // eventfd для остановки бэкенда io_uring
+    EventLoop   loop;        // Цикл событий: сокет + eventfd для остановки
+    std::thread thread;      // Поток приёма
+    std::unique_ptr<RateLimiter> limiter;  // Ограничение частоты по источнику (nullptr — выключено)
+
+    alignas(64) std::atomic<uint64_t> rx_packets{0};
+    std::atomic<uint64_t> rx_syscalls{0};
+    std::atomic<uint64_t> tx_packets{0};
+    std::atomic<uint64_t> tx_syscalls{0};
+    std::atomic<uint64_t> rx_enqueued{0};  // Запросов передано в очередь обработки (конвейер)
+    std::atomic<uint64_t> rx_dropped{0};   // Запросов отброшено: очередь обработки полна
+    std::atomic<uint64_t> gtp_messages{0};  // Принято сообщений GTPv2-C
+    std::atomic<uint64_t> gtp_invalid{0};   // Из них с неверным заголовком
+    std::atomic<uint64_t> throttled{0};     // Отброшено ограничением частоты
+
+    std::vector<uint8_t> lanes_to_wake;  // Очереди обработчиков, получившие запросы в текущей пачке (конвейер)
+};
+
+// Конвейер: очередь запросов (приём → обработка) и очередь ответов (обработка → отправка)
+struct UdpServer::Pipeline {
+    // Декодированный запрос; worker — чей сокет отправит ответ
+    // Для GTPv2-C в очередь попадают разобранные поля: gtp_msg.ies сброшен, буфер приёма уже переиспользован
+    struct Request {
+        sockaddr_in    addr{};
+        uint32_t       worker = 0;
+        Imsi           imsi;
+        bool           gtp = false;
+        GtpParseStatus gtp_status = GtpParseStatus::Ok;
+        GtpMessage     gtp_msg;
+    };
+
+    // Готовый ответ; text — строковый литерал из handle_imsi, для GTPv2-C — gtp_len байт в gtp
+    struct Reply {
+        sockaddr_in addr{};
+        uint32_t    worker = 0;
+        const char* text = nullptr;
+        uint16_t    gtp_len = 0;
+        uint8_t     gtp[kGtpMaxResponseSize];
+    };
+
+    // Очередь запросов одного обработчика. Все сообщения абонента попадают в одну очередь
+    // (lane_for), поэтому обрабатываются в порядке приёма: Create Session не обгонит Delete,
+    // повтор запроса на подключение — первый
+    struct alignas(64) Lane {
+        explicit Lane(size_t capacity) : requests(capacity) {}
+
+        MpmcRing<Request>     requests;
+        std::atomic<uint32_t> bell{0};  // Звонок для обработчика этой очереди
+        std::thread           thread;   // Обработчик
+    };
+
+    Pipeline(size_t processors, size_t capacity)
+        : replies(capacity)
+    {
+        for (size_t i = 0; i < processors; ++i) {
+            lanes.push_back(std::make_unique<Lane>(capacity));
+        }
+    }
+
+    // Очередь для ключа абонента: тот же хеш IMSI, что выбирает шард менеджера сессий, — при
+    // степенях двойки обработчик обращается к своему подмножеству шардов. Без абонента
+    // (невалидный IMSI, Echo) очередь выбирает fallback
+    size_t lane_for(Imsi imsi, uint32_t fallback) const noexcept {
+        size_t key = imsi.valid() ? std::hash<Imsi>{}(imsi) : fallback;
+        return key % lanes.size();
+    }
+
+    std::vector<std::unique_ptr<Lane>> lanes;  // По очереди на обработчик
+    MpmcRing<Reply>                    replies;
+
+    // Счётчик-«звонок»: потребитель спит в atomic::wait, пока производитель не изменит значение
+    std::atomic<uint32_t> replies_bell{0};
+
+    std::thread              sender;      // Поток отправки ответов
+
+    alignas(64) std::atomic<uint64_t> processed{0};        // Обработано запросов
+    std::atomic<uint64_t>             process_dropped{0};  // Ответов отброшено: очередь отправки полна
+    alignas(64) std::atomic<uint64_t> tx_sent{0};          // Отправлено ответов
+    std::atomic<uint64_t>             tx_dropped{0};       // Ответов не отправлено из-за ошибки sendmmsg
+};
+
+// Сообщает потребителям очереди о новых элементах
+static void ring_bell(std::atomic<uint32_t>& bell, bool all = false) {
+    bell.fetch_add(1, std::memory_order_release);
+    if (all)
+        bell.notify_all();
+    else
+        bell.notify_one();
+}
+
+// Извлекает элемент очереди конвейера: сначала короткое активное ожидание, затем сон до звонка
+// производителя. Возвращает false, когда сервер остановлен
+template <typename T>
+static bool wait_pop(MpmcRing<T>& ring, std::atomic<uint32_t>& bell, const std::atomic<bool>& running, T& out) {
+    for (int i = 0; i < kPipelineSpinIterations; ++i) {
+        if (ring.try_pop(out))
+            return true;
+    }
+    while (running.load(std::memory_order_relaxed)) {
+        uint32_t seen = bell.load(std::memory_order_acquire);
+        if (ring.try_pop(out))
+            return true;
+        bell.wait(seen, std::memory_order_acquire);
+    }
+    return false;
+}
+
 UdpServer::UdpServer(const std::string& ip,
                      uint16_t port,
                      Blacklist& blacklist,
-                     SessionManager& sessions)
+                     SessionManager& sessions,
+                     UdpServerOptions options)
     : ip_(ip)
     , port_(port)
     , blacklist_(blacklist)
     , sessions_(sessions)
+    , options_(std::move(options))
     , running_(false)
-{}
+{
+    options_.batch_size = std::clamp<size_t>(options_.batch_size, 1, kMaxBatchSize);
+    options_.workers    = std::max<size_t>(options_.workers, 1);
+    inet_pton(AF_INET, ip_.c_str(), &local_ipv4_);
 
-void UdpServer::start() {
-    running_ = true;
-    thread_ = std::thread(&UdpServer::run_loop, this);
-    spdlog::info("UDP server listening on {}:{}", ip_, port_);
-}
+    for (size_t i = 0; i < options_.workers; ++i) {
+        auto w = std::make_unique<Worker>();
+        w->index = i;
+        w->wake_fd = ::eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+        if (w->wake_fd < 0) {
+            throw std::runtime_error(std::string("eventfd failed: ") + std::strerror(errno));
+        }
+        if (!options_.cpu_affinity.empty()) {
+            w->cpu = options_.cpu_affinity[i % options_.cpu_affinity.size()];
+        }
+        if (options_.rate_limit_pps > 0) {
+            double   rate  = options_.rate_limit_pps / double(options_.workers);
+            uint32_t burst = std::max<uint32_t>(options_.rate_limit_burst / uint32_t(options_.workers), 1);
+            w->limiter = std::make_unique<RateLimiter>(rate, burst);
+        }
+        workers_.push_back(std::move(w));
+    }
 
-void UdpServer::stop() {
-    running_ = false;
+    if (options_.processing_threads > 0) {
+        pipeline_ = std::make_unique<Pipeline>(options_.processing_threads, std::max<size_t>(options_.queue_capacity, 1));
+        for (auto& w : workers_) {
+            w->lanes_to_wake.assign(options_.processing_threads, 0);
+        }
+    }
+    if (options_.overload_sample_interval.count() > 0) {
+        overload_ = std::make_unique<OverloadController>(options_.overload);
+    }
 }
 
-void UdpServer::join() {
-    if (thread_.joinable())
-        thread_.join();
+UdpServer::~UdpServer() {
+    stop();
+    join();
+    for (auto& w : workers_) {
+        if (w->sock >= 0) {
+            ::close(w->sock);
+            w->sock = -1;
+        }
+        if (w->wake_fd >= 0) {
+            ::close(w->wake_fd);
+            w->wake_fd = -1;
+        }
+    }
 }
 
-void UdpServer::run_loop() {
-    int sock = ::socket(AF_INET, SOCK_DGRAM, 0);
+int UdpServer::open_socket() {
+    // Бэкенду "blocking" нужен блокирующий сокет; epoll и io_uring работают с неблокирующим
+    int type = SOCK_DGRAM | SOCK_CLOEXEC;
+    if (options_.backend != UdpBackend::Blocking)
+        type |= SOCK_NONBLOCK;
+
+    int sock = ::socket(AF_INET, type, 0);
     if (sock < 0) {
         spdlog::critical("Failed to create UDP socket: {}", std::strerror(errno));
-        return;
+        return -1;
+    }
+
+    int one = 1;
+    if (::setsockopt(sock, SOL_SOCKET, SO_REUSEPORT, &one, sizeof(one)) < 0) {
+        spdlog::critical("Failed to set SO_REUSEPORT: {}", std::strerror(errno));
+        ::close(sock);
+        return -1;
     }
 
     sockaddr_in addr{};
@@ -54,62 +268,1007 @@ void UdpServer::run_loop() {
     if (::bind(sock, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) < 0) {
         spdlog::critical("UDP bind failed: {}", std::strerror(errno));
         ::close(sock);
+        return -1;
+    }
+
+    if (options_.backend == UdpBackend::Blocking) {
+        // Блокирующий приём просыпается по таймауту, чтобы заметить stop()
+        timeval tv{};
+        tv.tv_usec = kBlockingPollInterval.count() * 1000;
+        ::setsockopt(sock, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+    }
+    return sock;
+}
+
+void UdpServer::start() {
+    // Сокеты открываются по порядку: индекс сокета в группе SO_REUSEPORT равен номеру worker'а,
+    // на этом построен выбор worker'а CBPF-программой
+    for (auto& w : workers_) {
+        w->sock = open_socket();
+        if (w->sock < 0) {
+            for (auto& opened : workers_) {
+                if (opened->sock >= 0) {
+                    ::close(opened->sock);
+                    opened->sock = -1;
+                }
+            }
+            return;
+        }
+    }
+
+    if (workers_.size() > 1 &&
+        !attach_imsi_steering(workers_.front()->sock, static_cast<uint32_t>(workers_.size()))) {
+        spdlog::warn("Failed to attach IMSI steering program ({}), "
+                     "kernel will spread packets by 4-tuple hash", std::strerror(errno));
+    }
+
+    running_ = true;
+    for (auto& w : workers_) {
+        Worker& worker = *w;
+        worker.thread = std::thread(&UdpServer::run_loop, this, std::ref(worker));
+
+        if (worker.cpu >= 0) {
+            cpu_set_t set;
+            CPU_ZERO(&set);
+            CPU_SET(worker.cpu, &set);
+            int rc = pthread_setaffinity_np(worker.thread.native_handle(), sizeof(set), &set);
+            if (rc != 0) {
+                spdlog::warn("Failed to pin UDP worker {} to CPU {}: {}", worker.index, worker.cpu, std::strerror(rc));
+            }
+        }
+    }
+
+    if (pipeline_) {
+        for (size_t i = 0; i < pipeline_->lanes.size(); ++i) {
+            pipeline_->lanes[i]->thread = std::thread(&UdpServer::run_processor, this, i);
+        }
+        pipeline_->sender = std::thread(&UdpServer::run_sender, this);
+    }
+    if (overload_) {
+        overload_thread_ = std::thread(&UdpServer::run_overload_monitor, this);
+    }
+
+    spdlog::info("UDP server listening on {}:{} ({} workers, {} backend, batch size {}, {} BCD decoder)",
+                 ip_, port_, workers_.size(), to_string(options_.backend), options_.batch_size,
+                 to_string(bcd_batch_kernel()));
+    if (options_.rate_limit_pps > 0) {
+        spdlog::info("UDP rate limit: {} packets/sec per source, burst {}, {} sources tracked per worker, {}",
+                     options_.rate_limit_pps, options_.rate_limit_burst, workers_.front()->limiter->capacity(),
+                     options_.rate_limit_reply ? "replying \"throttled\"" : "dropping silently");
+    }
+    if (pipeline_) {
+        spdlog::info("UDP pipeline: {} processing threads, queue capacity {} per thread",
+                     pipeline_->lanes.size(), pipeline_->lanes.front()->requests.capacity());
+    }
+    if (overload_) {
+        spdlog::info("UDP overload protection: sampling every {} ms", options_.overload_sample_interval.count());
+    }
+}
+
+void UdpServer::stop() {
+    running_ = false;
+    uint64_t one = 1;
+    for (auto& w : workers_) {
+        w->loop.stop();
+        if (::write(w->wake_fd, &one, sizeof(one)) < 0 && errno != EAGAIN) {
+            spdlog::error("Failed to wake UDP worker {}: {}", w->index, std::strerror(errno));
+        }
+    }
+    if (pipeline_) {
+        for (auto& lane : pipeline_->lanes) {
+            ring_bell(lane->bell, true);
+        }
+        ring_bell(pipeline_->replies_bell, true);
+    }
+}
+
+void UdpServer::join() {
+    for (auto& w : workers_) {
+        if (w->thread.joinable())
+            w->thread.join();
+    }
+    if (pipeline_) {
+        for (auto& lane : pipeline_->lanes) {
+            if (lane->thread.joinable())
+                lane->thread.join();
+        }
+        if (pipeline_->sender.joinable())
+            pipeline_->sender.join();
+    }
+    if (overload_thread_.joinable())
+        overload_thread_.join();
+
+    // Сокеты закрываются после всех потоков: поток отправки конвейера пишет в сокеты worker'ов
+    for (auto& w : workers_) {
+        if (w->sock >= 0) {
+            ::close(w->sock);
+            w->sock = -1;
+        }
+    }
+}
+
+UdpStats UdpServer::stats() const {
+    UdpStats s;
+    for (const auto& w : workers_) {
+        uint64_t rx = w->rx_packets.load(std::memory_order_relaxed);
+        s.rx_packets  += rx;
+        s.rx_syscalls += w->rx_syscalls.load(std::memory_order_relaxed);
+        s.tx_packets  += w->tx_packets.load(std::memory_order_relaxed);
+        s.tx_syscalls += w->tx_syscalls.load(std::memory_order_relaxed);
+        s.worker_rx_packets.push_back(rx);
+        s.rx_stage.processed += w->rx_enqueued.load(std::memory_order_relaxed);
+        s.rx_stage.dropped   += w->rx_dropped.load(std::memory_order_relaxed);
+        s.gtp_messages       += w->gtp_messages.load(std::memory_order_relaxed);
+        s.gtp_invalid        += w->gtp_invalid.load(std::memory_order_relaxed);
+        s.throttled          += w->throttled.load(std::memory_order_relaxed);
+    }
+
+    if (pipeline_) {
+        s.pipeline = true;
+        for (const auto& lane : pipeline_->lanes) {
+            s.process_stage.queue_depth    += lane->requests.size();
+            s.process_stage.queue_capacity += lane->requests.capacity();
+        }
+        s.process_stage.processed      = pipeline_->processed.load(std::memory_order_relaxed);
+        s.process_stage.dropped        = pipeline_->process_dropped.load(std::memory_order_relaxed);
+        s.tx_stage.queue_depth         = pipeline_->replies.size();
+        s.tx_stage.queue_capacity      = pipeline_->replies.capacity();
+        s.tx_stage.processed           = pipeline_->tx_sent.load(std::memory_order_relaxed);
+        s.tx_stage.dropped             = pipeline_->tx_dropped.load(std::memory_order_relaxed);
+    }
+    return s;
+}
+
+const char* UdpServer::handle_datagram(const uint8_t* data, size_t len) {
+    return handle_imsi(Imsi::from_bcd(data, std::min(len, kDatagramSize)));
+}
+
+// Ставит запрос в очередь обработчика lane; очередь полна — обработчик не успевает,
+// запрос отбрасывается, клиент повторит его. Обработчик разбудит notify_processors
+template <typename Worker, typename Pipeline, typename Request>
+static bool push_request(Worker& w, Pipeline& p, size_t lane, const Request& req) {
+    if (!p.lanes[lane]->requests.try_push(req)) {
+        w.rx_dropped.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+    w.rx_enqueued.fetch_add(1, std::memory_order_relaxed);
+    w.lanes_to_wake[lane] = 1;
+    return true;
+}
+
+bool UdpServer::enqueue_request(Worker& w, Imsi imsi, const sockaddr_in& from) {
+    Pipeline::Request req;
+    req.addr   = from;
+    req.worker = static_cast<uint32_t>(w.index);
+    req.imsi   = imsi;
+    return push_request(w, *pipeline_, pipeline_->lane_for(imsi, from.sin_port), req);
+}
+
+bool UdpServer::enqueue_gtp(Worker& w, const uint8_t* data, size_t len, const sockaddr_in& from) {
+    Pipeline::Request req;
+    req.addr       = from;
+    req.worker     = static_cast<uint32_t>(w.index);
+    req.gtp        = true;
+    req.gtp_status = parse_gtpv2(data, len, req.gtp_msg);
+    req.gtp_msg.ies = {};
+
+    w.gtp_messages.fetch_add(1, std::memory_order_relaxed);
+    if (req.gtp_status == GtpParseStatus::InvalidHeader) {
+        w.gtp_invalid.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+
+    // Абонент Modify Bearer / Delete Session — по нашему TEID: в ту же очередь, что его Create Session
+    Imsi subscriber = req.gtp_msg.imsi;
+    if (!req.gtp_msg.has_imsi && req.gtp_msg.has_teid) {
+        if (auto tunnel = tunnels_.find(req.gtp_msg.teid))
+            subscriber = tunnel->imsi;
+    }
+    return push_request(w, *pipeline_, pipeline_->lane_for(subscriber, req.gtp_msg.teid ^ req.gtp_msg.sequence), req);
+}
+
+bool UdpServer::enqueue_reply(Worker& w, const char* text, const sockaddr_in& from) {
+    Pipeline::Reply reply;
+    reply.addr   = from;
+    reply.worker = static_cast<uint32_t>(w.index);
+    reply.text   = text;
+    if (!pipeline_->replies.try_push(reply)) {
+        pipeline_->process_dropped.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+    return true;
+}
+
+bool UdpServer::is_throttled(Worker& w, const sockaddr_in& from, uint64_t now_ns) {
+    if (!w.limiter || w.limiter->allow(from.sin_addr.s_addr, now_ns))
+        return false;
+    w.throttled.fetch_add(1, std::memory_order_relaxed);
+    return true;
+}
+
+void UdpServer::notify_processors(Worker& w) {
+    for (size_t i = 0; i < w.lanes_to_wake.size(); ++i) {
+        if (w.lanes_to_wake[i]) {
+            w.lanes_to_wake[i] = 0;
+            ring_bell(pipeline_->lanes[i]->bell);
+        }
+    }
+}
+
+void UdpServer::run_processor(size_t lane) {
+    Pipeline& p = *pipeline_;
+    Pipeline::Lane& own = *p.lanes[lane];
+    Pipeline::Request req;
+    while (wait_pop(own.requests, own.bell, running_, req)) {
+        Pipeline::Reply reply;
+        reply.addr   = req.addr;
+        reply.worker = req.worker;
+        if (req.gtp) {
+            reply.gtp_len = static_cast<uint16_t>(handle_gtp(req.gtp_msg, req.gtp_status, reply.gtp));
+            if (reply.gtp_len == 0) {
+                p.processed.fetch_add(1, std::memory_order_relaxed);
+                continue;
+            }
+        } else {
+            reply.text = handle_imsi(req.imsi);
+        }
+
+        if (p.replies.try_push(reply)) {
+            p.processed.fetch_add(1, std::memory_order_relaxed);
+            ring_bell(p.replies_bell);
+        } else {
+            p.process_dropped.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+}
+
+void UdpServer::run_sender() {
+    Pipeline& p = *pipeline_;
+    const size_t batch = options_.batch_size;
+    std::vector<Pipeline::Reply> replies(batch);
+    std::vector<iovec>   iov(batch);
+    std::vector<mmsghdr> msgs(batch);
+
+    while (wait_pop(p.replies, p.replies_bell, running_, replies[0])) {
+        size_t n = 1;
+        while (n < batch && p.replies.try_pop(replies[n])) {
+            ++n;
+        }
+
+        // Ответ уходит через сокет worker'а, принявшего запрос: у клиента тот же адрес сервера
+        for (auto& w : workers_) {
+            size_t m = 0;
+            for (size_t i = 0; i < n; ++i) {
+                if (replies[i].worker != w->index)
+                    continue;
+                if (replies[i].gtp_len > 0) {
+                    iov[m].iov_base = replies[i].gtp;
+                    iov[m].iov_len  = replies[i].gtp_len;
+                } else {
+                    iov[m].iov_base = const_cast<char*>(replies[i].text);
+                    iov[m].iov_len  = std::strlen(replies[i].text);
+                }
+                msgs[m] = mmsghdr{};
+                msgs[m].msg_hdr.msg_name    = &replies[i].addr;
+                msgs[m].msg_hdr.msg_namelen = sizeof(sockaddr_in);
+                msgs[m].msg_hdr.msg_iov     = &iov[m];
+                msgs[m].msg_hdr.msg_iovlen  = 1;
+                ++m;
+            }
+            if (m == 0)
+                continue;
+
+            size_t sent = send_replies(*w, msgs.data(), m);
+            p.tx_sent.fetch_add(sent, std::memory_order_relaxed);
+            if (sent < m)
+                p.tx_dropped.fetch_add(m - sent, std::memory_order_relaxed);
+        }
+    }
+}
+
+const char* UdpServer::handle_imsi(Imsi imsi) {
+    if (!imsi.valid()) {
+        spdlog::warn("Malformed IMSI in datagram, rejecting");
+        return "rejected";
+    }
+    spdlog::info("Received IMSI {}", imsi);
+    return admission_reply(admit_imsi(imsi));
+}
+
+const char* UdpServer::admission_reply(Admission a) noexcept {
+    switch (a) {
+    case Admission::Accepted: return "created";
+    case Admission::Busy:     return "busy";
+    case Admission::Rejected: break;
+    }
+    return "rejected";
+}
+
+UdpServer::Admission UdpServer::admit_imsi(Imsi imsi) {
+    // Проверяем чёрный список и создаём сессию при необходимости
+    if (blacklist_.is_blocked(imsi)) {
+        spdlog::warn("IMSI {} is blacklisted, rejecting", imsi);
+        return Admission::Rejected;
+    }
+
+    if (!overload_) {
+        bool accepted = sessions_.touch_session(imsi);
+        spdlog::info("{} session for IMSI {}", accepted ? "Created" : "Rejected", imsi);
+        return accepted ? Admission::Accepted : Admission::Rejected;
+    }
+
+    // Под защитой от перегрузки замеряем задержку хранилища; в перегрузке только продлеваем
+    auto started = std::chrono::steady_clock::now();
+    Admission result;
+    if (overload_->overloaded()) {
+        result = sessions_.refresh_session(imsi) ? Admission::Accepted : Admission::Busy;
+    } else {
+        result = sessions_.touch_session(imsi) ? Admission::Accepted : Admission::Rejected;
+    }
+    overload_->record_store_latency(std::chrono::steady_clock::now() - started);
+
+    if (result == Admission::Busy) {
+        overload_->count_shed();
+        spdlog::warn("Overloaded, not creating session for IMSI {}", imsi);
+    } else {
+        spdlog::info("{} session for IMSI {}", result == Admission::Accepted ? "Created" : "Rejected", imsi);
+    }
+    return result;
+}
+
+void UdpServer::admit_batch(std::span<const Imsi> imsis, Admission* out) {
+    // В перегрузке создавать сессии нельзя — каждый IMSI проходит путь только продления
+    if (overload_ && overload_->overloaded()) {
+        for (size_t i = 0; i < imsis.size(); ++i) {
+            out[i] = admit_imsi(imsis[i]);
+        }
         return;
     }
 
-    std::vector<uint8_t> buf(16);
-    sockaddr_in client_addr{};
-    socklen_t client_addr_len = sizeof(client_addr);
+    // Чёрный список — по одному, остальные IMSI уходят в менеджер сессий одной пачкой
+    std::vector<Imsi>     pending;
+    std::vector<uint32_t> pending_idx;
+    pending.reserve(imsis.size());
+    pending_idx.reserve(imsis.size());
+    for (size_t i = 0; i < imsis.size(); ++i) {
+        if (blacklist_.is_blocked(imsis[i])) {
+            spdlog::warn("IMSI {} is blacklisted, rejecting", imsis[i]);
+            out[i] = Admission::Rejected;
+            continue;
+        }
+        pending.push_back(imsis[i]);
+        pending_idx.push_back(static_cast<uint32_t>(i));
+    }
+    if (pending.empty())
+        return;
+
+    auto started = std::chrono::steady_clock::now();
+    auto results = sessions_.touch_batch(pending);
+    if (overload_)
+        overload_->record_store_latency(std::chrono::steady_clock::now() - started);
 
+    for (size_t k = 0; k < pending.size(); ++k) {
+        bool accepted = results[k] != UpsertResult::Failed;
+        out[pending_idx[k]] = accepted ? Admission::Accepted : Admission::Rejected;
+        spdlog::info("{} session for IMSI {}", accepted ? "Created" : "Rejected", pending[k]);
+    }
+}
+
+void UdpServer::run_overload_monitor() {
     while (running_) {
-        ssize_t len = ::recvfrom(sock,
-                                 buf.data(), buf.size(),
-                                 0,
-                                 reinterpret_cast<sockaddr*>(&client_addr),
-                                 &client_addr_len);
-
-        if (len <= 0) {
-            // При EINTR или таймауте просто делаем паузу
-            std::this_thread::sleep_for(std::chrono::milliseconds(100));
+        std::this_thread::sleep_for(options_.overload_sample_interval);
+        overload_->update(sample_load());
+    }
+}
+
+OverloadSample UdpServer::sample_load() const {
+    OverloadSample s;
+    if (pipeline_) {
+        // Перегрузка определяется самой заполненной очередью: абоненты другой не переходят
+        for (const auto& lane : pipeline_->lanes) {
+            s.queue_fill = std::max(s.queue_fill, double(lane->requests.size()) / double(lane->requests.capacity()));
+        }
+    }
+
+    // SO_MEMINFO: занятая память приёмной очереди против rcvbuf и счётчик потерь сокета —
+    // тот же sk_drops, что SO_RXQ_OVFL отдаёт в cmsg каждой датаграммы
+    for (const auto& w : workers_) {
+        uint32_t mem[SK_MEMINFO_VARS] = {};
+        socklen_t len = sizeof(mem);
+        if (w->sock < 0 || ::getsockopt(w->sock, SOL_SOCKET, SO_MEMINFO, mem, &len) < 0)
             continue;
+        if (mem[SK_MEMINFO_RCVBUF] > 0) {
+            s.backlog_fill = std::max(s.backlog_fill,
+                                      double(mem[SK_MEMINFO_RMEM_ALLOC]) / double(mem[SK_MEMINFO_RCVBUF]));
+        }
+        s.socket_drops += mem[SK_MEMINFO_DROPS];
+    }
+    return s;
+}
+
+size_t UdpServer::handle_gtp_datagram(Worker& w, const uint8_t* data, size_t len, uint8_t* out) {
+    GtpMessage msg;
+    GtpParseStatus status = parse_gtpv2(data, len, msg);
+    w.gtp_messages.fetch_add(1, std::memory_order_relaxed);
+    if (status == GtpParseStatus::InvalidHeader) {
+        w.gtp_invalid.fetch_add(1, std::memory_order_relaxed);
+        return 0;
+    }
+    return handle_gtp(msg, status, out);
+}
+
+size_t UdpServer::handle_gtp(const GtpMessage& req, GtpParseStatus status, uint8_t* out) {
+    GtpResponse resp;
+    resp.local_ipv4 = local_ipv4_;
+    resp.peer_teid  = req.sender_teid;
+
+    if (status == GtpParseStatus::InvalidLength) {
+        spdlog::warn("GTPv2-C message type {} (seq {}) has a truncated IE, rejecting", req.type, req.sequence);
+        resp.cause = GtpCause::InvalidLength;
+        return build_gtpv2_response(req, resp, out);
+    }
+
+    switch (GtpMessageType(req.type)) {
+    case GtpMessageType::EchoRequest:
+        break;
+
+    case GtpMessageType::CreateSessionRequest:
+        if (!req.has_imsi || !req.has_sender_teid) {
+            spdlog::warn("Create Session Request (seq {}) without IMSI or sender F-TEID", req.sequence);
+            resp.cause = GtpCause::MandatoryIeMissing;
+        } else if (!req.imsi.valid()) {
+            spdlog::warn("Create Session Request (seq {}) with malformed IMSI", req.sequence);
+            resp.cause = GtpCause::MandatoryIeIncorrect;
+        } else {
+            spdlog::info("Create Session Request for IMSI {}", req.imsi);
+            switch (admit_imsi(req.imsi)) {
+            case Admission::Accepted:
+                resp.local_teid = tunnels_.open(req.imsi, req.sender_teid);
+                break;
+            case Admission::Busy:
+                resp.cause = GtpCause::NoResourcesAvailable;
+                break;
+            case Admission::Rejected:
+                resp.cause = GtpCause::RequestRejected;
+                break;
+            }
         }
+        break;
 
-        // Декодируем BCD в строку IMSI (low‑nibble → первая цифра, high‑nibble → вторая)
-        std::string imsi;
-        for (ssize_t i = 0; i < len; ++i) {
-            uint8_t b   = buf[i];
-            uint8_t low =  b        & 0x0F;
-            uint8_t high= (b >> 4)  & 0x0F;
-            if (low  != 0xF) imsi.push_back(char('0' + low));
-            if (high != 0xF) imsi.push_back(char('0' + high));
+    case GtpMessageType::ModifyBearerRequest:
+    case GtpMessageType::DeleteSessionRequest: {
+        // Абонент определяется по нашему TEID из заголовка
+        auto tunnel = req.has_teid ? tunnels_.find(req.teid) : std::nullopt;
+        if (!tunnel) {
+            spdlog::warn("GTPv2-C message type {} for unknown TEID {:#x}", req.type, req.teid);
+            resp.cause     = GtpCause::ContextNotFound;
+            resp.peer_teid = 0;
+            break;
         }
-        spdlog::info("Received IMSI {}", imsi);
+        resp.peer_teid = tunnel->peer_teid;
 
-        // Проверяем чёрный список и создаём сессию при необходимости
-        bool accepted = false;
-        if (blacklist_.is_blocked(imsi)) {
-            spdlog::warn("IMSI {} is blacklisted, rejecting", imsi);
+        if (GtpMessageType(req.type) == GtpMessageType::ModifyBearerRequest) {
+            if (!sessions_.refresh_session(tunnel->imsi)) {
+                // Сессия истекла по таймауту — туннель больше не нужен
+                tunnels_.close(req.teid);
+                resp.cause = GtpCause::ContextNotFound;
+            }
         } else {
-            accepted = sessions_.touch_session(imsi);
-            spdlog::info("{} session for IMSI {}", accepted ? "Created" : "Rejected", imsi);
+            sessions_.end_session(tunnel->imsi);
+            tunnels_.close(req.teid);
         }
+        break;
+    }
 
-        const char* resp = accepted ? "created" : "rejected";
-        ssize_t sent = ::sendto(sock,
-                                resp, std::strlen(resp),
-                                0,
-                                reinterpret_cast<sockaddr*>(&client_addr),
-                                client_addr_len);
+    default:
+        spdlog::debug("Ignoring GTPv2-C message type {}", req.type);
+        return 0;
+    }
 
-        if (sent < 0) {
-            spdlog::error("Failed to send '{}' to client: {}", resp, std::strerror(errno));
+    return build_gtpv2_response(req, resp, out);
+}
+
+// Буферы одной пачки: данные, адреса клиентов и заголовки для recvmmsg/sendmmsg
+struct UdpServer::BatchBuffers {
+    explicit BatchBuffers(size_t batch)
+        : size(batch)
+        , data(batch * kDatagramSize)
+        , client_addrs(batch)
+        , rx_iov(batch)
+        , rx_msgs(batch)
+        , tx_iov(batch)
+        , tx_msgs(batch)
+        , tx_data(batch * kGtpMaxResponseSize)
+        , bcd(batch * 8)
+        , imsis(batch)
+        , valid((batch + 63) / 64)
+        , throttled(batch)
+        , admission(batch)
+    {
+        for (size_t i = 0; i < batch; ++i) {
+            rx_iov[i].iov_base = data.data() + i * kDatagramSize;
+            rx_iov[i].iov_len  = kDatagramSize;
+        }
+    }
+
+    size_t                   size;
+    std::vector<uint8_t>     data;
+    std::vector<sockaddr_in> client_addrs;
+    std::vector<iovec>       rx_iov;
+    std::vector<mmsghdr>     rx_msgs;
+    std::vector<iovec>       tx_iov;
+    std::vector<mmsghdr>     tx_msgs;
+    std::vector<uint8_t>     tx_data;  // Ответы GTPv2-C, по kGtpMaxResponseSize байт на датаграмму
+    std::vector<uint8_t>     bcd;    // Первые 8 байт каждой датаграммы, дополненные 0xFF, — вход decode_bcd_batch
+    std::vector<Imsi>        imsis;  // Разобранные IMSI пачки
+    std::vector<uint64_t>    valid;  // Маска валидных IMSI
+    std::vector<uint8_t>     throttled;  // 1 — датаграмма не прошла ограничение частоты
+    std::vector<Admission>   admission;  // Итог обработки IMSI-датаграммы
+    std::vector<Imsi>        admit_imsis;  // Валидные IMSI пачки — вход admit_batch
+    std::vector<uint32_t>    admit_idx;    // Номер датаграммы для каждого из admit_imsis
+    std::vector<Admission>   admitted;     // Выход admit_batch
+};
+
+void UdpServer::run_loop(Worker& w) {
+    switch (options_.backend) {
+    case UdpBackend::IoUring:
+        if (run_uring_loop(w))
+            break;
+        spdlog::warn("UDP worker {}: io_uring is not supported by the kernel, falling back to epoll", w.index);
+        [[fallthrough]];
+    case UdpBackend::Epoll:
+        run_epoll_loop(w);
+        break;
+    case UdpBackend::Blocking:
+        run_blocking_loop(w);
+        break;
+    }
+
+    spdlog::info("UDP worker {} stopped: rx {} packets / {} syscalls, tx {} packets / {} syscalls",
+                 w.index,
+                 w.rx_packets.load(std::memory_order_relaxed), w.rx_syscalls.load(std::memory_order_relaxed),
+                 w.tx_packets.load(std::memory_order_relaxed), w.tx_syscalls.load(std::memory_order_relaxed));
+}
+
+void UdpServer::run_blocking_loop(Worker& w) {
+    BatchBuffers batch(options_.batch_size);
+
+    // Ждём первую датаграмму (не дольше kBlockingPollInterval), остальные забираем без блокировки
+    while (running_) {
+        process_batch(w, batch, MSG_WAITFORONE);
+    }
+}
+
+void UdpServer::run_epoll_loop(Worker& w) {
+    BatchBuffers batch(options_.batch_size);
+
+    // Сокет готов к чтению — выбираем очередь пачками до EAGAIN
+    // Не больше kMaxBatchesPerWakeup пачек подряд, чтобы не задерживать другие дескрипторы цикла
+    static constexpr int kMaxBatchesPerWakeup = 64;
+    w.loop.add(w.sock, EPOLLIN, [this, &w, &batch](uint32_t) {
+        for (int i = 0; i < kMaxBatchesPerWakeup && running_; ++i) {
+            if (process_batch(w, batch, 0) < batch.size)
+                break;
+        }
+    });
+
+    w.loop.run();
+    w.loop.remove(w.sock);
+}
+
+size_t UdpServer::process_batch(Worker& w, BatchBuffers& b, int recv_flags) {
+    for (size_t i = 0; i < b.size; ++i) {
+        b.rx_msgs[i] = mmsghdr{};
+        b.rx_msgs[i].msg_hdr.msg_name    = &b.client_addrs[i];
+        b.rx_msgs[i].msg_hdr.msg_namelen = sizeof(sockaddr_in);
+        b.rx_msgs[i].msg_hdr.msg_iov     = &b.rx_iov[i];
+        b.rx_msgs[i].msg_hdr.msg_iovlen  = 1;
+    }
+
+    // Забираем всё, что уже есть в очереди сокета, не больше размера пачки
+    int n = ::recvmmsg(w.sock, b.rx_msgs.data(), static_cast<unsigned>(b.size), recv_flags, nullptr);
+    if (n < 0) {
+        if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR) {
+            spdlog::error("recvmmsg failed: {}", std::strerror(errno));
+        }
+        return 0;
+    }
+    if (n == 0)
+        return 0;
+
+    w.rx_syscalls.fetch_add(1, std::memory_order_relaxed);
+    w.rx_packets.fetch_add(static_cast<uint64_t>(n), std::memory_order_relaxed);
+
+    // Ограничение частоты — до разбора: датаграммы сверх темпа источника не декодируются
+    uint64_t now_ns = w.limiter ? RateLimiter::now_ns() : 0;
+    for (int i = 0; i < n; ++i) {
+        b.throttled[i] = is_throttled(w, b.client_addrs[i], now_ns);
+    }
+
+    // Все IMSI пачки разбираются одним вызовом (AVX2, если процессор поддерживает).
+    // Датаграмма длиннее 8 байт — не IMSI: дорожка остаётся заполнителем и декодируется
+    // как невалидная, как в Imsi::from_bcd
+    for (int i = 0; i < n; ++i) {
+        uint8_t* lane = b.bcd.data() + 8 * size_t(i);
+        std::memset(lane, 0xFF, 8);
+        if (!b.throttled[i] && b.rx_msgs[i].msg_len <= 8)
+            std::memcpy(lane, b.rx_iov[i].iov_base, b.rx_msgs[i].msg_len);
+    }
+    decode_bcd_batch(b.bcd.data(), static_cast<size_t>(n), b.imsis.data(), b.valid.data());
+
+    // Конвейер: только декодируем и ставим в очередь, ответы отправит поток отправки
+    if (pipeline_) {
+        bool queued = false, replied = false;
+        for (int i = 0; i < n; ++i) {
+            size_t len = b.rx_msgs[i].msg_len;
+            auto* data = static_cast<const uint8_t*>(b.rx_iov[i].iov_base);
+            bool gtp = looks_like_gtpv2(data, len);
+            if (b.throttled[i]) {
+                if (options_.rate_limit_reply && !gtp)
+                    replied |= enqueue_reply(w, kThrottledReply, b.client_addrs[i]);
+            } else if (gtp) {
+                queued |= enqueue_gtp(w, data, len, b.client_addrs[i]);
+            } else if (len > 0) {
+                queued |= enqueue_request(w, b.imsis[i], b.client_addrs[i]);
+            }
+        }
+        if (queued)
+            notify_processors(w);
+        if (replied)
+            ring_bell(pipeline_->replies_bell);
+        return static_cast<size_t>(n);
+    }
+
+    // Запросы на подключение всей пачки — одним обращением к менеджеру сессий
+    b.admit_imsis.clear();
+    b.admit_idx.clear();
+    for (int i = 0; i < n; ++i) {
+        size_t len = b.rx_msgs[i].msg_len;
+        if (len == 0 || b.throttled[i] || looks_like_gtpv2(static_cast<const uint8_t*>(b.rx_iov[i].iov_base), len))
+            continue;
+        if (!b.imsis[i].valid()) {
+            spdlog::warn("Malformed IMSI in datagram, rejecting");
+            b.admission[i] = Admission::Rejected;
+            continue;
+        }
+        spdlog::info("Received IMSI {}", b.imsis[i]);
+        b.admit_imsis.push_back(b.imsis[i]);
+        b.admit_idx.push_back(static_cast<uint32_t>(i));
+    }
+    if (!b.admit_imsis.empty()) {
+        b.admitted.resize(b.admit_imsis.size());
+        admit_batch(b.admit_imsis, b.admitted.data());
+        for (size_t k = 0; k < b.admit_idx.size(); ++k) {
+            b.admission[b.admit_idx[k]] = b.admitted[k];
+        }
+    }
+
+    // Обрабатываем всю пачку и готовим ответы
+    size_t replies = 0;
+    for (int i = 0; i < n; ++i) {
+        size_t len = b.rx_msgs[i].msg_len;
+        if (len == 0)
+            continue;
+
+        auto* data = static_cast<const uint8_t*>(b.rx_iov[i].iov_base);
+        bool gtp = looks_like_gtpv2(data, len);
+        if (b.throttled[i]) {
+            if (!options_.rate_limit_reply || gtp)
+                continue;
+            b.tx_iov[replies].iov_base = const_cast<char*>(kThrottledReply);
+            b.tx_iov[replies].iov_len  = std::strlen(kThrottledReply);
+        } else if (gtp) {
+            uint8_t* out = b.tx_data.data() + size_t(i) * kGtpMaxResponseSize;
+            size_t out_len = handle_gtp_datagram(w, data, len, out);
+            if (out_len == 0)
+                continue;
+            b.tx_iov[replies].iov_base = out;
+            b.tx_iov[replies].iov_len  = out_len;
         } else {
-            spdlog::info("Sent {} bytes: '{}'", sent, resp);
+            const char* resp = admission_reply(b.admission[i]);
+            b.tx_iov[replies].iov_base = const_cast<char*>(resp);
+            b.tx_iov[replies].iov_len  = std::strlen(resp);
+        }
+        b.tx_msgs[replies] = mmsghdr{};
+        b.tx_msgs[replies].msg_hdr.msg_name    = &b.client_addrs[i];
+        b.tx_msgs[replies].msg_hdr.msg_namelen = b.rx_msgs[i].msg_hdr.msg_namelen;
+        b.tx_msgs[replies].msg_hdr.msg_iov     = &b.tx_iov[replies];
+        b.tx_msgs[replies].msg_hdr.msg_iovlen  = 1;
+        ++replies;
+    }
+
+    size_t sent_total = send_replies(w, b.tx_msgs.data(), replies);
+    spdlog::debug("Batch: received {} datagrams, sent {} replies", n, sent_total);
+
+    return static_cast<size_t>(n);
+}
+
+size_t UdpServer::send_replies(Worker& w, mmsghdr* msgs, size_t count) {
+    // Отправляем все ответы пачкой; sendmmsg может отправить только часть — досылаем остаток.
+    // При переполнении буфера отправки (EAGAIN) ответы отбрасываются: клиент повторит запрос
+    size_t sent_total = 0;
+    while (sent_total < count) {
+        int sent = ::sendmmsg(w.sock, msgs + sent_total, static_cast<unsigned>(count - sent_total), 0);
+        if (sent < 0) {
+            if (errno == EINTR)
+                continue;
+            spdlog::error("Failed to send {} replies to clients: {}",
+                          count - sent_total, std::strerror(errno));
+            break;
+        }
+        w.tx_syscalls.fetch_add(1, std::memory_order_relaxed);
+        sent_total += static_cast<size_t>(sent);
+    }
+    w.tx_packets.fetch_add(sent_total, std::memory_order_relaxed);
+    return sent_total;
+}
+
+// Контекст одной отправки через io_uring: живёт до получения CQE
+struct UringSendSlot {
+    sockaddr_in addr{};
+    iovec       iov{};
+    msghdr      msg{};
+    uint8_t     data[kGtpMaxResponseSize];  // Ответ GTPv2-C
+};
+
+bool UdpServer::run_uring_loop(Worker& w) {
+    // Память, на которую ссылаются запросы в ядре, объявлена до кольца: при любом выходе
+    // кольцо закрывается раньше, чем она освобождается
+
+    // Шаблон для multishot recvmsg: ядро кладёт адрес отправителя и данные в предоставленный буфер
+    msghdr recv_msg{};
+    recv_msg.msg_namelen = sizeof(sockaddr_in);
+
+    // Слоты отправки: по одному на ответ, пока ядро не вернёт CQE
+    std::vector<UringSendSlot> slots(kUringBuffers);
+    std::vector<uint32_t> free_slots(slots.size());
+    for (uint32_t i = 0; i < free_slots.size(); ++i) {
+        free_slots[i] = static_cast<uint32_t>(free_slots.size() - 1 - i);
+    }
+
+    uint64_t wake_value = 0;
+
+    std::unique_ptr<IoUring> ring;
+    try {
+        ring = std::make_unique<IoUring>(kUringEntries, kUringCqEntries);
+        ring->setup_buffers(kUringBufGroup, kUringBuffers, kUringBufSize);
+    } catch (const std::system_error& e) {
+        spdlog::warn("UDP worker {}: io_uring setup failed: {}", w.index, e.what());
+        return false;
+    }
+
+    bool recv_armed   = false;  // Multishot recvmsg ещё в ядре (нет CQE без IORING_CQE_F_MORE)
+    bool wake_armed   = false;  // Чтение eventfd ещё в ядре
+    bool received_any = false;
+    bool unsupported  = false;
+
+    // Следующий свободный SQE; если очередь заполнена — отдаём накопленное ядру
+    auto next_sqe = [&ring]() {
+        io_uring_sqe* sqe = ring->get_sqe();
+        while (!sqe) {
+            ring->submit_and_wait(0);
+            sqe = ring->get_sqe();
+        }
+        return sqe;
+    };
+
+    auto arm_recv = [&]() {
+        io_uring_sqe* sqe = next_sqe();
+        sqe->opcode    = IORING_OP_RECVMSG;
+        sqe->fd        = w.sock;
+        sqe->addr      = reinterpret_cast<uint64_t>(&recv_msg);
+        sqe->len       = 1;
+        sqe->ioprio    = IORING_RECV_MULTISHOT;
+        sqe->flags     = IOSQE_BUFFER_SELECT;
+        sqe->buf_group = kUringBufGroup;
+        sqe->user_data = kUringRecv;
+        recv_armed = true;
+    };
+
+    // Чтение eventfd завершится, когда stop() разбудит worker'а
+    auto arm_wake = [&]() {
+        io_uring_sqe* sqe = next_sqe();
+        sqe->opcode    = IORING_OP_READ;
+        sqe->fd        = w.wake_fd;
+        sqe->addr      = reinterpret_cast<uint64_t>(&wake_value);
+        sqe->len       = sizeof(wake_value);
+        sqe->user_data = kUringWake;
+        wake_armed = true;
+    };
+
+    arm_recv();
+    arm_wake();
+
+    while (running_) {
+        int ret = ring->submit_and_wait(1);
+        if (ret < 0 && ret != -EINTR && ret != -EAGAIN && ret != -EBUSY) {
+            spdlog::error("UDP worker {}: io_uring_enter failed: {}", w.index, std::strerror(-ret));
+            break;
+        }
+
+        unsigned ready = ring->cq_ready();
+        size_t rx = 0, tx_queued = 0, tx_done = 0;
+        bool rearm = false;
+        bool queued = false, replied = false;
+        uint64_t now_ns = w.limiter ? RateLimiter::now_ns() : 0;
+
+        for (unsigned i = 0; i < ready; ++i) {
+            io_uring_cqe* cqe = ring->cqe_at(i);
+            uint64_t tag = cqe->user_data & kUringTagMask;
+
+            if (tag == kUringSend) {
+                free_slots.push_back(static_cast<uint32_t>(cqe->user_data & ~kUringTagMask));
+                if (cqe->res >= 0) {
+                    ++tx_done;
+                } else if (cqe->res != -ECANCELED) {
+                    spdlog::error("UDP worker {}: failed to send reply: {}", w.index, std::strerror(-cqe->res));
+                }
+                continue;
+            }
+
+            if (tag == kUringWake) {
+                wake_armed = false;
+                continue;
+            }
+
+            if (cqe->user_data == IoUring::kProvideBuffersUserData) {
+                spdlog::error("UDP worker {}: failed to return receive buffers: {}", w.index, std::strerror(-cqe->res));
+                continue;
+            }
+
+            // Завершение multishot recvmsg: без IORING_CQE_F_MORE запрос снят и его нужно перевзвести
+            if (!(cqe->flags & IORING_CQE_F_MORE)) {
+                recv_armed = false;
+                rearm = true;
+            }
+
+            if (cqe->res < 0) {
+                if (cqe->res == -EINVAL && !received_any) {
+                    unsupported = true;  // Ядро без multishot recvmsg
+                } else if (cqe->res != -ENOBUFS) {
+                    spdlog::error("UDP worker {}: recvmsg failed: {}", w.index, std::strerror(-cqe->res));
+                }
+                continue;
+            }
+            if (!(cqe->flags & IORING_CQE_F_BUFFER))
+                continue;
+
+            received_any = true;
+            ++rx;
+            auto bid = static_cast<uint16_t>(cqe->flags >> IORING_CQE_BUFFER_SHIFT);
+            uint8_t* buf = ring->buffer(bid);
+            auto* out = reinterpret_cast<io_uring_recvmsg_out*>(buf);
+            const uint8_t* name    = buf + sizeof(io_uring_recvmsg_out);
+            const uint8_t* payload = name + recv_msg.msg_namelen + recv_msg.msg_controllen;
+            size_t payload_len = std::min<size_t>(out->payloadlen, kDatagramSize);
+
+            sockaddr_in from{};
+            std::memcpy(&from, name, std::min<size_t>(out->namelen, sizeof(from)));
+            bool gtp       = looks_like_gtpv2(payload, payload_len);
+            bool throttled = payload_len > 0 && is_throttled(w, from, now_ns);
+
+            if (throttled && (!options_.rate_limit_reply || gtp)) {
+                // Отбрасываем без ответа
+            } else if (payload_len > 0 && pipeline_) {
+                if (throttled)
+                    replied |= enqueue_reply(w, kThrottledReply, from);
+                else if (gtp)
+                    queued |= enqueue_gtp(w, payload, payload_len, from);
+                else
+                    queued |= enqueue_request(w, Imsi::from_bcd(payload, payload_len), from);
+            } else if (payload_len > 0 && !free_slots.empty()) {
+                uint32_t slot_idx = free_slots.back();
+                UringSendSlot& slot = slots[slot_idx];
+                if (throttled) {
+                    slot.iov.iov_base = const_cast<char*>(kThrottledReply);
+                    slot.iov.iov_len  = std::strlen(kThrottledReply);
+                } else if (gtp) {
+                    slot.iov.iov_base = slot.data;
+                    slot.iov.iov_len  = handle_gtp_datagram(w, payload, payload_len, slot.data);
+                } else {
+                    const char* resp = handle_datagram(payload, payload_len);
+                    slot.iov.iov_base = const_cast<char*>(resp);
+                    slot.iov.iov_len  = std::strlen(resp);
+                }
+
+                // Сообщение без ответа: слот остаётся свободным
+                if (slot.iov.iov_len == 0) {
+                    ring->recycle_buffer(bid);
+                    continue;
+                }
+                free_slots.pop_back();
+                slot.addr = from;
+                slot.msg = msghdr{};
+                slot.msg.msg_name    = &slot.addr;
+                slot.msg.msg_namelen = sizeof(slot.addr);
+                slot.msg.msg_iov     = &slot.iov;
+                slot.msg.msg_iovlen  = 1;
+
+                // Ответы всей пачки CQE уходят ядру одним io_uring_enter в начале следующей итерации.
+                // Без IOSQE_IO_LINK: ответы разным абонентам независимы, а в цепочке ошибка одной
+                // отправки отменила бы остальные и ядро выполняло бы их строго по очереди
+                io_uring_sqe* sqe = next_sqe();
+                sqe->opcode    = IORING_OP_SENDMSG;
+                sqe->fd        = w.sock;
+                sqe->addr      = reinterpret_cast<uint64_t>(&slot.msg);
+                sqe->len       = 1;
+                sqe->user_data = kUringSend | slot_idx;
+                ++tx_queued;
+            } else if (payload_len > 0) {
+                spdlog::warn("UDP worker {}: no free send slots, dropping reply", w.index);
+            }
+
+            ring->recycle_buffer(bid);
+        }
+
+        ring->cq_advance(ready);
+        ring->commit_buffers();
+        if (queued)
+            notify_processors(w);
+        if (replied)
+            ring_bell(pipeline_->replies_bell);
+
+        if (unsupported)
+            break;
+        if (rearm && running_)
+            arm_recv();
+
+        if (rx) {
+            w.rx_syscalls.fetch_add(1, std::memory_order_relaxed);
+            w.rx_packets.fetch_add(rx, std::memory_order_relaxed);
+        }
+        if (tx_queued)
+            w.tx_syscalls.fetch_add(1, std::memory_order_relaxed);
+        if (tx_done)
+            w.tx_packets.fetch_add(tx_done, std::memory_order_relaxed);
+    }
+
+    // Снимаем всё, что осталось в ядре, и дожидаемся CQE каждого запроса: до последнего из них
+    // ядро может читать слоты отправки, recv_msg и wake_value. Отправка, которую уже не снять
+    // (-EALREADY), завершится сама
+    auto cancel = [&](uint64_t user_data) {
+        io_uring_sqe* sqe = next_sqe();
+        sqe->opcode    = IORING_OP_ASYNC_CANCEL;
+        sqe->addr      = user_data;
+        sqe->user_data = kUringCancel;
+    };
+    if (recv_armed)
+        cancel(kUringRecv);
+    if (wake_armed)
+        cancel(kUringWake);
+    std::vector<bool> idle(slots.size(), false);
+    for (uint32_t idx : free_slots) idle[idx] = true;
+    for (uint32_t idx = 0; idx < slots.size(); ++idx) {
+        if (!idle[idx])
+            cancel(kUringSend | idx);
+    }
+
+    auto in_flight = [&]() { return slots.size() - free_slots.size(); };
+    while (in_flight() > 0 || recv_armed || wake_armed) {
+        int ret = ring->submit_and_wait(1);
+        if (ret < 0 && ret != -EINTR && ret != -EAGAIN && ret != -EBUSY) {
+            // Кольцо закроется раньше, чем освободятся слоты (см. порядок объявлений)
+            spdlog::error("UDP worker {}: io_uring_enter failed while draining: {}", w.index, std::strerror(-ret));
+            break;
+        }
+        unsigned ready = ring->cq_ready();
+        for (unsigned i = 0; i < ready; ++i) {
+            io_uring_cqe* cqe = ring->cqe_at(i);
+            uint64_t tag = cqe->user_data & kUringTagMask;
+            if (tag == kUringSend) {
+                free_slots.push_back(static_cast<uint32_t>(cqe->user_data & ~kUringTagMask));
+                if (cqe->res >= 0)
+                    w.tx_packets.fetch_add(1, std::memory_order_relaxed);
+            } else if (tag == kUringRecv && !(cqe->flags & IORING_CQE_F_MORE)) {
+                recv_armed = false;
+            } else if (tag == kUringWake) {
+                wake_armed = false;
+            }
         }
+        ring->cq_advance(ready);
     }
 
-    ::close(sock);
-    spdlog::info("UDP server stopped");
+    return !unsupported;
 }
 
 } // namespace pgw
@@ -0,0 +1,45 @@
+#include <gtest/gtest.h>
+#include "pgw/clock.hpp"
+#include <cstdlib>
+#include <string>
+#include <thread>
+
+using namespace pgw;
+
+// Тестируем разбор и форматирование меток местного времени
+TEST(ClockTest, FormatsAndParsesTimestamps) {
+    EpochMs ms = 0;
+    ASSERT_TRUE(parse_timestamp("2025-07-27 12:00:00", ms));
+    EXPECT_EQ(ms % 1000, 0);
+    EXPECT_EQ(std::string(format_timestamp(ms)), "2025-07-27 12:00:00");
+
+    // Миллисекунды внутри секунды дают ту же строку (из кэша), следующая секунда — новую
+    EXPECT_EQ(std::string(format_timestamp(ms + 999)), "2025-07-27 12:00:00");
+    EXPECT_EQ(std::string(format_timestamp(ms + 1000)), "2025-07-27 12:00:01");
+    EXPECT_EQ(std::string(format_timestamp(ms + 3600 * 1000)), "2025-07-27 13:00:00");
+}
+
+// Тестируем отказ на строках не того формата
+TEST(ClockTest, RejectsMalformedTimestamps) {
+    EpochMs ms = 42;
+    EXPECT_FALSE(parse_timestamp("", ms));
+    EXPECT_FALSE(parse_timestamp("2025-07-27", ms));
+    EXPECT_FALSE(parse_timestamp("2025-07-27 12:00:00 extra", ms));
+    EXPECT_FALSE(parse_timestamp("not a date", ms));
+    EXPECT_EQ(ms, 42);
+}
+
+// Тестируем, что грубые часы идут вместе с системными
+TEST(ClockTest, CoarseClockTracksSystemTime) {
+    CoarseClock clock(std::chrono::milliseconds(1));
+    EXPECT_LT(std::llabs(clock.epoch_ms() - epoch_ms_now()), 50);
+
+    EpochMs before = clock.epoch_ms();
+    auto    mono   = clock.steady();
+    std::this_thread::sleep_for(std::chrono::milliseconds(30));
+    EXPECT_GE(clock.epoch_ms() - before, 20);
+    EXPECT_GE(clock.steady() - mono, std::chrono::milliseconds(20));
+    EXPECT_LE(clock.steady(), std::chrono::steady_clock::now());
+
+    EXPECT_THROW(CoarseClock(std::chrono::milliseconds(0)), std::invalid_argument);
+}
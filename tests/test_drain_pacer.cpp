@@ -0,0 +1,59 @@
+#include <gtest/gtest.h>
+#include "pgw/drain_pacer.hpp"
+#include <stdexcept>
+
+using namespace pgw;
+
+static constexpr uint64_t kSecond = 1'000'000'000ull;
+
+// Тестируем, что маркеры прибывают строго по расписанию 1 / rate, без накопления ошибки
+TEST(DrainPacerTest, TokensFollowSchedule) {
+    const uint64_t t0 = 5 * kSecond;
+    DrainPacer pacer(3.0, 1, t0);  // Интервал 333.33 мс — не целое число наносекунд
+
+    EXPECT_EQ(pacer.available(t0), 1u);  // Первый маркер готов сразу
+    pacer.take(1, t0);
+    EXPECT_EQ(pacer.available(t0), 0u);
+
+    // Забираем маркеры точно в момент готовности: через 3000 маркеров расписание не уплыло
+    uint64_t now = t0;
+    for (int i = 0; i < 3000; ++i) {
+        now = pacer.ready_at(1);
+        ASSERT_EQ(pacer.available(now), 1u) << i;
+        ASSERT_EQ(pacer.available(now - 1), 0u) << i;
+        pacer.take(1, now);
+    }
+    EXPECT_NEAR(double(now - t0), 1000.0 * kSecond, 2.0);
+}
+
+// Тестируем, что корзина копит не больше пачки и после паузы не выбрасывает лишнего
+TEST(DrainPacerTest, BatchCapsBurst) {
+    const uint64_t t0 = kSecond;
+    DrainPacer pacer(1000.0, 4, t0);  // Маркер в миллисекунду, пачка — 4
+
+    EXPECT_EQ(pacer.ready_at(4), t0 + 3'000'000);
+    EXPECT_EQ(pacer.available(t0 + 3'000'000), 4u);
+
+    // Долгая пауза: готова только одна пачка, дальше — снова по маркеру в миллисекунду
+    uint64_t now = t0 + 10 * kSecond;
+    EXPECT_EQ(pacer.available(now), 4u);
+    pacer.take(4, now);
+    EXPECT_EQ(pacer.available(now), 0u);
+    EXPECT_EQ(pacer.ready_at(1), now + 1'000'000);
+
+    // Невостребованные маркеры возвращаются
+    pacer.give_back(2);
+    EXPECT_EQ(pacer.available(now), 2u);
+}
+
+// Тестируем размер пачки по темпу и проверку параметров
+TEST(DrainPacerTest, BatchForRateAndValidation) {
+    EXPECT_EQ(DrainPacer::batch_for(10), 1u);
+    EXPECT_EQ(DrainPacer::batch_for(999), 1u);
+    EXPECT_EQ(DrainPacer::batch_for(50000), 50u);
+    EXPECT_EQ(DrainPacer::batch_for(1e8), DrainPacer::kMaxBatch);
+
+    EXPECT_THROW(DrainPacer(0.0, 1, 0), std::invalid_argument);
+    EXPECT_THROW(DrainPacer(-1.0, 1, 0), std::invalid_argument);
+    EXPECT_THROW(DrainPacer(10.0, 0, 0), std::invalid_argument);
+}
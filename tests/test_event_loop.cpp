@@ -0,0 +1,56 @@
+#include <gtest/gtest.h>
+#include "pgw/event_loop.hpp"
+#include <sys/epoll.h>
+#include <unistd.h>
+#include <chrono>
+#include <thread>
+
+using namespace pgw;
+
+// Тестируем, что stop() будит поток, ожидающий в run(), без задержки
+TEST(EventLoopTest, StopWakesRunImmediately) {
+    EventLoop loop;
+    std::thread t([&] { loop.run(); });
+
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+
+    auto started = std::chrono::steady_clock::now();
+    loop.stop();
+    t.join();
+    auto elapsed = std::chrono::steady_clock::now() - started;
+
+    // Поток не спит по таймеру, поэтому завершается существенно быстрее прежних 100 мс
+    EXPECT_LT(elapsed, std::chrono::milliseconds(50));
+}
+
+// Тестируем, что stop() до run() не даёт циклу заблокироваться
+TEST(EventLoopTest, StopBeforeRun) {
+    EventLoop loop;
+    loop.stop();
+    loop.run();  // Должен сразу вернуться
+    SUCCEED();
+}
+
+// Тестируем вызов обработчика при готовности дескриптора к чтению
+TEST(EventLoopTest, DispatchesReadableDescriptor) {
+    int fds[2];
+    ASSERT_EQ(::pipe(fds), 0);
+
+    EventLoop loop;
+    int calls = 0;
+    loop.add(fds[0], EPOLLIN, [&](uint32_t events) {
+        EXPECT_TRUE(events & EPOLLIN);
+        char c;
+        EXPECT_EQ(::read(fds[0], &c, 1), 1);
+        ++calls;
+        loop.stop();
+    });
+
+    std::thread t([&] { loop.run(); });
+    ASSERT_EQ(::write(fds[1], "x", 1), 1);
+    t.join();
+
+    EXPECT_EQ(calls, 1);
+    ::close(fds[0]);
+    ::close(fds[1]);
+}
@@ -0,0 +1,211 @@
+#include <gtest/gtest.h>
+#include "pgw/flat_session_store.hpp"
+
+#include <atomic>
+#include <random>
+#include <string>
+#include <thread>
+#include <unordered_map>
+
+using namespace pgw;
+
+static Imsi imsi_at(uint64_t i) {
+    return Imsi::from_string(std::to_string(250010000000000ull + i));
+}
+
+static StoredSession make_session(uint64_t i, EpochMs expires_at) {
+    return StoredSession{ imsi_at(i), 1000, expires_at };
+}
+
+// Тестируем сохранение, поиск и удаление
+TEST(FlatSessionStoreTest, SaveFindDelete) {
+    FlatSessionStore store;
+    EXPECT_TRUE(store.save_session(make_session(1, 5000)));
+    EXPECT_TRUE(store.save_session(make_session(2, 7000)));
+    EXPECT_FALSE(store.save_session(StoredSession{}));  // Невалидный IMSI не сохраняется
+
+    EXPECT_TRUE(store.session_exists(imsi_at(1)));
+    EXPECT_FALSE(store.session_exists(imsi_at(3)));
+    auto s = store.get_session(imsi_at(2));
+    ASSERT_TRUE(s.has_value());
+    EXPECT_EQ(s->imsi, imsi_at(2));
+    EXPECT_EQ(s->created_at, 1000);
+    EXPECT_EQ(s->expires_at, 7000);
+
+    EXPECT_TRUE(store.delete_session(imsi_at(1)));
+    EXPECT_FALSE(store.delete_session(imsi_at(1)));
+    EXPECT_FALSE(store.session_exists(imsi_at(1)));
+    EXPECT_EQ(store.size(), 1u);
+}
+
+// Тестируем upsert и пакетные формы
+TEST(FlatSessionStoreTest, UpsertAndBatches) {
+    FlatSessionStore store;
+    EXPECT_EQ(store.upsert(make_session(1, 5000)), UpsertResult::Created);
+    EXPECT_EQ(store.upsert({ imsi_at(1), 4000, 9000 }), UpsertResult::Refreshed);
+    EXPECT_EQ(store.get_session(imsi_at(1))->created_at, 1000);
+    EXPECT_EQ(store.get_session(imsi_at(1))->expires_at, 9000);
+
+    std::vector<StoredSession> batch = { make_session(2, 5000), make_session(1, 6000), make_session(2, 8000) };
+    auto results = store.upsert_batch(batch);
+    ASSERT_EQ(results.size(), 3u);
+    EXPECT_EQ(results[0], UpsertResult::Created);
+    EXPECT_EQ(results[1], UpsertResult::Refreshed);
+    EXPECT_EQ(results[2], UpsertResult::Refreshed);
+
+    std::vector<Imsi> imsis = { imsi_at(2), imsi_at(3), imsi_at(1) };
+    auto found = store.lookup_batch(imsis);
+    ASSERT_EQ(found.size(), 3u);
+    ASSERT_TRUE(found[0].has_value());
+    EXPECT_EQ(found[0]->expires_at, 8000);
+    EXPECT_FALSE(found[1].has_value());
+    ASSERT_TRUE(found[2].has_value());
+
+    EXPECT_EQ(store.delete_batch(imsis), 2u);
+    EXPECT_EQ(store.size(), 0u);
+}
+
+// Тестируем сканирование сроков
+TEST(FlatSessionStoreTest, ExpiryScans) {
+    FlatSessionStore store;
+    for (uint64_t i = 0; i < 1000; ++i) {
+        store.save_session(make_session(i, i % 2 ? 10000 : 2000));
+    }
+    EXPECT_EQ(store.load_sessions(5000).size(), 500u);
+    EXPECT_EQ(store.load_expired_sessions(5000).size(), 500u);
+
+    store.cleanup_expired_sessions(5000);
+    EXPECT_EQ(store.size(), 500u);
+    for (uint64_t i = 0; i < 1000; ++i) {
+        EXPECT_EQ(store.session_exists(imsi_at(i)), i % 2 == 1) << i;
+    }
+}
+
+// Тестируем предвыделение и рост таблицы за пределы заданной ёмкости
+TEST(FlatSessionStoreTest, CapacityAndGrowth) {
+    FlatSessionStore store(1000);
+    const size_t slots = store.slot_count();
+    EXPECT_GE(slots * 7 / 8, 1000u);
+    for (uint64_t i = 0; i < 1000; ++i) {
+        store.upsert(make_session(i, 5000));
+    }
+    EXPECT_EQ(store.slot_count(), slots);  // Заданная ёмкость принята без перестроения
+
+    for (uint64_t i = 1000; i < 20000; ++i) {
+        store.upsert(make_session(i, 5000));
+    }
+    EXPECT_GT(store.slot_count(), slots);
+    EXPECT_EQ(store.size(), 20000u);
+    for (uint64_t i = 0; i < 20000; ++i) {
+        ASSERT_TRUE(store.session_exists(imsi_at(i))) << i;
+    }
+}
+
+// Тестируем, что просьба об огромных страницах не мешает работе, даже если их нет
+TEST(FlatSessionStoreTest, HugePagesOptional) {
+    FlatSessionStore store(100000, true);
+    for (uint64_t i = 0; i < 1000; ++i) {
+        store.upsert(make_session(i, 5000));
+    }
+    EXPECT_EQ(store.size(), 1000u);
+    EXPECT_TRUE(store.session_exists(imsi_at(999)));
+}
+
+// Сверяем со стандартной хеш-таблицей на случайной смеси операций (маленькая таблица —
+// длинные цепочки, перенос через конец массива и обратные сдвиги)
+TEST(FlatSessionStoreTest, MatchesReferenceModel) {
+    FlatSessionStore store;
+    std::unordered_map<uint64_t, StoredSession> model;
+    std::mt19937_64 rng(7);
+
+    for (int step = 0; step < 200000; ++step) {
+        uint64_t id = rng() % 3000;
+        switch (rng() % 6) {
+        case 0:
+        case 1: {
+            StoredSession s = make_session(id, EpochMs(rng() % 10000));
+            auto r = store.upsert(s);
+            auto [it, inserted] = model.try_emplace(id, s);
+            EXPECT_EQ(r, inserted ? UpsertResult::Created : UpsertResult::Refreshed);
+            it->second.expires_at = s.expires_at;
+            break;
+        }
+        case 2:
+            EXPECT_EQ(store.delete_session(imsi_at(id)), model.erase(id) > 0);
+            break;
+        case 3: {
+            auto s = store.get_session(imsi_at(id));
+            auto it = model.find(id);
+            ASSERT_EQ(s.has_value(), it != model.end());
+            if (s) {
+                EXPECT_EQ(s->expires_at, it->second.expires_at);
+            }
+            break;
+        }
+        case 4:
+            EXPECT_EQ(store.session_exists(imsi_at(id)), model.count(id) > 0);
+            break;
+        case 5:
+            if (rng() % 100 == 0) {
+                EpochMs now = EpochMs(rng() % 10000);
+                store.cleanup_expired_sessions(now);
+                std::erase_if(model, [&](auto& kv) { return kv.second.expires_at <= now; });
+            }
+            break;
+        }
+        ASSERT_EQ(store.size(), model.size());
+    }
+    for (auto& [id, s] : model) {
+        ASSERT_TRUE(store.session_exists(imsi_at(id)));
+    }
+}
+
+// Читатели без блокировок одновременно с писателем: постоянные сессии всегда находятся
+// и никогда не читаются «наполовину» (created_at и expires_at одной записи согласованы)
+TEST(FlatSessionStoreTest, ConcurrentReadersSeeConsistentRecords) {
+    FlatSessionStore store;
+    EXPECT_TRUE(store.concurrent_reads());
+    const uint64_t stable = 2000;
+    for (uint64_t i = 0; i < stable; ++i) {
+        store.upsert({ imsi_at(i), EpochMs(i), EpochMs(i) + 1000000 });
+    }
+
+    std::atomic<bool> stop{false};
+    std::atomic<uint64_t> errors{0}, reads{0};
+    std::vector<std::thread> readers;
+    for (int r = 0; r < 3; ++r) {
+        readers.emplace_back([&, r] {
+            std::mt19937_64 rng(r);
+            while (!stop.load(std::memory_order_relaxed)) {
+                uint64_t id = rng() % stable;
+                auto s = store.get_session(imsi_at(id));
+                // Продление сдвигает expires_at на кратное 1000000 от created_at
+                if (!s || s->created_at != EpochMs(id) || (s->expires_at - s->created_at) % 1000000 != 0)
+                    errors.fetch_add(1);
+                reads.fetch_add(1, std::memory_order_relaxed);
+            }
+        });
+    }
+
+    // Писатель: поток создания и удаления временных сессий (сдвиги цепочек, рост таблицы)
+    // и продление постоянных
+    std::mt19937_64 rng(42);
+    for (int step = 0; step < 200000; ++step) {
+        uint64_t id = stable + rng() % 20000;
+        if (rng() % 2)
+            store.upsert(make_session(id, 5000));
+        else
+            store.delete_session(imsi_at(id));
+        if (step % 10 == 0) {
+            uint64_t s = rng() % stable;
+            store.upsert({ imsi_at(s), 0, EpochMs(s) + 1000000 * EpochMs(2 + step % 7) });
+        }
+    }
+    stop = true;
+    for (auto& th : readers) th.join();
+
+    EXPECT_EQ(errors.load(), 0u);
+    EXPECT_GT(reads.load(), 0u);
+    auto all = store.load_sessions(0);
+    EXPECT_GE(all.size(), stable);
+}
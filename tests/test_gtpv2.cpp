@@ -0,0 +1,185 @@
+#include <gtest/gtest.h>
+#include "pgw/gtpv2.hpp"
+#include <arpa/inet.h>
+#include <vector>
+
+using namespace pgw;
+
+// Сборка тестовых сообщений GTPv2-C
+static void put_ie(std::vector<uint8_t>& m, uint8_t type, std::vector<uint8_t> value, uint8_t instance = 0) {
+    m.push_back(type);
+    m.push_back(uint8_t(value.size() >> 8));
+    m.push_back(uint8_t(value.size()));
+    m.push_back(instance);
+    m.insert(m.end(), value.begin(), value.end());
+}
+
+static std::vector<uint8_t> make_message(uint8_t type, uint32_t teid, uint32_t seq, const std::vector<uint8_t>& ies) {
+    std::vector<uint8_t> m{0x48, type, 0, 0,
+                           uint8_t(teid >> 24), uint8_t(teid >> 16), uint8_t(teid >> 8), uint8_t(teid),
+                           uint8_t(seq >> 16), uint8_t(seq >> 8), uint8_t(seq), 0};
+    m.insert(m.end(), ies.begin(), ies.end());
+    m[2] = uint8_t((m.size() - 4) >> 8);
+    m[3] = uint8_t(m.size() - 4);
+    return m;
+}
+
+// Create Session Request: IMSI 001010123456789, APN, Sender F-TEID 0x11223344, Bearer Context с EBI 5
+static std::vector<uint8_t> make_create_session() {
+    std::vector<uint8_t> ies;
+    put_ie(ies, 1, {0x00, 0x01, 0x01, 0x21, 0x43, 0x65, 0x87, 0xF9});
+    put_ie(ies, 71, {8, 'i', 'n', 't', 'e', 'r', 'n', 'e', 't'});  // APN — пропускается
+    put_ie(ies, 87, {0x86, 0x11, 0x22, 0x33, 0x44, 10, 0, 0, 1});
+    std::vector<uint8_t> bearer;
+    put_ie(bearer, 73, {0x05});
+    put_ie(ies, 93, bearer);
+    return make_message(32, 0, 0x000102, ies);
+}
+
+// Тестируем разбор Create Session Request и то, что IE остаются внутри буфера приёма
+TEST(Gtpv2Test, ParsesCreateSessionRequest) {
+    auto pkt = make_create_session();
+    GtpMessage msg;
+    ASSERT_EQ(parse_gtpv2(pkt.data(), pkt.size(), msg), GtpParseStatus::Ok);
+
+    EXPECT_EQ(msg.type, uint8_t(GtpMessageType::CreateSessionRequest));
+    EXPECT_TRUE(msg.has_teid);
+    EXPECT_EQ(msg.sequence, 0x000102u);
+    EXPECT_TRUE(msg.has_imsi);
+    EXPECT_EQ(msg.imsi.to_string(), "001010123456789");
+    EXPECT_TRUE(msg.has_sender_teid);
+    EXPECT_EQ(msg.sender_teid, 0x11223344u);
+    EXPECT_EQ(msg.ebi, 5);
+
+    EXPECT_EQ(msg.ies.data(), pkt.data() + kGtpHeaderSize);
+    EXPECT_EQ(msg.ies.size(), pkt.size() - kGtpHeaderSize);
+
+    // Обход IE возвращает значения, указывающие в пакет
+    GtpIeReader reader(msg.ies);
+    GtpIe ie;
+    size_t count = 0;
+    while (reader.next(ie)) {
+        EXPECT_GE(ie.value.data(), pkt.data());
+        EXPECT_LE(ie.value.data() + ie.value.size(), pkt.data() + pkt.size());
+        ++count;
+    }
+    EXPECT_FALSE(reader.malformed());
+    EXPECT_EQ(count, 4u);
+}
+
+// Тестируем TEID заголовка и Linked EBI в Delete Session Request
+TEST(Gtpv2Test, ParsesDeleteSessionRequest) {
+    std::vector<uint8_t> ies;
+    put_ie(ies, 73, {0x06});
+    auto pkt = make_message(36, 0xCAFE0001, 7, ies);
+
+    GtpMessage msg;
+    ASSERT_EQ(parse_gtpv2(pkt.data(), pkt.size(), msg), GtpParseStatus::Ok);
+    EXPECT_EQ(msg.type, uint8_t(GtpMessageType::DeleteSessionRequest));
+    EXPECT_EQ(msg.teid, 0xCAFE0001u);
+    EXPECT_EQ(msg.ebi, 6);
+    EXPECT_FALSE(msg.has_imsi);
+}
+
+// Тестируем обработку испорченных сообщений
+TEST(Gtpv2Test, RejectsMalformedMessages) {
+    auto pkt = make_create_session();
+    GtpMessage msg;
+
+    // Датаграмма короче длины из заголовка
+    EXPECT_EQ(parse_gtpv2(pkt.data(), pkt.size() - 1, msg), GtpParseStatus::InvalidHeader);
+
+    // Не версия 2
+    auto v1 = pkt;
+    v1[0] = 0x30;
+    EXPECT_EQ(parse_gtpv2(v1.data(), v1.size(), msg), GtpParseStatus::InvalidHeader);
+
+    // IE длиннее сообщения: заголовок разобран, ответить можно
+    auto bad_ie = pkt;
+    bad_ie[kGtpHeaderSize + 2] = 0xFF;
+    EXPECT_EQ(parse_gtpv2(bad_ie.data(), bad_ie.size(), msg), GtpParseStatus::InvalidLength);
+    EXPECT_EQ(msg.sequence, 0x000102u);
+
+    // IMSI с недесятичной цифрой
+    auto bad_imsi = pkt;
+    bad_imsi[kGtpHeaderSize + kGtpIeHeaderSize] = 0xA0;
+    ASSERT_EQ(parse_gtpv2(bad_imsi.data(), bad_imsi.size(), msg), GtpParseStatus::Ok);
+    EXPECT_TRUE(msg.has_imsi);
+    EXPECT_FALSE(msg.imsi.valid());
+}
+
+// Тестируем, что ответ разбирается тем же парсером и содержит Cause, Sender F-TEID и Bearer Context
+TEST(Gtpv2Test, BuildsCreateSessionResponse) {
+    auto pkt = make_create_session();
+    GtpMessage req;
+    ASSERT_EQ(parse_gtpv2(pkt.data(), pkt.size(), req), GtpParseStatus::Ok);
+
+    GtpResponse resp;
+    resp.peer_teid  = req.sender_teid;
+    resp.local_teid = 0x42;
+    inet_pton(AF_INET, "192.0.2.1", &resp.local_ipv4);
+
+    uint8_t out[kGtpMaxResponseSize];
+    size_t len = build_gtpv2_response(req, resp, out);
+    ASSERT_GT(len, kGtpHeaderSize);
+    ASSERT_LE(len, kGtpMaxResponseSize);
+
+    GtpMessage parsed;
+    ASSERT_EQ(parse_gtpv2(out, len, parsed), GtpParseStatus::Ok);
+    EXPECT_EQ(parsed.type, uint8_t(GtpMessageType::CreateSessionResponse));
+    EXPECT_EQ(parsed.teid, 0x11223344u);
+    EXPECT_EQ(parsed.sequence, req.sequence);
+    EXPECT_EQ(parsed.sender_teid, 0x42u);
+    EXPECT_EQ(parsed.ebi, 5);
+
+    GtpIeReader reader(parsed.ies);
+    GtpIe ie;
+    ASSERT_TRUE(reader.next(ie));
+    EXPECT_EQ(ie.type, uint8_t(GtpIeType::Cause));
+    EXPECT_EQ(ie.value[0], uint8_t(GtpCause::RequestAccepted));
+    ASSERT_TRUE(reader.next(ie));
+    ASSERT_EQ(ie.type, uint8_t(GtpIeType::FTeid));
+    EXPECT_EQ(ie.value[5], 192);
+    EXPECT_EQ(ie.value[8], 1);
+}
+
+// Тестируем, что на неподдерживаемые сообщения сервер не отвечает, а Echo получает ответ без TEID
+TEST(Gtpv2Test, EchoAndUnsupportedMessages) {
+    const uint8_t echo[] = {0x40, 1, 0, 9, 0, 0, 5, 0, 3, 0, 1, 0, 7};
+    GtpMessage req;
+    ASSERT_EQ(parse_gtpv2(echo, sizeof(echo), req), GtpParseStatus::Ok);
+    EXPECT_FALSE(req.has_teid);
+
+    uint8_t out[kGtpMaxResponseSize];
+    size_t len = build_gtpv2_response(req, GtpResponse{}, out);
+    ASSERT_EQ(len, kGtpShortHeaderSize + kGtpIeHeaderSize + 1);
+    EXPECT_EQ(out[1], uint8_t(GtpMessageType::EchoResponse));
+    EXPECT_EQ(out[6], 5);
+
+    req.type = 95;  // Create Bearer Request
+    EXPECT_EQ(build_gtpv2_response(req, GtpResponse{}, out), 0u);
+}
+
+// Тестируем выделение, повторное использование и закрытие туннелей
+TEST(Gtpv2Test, TunnelTable) {
+    GtpTunnelTable tunnels;
+    Imsi a = Imsi::from_string("001010000000001");
+    Imsi b = Imsi::from_string("001010000000002");
+
+    uint32_t ta = tunnels.open(a, 100);
+    uint32_t tb = tunnels.open(b, 200);
+    EXPECT_NE(ta, 0u);
+    EXPECT_NE(ta, tb);
+
+    // Повторный Create Session того же абонента — тот же TEID, новый TEID пира
+    EXPECT_EQ(tunnels.open(a, 101), ta);
+    auto found = tunnels.find(ta);
+    ASSERT_TRUE(found);
+    EXPECT_EQ(found->imsi, a);
+    EXPECT_EQ(found->peer_teid, 101u);
+
+    EXPECT_TRUE(tunnels.close(ta));
+    EXPECT_FALSE(tunnels.close(ta));
+    EXPECT_FALSE(tunnels.find(ta));
+    EXPECT_EQ(tunnels.size(), 1u);
+}
@@ -0,0 +1,117 @@
+#include <gtest/gtest.h>
+#include "pgw/http_api.hpp"
+#include "pgw/sqlite_session_store.hpp"
+#include "pgw/tiered_session_store.hpp"
+#include <spdlog/spdlog.h>
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <string>
+
+namespace fs = std::filesystem;
+using namespace pgw;
+
+class HttpApiTest : public ::testing::Test {
+protected:
+    std::string db_path  = "http_api_test.db";
+    std::string cdr_path = "http_api_test_cdr.csv";
+
+    void SetUp() override {
+        remove_files();
+        // Поток сервера повторяет listen, пока не запрошен останов, и логирует каждую попытку
+        spdlog::set_level(spdlog::level::warn);
+    }
+    void TearDown() override {
+        spdlog::set_level(spdlog::level::info);
+        remove_files();
+    }
+
+    void remove_files() {
+        for (const auto& p : { db_path, db_path + "-wal", db_path + "-shm", cdr_path }) {
+            fs::remove(p);
+        }
+    }
+
+    static Imsi imsi_at(size_t i) { return Imsi::from_string(std::to_string(1010000000000ull + i)); }
+
+    size_t count_cdr(const std::string& action) {
+        std::ifstream in(cdr_path);
+        size_t n = 0;
+        for (std::string line; std::getline(in, line);) {
+            n += line.find("," + action) != std::string::npos;
+        }
+        return n;
+    }
+
+    // Останов тем же путём, что GET /stop; join() возвращает после выгрузки сессий
+    static void stop_through_api(SessionManager& sessions, bool& udp_stopped) {
+        HttpApi http(0, sessions, [&] { udp_stopped = true; }, 1000);
+        http.start();
+        EXPECT_TRUE(http.request_stop());
+        EXPECT_FALSE(http.request_stop());
+        http.join();
+        EXPECT_TRUE(sessions.list_sessions().empty());
+    }
+};
+
+// Останов через API не завершает процесс: после join() деструкторы фиксируют отложенную
+// запись SQLite (удаления выгруженных сессий) и CdrWriter дописывает CDR
+TEST_F(HttpApiTest, StopFlushesWriteBehindStore) {
+    constexpr size_t kSessions = 20;
+    bool udp_stopped = false;
+    {
+        CdrWriter cdr(cdr_path);
+        SqliteStoreOptions options;
+        options.commit_interval = std::chrono::hours(1);
+        SqliteSessionStore* store = nullptr;
+        // Как в main.cpp: хранилище SQLite — один шард
+        SessionManager sessions(std::chrono::seconds(60),
+                                [&](size_t) {
+                                    auto s = std::make_unique<SqliteSessionStore>(db_path, options);
+                                    store = s.get();
+                                    return s;
+                                },
+                                1, cdr);
+        for (size_t i = 0; i < kSessions; ++i) {
+            ASSERT_TRUE(sessions.touch_session(imsi_at(i)));
+        }
+        ASSERT_NE(store, nullptr);
+        ASSERT_TRUE(store->flush());  // Сессии в базе; удаления при выгрузке останутся отложенными
+
+        stop_through_api(sessions, udp_stopped);
+    }
+    EXPECT_TRUE(udp_stopped);
+
+    SqliteSessionStore reader(db_path);
+    EXPECT_TRUE(reader.load_sessions(0).empty());
+    EXPECT_EQ(count_cdr("expired"), kSessions);
+}
+
+// То же для многоуровневого хранилища: удаления выгруженных сессий записывает в базу
+// последняя пачка SessionWriteBack при его разрушении
+TEST_F(HttpApiTest, StopFlushesTieredWriteBack) {
+    constexpr size_t kShards   = 4;
+    constexpr size_t kSessions = 40;
+    bool udp_stopped = false;
+    {
+        CdrWriter cdr(cdr_path);
+        TieredStoreOptions options;
+        options.writeback_interval = std::chrono::hours(1);
+        auto wb = std::make_shared<SessionWriteBack>(std::make_unique<SqliteSessionStore>(db_path), kShards, options);
+        SessionManager sessions(std::chrono::seconds(60),
+                                [wb](size_t shard) { return std::make_unique<TieredSessionStore>(wb, shard); },
+                                kShards, cdr);
+        for (size_t i = 0; i < kSessions; ++i) {
+            ASSERT_TRUE(sessions.touch_session(imsi_at(i)));
+        }
+        ASSERT_TRUE(wb->flush());
+        ASSERT_EQ(wb->cold().load_sessions(0).size(), kSessions);
+
+        stop_through_api(sessions, udp_stopped);
+    }
+    EXPECT_TRUE(udp_stopped);
+
+    SqliteSessionStore reader(db_path);
+    EXPECT_TRUE(reader.load_sessions(0).empty());
+    EXPECT_EQ(count_cdr("expired"), kSessions);
+}
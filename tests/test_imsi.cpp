@@ -0,0 +1,72 @@
+#include <gtest/gtest.h>
+#include "pgw/imsi.hpp"
+#include <array>
+#include <unordered_set>
+
+using namespace pgw;
+
+// Тестируем разбор BCD с провода: 15 цифр, последний полубайт — заполнитель 0xF
+TEST(ImsiTest, FromBcdFifteenDigits) {
+    // 001010123456789 → 00 01 01 21 43 65 87 F9
+    std::array<uint8_t, 8> bcd{0x00, 0x01, 0x01, 0x21, 0x43, 0x65, 0x87, 0xF9};
+    Imsi imsi = Imsi::from_bcd(bcd.data(), bcd.size());
+
+    ASSERT_TRUE(imsi.valid());
+    EXPECT_EQ(imsi.digits(), 15u);
+    EXPECT_EQ(imsi.to_string(), "001010123456789");
+    EXPECT_EQ(imsi, Imsi::from_string("001010123456789"));
+    EXPECT_EQ(imsi.packed(), 0xF001010123456789ull);
+}
+
+// Тестируем, что to_bcd и from_bcd взаимно обратны, в том числе для чётного числа цифр и короткой нагрузки
+TEST(ImsiTest, BcdRoundTrip) {
+    for (const char* s : {"001010123456789", "12345678901234", "1", "99"}) {
+        Imsi imsi = Imsi::from_string(s);
+        ASSERT_TRUE(imsi.valid()) << s;
+
+        uint8_t bcd[8];
+        size_t n = imsi.to_bcd(bcd);
+        EXPECT_EQ(Imsi::from_bcd(bcd, n), imsi) << s;
+        EXPECT_EQ(Imsi::from_bcd(bcd, n).to_string(), s);
+    }
+}
+
+// Тестируем, что ведущие нули значимы
+TEST(ImsiTest, LeadingZerosAreSignificant) {
+    EXPECT_NE(Imsi::from_string("0010101"), Imsi::from_string("10101"));
+    EXPECT_EQ(Imsi::from_string("0010101").to_string(), "0010101");
+}
+
+// Тестируем отказ на недопустимых данных
+TEST(ImsiTest, RejectsMalformedInput) {
+    EXPECT_FALSE(Imsi::from_string("").valid());
+    EXPECT_FALSE(Imsi::from_string("1234567890123456").valid());  // 16 цифр
+    EXPECT_FALSE(Imsi::from_string("12345abc").valid());
+
+    uint8_t filler_only[2] = {0xFF, 0xFF};
+    EXPECT_FALSE(Imsi::from_bcd(filler_only, sizeof(filler_only)).valid());
+
+    uint8_t bad_digit[2] = {0x1A, 0xF2};  // полубайт 0xA
+    EXPECT_FALSE(Imsi::from_bcd(bad_digit, sizeof(bad_digit)).valid());
+
+    uint8_t sixteen_digits[8] = {0x21, 0x43, 0x65, 0x87, 0x09, 0x21, 0x43, 0x65};
+    EXPECT_FALSE(Imsi::from_bcd(sixteen_digits, sizeof(sixteen_digits)).valid());
+
+    EXPECT_FALSE(Imsi::from_bcd(nullptr, 0).valid());
+
+    // Датаграмма из 9 байт — не IMSI, даже если первые 8 байт им были бы
+    uint8_t nine_bytes[9] = {0x00, 0x01, 0x21, 0x43, 0x65, 0x87, 0x09, 0xF1, 0x00};
+    ASSERT_TRUE(Imsi::from_bcd(nine_bytes, 8).valid());
+    EXPECT_FALSE(Imsi::from_bcd(nine_bytes, sizeof(nine_bytes)).valid());
+}
+
+// Тестируем использование в качестве ключа и форматирование для логов
+TEST(ImsiTest, HashAndFormat) {
+    std::unordered_set<Imsi> set;
+    set.insert(Imsi::from_string("001010000000001"));
+    set.insert(Imsi::from_string("001010000000001"));
+    set.insert(Imsi::from_string("001010000000002"));
+    EXPECT_EQ(set.size(), 2u);
+
+    EXPECT_EQ(fmt::format("IMSI {}", Imsi::from_string("001010000000001")), "IMSI 001010000000001");
+}
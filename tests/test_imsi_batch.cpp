@@ -0,0 +1,73 @@
+#include <gtest/gtest.h>
+#include "pgw/imsi_batch.hpp"
+#include <cstring>
+#include <random>
+#include <vector>
+
+using namespace pgw;
+
+// Случайные 8-байтовые BCD-поля: валидные IMSI разной длины и испорченные
+static std::vector<uint8_t> make_lanes(size_t count) {
+    std::mt19937_64 rng(42);
+    std::vector<uint8_t> lanes(count * 8);
+    for (size_t i = 0; i < count; ++i) {
+        uint8_t* lane = lanes.data() + 8 * i;
+        size_t digits = 1 + rng() % 15;
+        std::string s;
+        for (size_t d = 0; d < digits; ++d) s.push_back(char('0' + rng() % 10));
+        std::memset(lane, 0xFF, 8);
+        Imsi::from_string(s).to_bcd(lane);
+
+        switch (rng() % 6) {
+        case 0: lane[rng() % 8] = uint8_t(rng()); break;  // Случайный байт
+        case 1: std::memset(lane, 0xFF, 8); break;         // Только заполнитель
+        default: break;
+        }
+    }
+    return lanes;
+}
+
+// Тестируем, что AVX2 и скалярное ядро дают побитно одинаковый результат и совпадают с Imsi::from_bcd8
+TEST(ImsiBatchTest, KernelsAgree) {
+    const size_t count = 1003;  // Не кратно 4 и 64: проверяем хвост
+    auto lanes = make_lanes(count);
+
+    std::vector<Imsi> scalar(count), simd(count);
+    std::vector<uint64_t> scalar_mask((count + 63) / 64), simd_mask((count + 63) / 64);
+
+    size_t scalar_valid = decode_bcd_batch(BcdKernel::Scalar, lanes.data(), count, scalar.data(), scalar_mask.data());
+    size_t simd_valid   = decode_bcd_batch(BcdKernel::Avx2, lanes.data(), count, simd.data(), simd_mask.data());
+
+    EXPECT_EQ(scalar_valid, simd_valid);
+    EXPECT_EQ(scalar_mask, simd_mask);
+    size_t invalid = 0;
+    for (size_t i = 0; i < count; ++i) {
+        Imsi expected = Imsi::from_bcd8(lanes.data() + 8 * i);
+        ASSERT_EQ(scalar[i], expected) << "lane " << i;
+        ASSERT_EQ(simd[i], expected) << "lane " << i;
+        EXPECT_EQ(bool(simd_mask[i / 64] >> (i % 64) & 1), expected.valid());
+        invalid += !expected.valid();
+    }
+    // В наборе есть и валидные, и невалидные номера
+    EXPECT_GT(invalid, 0u);
+    EXPECT_GT(scalar_valid, count / 2);
+}
+
+// Тестируем разбор известных значений и маску валидности
+TEST(ImsiBatchTest, DecodesKnownValues) {
+    const uint8_t lanes[4][8] = {
+        {0x00, 0x01, 0x01, 0x21, 0x43, 0x65, 0x87, 0xF9},  // 001010123456789
+        {0x21, 0xF3, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF},  // 123
+        {0x21, 0xA3, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF},  // недопустимая цифра 0xA
+        {0x21, 0x43, 0x65, 0x87, 0x09, 0x21, 0x43, 0x65},  // 16 цифр
+    };
+    Imsi out[4];
+    uint64_t mask = ~0ull;
+
+    EXPECT_EQ(decode_bcd_batch(&lanes[0][0], 4, out, &mask), 2u);
+    EXPECT_EQ(mask, 0b0011u);
+    EXPECT_EQ(out[0].to_string(), "001010123456789");
+    EXPECT_EQ(out[1].to_string(), "123");
+    EXPECT_FALSE(out[2].valid());
+    EXPECT_FALSE(out[3].valid());
+}
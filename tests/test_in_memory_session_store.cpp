@@ -4,11 +4,18 @@
 
 using namespace pgw;
 
+// Дата "YYYY-MM-DD" → Unix-время (мс) начала суток
+static EpochMs day(const std::string& date) {
+    EpochMs ms = 0;
+    EXPECT_TRUE(parse_timestamp(date + " 00:00:00", ms));
+    return ms;
+}
+
 // Создаем фиктивные данные сессий
 StoredSession make_session(const std::string& imsi, const std::string& expires_at) {
     StoredSession session;
-    session.imsi = imsi;  // Прямо передаем строку
-    session.expires_at = expires_at;
+    session.imsi = Imsi::from_string(imsi);  // Упаковываем строку в 64-битный IMSI
+    session.expires_at = day(expires_at);
     return session;
 }
 
@@ -25,17 +32,17 @@ TEST(InMemorySessionStoreTest_MEMORY, SaveAndDeleteSession_MEMORY) {
     EXPECT_TRUE(store.save_session(session2));
 
     // Проверяем, что сессии существуют
-    EXPECT_TRUE(store.session_exists("123456789012345"));
-    EXPECT_TRUE(store.session_exists("987654321012345"));
+    EXPECT_TRUE(store.session_exists(Imsi::from_string("123456789012345")));
+    EXPECT_TRUE(store.session_exists(Imsi::from_string("987654321012345")));
 
     // Удаляем одну сессию и проверяем
-    EXPECT_TRUE(store.delete_session("123456789012345"));
-    EXPECT_FALSE(store.session_exists("123456789012345"));
-    EXPECT_TRUE(store.session_exists("987654321012345"));
+    EXPECT_TRUE(store.delete_session(Imsi::from_string("123456789012345")));
+    EXPECT_FALSE(store.session_exists(Imsi::from_string("123456789012345")));
+    EXPECT_TRUE(store.session_exists(Imsi::from_string("987654321012345")));
 
     // Удаляем последнюю сессию и проверяем
-    EXPECT_TRUE(store.delete_session("987654321012345"));
-    EXPECT_FALSE(store.session_exists("987654321012345"));
+    EXPECT_TRUE(store.delete_session(Imsi::from_string("987654321012345")));
+    EXPECT_FALSE(store.session_exists(Imsi::from_string("987654321012345")));
 }
 
 TEST(InMemorySessionStoreTest_MEMORY, LoadActiveSessions_MEMORY) {
@@ -47,7 +54,7 @@ TEST(InMemorySessionStoreTest_MEMORY, LoadActiveSessions_MEMORY) {
     store.save_session(make_session("111223344556677", "2024-01-01"));
 
     // Загружаем активные сессии для даты "2023-01-01"
-    auto active_sessions = store.load_sessions("2023-01-01");
+    auto active_sessions = store.load_sessions(day("2023-01-01"));
 
     // Проверяем, что в списке активных сессий только те, что не просрочены
     ASSERT_EQ(active_sessions.size(), 2);
@@ -56,7 +63,7 @@ TEST(InMemorySessionStoreTest_MEMORY, LoadActiveSessions_MEMORY) {
     std::vector<std::string> expected_imsi = {"123456789012345", "111223344556677"};
     std::vector<std::string> actual_imsi;
     for (const auto& session : active_sessions) {
-        actual_imsi.push_back(session.imsi);  // Теперь это строка
+        actual_imsi.push_back(session.imsi.to_string());
     }
 
     // Сравниваем наборы имси (без учета порядка)
@@ -76,11 +83,11 @@ TEST(InMemorySessionStoreTest_MEMORY, LoadExpiredSessions_MEMORY) {
     store.save_session(make_session("111223344556677", "2024-01-01"));
 
     // Загружаем просроченные сессии для даты "2023-01-01"
-    auto expired_sessions = store.load_expired_sessions("2023-01-01");
+    auto expired_sessions = store.load_expired_sessions(day("2023-01-01"));
 
     // Проверяем, что в списке просроченных сессий только те, что просрочены
     ASSERT_EQ(expired_sessions.size(), 1);
-    EXPECT_EQ(expired_sessions[0].imsi, "987654321012345");
+    EXPECT_EQ(expired_sessions[0].imsi.to_string(), "987654321012345");
 }
 
 // Тестируем удаление просроченных сессий в памяти
@@ -93,10 +100,79 @@ TEST(InMemorySessionStoreTest_MEMORY, CleanupExpiredSessions_MEMORY) {
     store.save_session(make_session("111223344556677", "2024-01-01"));
 
     // Убираем просроченные сессии для даты "2023-01-01"
-    store.cleanup_expired_sessions("2023-01-01");
+    store.cleanup_expired_sessions(day("2023-01-01"));
 
     // Проверяем, что остались только актуальные сессии
-    EXPECT_TRUE(store.session_exists("123456789012345"));
-    EXPECT_FALSE(store.session_exists("987654321012345"));
-    EXPECT_TRUE(store.session_exists("111223344556677"));
+    EXPECT_TRUE(store.session_exists(Imsi::from_string("123456789012345")));
+    EXPECT_FALSE(store.session_exists(Imsi::from_string("987654321012345")));
+    EXPECT_TRUE(store.session_exists(Imsi::from_string("111223344556677")));
+}
+
+// Тестируем точечный поиск сессии вместе со сроком
+TEST(InMemorySessionStoreTest_MEMORY, GetSession_MEMORY) {
+    InMemorySessionStore store;
+    store.save_session(make_session("123456789012345", "2023-12-31"));
+    store.save_session(make_session("987654321012345", "2022-01-01"));
+
+    auto s = store.get_session(Imsi::from_string("123456789012345"));
+    ASSERT_TRUE(s.has_value());
+    EXPECT_EQ(s->imsi.to_string(), "123456789012345");
+    EXPECT_EQ(s->expires_at, day("2023-12-31"));
+
+    // Просроченная сессия тоже возвращается: решение о сроке принимает вызывающий
+    EXPECT_TRUE(store.get_session(Imsi::from_string("987654321012345")).has_value());
+    EXPECT_FALSE(store.get_session(Imsi::from_string("111223344556677")).has_value());
+}
+
+// Тестируем upsert: первый вызов создаёт сессию, повторный продлевает, не трогая created_at
+TEST(InMemorySessionStoreTest_MEMORY, Upsert_MEMORY) {
+    InMemorySessionStore store;
+    StoredSession s = make_session("123456789012345", "2023-12-31");
+    s.created_at = day("2023-01-01");
+    EXPECT_EQ(store.upsert(s), UpsertResult::Created);
+
+    StoredSession again = make_session("123456789012345", "2024-06-30");
+    again.created_at = day("2024-01-01");
+    EXPECT_EQ(store.upsert(again), UpsertResult::Refreshed);
+
+    auto found = store.get_session(s.imsi);
+    ASSERT_TRUE(found.has_value());
+    EXPECT_EQ(found->created_at, day("2023-01-01"));
+    EXPECT_EQ(found->expires_at, day("2024-06-30"));
+}
+
+// Тестируем пакетные формы: результаты в порядке входа, повтор IMSI в пачке видит предыдущий
+TEST(InMemorySessionStoreTest_MEMORY, BatchOperations_MEMORY) {
+    InMemorySessionStore store;
+    store.save_session(make_session("111223344556677", "2023-12-31"));
+
+    std::vector<StoredSession> batch = {
+        make_session("123456789012345", "2024-01-01"),
+        make_session("111223344556677", "2024-01-01"),
+        make_session("123456789012345", "2024-02-01"),
+    };
+    auto results = store.upsert_batch(batch);
+    ASSERT_EQ(results.size(), 3u);
+    EXPECT_EQ(results[0], UpsertResult::Created);
+    EXPECT_EQ(results[1], UpsertResult::Refreshed);
+    EXPECT_EQ(results[2], UpsertResult::Refreshed);
+
+    std::vector<Imsi> imsis = {
+        Imsi::from_string("123456789012345"),
+        Imsi::from_string("987654321012345"),
+        Imsi::from_string("111223344556677"),
+    };
+    auto found = store.lookup_batch(imsis);
+    ASSERT_EQ(found.size(), 3u);
+    ASSERT_TRUE(found[0].has_value());
+    EXPECT_EQ(found[0]->expires_at, day("2024-02-01"));
+    EXPECT_FALSE(found[1].has_value());
+    ASSERT_TRUE(found[2].has_value());
+    EXPECT_EQ(found[2]->expires_at, day("2024-01-01"));
+
+    // Удалённых — только те, что были в хранилище
+    EXPECT_EQ(store.delete_batch(imsis), 2u);
+    EXPECT_FALSE(store.session_exists(imsis[0]));
+    EXPECT_FALSE(store.session_exists(imsis[2]));
+    EXPECT_EQ(store.delete_batch({}), 0u);
 }
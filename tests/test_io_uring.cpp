@@ -0,0 +1,86 @@
+#include <gtest/gtest.h>
+#include "pgw/io_uring.hpp"
+#include <arpa/inet.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <system_error>
+
+using namespace pgw;
+
+// Создаёт кольцо или пропускает тест, если ядро не поддерживает io_uring
+static std::unique_ptr<IoUring> make_ring_or_skip() {
+    try {
+        auto ring = std::make_unique<IoUring>(8, 64);
+        ring->setup_buffers(0, 4, 64);
+        return ring;
+    } catch (const std::system_error&) {
+        return nullptr;
+    }
+}
+
+// Тестируем, что multishot recvmsg раскладывает датаграммы по предоставленным буферам,
+// а возвращённый буфер снова доступен ядру
+TEST(IoUringTest, MultishotRecvUsesProvidedBuffers) {
+    auto ring = make_ring_or_skip();
+    if (!ring)
+        GTEST_SKIP() << "io_uring is not supported";
+
+    int s = ::socket(AF_INET, SOCK_DGRAM, 0);
+    ASSERT_GE(s, 0);
+    sockaddr_in addr{};
+    addr.sin_family = AF_INET;
+    inet_pton(AF_INET, "127.0.0.1", &addr.sin_addr);
+    ASSERT_EQ(::bind(s, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)), 0);
+    socklen_t len = sizeof(addr);
+    ASSERT_EQ(::getsockname(s, reinterpret_cast<sockaddr*>(&addr), &len), 0);
+
+    int client = ::socket(AF_INET, SOCK_DGRAM, 0);
+    ASSERT_GE(client, 0);
+
+    msghdr recv_msg{};
+    recv_msg.msg_namelen = sizeof(sockaddr_in);
+    io_uring_sqe* sqe = ring->get_sqe();
+    ASSERT_NE(sqe, nullptr);
+    sqe->opcode    = IORING_OP_RECVMSG;
+    sqe->fd        = s;
+    sqe->addr      = reinterpret_cast<uint64_t>(&recv_msg);
+    sqe->len       = 1;
+    sqe->ioprio    = IORING_RECV_MULTISHOT;
+    sqe->flags     = IOSQE_BUFFER_SELECT;
+    sqe->buf_group = 0;
+    sqe->user_data = 1;
+
+    // Буферов 4, датаграмм 6: без возврата буферов ядру последние две не поместились бы
+    for (int i = 0; i < 6; ++i) {
+        std::string payload = "msg" + std::to_string(i);
+        ASSERT_EQ(::sendto(client, payload.data(), payload.size(), 0,
+                           reinterpret_cast<sockaddr*>(&addr), sizeof(addr)),
+                  static_cast<ssize_t>(payload.size()));
+
+        ASSERT_GE(ring->submit_and_wait(1), 0);
+        ASSERT_GE(ring->cq_ready(), 1u);
+        io_uring_cqe* cqe = ring->cqe_at(0);
+        if (cqe->res == -EINVAL) {
+            GTEST_SKIP() << "multishot recvmsg is not supported";
+        }
+        ASSERT_GT(cqe->res, 0) << std::strerror(-cqe->res);
+        ASSERT_TRUE(cqe->flags & IORING_CQE_F_BUFFER);
+        EXPECT_TRUE(cqe->flags & IORING_CQE_F_MORE);
+
+        auto bid = static_cast<uint16_t>(cqe->flags >> IORING_CQE_BUFFER_SHIFT);
+        uint8_t* buf = ring->buffer(bid);
+        auto* out = reinterpret_cast<io_uring_recvmsg_out*>(buf);
+        const char* data = reinterpret_cast<const char*>(buf + sizeof(io_uring_recvmsg_out) + recv_msg.msg_namelen);
+        EXPECT_EQ(std::string(data, out->payloadlen), payload);
+
+        ring->cq_advance(1);
+        ring->recycle_buffer(bid);
+        ring->commit_buffers();
+    }
+
+    ::close(client);
+    ::close(s);
+}
@@ -0,0 +1,74 @@
+#include <gtest/gtest.h>
+#include "pgw/mpmc_ring.hpp"
+#include <atomic>
+#include <cstdint>
+#include <thread>
+#include <vector>
+
+using namespace pgw;
+
+// Тестируем порядок FIFO и отказ при переполнении
+TEST(MpmcRingTest, FifoAndFullQueue) {
+    MpmcRing<int> ring(3);  // Округляется до 4
+    EXPECT_EQ(ring.capacity(), 4u);
+
+    for (int i = 0; i < 4; ++i) {
+        EXPECT_TRUE(ring.try_push(i));
+    }
+    EXPECT_FALSE(ring.try_push(99));
+    EXPECT_EQ(ring.size(), 4u);
+
+    int v = -1;
+    for (int i = 0; i < 4; ++i) {
+        ASSERT_TRUE(ring.try_pop(v));
+        EXPECT_EQ(v, i);
+    }
+    EXPECT_FALSE(ring.try_pop(v));
+    EXPECT_EQ(ring.size(), 0u);
+
+    // После оборота кольца ячейки снова доступны
+    EXPECT_TRUE(ring.try_push(5));
+    ASSERT_TRUE(ring.try_pop(v));
+    EXPECT_EQ(v, 5);
+}
+
+// Тестируем, что при нескольких производителях и потребителях каждый элемент извлекается ровно один раз
+TEST(MpmcRingTest, ConcurrentProducersAndConsumers) {
+    constexpr int kProducers = 4;
+    constexpr int kConsumers = 4;
+    constexpr uint64_t kPerProducer = 50000;
+
+    MpmcRing<uint64_t> ring(1024);
+    std::atomic<uint64_t> sum{0};
+    std::atomic<uint64_t> popped{0};
+
+    std::vector<std::thread> threads;
+    for (int p = 0; p < kProducers; ++p) {
+        threads.emplace_back([&ring, p] {
+            for (uint64_t i = 1; i <= kPerProducer; ++i) {
+                uint64_t value = uint64_t(p) * kPerProducer + i;
+                while (!ring.try_push(value)) {
+                    std::this_thread::yield();
+                }
+            }
+        });
+    }
+    for (int c = 0; c < kConsumers; ++c) {
+        threads.emplace_back([&] {
+            uint64_t v;
+            while (popped.load() < kProducers * kPerProducer) {
+                if (ring.try_pop(v)) {
+                    sum.fetch_add(v);
+                    popped.fetch_add(1);
+                } else {
+                    std::this_thread::yield();
+                }
+            }
+        });
+    }
+    for (auto& t : threads) t.join();
+
+    const uint64_t n = kProducers * kPerProducer;
+    EXPECT_EQ(popped.load(), n);
+    EXPECT_EQ(sum.load(), n * (n + 1) / 2);
+}
@@ -0,0 +1,60 @@
+#include <gtest/gtest.h>
+#include "pgw/overload_controller.hpp"
+
+using namespace pgw;
+using namespace std::chrono_literals;
+
+// Тестируем вход в перегрузку по очереди и выход только ниже нижнего порога (гистерезис)
+TEST(OverloadControllerTest, QueueHysteresis) {
+    OverloadController c(OverloadThresholds{});
+
+    EXPECT_FALSE(c.update({0.5, 0.0, 0}));
+    EXPECT_TRUE(c.update({0.8, 0.0, 0}));
+    EXPECT_EQ(c.state().reason, "queue");
+
+    // Между порогами состояние сохраняется
+    EXPECT_TRUE(c.update({0.5, 0.0, 0}));
+    EXPECT_FALSE(c.update({0.1, 0.0, 0}));
+    EXPECT_EQ(c.state().reason, "");
+    EXPECT_EQ(c.state().transitions, 1u);
+}
+
+// Тестируем, что рост счётчика потерь сокета сразу означает перегрузку
+TEST(OverloadControllerTest, SocketDropsTriggerOverload) {
+    OverloadController c(OverloadThresholds{});
+
+    EXPECT_FALSE(c.update({0.0, 0.0, 100}));  // Первая выборка — только точка отсчёта
+    EXPECT_FALSE(c.update({0.0, 0.0, 100}));
+    EXPECT_TRUE(c.update({0.0, 0.0, 150}));
+    EXPECT_EQ(c.state().reason, "socket_drops");
+    EXPECT_FALSE(c.update({0.0, 0.0, 150}));
+}
+
+// Тестируем сглаженную задержку хранилища
+TEST(OverloadControllerTest, StoreLatency) {
+    OverloadThresholds t;
+    t.latency_high = 10ms;
+    t.latency_low  = 1ms;
+    OverloadController c(t);
+
+    for (int i = 0; i < 200; ++i) c.record_store_latency(50ms);
+    EXPECT_TRUE(c.update({}));
+    EXPECT_EQ(c.state().reason, "store_latency");
+
+    for (int i = 0; i < 200; ++i) c.record_store_latency(100us);
+    EXPECT_FALSE(c.update({}));
+    EXPECT_LT(c.state().store_latency_us, 1000u);
+}
+
+// Тестируем сериализацию состояния для HTTP
+TEST(OverloadControllerTest, StateToJson) {
+    OverloadController c(OverloadThresholds{});
+    c.update({0.9, 0.3, 7});
+    c.count_shed();
+
+    nlohmann::json j = c.state();
+    EXPECT_TRUE(j["overloaded"].get<bool>());
+    EXPECT_EQ(j["shed"].get<uint64_t>(), 1u);
+    EXPECT_EQ(j["socket_drops"].get<uint64_t>(), 7u);
+    EXPECT_DOUBLE_EQ(j["thresholds"]["queue_high"].get<double>(), 0.75);
+}
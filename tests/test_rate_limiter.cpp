@@ -0,0 +1,68 @@
+#include <gtest/gtest.h>
+#include "pgw/rate_limiter.hpp"
+#include <stdexcept>
+
+using namespace pgw;
+
+static constexpr uint64_t kSecond = 1'000'000'000ull;
+
+// Тестируем, что источник получает burst пакетов сразу, затем — по одному за интервал
+TEST(RateLimiterTest, BurstThenSteadyRate) {
+    RateLimiter limiter(100.0, 5);  // 100 пакетов/с, интервал 10 мс
+    const uint32_t ip = 0x0100007F;
+    uint64_t now = kSecond;
+
+    for (int i = 0; i < 5; ++i) {
+        EXPECT_TRUE(limiter.allow(ip, now)) << "packet " << i;
+    }
+    EXPECT_FALSE(limiter.allow(ip, now));
+
+    // Через 10 мс освобождается ровно один маркер
+    now += kSecond / 100;
+    EXPECT_TRUE(limiter.allow(ip, now));
+    EXPECT_FALSE(limiter.allow(ip, now));
+
+    // После долгой паузы корзина снова полна, но не больше burst
+    now += 10 * kSecond;
+    for (int i = 0; i < 5; ++i) {
+        EXPECT_TRUE(limiter.allow(ip, now));
+    }
+    EXPECT_FALSE(limiter.allow(ip, now));
+}
+
+// Тестируем, что источники не мешают друг другу
+TEST(RateLimiterTest, SourcesAreIndependent) {
+    RateLimiter limiter(1.0, 1);
+    uint64_t now = kSecond;
+
+    EXPECT_TRUE(limiter.allow(1, now));
+    EXPECT_FALSE(limiter.allow(1, now));
+    EXPECT_TRUE(limiter.allow(2, now));
+    EXPECT_TRUE(limiter.allow(3, now));
+    EXPECT_FALSE(limiter.allow(2, now));
+}
+
+// Тестируем вытеснение: при переполнении таблицы уходит запись с самым ранним TAT,
+// а источник, исчерпавший запас, остаётся в таблице и продолжает ограничиваться
+TEST(RateLimiterTest, EvictsIdleSources) {
+    RateLimiter limiter(1.0, 5, RateLimiter::kWays);  // Один набор из четырёх записей
+    EXPECT_EQ(limiter.capacity(), RateLimiter::kWays);
+    uint64_t now = kSecond;
+
+    const uint32_t active = 100;
+    while (limiter.allow(active, now)) {}
+
+    // Новые источники с одним пакетом вытесняют друг друга, но не исчерпавший запас источник
+    for (uint32_t ip = 1; ip <= 16; ++ip) {
+        now += 1000;
+        EXPECT_TRUE(limiter.allow(ip, now));
+        EXPECT_FALSE(limiter.allow(active, now));
+    }
+}
+
+// Тестируем проверку параметров
+TEST(RateLimiterTest, RejectsInvalidParameters) {
+    EXPECT_THROW(RateLimiter(0.0, 10), std::invalid_argument);
+    EXPECT_THROW(RateLimiter(-5.0, 10), std::invalid_argument);
+    EXPECT_THROW(RateLimiter(10.0, 0), std::invalid_argument);
+}
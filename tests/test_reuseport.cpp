@@ -0,0 +1,98 @@
+#include <gtest/gtest.h>
+#include "pgw/reuseport.hpp"
+#include <arpa/inet.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <array>
+#include <vector>
+
+using namespace pgw;
+
+// BCD-представление 15-значного IMSI 001010123456XYZ (последняя цифра в младшем полубайте, старший — 0xF)
+static std::array<uint8_t, 8> make_bcd_imsi(int suffix) {
+    std::array<uint8_t, 8> bcd{0x00, 0x01, 0x01, 0x21, 0x43, 0x65, 0x00, 0xF0};
+    int x = suffix / 100 % 10, y = suffix / 10 % 10, z = suffix % 10;
+    bcd[6] = uint8_t((y << 4) | x);
+    bcd[7] = uint8_t(0xF0 | z);
+    return bcd;
+}
+
+// Тестируем, что хеш распределяет абонентов по всем worker'ам
+TEST(ReuseportTest, SteeringSpreadsSubscribers) {
+    const uint32_t workers = 4;
+    std::vector<int> counts(workers, 0);
+    for (int i = 0; i < 1000; ++i) {
+        auto bcd = make_bcd_imsi(i);
+        uint32_t idx = imsi_steering_index(bcd.data(), bcd.size(), workers);
+        ASSERT_LT(idx, workers);
+        ++counts[idx];
+    }
+    // Каждому worker'у должна достаться заметная доля абонентов
+    for (int c : counts) {
+        EXPECT_GT(c, 150);
+    }
+}
+
+// Тестируем, что слишком короткая нагрузка и один worker всегда дают индекс 0
+TEST(ReuseportTest, DegenerateInputsGoToFirstWorker) {
+    uint8_t short_payload[3] = {0x10, 0x32, 0x54};
+    EXPECT_EQ(imsi_steering_index(short_payload, sizeof(short_payload), 4), 0u);
+
+    auto bcd = make_bcd_imsi(123);
+    EXPECT_EQ(imsi_steering_index(bcd.data(), bcd.size(), 1), 0u);
+}
+
+// Тестируем, что ядро выбирает тот же сокет группы SO_REUSEPORT, что и imsi_steering_index
+TEST(ReuseportTest, KernelProgramMatchesUserspaceHash) {
+    const uint32_t workers = 4;
+    std::vector<int> socks;
+
+    sockaddr_in addr{};
+    addr.sin_family = AF_INET;
+    inet_pton(AF_INET, "127.0.0.1", &addr.sin_addr);
+
+    for (uint32_t i = 0; i < workers; ++i) {
+        int s = ::socket(AF_INET, SOCK_DGRAM | SOCK_NONBLOCK, 0);
+        ASSERT_GE(s, 0);
+        int one = 1;
+        ASSERT_EQ(::setsockopt(s, SOL_SOCKET, SO_REUSEPORT, &one, sizeof(one)), 0);
+        ASSERT_EQ(::bind(s, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)), 0);
+        if (i == 0) {
+            // Порт 0 выбирает ядро; остальные сокеты группы привязываются к тому же порту
+            socklen_t len = sizeof(addr);
+            ASSERT_EQ(::getsockname(s, reinterpret_cast<sockaddr*>(&addr), &len), 0);
+        }
+        socks.push_back(s);
+    }
+    if (!attach_imsi_steering(socks[0], workers)) {
+        for (int s : socks) ::close(s);
+        GTEST_SKIP() << "SO_ATTACH_REUSEPORT_CBPF is not supported";
+    }
+
+    int client = ::socket(AF_INET, SOCK_DGRAM, 0);
+    ASSERT_GE(client, 0);
+
+    for (int i = 0; i < 64; ++i) {
+        auto bcd = make_bcd_imsi(i * 7);
+        ASSERT_EQ(::sendto(client, bcd.data(), bcd.size(), 0,
+                           reinterpret_cast<sockaddr*>(&addr), sizeof(addr)),
+                  static_cast<ssize_t>(bcd.size()));
+
+        uint32_t expected = imsi_steering_index(bcd.data(), bcd.size(), workers);
+
+        // Ждём датаграмму на любом из сокетов и проверяем, что пришла в ожидаемый
+        std::vector<pollfd> fds;
+        for (int s : socks) fds.push_back({s, POLLIN, 0});
+        ASSERT_EQ(::poll(fds.data(), fds.size(), 1000), 1);
+        EXPECT_TRUE(fds[expected].revents & POLLIN) << "IMSI #" << i;
+
+        uint8_t buf[16];
+        for (int s : socks) {
+            while (::recv(s, buf, sizeof(buf), 0) > 0) {}
+        }
+    }
+
+    ::close(client);
+    for (int s : socks) ::close(s);
+}
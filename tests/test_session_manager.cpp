@@ -1,10 +1,16 @@
 // test/cdr_writer_test.cpp
 #include <gtest/gtest.h>
 #include "pgw/cdr_writer.hpp"
+#include "pgw/in_memory_session_store.hpp"
+#include "pgw/flat_session_store.hpp"
+#include "pgw/session_manager.hpp"
+#include <algorithm>
 #include <fstream>
 #include <filesystem>
 #include <thread>
 #include <chrono>
+#include <unordered_set>
+#include <vector>
 
 namespace fs = std::filesystem;
 
@@ -31,7 +37,9 @@ protected:
 TEST_F(CdrWriterTest, WriteCdrRecord) {
     pgw::CdrWriter writer(test_file);
 
-    pgw::CdrRecord record = {"2025-07-27 12:00:00", "1234567890", "created"};
+    pgw::EpochMs ts = 0;
+    ASSERT_TRUE(pgw::parse_timestamp("2025-07-27 12:00:00", ts));
+    pgw::CdrRecord record = {ts, pgw::Imsi::from_string("1234567890"), "created"};
     writer.write(record);
 
     // Даем время на запись в файл
@@ -51,7 +59,9 @@ TEST_F(CdrWriterTest, WriteCdrRecord) {
 TEST_F(CdrWriterTest, WriterThreadShutdown) {
     {
         pgw::CdrWriter writer(test_file);
-        pgw::CdrRecord record = {"2025-07-27 12:01:00", "0987654321", "expired"};
+        pgw::EpochMs ts = 0;
+        ASSERT_TRUE(pgw::parse_timestamp("2025-07-27 12:01:00", ts));
+        pgw::CdrRecord record = {ts + 999, pgw::Imsi::from_string("0987654321"), "expired"};
         writer.write(record);
 
         // Даем время на запись
@@ -69,6 +79,27 @@ TEST_F(CdrWriterTest, WriterThreadShutdown) {
     ASSERT_EQ(line, "2025-07-27 12:01:00,0987654321,expired");
 }
 
+// Тестируем, что пачка записей попадает в файл целиком и в исходном порядке
+TEST_F(CdrWriterTest, WriteBatchKeepsOrder) {
+    {
+        pgw::CdrWriter writer(test_file);
+        std::vector<pgw::CdrRecord> batch;
+        for (int i = 0; i < 100; ++i) {
+            batch.push_back({ 0, pgw::Imsi::from_string(std::to_string(1000 + i)), "expired" });
+        }
+        writer.write_batch(batch);
+    }
+
+    std::ifstream file(test_file);
+    std::string line;
+    int n = 0;
+    while (std::getline(file, line)) {
+        EXPECT_NE(line.find("," + std::to_string(1000 + n) + ",expired"), std::string::npos) << line;
+        ++n;
+    }
+    EXPECT_EQ(n, 100);
+}
+
 // Тест на пустой путь
 TEST_F(CdrWriterTest, NoFilePath) {
     // Проверяем, что выбрасывается исключение при пустом пути
@@ -76,3 +107,408 @@ TEST_F(CdrWriterTest, NoFilePath) {
         pgw::CdrWriter writer(""); // передаем пустую строку вместо пути
     }, std::invalid_argument);  // ожидаем исключение std::invalid_argument
 }
+
+// Тесты шардированного менеджера сессий
+class ShardedSessionManagerTest : public ::testing::Test {
+protected:
+    std::string cdr_file = "test_sharded_cdr.csv";
+    std::vector<pgw::InMemorySessionStore*> stores;  // Разделы по номерам шардов
+
+    pgw::SessionStoreFactory factory() {
+        return [this](size_t shard) {
+            auto store = std::make_unique<pgw::InMemorySessionStore>();
+            if (stores.size() <= shard) stores.resize(shard + 1);
+            stores[shard] = store.get();
+            return store;
+        };
+    }
+
+    static pgw::Imsi imsi_at(size_t i) {
+        return pgw::Imsi::from_string(std::to_string(1010000000000ull + i));
+    }
+
+    void TearDown() override {
+        if (fs::exists(cdr_file)) {
+            fs::remove(cdr_file);
+        }
+    }
+};
+
+// Тестируем округление числа шардов и отказ от нуля
+TEST_F(ShardedSessionManagerTest, ShardCount) {
+    pgw::CdrWriter cdr(cdr_file);
+    {
+        pgw::SessionManager sessions(std::chrono::seconds(30), factory(), 6, cdr);
+        EXPECT_EQ(sessions.shard_count(), 8u);
+        EXPECT_EQ(stores.size(), 8u);
+    }
+    EXPECT_THROW(pgw::SessionManager(std::chrono::seconds(30), factory(), 0, cdr), std::invalid_argument);
+}
+
+// Тестируем, что каждая сессия попадает ровно в один раздел, а список собирается со всех шардов
+TEST_F(ShardedSessionManagerTest, PartitionsSessionsByImsi) {
+    pgw::CdrWriter cdr(cdr_file);
+    pgw::SessionManager sessions(std::chrono::seconds(30), factory(), 4, cdr);
+
+    const size_t count = 200;
+    for (size_t i = 0; i < count; ++i) {
+        EXPECT_TRUE(sessions.touch_session(imsi_at(i)));
+    }
+
+    size_t stored = 0;
+    for (size_t i = 0; i < count; ++i) {
+        size_t owners = 0;
+        for (auto* store : stores) {
+            owners += store->session_exists(imsi_at(i)) ? 1 : 0;
+        }
+        EXPECT_EQ(owners, 1u);
+        EXPECT_TRUE(sessions.is_active(imsi_at(i)));
+    }
+    for (auto* store : stores) {
+        size_t part = store->load_sessions(0).size();
+        EXPECT_GT(part, 0u);  // 200 абонентов на 4 шарда — пустых быть не должно
+        stored += part;
+    }
+    EXPECT_EQ(stored, count);
+    EXPECT_EQ(sessions.list_sessions().size(), count);
+
+    // Точечный поиск возвращает сроки сессии
+    auto before = pgw::epoch_ms_now();
+    auto s = sessions.get_session(imsi_at(0));
+    ASSERT_TRUE(s.has_value());
+    EXPECT_EQ(s->imsi, imsi_at(0));
+    EXPECT_LE(s->created_at, before + 10);
+    EXPECT_NEAR(double(s->expires_at - s->created_at), 30000.0, 1.0);
+
+    EXPECT_TRUE(sessions.end_session(imsi_at(0)));
+    EXPECT_FALSE(sessions.end_session(imsi_at(0)));
+    EXPECT_FALSE(sessions.get_session(imsi_at(0)).has_value());
+    EXPECT_FALSE(sessions.is_active(imsi_at(0)));
+    EXPECT_FALSE(sessions.refresh_session(imsi_at(0)));
+    EXPECT_TRUE(sessions.refresh_session(imsi_at(1)));
+}
+
+// Тестируем одновременную работу нескольких потоков с разными абонентами
+TEST_F(ShardedSessionManagerTest, ConcurrentTouch) {
+    pgw::CdrWriter cdr(cdr_file);
+    pgw::SessionManager sessions(std::chrono::seconds(30), factory(), 8, cdr);
+
+    const size_t threads = 4, per_thread = 500;
+    std::vector<std::thread> pool;
+    for (size_t t = 0; t < threads; ++t) {
+        pool.emplace_back([&, t] {
+            for (size_t i = 0; i < per_thread; ++i) {
+                sessions.touch_session(imsi_at(t * per_thread + i));
+                sessions.touch_session(imsi_at(t * per_thread + i));  // Повторное — продление
+            }
+        });
+    }
+    for (auto& th : pool) th.join();
+
+    auto all = sessions.list_sessions();
+    ASSERT_EQ(all.size(), threads * per_thread);
+    std::unordered_set<pgw::Imsi> unique;
+    for (auto& s : all) unique.insert(s.imsi);
+    EXPECT_EQ(unique.size(), all.size());
+}
+
+// Тестируем, что graceful stop выгружает сессии из всех шардов
+TEST_F(ShardedSessionManagerTest, GracefulStopDrainsAllShards) {
+    pgw::CdrWriter cdr(cdr_file);
+    pgw::SessionManager sessions(std::chrono::seconds(30), factory(), 4, cdr);
+
+    for (size_t i = 0; i < 20; ++i) {
+        sessions.touch_session(imsi_at(i));
+    }
+    sessions.graceful_stop(1000);
+    EXPECT_TRUE(sessions.list_sessions().empty());
+    for (auto* store : stores) {
+        EXPECT_TRUE(store->load_sessions(0).empty());
+    }
+}
+
+// Тестируем темп выгрузки и её ход: offload_rate выпускает не больше заданного числа,
+// graceful stop идёт по расписанию маркерной корзины и сообщает, сколько осталось
+TEST_F(ShardedSessionManagerTest, DrainIsPacedAndReportsProgress) {
+    {
+        pgw::CdrWriter cdr(cdr_file);
+        pgw::SessionManager sessions(std::chrono::seconds(30), factory(), 4, cdr);
+        for (size_t i = 0; i < 60; ++i) {
+            sessions.touch_session(imsi_at(i));
+        }
+        EXPECT_FALSE(sessions.drain_progress().active);
+
+        EXPECT_EQ(sessions.offload_rate(10), 10u);
+        EXPECT_EQ(sessions.list_sessions().size(), 50u);
+
+        // 50 сессий по 500 в секунду: первая сразу, остальные через 2 мс — около 98 мс
+        pgw::DrainProgress mid;
+        std::thread watcher([&] {
+            std::this_thread::sleep_for(std::chrono::milliseconds(40));
+            mid = sessions.drain_progress();
+        });
+        auto t0 = std::chrono::steady_clock::now();
+        sessions.graceful_stop(500);
+        auto elapsed = std::chrono::steady_clock::now() - t0;
+        watcher.join();
+
+        EXPECT_GE(elapsed, std::chrono::milliseconds(90));
+        EXPECT_LT(elapsed, std::chrono::milliseconds(1000));
+        EXPECT_TRUE(mid.active);
+        EXPECT_EQ(mid.total, 50u);
+        EXPECT_EQ(mid.rate, 500u);
+        EXPECT_GT(mid.released, 0u);
+        EXPECT_LT(mid.released, 50u);
+        // Счётчики читаются не атомарно вместе: пачка (здесь — одна сессия) может быть в пути
+        EXPECT_GE(mid.released + mid.remaining, 49u);
+        EXPECT_LE(mid.released + mid.remaining, 50u);
+        EXPECT_GT(mid.eta_ms, 0u);
+
+        auto done = sessions.drain_progress();
+        EXPECT_FALSE(done.active);
+        EXPECT_EQ(done.released, 50u);
+        EXPECT_EQ(done.remaining, 0u);
+        EXPECT_GE(done.elapsed_ms, 90u);
+        EXPECT_TRUE(sessions.list_sessions().empty());
+        EXPECT_EQ(sessions.expiry_stats().sessions, 0u);
+    }
+
+    // Каждой выгруженной сессии — ровно один CDR "expired"
+    std::ifstream file(cdr_file);
+    std::unordered_set<std::string> expired;
+    size_t lines = 0;
+    for (std::string line; std::getline(file, line); ) {
+        if (line.ends_with(",expired")) {
+            expired.insert(line.substr(line.find(',')));
+            ++lines;
+        }
+    }
+    EXPECT_EQ(lines, 60u);
+    EXPECT_EQ(expired.size(), 60u);
+}
+
+// Тестируем предел числа сессий: заполненный шард отклоняет новые сессии, но продлевает существующие,
+// а статистика памяти сходится с числом сессий
+TEST_F(ShardedSessionManagerTest, MaxSessionsAndMemoryStats) {
+    pgw::CdrWriter cdr(cdr_file);
+    pgw::SessionManager sessions(std::chrono::seconds(30), factory(), 4, cdr, 40);
+
+    size_t accepted = 0;
+    std::vector<pgw::Imsi> admitted;
+    for (size_t i = 0; i < 200; ++i) {
+        if (sessions.touch_session(imsi_at(i))) {
+            ++accepted;
+            admitted.push_back(imsi_at(i));
+        }
+    }
+    EXPECT_EQ(accepted, 40u);
+    size_t stored = 0;
+    for (auto* store : stores) {
+        stored += store->load_sessions(0).size();
+    }
+    EXPECT_EQ(stored, 40u);
+    for (auto imsi : admitted) {
+        EXPECT_TRUE(sessions.touch_session(imsi));
+    }
+
+    // Пачка: существующие продлеваются, новые отклоняются
+    std::vector<pgw::Imsi> batch = { admitted[0], imsi_at(500), admitted[1] };
+    auto results = sessions.touch_batch(batch);
+    EXPECT_EQ(results[0], pgw::UpsertResult::Refreshed);
+    EXPECT_EQ(results[1], pgw::UpsertResult::Failed);
+    EXPECT_EQ(results[2], pgw::UpsertResult::Refreshed);
+
+    auto m = sessions.memory_stats();
+    EXPECT_EQ(m.max_sessions, 40u);
+    EXPECT_EQ(m.sessions, 40u);
+    EXPECT_EQ(m.rejected, 161u);
+    EXPECT_GT(m.store.bytes_in_use, 0u);
+    EXPECT_GE(m.store.bytes_reserved, m.store.bytes_in_use);
+    EXPECT_GE(m.wheel.bytes_reserved, m.wheel.bytes_in_use);
+    EXPECT_GT(m.bytes_per_session, 0u);
+    EXPECT_GE(m.fragmentation, 0.0);
+    EXPECT_LT(m.fragmentation, 1.0);
+    EXPECT_GT(m.rss_bytes, 0u);
+
+    // Место освобождается с завершением сессии
+    EXPECT_TRUE(sessions.end_session(admitted[0]));
+    size_t reopened = 0;
+    for (size_t i = 200; i < 400 && !reopened; ++i) {
+        reopened += sessions.touch_session(imsi_at(i)) ? 1 : 0;
+    }
+    EXPECT_EQ(reopened, 1u);
+    EXPECT_EQ(sessions.memory_stats().sessions, 40u);
+}
+
+// Предел общий, а не доля на шард: все сессии одного шарда занимают его целиком
+TEST_F(ShardedSessionManagerTest, MaxSessionsIsGlobal) {
+    constexpr size_t kShards = 16;
+    pgw::CdrWriter cdr(cdr_file);
+    pgw::SessionManager sessions(std::chrono::seconds(30), factory(), kShards, cdr, 20);
+
+    // Абоненты, попадающие в тот же шард, что и первый (шард выбирается так же, как в менеджере)
+    std::vector<pgw::Imsi> same_shard;
+    const size_t shard = std::hash<pgw::Imsi>{}(imsi_at(0)) & (kShards - 1);
+    for (size_t i = 0; same_shard.size() < 22; ++i) {
+        if ((std::hash<pgw::Imsi>{}(imsi_at(i)) & (kShards - 1)) == shard)
+            same_shard.push_back(imsi_at(i));
+    }
+
+    for (size_t i = 0; i < 10; ++i) {
+        ASSERT_TRUE(sessions.touch_session(same_shard[i]));
+    }
+    std::vector<pgw::Imsi> batch(same_shard.begin() + 10, same_shard.begin() + 20);
+    for (auto r : sessions.touch_batch(batch)) {
+        EXPECT_EQ(r, pgw::UpsertResult::Created);
+    }
+    size_t largest = 0;
+    for (auto* store : stores) {
+        largest = std::max(largest, store->load_sessions(0).size());
+    }
+    EXPECT_EQ(largest, 20u);  // Намного больше равной доли ceil(20 / 16)
+
+    EXPECT_FALSE(sessions.touch_session(same_shard[20]));
+    std::vector<pgw::Imsi> extra = { same_shard[21], same_shard[0] };
+    auto results = sessions.touch_batch(extra);
+    EXPECT_EQ(results[0], pgw::UpsertResult::Failed);
+    EXPECT_EQ(results[1], pgw::UpsertResult::Refreshed);
+    EXPECT_TRUE(sessions.end_session(same_shard[0]));
+    EXPECT_TRUE(sessions.touch_session(same_shard[20]));
+
+    auto m = sessions.memory_stats();
+    EXPECT_EQ(m.sessions, 20u);
+    EXPECT_EQ(m.rejected, 2u);
+}
+
+// Повтор нового IMSI в пачке у предела занимает место один раз и не считается отказом
+TEST_F(ShardedSessionManagerTest, BatchDuplicateUsesLimitOnce) {
+    pgw::CdrWriter cdr(cdr_file);
+    pgw::SessionManager sessions(std::chrono::seconds(30), factory(), 1, cdr, 2);
+    ASSERT_TRUE(sessions.touch_session(imsi_at(0)));
+
+    std::vector<pgw::Imsi> batch = { imsi_at(1), imsi_at(1), imsi_at(2), imsi_at(1) };
+    auto results = sessions.touch_batch(batch);
+    EXPECT_EQ(results[0], pgw::UpsertResult::Created);
+    EXPECT_EQ(results[1], pgw::UpsertResult::Refreshed);
+    EXPECT_EQ(results[2], pgw::UpsertResult::Failed);  // Места нет
+    EXPECT_EQ(results[3], pgw::UpsertResult::Refreshed);
+
+    auto m = sessions.memory_stats();
+    EXPECT_EQ(m.sessions, 2u);
+    EXPECT_EQ(m.rejected, 1u);
+}
+
+// Тестируем тёплый перезапуск: снимок одного менеджера восстанавливается другим (с другим числом шардов),
+// сроки и время создания сохраняются, сессии снова стоят на колёсах; после graceful stop снимок пуст
+TEST_F(ShardedSessionManagerTest, SnapshotWarmRestart) {
+    const std::string snap = "test_sharded_sessions.snap";
+    pgw::CdrWriter cdr(cdr_file);
+    std::vector<pgw::StoredSession> before;
+    {
+        pgw::SessionManager sessions(std::chrono::seconds(30), factory(), 4, cdr);
+        for (size_t i = 0; i < 300; ++i) {
+            sessions.touch_session(imsi_at(i));
+        }
+        EXPECT_EQ(sessions.save_snapshot(snap), 300u);
+        before = sessions.list_sessions();
+    }
+
+    stores.clear();
+    {
+        pgw::SessionManager sessions(std::chrono::seconds(30), factory(), 8, cdr);
+        EXPECT_EQ(sessions.restore_snapshot(snap, 3), 300u);
+        EXPECT_EQ(sessions.expiry_stats().sessions, 300u);
+        for (auto& s : before) {
+            auto r = sessions.get_session(s.imsi);
+            ASSERT_TRUE(r.has_value());
+            EXPECT_EQ(r->created_at, s.created_at);
+            EXPECT_EQ(r->expires_at, s.expires_at);
+        }
+
+        sessions.enable_snapshots(snap, std::chrono::seconds(3600));
+        sessions.graceful_stop(0);
+    }
+    {
+        pgw::SessionManager sessions(std::chrono::seconds(30), factory(), 2, cdr);
+        EXPECT_EQ(sessions.restore_snapshot(snap), 0u);
+        EXPECT_TRUE(sessions.list_sessions().empty());
+    }
+    fs::remove(snap);
+}
+
+// Тестируем истечение по колесу таймеров: сессия снимается вскоре после таймаута, продление переносит срок
+TEST_F(ShardedSessionManagerTest, ExpiresOnTimingWheel) {
+    pgw::CdrWriter cdr(cdr_file);
+    pgw::SessionManager sessions(std::chrono::seconds(1), factory(), 2, cdr);
+
+    sessions.touch_session(imsi_at(1));
+    sessions.touch_session(imsi_at(2));
+    EXPECT_EQ(sessions.expiry_stats().sessions, 2u);
+
+    std::this_thread::sleep_for(std::chrono::milliseconds(600));
+    sessions.refresh_session(imsi_at(2));
+
+    // Первая истекает примерно через секунду, вторая — на 600 мс позже
+    std::this_thread::sleep_for(std::chrono::milliseconds(600));
+    EXPECT_FALSE(sessions.is_active(imsi_at(1)));
+    EXPECT_TRUE(sessions.is_active(imsi_at(2)));
+
+    std::this_thread::sleep_for(std::chrono::milliseconds(700));
+    EXPECT_FALSE(sessions.is_active(imsi_at(2)));
+
+    auto st = sessions.expiry_stats();
+    EXPECT_EQ(st.sessions, 0u);
+    EXPECT_EQ(st.expired, 2u);
+    EXPECT_LT(st.max_lag_us, 200000u);
+    for (auto* store : stores) {
+        EXPECT_TRUE(store->load_sessions(0).empty());
+    }
+}
+
+// Тестируем пакетное создание: результаты в порядке входа, сессии разложены по своим шардам
+TEST_F(ShardedSessionManagerTest, TouchBatch) {
+    pgw::CdrWriter cdr(cdr_file);
+    pgw::SessionManager sessions(std::chrono::seconds(30), factory(), 4, cdr);
+
+    EXPECT_TRUE(sessions.touch_session(imsi_at(3)));
+    auto created_at = sessions.get_session(imsi_at(3))->created_at;
+
+    std::vector<pgw::Imsi> batch;
+    for (size_t i = 0; i < 32; ++i) {
+        batch.push_back(imsi_at(i));
+    }
+    batch.push_back(imsi_at(0));  // Повтор в той же пачке — продление
+
+    auto results = sessions.touch_batch(batch);
+    ASSERT_EQ(results.size(), batch.size());
+    for (size_t i = 0; i < 32; ++i) {
+        EXPECT_EQ(results[i], i == 3 ? pgw::UpsertResult::Refreshed : pgw::UpsertResult::Created) << i;
+        EXPECT_TRUE(sessions.is_active(imsi_at(i)));
+    }
+    EXPECT_EQ(results.back(), pgw::UpsertResult::Refreshed);
+
+    // Продление не меняет время создания
+    EXPECT_EQ(sessions.get_session(imsi_at(3))->created_at, created_at);
+    EXPECT_EQ(sessions.list_sessions().size(), 32u);
+    EXPECT_EQ(sessions.expiry_stats().sessions, 32u);
+    EXPECT_TRUE(sessions.touch_batch({}).empty());
+}
+
+// Тестируем менеджер поверх плоской таблицы: чтения идут мимо мьютекса шарда
+TEST_F(ShardedSessionManagerTest, LockFreeReadsOnFlatStore) {
+    pgw::CdrWriter cdr(cdr_file);
+    auto make_flat = [](size_t) { return std::make_unique<pgw::FlatSessionStore>(64); };
+    pgw::SessionManager sessions(std::chrono::seconds(30), make_flat, 4, cdr);
+
+    for (size_t i = 0; i < 100; ++i) {
+        EXPECT_TRUE(sessions.touch_session(imsi_at(i)));
+    }
+    EXPECT_TRUE(sessions.is_active(imsi_at(42)));
+    EXPECT_FALSE(sessions.is_active(imsi_at(1000)));
+    EXPECT_EQ(sessions.list_sessions().size(), 100u);
+    EXPECT_EQ(sessions.expiry_stats().sessions, 100u);
+
+    EXPECT_TRUE(sessions.end_session(imsi_at(42)));
+    EXPECT_FALSE(sessions.is_active(imsi_at(42)));
+    EXPECT_EQ(sessions.expiry_stats().sessions, 99u);
+}
@@ -0,0 +1,114 @@
+#include <gtest/gtest.h>
+#include "pgw/session_snapshot.hpp"
+
+#include <filesystem>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+using namespace pgw;
+namespace fs = std::filesystem;
+
+class SessionSnapshotTest : public ::testing::Test {
+protected:
+    std::string path = "test_sessions.snap";
+
+    void TearDown() override {
+        fs::remove(path);
+        fs::remove(path + ".tmp");
+    }
+
+    static StoredSession make_session(uint64_t i) {
+        return { Imsi::from_string(std::to_string(250010000000000ull + i)), EpochMs(1000 + i), EpochMs(5000 + i) };
+    }
+
+    // Сумма хешей записей файла — то, что сверяет восстановление
+    static uint64_t sum_of(const SnapshotFile& file) {
+        uint64_t sum = 0;
+        for (size_t i = 0; i < file.size(); ++i) {
+            sum += snapshot_record_hash(file.at(i));
+        }
+        return sum;
+    }
+};
+
+// Тестируем запись пачками и чтение записей по индексу
+TEST_F(SessionSnapshotTest, RoundTrip) {
+    std::vector<StoredSession> a, b;
+    for (uint64_t i = 0; i < 50000; ++i) {
+        (i % 3 ? a : b).push_back(make_session(i));
+    }
+    {
+        SnapshotWriter writer(path);
+        writer.append(a);
+        writer.append(b);
+        EXPECT_EQ(writer.commit(777), 50000u);
+    }
+    EXPECT_FALSE(fs::exists(path + ".tmp"));
+
+    SnapshotFile file(path);
+    ASSERT_EQ(file.size(), 50000u);
+    EXPECT_EQ(file.written_at(), 777);
+    EXPECT_EQ(sum_of(file), file.checksum());
+
+    auto first = file.at(0);
+    EXPECT_EQ(first.imsi, a[0].imsi);
+    EXPECT_EQ(first.created_at, a[0].created_at);
+    EXPECT_EQ(first.expires_at, a[0].expires_at);
+    auto last = file.at(file.size() - 1);
+    EXPECT_EQ(last.imsi, b.back().imsi);
+}
+
+// Тестируем, что незавершённая запись не трогает прежний снимок
+TEST_F(SessionSnapshotTest, UncommittedWriteKeepsPrevious) {
+    {
+        SnapshotWriter writer(path);
+        std::vector<StoredSession> one = { make_session(1) };
+        writer.append(one);
+        writer.commit(1);
+    }
+    {
+        SnapshotWriter writer(path);
+        std::vector<StoredSession> many(100, make_session(2));
+        writer.append(many);
+        // Без commit()
+    }
+    EXPECT_FALSE(fs::exists(path + ".tmp"));
+    SnapshotFile file(path);
+    EXPECT_EQ(file.size(), 1u);
+}
+
+// Тестируем отказ от чужого, обрезанного и испорченного файла
+TEST_F(SessionSnapshotTest, RejectsDamagedFiles) {
+    {
+        SnapshotWriter writer(path);
+        std::vector<StoredSession> sessions = { make_session(1), make_session(2), make_session(3) };
+        writer.append(sessions);
+        writer.commit(1);
+    }
+    const auto size = fs::file_size(path);
+
+    // Испорченная запись: заголовок цел, но сумма не сходится
+    {
+        std::fstream f(path, std::ios::in | std::ios::out | std::ios::binary);
+        f.seekp(static_cast<std::streamoff>(sizeof(SnapshotHeader) + 9));
+        f.put('\x7f');
+    }
+    {
+        SnapshotFile file(path);
+        EXPECT_NE(sum_of(file), file.checksum());
+    }
+
+    fs::resize_file(path, size - 5);
+    EXPECT_THROW(SnapshotFile{path}, std::runtime_error);
+
+    {
+        std::ofstream f(path, std::ios::binary | std::ios::trunc);
+        f << std::string(64, 'x');
+    }
+    EXPECT_THROW(SnapshotFile{path}, std::runtime_error);
+
+    fs::remove(path);
+    EXPECT_THROW(SnapshotFile{path}, std::system_error);
+}
@@ -0,0 +1,70 @@
+#include <gtest/gtest.h>
+#include "pgw/slab_pool.hpp"
+#include "pgw/imsi.hpp"
+
+#include <set>
+#include <stdexcept>
+#include <unordered_map>
+
+using namespace pgw;
+
+// Тестируем выдачу, повторное использование освобождённых объектов и учёт плит
+TEST(SlabPoolTest, AllocateReuseAndStats) {
+    SlabPool pool(20);
+    EXPECT_EQ(pool.object_size(), 24u);  // Округление до выравнивания
+
+    void* a = pool.allocate();
+    void* b = pool.allocate();
+    EXPECT_NE(a, b);
+    EXPECT_EQ(pool.stats().objects, 2u);
+    EXPECT_EQ(pool.stats().slabs, 1u);
+
+    pool.deallocate(a);
+    EXPECT_EQ(pool.allocate(), a);  // Освобождённый объект выдаётся следующим
+
+    // reserve выделяет плиты заранее; дальше до ёмкости плиты не добавляются
+    pool.reserve(200000);
+    SlabStats s = pool.stats();
+    EXPECT_GE(s.capacity, 200000u);
+    EXPECT_EQ(s.bytes_reserved, s.slabs * (SlabPool::kSlabBytes / 24) * 24);
+    std::set<void*> seen;
+    for (size_t i = 2; i < s.capacity; ++i) {
+        seen.insert(pool.allocate());
+    }
+    EXPECT_EQ(seen.size(), s.capacity - 2);
+    EXPECT_EQ(pool.stats().slabs, s.slabs);
+    EXPECT_EQ(pool.stats().bytes_in_use, s.capacity * 24);
+}
+
+// Тестируем пул как аллокатор узлов хеш-таблицы: каждый элемент — ровно один объект пула
+TEST(SlabPoolTest, BacksUnorderedMapNodes) {
+    using Map = std::unordered_map<Imsi, uint64_t, std::hash<Imsi>, std::equal_to<Imsi>,
+                                   SlabAllocator<std::pair<const Imsi, uint64_t>>>;
+    const size_t node = slab_node_size<Map>(std::pair<const Imsi, uint64_t>{});
+    EXPECT_GE(node, sizeof(std::pair<const Imsi, uint64_t>));
+
+    SlabPool pool(node);
+    {
+        Map map{ Map::allocator_type(pool) };
+        for (uint64_t i = 0; i < 10000; ++i) {
+            map.emplace(Imsi::from_string(std::to_string(1010000000000ull + i)), i);
+        }
+        EXPECT_EQ(pool.stats().objects, 10000u);
+        for (uint64_t i = 0; i < 5000; ++i) {
+            map.erase(Imsi::from_string(std::to_string(1010000000000ull + i)));
+        }
+        EXPECT_EQ(pool.stats().objects, 5000u);
+        EXPECT_EQ(map.at(Imsi::from_string("1010000009999")), 9999u);
+    }
+    EXPECT_EQ(pool.stats().objects, 0u);
+}
+
+// Тестируем, что без размера объекта пул нельзя зарезервировать
+TEST(SlabPoolTest, ReserveNeedsObjectSize) {
+    SlabPool pool;
+    EXPECT_THROW(pool.reserve(10), std::logic_error);
+    EXPECT_TRUE(pool.adopt(30));
+    EXPECT_EQ(pool.object_size(), 32u);
+    EXPECT_FALSE(pool.adopt(64));
+    EXPECT_NO_THROW(pool.reserve(10));
+}
@@ -1,7 +1,12 @@
 #include <gtest/gtest.h>
 #include "pgw/sqlite_session_store.hpp"
 #include "pgw/session.hpp"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
 #include <filesystem>
+#include <thread>
+#include <vector>
 
 namespace fs = std::filesystem;
 using namespace pgw;
@@ -28,12 +33,38 @@ protected:
         }
     }
 
+    // Хранилище с отложенной записью на том же файле
+    void reopen_write_behind(std::chrono::milliseconds interval, size_t rows) {
+        SqliteStoreOptions options;
+        options.commit_interval = interval;
+        options.commit_rows     = rows;
+        store_.reset();
+        store_ = std::make_unique<SqliteSessionStore>(db_path, options);
+    }
+
+    // Ждёт, пока фоновый поток зафиксирует commits транзакций
+    bool wait_commits(uint64_t commits) {
+        for (int i = 0; i < 200; ++i) {
+            auto st = store_->commit_stats();
+            if (st.commits >= commits && st.pending == 0) return true;
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        }
+        return false;
+    }
+
+    // "YYYY-MM-DD HH:MM:SS" → Unix-время (мс)
+    static EpochMs at(const std::string& text) {
+        EpochMs ms = 0;
+        EXPECT_TRUE(parse_timestamp(text, ms));
+        return ms;
+    }
+
     // Создание тестовой сессии
     StoredSession create_session(const std::string& imsi, const std::string& created_at, const std::string& expires_at) {
         StoredSession session;
-        session.imsi = imsi;
-        session.created_at = created_at;
-        session.expires_at = expires_at;
+        session.imsi = Imsi::from_string(imsi);
+        session.created_at = at(created_at);
+        session.expires_at = at(expires_at);
         return session;
     }
 };
@@ -46,11 +77,13 @@ TEST_F(SqliteSessionStoreTest, SaveAndLoadSessions) {
     ASSERT_TRUE(store_->save_session(session));
 
     // Загружаем сессии с условием, что они не истекли
-    auto loaded_sessions = store_->load_sessions("2023-06-01 00:00:00");
+    auto loaded_sessions = store_->load_sessions(at("2023-06-01 00:00:00"));
 
-    // Проверяем, что сессия была загружена
+    // Проверяем, что сессия была загружена вместе со сроками
     ASSERT_EQ(loaded_sessions.size(), 1);
-    EXPECT_EQ(loaded_sessions[0].imsi, "123456789012345");
+    EXPECT_EQ(loaded_sessions[0].imsi.to_string(), "123456789012345");
+    EXPECT_EQ(loaded_sessions[0].created_at, session.created_at);
+    EXPECT_EQ(loaded_sessions[0].expires_at, session.expires_at);
 }
 
 // Тест 2: Проверка загрузки просроченных сессий
@@ -60,11 +93,11 @@ TEST_F(SqliteSessionStoreTest, LoadExpiredSessions) {
     store_->save_session(create_session("987654321012345", "2022-01-01 00:00:00", "2022-12-31 23:59:59"));
 
     // Загружаем просроченные сессии на 2023-01-01
-    auto expired_sessions = store_->load_expired_sessions("2023-01-01 00:00:00");
+    auto expired_sessions = store_->load_expired_sessions(at("2023-01-01 00:00:00"));
 
     // Проверяем, что загружена только одна просроченная сессия
     ASSERT_EQ(expired_sessions.size(), 1);
-    EXPECT_EQ(expired_sessions[0].imsi, "987654321012345");
+    EXPECT_EQ(expired_sessions[0].imsi.to_string(), "987654321012345");
 }
 
 // Тест 3: Проверка удаления сессий
@@ -74,11 +107,11 @@ TEST_F(SqliteSessionStoreTest, DeleteSession) {
     store_->save_session(create_session("987654321012345", "2022-01-01 00:00:00", "2022-12-31 23:59:59"));
 
     // Удаляем одну сессию
-    ASSERT_TRUE(store_->delete_session("123456789012345"));
+    ASSERT_TRUE(store_->delete_session(Imsi::from_string("123456789012345")));
 
     // Проверяем, что сессия была удалена
-    EXPECT_FALSE(store_->session_exists("123456789012345"));
-    EXPECT_TRUE(store_->session_exists("987654321012345"));
+    EXPECT_FALSE(store_->session_exists(Imsi::from_string("123456789012345")));
+    EXPECT_TRUE(store_->session_exists(Imsi::from_string("987654321012345")));
 }
 
 // Тест 4: Проверка очистки просроченных сессий
@@ -88,10 +121,419 @@ TEST_F(SqliteSessionStoreTest, CleanupExpiredSessions) {
     store_->save_session(create_session("987654321012345", "2022-01-01 00:00:00", "2022-12-31 23:59:59"));
 
     // Очистка просроченных сессий на 2023-01-01
-    store_->cleanup_expired_sessions("2023-01-01 00:00:00");
+    store_->cleanup_expired_sessions(at("2023-01-01 00:00:00"));
 
     // Проверяем, что осталась только актуальная сессия
-    EXPECT_TRUE(store_->session_exists("123456789012345"));
-    EXPECT_FALSE(store_->session_exists("987654321012345"));
+    EXPECT_TRUE(store_->session_exists(Imsi::from_string("123456789012345")));
+    EXPECT_FALSE(store_->session_exists(Imsi::from_string("987654321012345")));
+}
+
+
+// Тест 5: Точечный поиск сессии по IMSI
+TEST_F(SqliteSessionStoreTest, GetSession) {
+    StoredSession session = create_session("123456789012345", "2023-01-01 00:00:00", "2023-12-31 23:59:59");
+    store_->save_session(session);
+
+    auto found = store_->get_session(Imsi::from_string("123456789012345"));
+    ASSERT_TRUE(found.has_value());
+    EXPECT_EQ(found->imsi, session.imsi);
+    EXPECT_EQ(found->created_at, session.created_at);
+    EXPECT_EQ(found->expires_at, session.expires_at);
+
+    EXPECT_FALSE(store_->get_session(Imsi::from_string("987654321012345")).has_value());
 }
 
+// Тест 6: upsert создаёт сессию, повторный вызов продлевает срок и сохраняет created_at
+TEST_F(SqliteSessionStoreTest, Upsert) {
+    StoredSession session = create_session("123456789012345", "2023-01-01 00:00:00", "2023-12-31 23:59:59");
+    EXPECT_EQ(store_->upsert(session), UpsertResult::Created);
+
+    StoredSession again = create_session("123456789012345", "2024-01-01 00:00:00", "2024-06-30 12:00:00");
+    EXPECT_EQ(store_->upsert(again), UpsertResult::Refreshed);
+
+    auto found = store_->get_session(session.imsi);
+    ASSERT_TRUE(found.has_value());
+    EXPECT_EQ(found->created_at, session.created_at);
+    EXPECT_EQ(found->expires_at, again.expires_at);
+}
+
+// Тест 7: пакетные формы в одной транзакции — результаты в порядке входа
+TEST_F(SqliteSessionStoreTest, BatchOperations) {
+    store_->save_session(create_session("111223344556677", "2023-01-01 00:00:00", "2023-12-31 23:59:59"));
+
+    std::vector<StoredSession> batch = {
+        create_session("123456789012345", "2023-06-01 00:00:00", "2024-01-01 00:00:00"),
+        create_session("111223344556677", "2023-06-01 00:00:00", "2024-01-01 00:00:00"),
+        create_session("123456789012345", "2023-06-01 00:00:00", "2024-02-01 00:00:00"),
+    };
+    auto results = store_->upsert_batch(batch);
+    ASSERT_EQ(results.size(), 3u);
+    EXPECT_EQ(results[0], UpsertResult::Created);
+    EXPECT_EQ(results[1], UpsertResult::Refreshed);
+    EXPECT_EQ(results[2], UpsertResult::Refreshed);
+
+    std::vector<Imsi> imsis = {
+        Imsi::from_string("123456789012345"),
+        Imsi::from_string("987654321012345"),
+        Imsi::from_string("111223344556677"),
+    };
+    auto found = store_->lookup_batch(imsis);
+    ASSERT_EQ(found.size(), 3u);
+    ASSERT_TRUE(found[0].has_value());
+    EXPECT_EQ(found[0]->expires_at, at("2024-02-01 00:00:00"));
+    EXPECT_FALSE(found[1].has_value());
+    ASSERT_TRUE(found[2].has_value());
+    EXPECT_EQ(found[2]->created_at, at("2023-01-01 00:00:00"));
+
+    EXPECT_EQ(store_->delete_batch(imsis), 2u);
+    EXPECT_FALSE(store_->session_exists(imsis[0]));
+    EXPECT_FALSE(store_->session_exists(imsis[2]));
+
+    // После пачки транзакция закрыта: одиночные операции работают как обычно
+    EXPECT_TRUE(store_->save_session(batch[0]));
+    EXPECT_TRUE(store_->session_exists(batch[0].imsi));
+}
+
+// Тест 8: запросы подготовлены один раз и переиспользуются — счётчики по каждому запросу
+TEST_F(SqliteSessionStoreTest, StatementStats) {
+    auto count = [this](const std::string& name) {
+        for (const auto& s : store_->statement_stats()) {
+            if (s.name == name) return s.calls;
+        }
+        ADD_FAILURE() << "No statement " << name;
+        return uint64_t{0};
+    };
+
+    StoredSession a = create_session("123456789012345", "2023-01-01 00:00:00", "2023-12-31 23:59:59");
+    StoredSession b = create_session("987654321012345", "2023-01-01 00:00:00", "2023-12-31 23:59:59");
+    EXPECT_EQ(store_->upsert(a), UpsertResult::Created);    // UPDATE без строки, затем INSERT
+    EXPECT_EQ(store_->upsert(a), UpsertResult::Refreshed);  // Только UPDATE
+    EXPECT_EQ(store_->upsert(b), UpsertResult::Created);
+    EXPECT_TRUE(store_->session_exists(a.imsi));
+    EXPECT_TRUE(store_->session_exists(b.imsi));
+    EXPECT_TRUE(store_->delete_session(b.imsi));
+    EXPECT_FALSE(store_->session_exists(b.imsi));
+
+    EXPECT_EQ(count("update_expires"), 3u);
+    EXPECT_EQ(count("insert"), 2u);
+    EXPECT_EQ(count("exists"), 3u);
+    EXPECT_EQ(count("delete"), 1u);
+
+    // Пачка — одна транзакция на подготовленных BEGIN/COMMIT
+    store_->upsert_batch(std::vector<StoredSession>{ a, b });
+    EXPECT_EQ(count("begin"), 1u);
+    EXPECT_EQ(count("commit"), 1u);
+    EXPECT_EQ(count("update_expires"), 5u);
+
+    // Параметры привязаны без копирования: после сброса запроса значения не «залипают»
+    auto found = store_->get_session(b.imsi);
+    ASSERT_TRUE(found.has_value());
+    EXPECT_EQ(found->expires_at, b.expires_at);
+    EXPECT_FALSE(store_->get_session(Imsi::from_string("111223344556677")).has_value());
+
+    for (const auto& s : store_->statement_stats()) {
+        EXPECT_EQ(s.errors, 0u) << s.name;
+        EXPECT_GE(s.total_ns, s.max_ns) << s.name;
+    }
+}
+
+// Тест 9: отложенная запись — чтение видит изменения до фиксации, деструктор их фиксирует
+TEST_F(SqliteSessionStoreTest, WriteBehindReadsPendingAndFlushesOnClose) {
+    StoredSession old = create_session("111223344556677", "2023-01-01 00:00:00", "2023-12-31 23:59:59");
+    ASSERT_TRUE(store_->save_session(old));
+    reopen_write_behind(std::chrono::hours(1), 1000);
+
+    StoredSession a = create_session("123456789012345", "2023-01-01 00:00:00", "2023-12-31 23:59:59");
+    StoredSession a2 = create_session("123456789012345", "2023-06-01 00:00:00", "2024-06-30 00:00:00");
+    StoredSession old2 = create_session("111223344556677", "2023-06-01 00:00:00", "2024-01-31 00:00:00");
+    EXPECT_EQ(store_->upsert(a), UpsertResult::Created);
+    EXPECT_EQ(store_->upsert(a2), UpsertResult::Refreshed);
+    EXPECT_EQ(store_->upsert(old2), UpsertResult::Refreshed);  // Строка в базе: продлевается только срок
+
+    auto found = store_->get_session(a.imsi);
+    ASSERT_TRUE(found.has_value());
+    EXPECT_EQ(found->created_at, a.created_at);
+    EXPECT_EQ(found->expires_at, a2.expires_at);
+    found = store_->get_session(old.imsi);
+    ASSERT_TRUE(found.has_value());
+    EXPECT_EQ(found->created_at, old.created_at);
+    EXPECT_EQ(found->expires_at, old2.expires_at);
+
+    // Удаление и повторное создание в пределах одного окна
+    StoredSession b = create_session("987654321012345", "2023-01-01 00:00:00", "2023-12-31 23:59:59");
+    EXPECT_EQ(store_->upsert(b), UpsertResult::Created);
+    EXPECT_TRUE(store_->delete_session(b.imsi));
+    EXPECT_FALSE(store_->session_exists(b.imsi));
+    EXPECT_FALSE(store_->get_session(b.imsi).has_value());
+    EXPECT_EQ(store_->upsert(b), UpsertResult::Created);
+    std::vector<Imsi> gone = { b.imsi, b.imsi, Imsi::from_string("555555555555555") };
+    EXPECT_EQ(store_->delete_batch(gone), 1u);
+
+    auto st = store_->commit_stats();
+    EXPECT_EQ(st.commits, 0u);
+    EXPECT_EQ(st.pending, 3u);
+
+    // Другое соединение ещё не видит изменений; после закрытия хранилища — видит
+    {
+        SqliteSessionStore reader(db_path);
+        EXPECT_FALSE(reader.session_exists(a.imsi));
+    }
+    store_.reset();
+    SqliteSessionStore reader(db_path);
+    found = reader.get_session(a.imsi);
+    ASSERT_TRUE(found.has_value());
+    EXPECT_EQ(found->expires_at, a2.expires_at);
+    found = reader.get_session(old.imsi);
+    ASSERT_TRUE(found.has_value());
+    EXPECT_EQ(found->created_at, old.created_at);
+    EXPECT_EQ(found->expires_at, old2.expires_at);
+    EXPECT_FALSE(reader.session_exists(b.imsi));
+}
+
+// Тест 9а: хранилище закрыто сразу после записи — поток отложенной записи мог ещё ни разу не
+// взять мьютекс, но изменения всё равно фиксируются
+TEST_F(SqliteSessionStoreTest, WriteBehindFlushesWhenClosedImmediately) {
+    for (uint64_t i = 0; i < 50; ++i) {
+        StoredSession s{ Imsi::from_string(std::to_string(1010000000000ull + i)), 1000, 2000 };
+        reopen_write_behind(std::chrono::hours(1), 1000);
+        ASSERT_TRUE(store_->save_session(s));
+        store_.reset();
+        SqliteSessionStore reader(db_path);
+        ASSERT_TRUE(reader.session_exists(s.imsi)) << "iteration " << i;
+    }
+}
+
+// Тест 10: фиксация по числу строк и по интервалу; выборки по сроку видят отложенные изменения
+TEST_F(SqliteSessionStoreTest, WriteBehindCommitsByRowsAndInterval) {
+    reopen_write_behind(std::chrono::hours(1), 3);
+    std::vector<StoredSession> batch = {
+        create_session("100000000000001", "2023-01-01 00:00:00", "2023-12-31 23:59:59"),
+        create_session("100000000000002", "2023-01-01 00:00:00", "2023-12-31 23:59:59"),
+        create_session("100000000000003", "2022-01-01 00:00:00", "2022-12-31 23:59:59"),
+    };
+    auto results = store_->upsert_batch(batch);
+    EXPECT_EQ(std::count(results.begin(), results.end(), UpsertResult::Created), 3);
+    ASSERT_TRUE(wait_commits(1));
+    EXPECT_EQ(store_->commit_stats().last_batch_rows, 3u);
+
+    reopen_write_behind(std::chrono::milliseconds(20), 1000);
+    store_->save_session(create_session("100000000000004", "2023-01-01 00:00:00", "2023-12-31 23:59:59"));
+    ASSERT_TRUE(wait_commits(1));
+    auto st = store_->commit_stats();
+    EXPECT_EQ(st.rows, 1u);
+    EXPECT_EQ(st.failed_commits, 0u);
+    EXPECT_GE(st.total_commit_ns, st.max_commit_ns);
+
+    store_->delete_session(batch[0].imsi);
+    EXPECT_EQ(store_->load_sessions(at("2023-06-01 00:00:00")).size(), 2u);
+    EXPECT_EQ(store_->load_expired_sessions(at("2023-06-01 00:00:00")).size(), 1u);
+    EXPECT_EQ(store_->commit_stats().pending, 0u);
+}
+
+// Тест 11: режим журнала включается в файле базы; неизвестный режим — ошибка конфигурации
+TEST_F(SqliteSessionStoreTest, JournalModeAndValidation) {
+    sqlite3* db = nullptr;
+    ASSERT_EQ(sqlite3_open(db_path.c_str(), &db), SQLITE_OK);
+    sqlite3_stmt* stmt = nullptr;
+    ASSERT_EQ(sqlite3_prepare_v2(db, "PRAGMA journal_mode;", -1, &stmt, nullptr), SQLITE_OK);
+    ASSERT_EQ(sqlite3_step(stmt), SQLITE_ROW);
+    EXPECT_STREQ(reinterpret_cast<const char*>(sqlite3_column_text(stmt, 0)), "wal");
+    sqlite3_finalize(stmt);
+    sqlite3_close(db);
+
+    SqliteStoreOptions bad;
+    bad.journal_mode = "fast";
+    EXPECT_THROW(SqliteSessionStore(db_path, bad), std::invalid_argument);
+    bad = {};
+    bad.synchronous = "sometimes";
+    EXPECT_THROW(SqliteSessionStore(db_path, bad), std::invalid_argument);
+}
+
+// Тест 12: файл в прежнем текстовом формате переводится в схему с целыми сроками при открытии
+TEST_F(SqliteSessionStoreTest, MigratesTextSchema) {
+    store_.reset();
+    fs::remove(db_path);
+    {
+        sqlite3* db = nullptr;
+        ASSERT_EQ(sqlite3_open(db_path.c_str(), &db), SQLITE_OK);
+        const char* sql =
+            "CREATE TABLE sessions (imsi TEXT PRIMARY KEY, created_at TEXT, expires_at TEXT);"
+            "INSERT INTO sessions VALUES ('123456789012345', '2023-01-01 00:00:00', '2023-12-31 23:59:59');"
+            "INSERT INTO sessions VALUES ('987654321012345', '2023-01-01 00:00:00', '2023-02-01 00:00:00');"
+            "INSERT INTO sessions VALUES ('12ab', '2023-01-01 00:00:00', 'never');";
+        ASSERT_EQ(sqlite3_exec(db, sql, nullptr, nullptr, nullptr), SQLITE_OK);
+        sqlite3_close(db);
+    }
+
+    store_ = std::make_unique<SqliteSessionStore>(db_path);
+    auto found = store_->get_session(Imsi::from_string("123456789012345"));
+    ASSERT_TRUE(found.has_value());
+    EXPECT_EQ(found->created_at, at("2023-01-01 00:00:00"));
+    EXPECT_EQ(found->expires_at, at("2023-12-31 23:59:59"));
+    EXPECT_EQ(store_->load_sessions(at("2023-06-01 00:00:00")).size(), 1u);
+    EXPECT_EQ(store_->load_expired_sessions(at("2023-06-01 00:00:00")).size(), 1u);
+
+    // Сроки теперь хранятся с точностью до миллисекунды
+    StoredSession precise{ Imsi::from_string("111223344556677"), 1700000000123, 1700000060456 };
+    ASSERT_TRUE(store_->save_session(precise));
+    store_.reset();
+
+    sqlite3* db = nullptr;
+    ASSERT_EQ(sqlite3_open(db_path.c_str(), &db), SQLITE_OK);
+    sqlite3_stmt* stmt = nullptr;
+    ASSERT_EQ(sqlite3_prepare_v2(db, "SELECT (SELECT user_version FROM pragma_user_version), count(*), "
+                                     "sum(typeof(expires_at) = 'integer') FROM sessions;", -1, &stmt, nullptr),
+              SQLITE_OK);
+    ASSERT_EQ(sqlite3_step(stmt), SQLITE_ROW);
+    EXPECT_EQ(sqlite3_column_int(stmt, 0), 1);
+    EXPECT_EQ(sqlite3_column_int(stmt, 1), 3);  // Строка с неразборчивыми полями отброшена
+    EXPECT_EQ(sqlite3_column_int(stmt, 2), 3);
+    sqlite3_finalize(stmt);
+    sqlite3_close(db);
+
+    // Повторное открытие — без миграции, данные на месте
+    store_ = std::make_unique<SqliteSessionStore>(db_path);
+    found = store_->get_session(precise.imsi);
+    ASSERT_TRUE(found.has_value());
+    EXPECT_EQ(found->created_at, precise.created_at);
+    EXPECT_EQ(found->expires_at, precise.expires_at);
+}
+
+// Тест 13: выборки по сроку идут по индексу expires_at (поиск по диапазону, без полного
+// просмотра таблицы), по IMSI — по ключу таблицы
+TEST_F(SqliteSessionStoreTest, QueryPlansUseIndexes) {
+    for (const char* name : { "load_live", "load_expired", "delete_expired" }) {
+        std::string plan = store_->query_plan(name);
+        EXPECT_NE(plan.find("INDEX sessions_expires_at (expires_at"), std::string::npos) << name << ":\n" << plan;
+        EXPECT_EQ(plan.find("SCAN"), std::string::npos) << name << ":\n" << plan;
+    }
+    for (const char* name : { "update_expires", "delete", "exists", "select" }) {
+        std::string plan = store_->query_plan(name);
+        EXPECT_NE(plan.find("USING INTEGER PRIMARY KEY"), std::string::npos) << name << ":\n" << plan;
+    }
+    EXPECT_THROW(store_->query_plan("no_such_query"), std::invalid_argument);
+}
+
+// Тест 14: истёкшие удаляются порциями, каждая — отдельным выполнением запроса
+TEST_F(SqliteSessionStoreTest, CleanupDeletesInChunks) {
+    SqliteStoreOptions options;
+    options.expire_chunk_rows = 100;
+    store_.reset();
+    store_ = std::make_unique<SqliteSessionStore>(db_path, options);
+
+    std::vector<StoredSession> batch;
+    for (uint64_t i = 0; i < 260; ++i) {
+        EpochMs expires = i < 250 ? 1000 + EpochMs(i) : 1000000;
+        batch.push_back({ Imsi::from_string(std::to_string(1010000000000ull + i)), 0, expires });
+    }
+    store_->upsert_batch(batch);
+    store_->cleanup_expired_sessions(500000);
+
+    EXPECT_EQ(store_->load_sessions(0).size(), 10u);
+    auto stats = store_->statement_stats();
+    auto del = std::find_if(stats.begin(), stats.end(), [](const auto& s) { return s.name == "delete_expired"; });
+    ASSERT_NE(del, stats.end());
+    EXPECT_EQ(del->calls, 3u);  // 100 + 100 + 50
+
+    options.expire_chunk_rows = 0;
+    EXPECT_THROW(SqliteSessionStore(db_path, options), std::invalid_argument);
+}
+
+// Тест 15: пул чтения — чтения из нескольких потоков идут через свои соединения одновременно
+// с записью и видят всё, что уже записано
+TEST_F(SqliteSessionStoreTest, ReadPoolReadsAlongsideWrites) {
+    SqliteStoreOptions options;
+    options.read_connections = 3;
+    store_.reset();
+    store_ = std::make_unique<SqliteSessionStore>(db_path, options);
+    ASSERT_TRUE(store_->concurrent_reads());
+    EXPECT_EQ(store_->read_pool_stats().connections, 3u);
+
+    constexpr uint64_t kCount = 500;
+    auto imsi_at = [](uint64_t i) { return Imsi::from_string(std::to_string(1010000000000ull + i)); };
+    std::atomic<uint64_t> written{0};
+    std::atomic<uint64_t> missing{0};
+    std::atomic<uint64_t> reads{0};
+
+    std::thread writer([&] {
+        for (uint64_t i = 0; i < kCount; ++i) {
+            EXPECT_EQ(store_->upsert({ imsi_at(i), 1000, 2000000 + EpochMs(i) }), UpsertResult::Created);
+            written.store(i + 1, std::memory_order_release);
+        }
+    });
+    std::vector<std::thread> readers;
+    for (uint64_t t = 0; t < 3; ++t) {
+        readers.emplace_back([&, t] {
+            uint64_t n = t;
+            while (written.load(std::memory_order_acquire) < kCount) {
+                uint64_t done = written.load(std::memory_order_acquire);
+                if (done == 0) {
+                    std::this_thread::yield();
+                    continue;
+                }
+                uint64_t i = n++ % done;
+                auto s = store_->get_session(imsi_at(i));
+                if (!s || s->expires_at != 2000000 + EpochMs(i)) missing.fetch_add(1);
+                reads.fetch_add(1);
+            }
+        });
+    }
+    writer.join();
+    for (auto& th : readers) th.join();
+
+    EXPECT_EQ(missing.load(), 0u);
+    EXPECT_EQ(store_->load_sessions(0).size(), kCount);
+    EXPECT_EQ(store_->lookup_batch(std::vector<Imsi>{ imsi_at(0), imsi_at(kCount) })[0]->created_at, 1000);
+
+    auto pool = store_->read_pool_stats();
+    EXPECT_EQ(pool.reads, reads.load() + 2);  // + load_sessions и lookup_batch
+    auto stats = store_->statement_stats();
+    for (const auto& s : stats) {
+        EXPECT_EQ(s.errors, 0u) << s.name;
+    }
+    auto select_stats = std::find_if(stats.begin(), stats.end(), [](const auto& s) { return s.name == "select"; });
+    ASSERT_NE(select_stats, stats.end());
+    EXPECT_EQ(select_stats->calls, reads.load() + 2);
+
+    // База в памяти у каждого соединения своя — пул не открывается
+    SqliteSessionStore memory(":memory:", options);
+    EXPECT_FALSE(memory.concurrent_reads());
+    EXPECT_EQ(memory.read_pool_stats().connections, 0u);
+}
+
+// Тест 16: пул чтения с отложенной записью — чтение видит изменения, ещё не записанные в базу
+TEST_F(SqliteSessionStoreTest, ReadPoolSeesPendingWrites) {
+    SqliteStoreOptions options;
+    options.read_connections = 2;
+    options.commit_interval  = std::chrono::hours(1);
+    store_.reset();
+    store_ = std::make_unique<SqliteSessionStore>(db_path, options);
+    ASSERT_TRUE(store_->concurrent_reads());
+
+    StoredSession a = create_session("123456789012345", "2023-01-01 00:00:00", "2023-12-31 23:59:59");
+    StoredSession b = create_session("987654321012345", "2023-01-01 00:00:00", "2023-12-31 23:59:59");
+    ASSERT_TRUE(store_->save_session(a));
+    ASSERT_TRUE(store_->save_session(b));
+    EXPECT_TRUE(store_->session_exists(a.imsi));
+    ASSERT_TRUE(store_->flush());
+
+    // Продление в памяти поверх строки в базе, удаление — до фиксации
+    StoredSession later = a;
+    later.expires_at = at("2024-06-30 00:00:00");
+    EXPECT_EQ(store_->upsert(later), UpsertResult::Refreshed);
+    EXPECT_TRUE(store_->delete_session(b.imsi));
+
+    auto found = store_->get_session(a.imsi);
+    ASSERT_TRUE(found.has_value());
+    EXPECT_EQ(found->created_at, a.created_at);
+    EXPECT_EQ(found->expires_at, later.expires_at);
+    EXPECT_FALSE(store_->session_exists(b.imsi));
+    auto batch = store_->lookup_batch(std::vector<Imsi>{ a.imsi, b.imsi });
+    ASSERT_TRUE(batch[0].has_value());
+    EXPECT_EQ(batch[0]->expires_at, later.expires_at);
+    EXPECT_FALSE(batch[1].has_value());
+
+    // Выборка по сроку сначала фиксирует отложенное
+    EXPECT_EQ(store_->load_sessions(at("2024-01-01 00:00:00")).size(), 1u);
+    EXPECT_EQ(store_->commit_stats().pending, 0u);
+}
@@ -0,0 +1,178 @@
+#include <gtest/gtest.h>
+#include "pgw/tiered_session_store.hpp"
+#include "pgw/session_manager.hpp"
+#include <chrono>
+#include <filesystem>
+#include <thread>
+
+namespace fs = std::filesystem;
+using namespace pgw;
+
+class TieredSessionStoreTest : public ::testing::Test {
+protected:
+    std::string db_path  = "tiered_test.db";
+    std::string cdr_path = "tiered_test_cdr.csv";
+
+    void SetUp() override { remove_files(); }
+    void TearDown() override { remove_files(); }
+
+    void remove_files() {
+        for (const auto& p : { db_path, db_path + "-wal", db_path + "-shm", cdr_path }) {
+            fs::remove(p);
+        }
+    }
+
+    std::shared_ptr<SessionWriteBack> backend(size_t shards, std::chrono::milliseconds interval,
+                                              size_t rows = 4096) {
+        TieredStoreOptions options;
+        options.writeback_interval = interval;
+        options.writeback_rows     = rows;
+        return std::make_shared<SessionWriteBack>(std::make_unique<SqliteSessionStore>(db_path), shards, options);
+    }
+
+    static Imsi imsi_at(size_t i) { return Imsi::from_string(std::to_string(1010000000000ull + i)); }
+
+    // Ждёт, пока поток запишет flushes пачек
+    static bool wait_flushes(SessionWriteBack& wb, uint64_t flushes) {
+        for (int i = 0; i < 200; ++i) {
+            auto st = wb.stats();
+            if (st.flushes >= flushes && st.dirty == 0) return true;
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        }
+        return false;
+    }
+};
+
+// Сто продлений одной сессии за окно — одна строка в базе; чтение — из памяти
+TEST_F(TieredSessionStoreTest, CoalescesRefreshesIntoOneWrite) {
+    auto wb = backend(1, std::chrono::hours(1));
+    TieredSessionStore store(wb, 0);
+
+    const Imsi imsi = imsi_at(1);
+    EXPECT_EQ(store.upsert({ imsi, 1000000, 2000000 }), UpsertResult::Created);
+    for (EpochMs t = 1; t < 100; ++t) {
+        EXPECT_EQ(store.upsert({ imsi, 1000000 + t * 1000, 2000000 + t * 1000 }), UpsertResult::Refreshed);
+    }
+    auto found = store.get_session(imsi);
+    ASSERT_TRUE(found.has_value());
+    EXPECT_EQ(found->created_at, 1000000);
+    EXPECT_EQ(found->expires_at, 2099000);
+    EXPECT_FALSE(wb->cold().session_exists(imsi));  // Ещё в памяти
+
+    auto st = wb->stats();
+    EXPECT_EQ(st.changes, 100u);
+    EXPECT_EQ(st.dirty, 1u);
+
+    ASSERT_TRUE(wb->flush());
+    st = wb->stats();
+    EXPECT_EQ(st.flushes, 1u);
+    EXPECT_EQ(st.rows, 1u);
+    EXPECT_EQ(st.dirty, 0u);
+    found = wb->cold().get_session(imsi);
+    ASSERT_TRUE(found.has_value());
+    EXPECT_EQ(found->created_at, 1000000);
+    EXPECT_EQ(found->expires_at, 2099000);
+
+    // Удаление и повторное создание в одном окне — строка заменяется целиком
+    EXPECT_TRUE(store.delete_session(imsi));
+    EXPECT_FALSE(store.session_exists(imsi));
+    EXPECT_EQ(store.upsert({ imsi, 5000000, 9000000 }), UpsertResult::Created);
+    ASSERT_TRUE(wb->flush());
+    found = wb->cold().get_session(imsi);
+    ASSERT_TRUE(found.has_value());
+    EXPECT_EQ(found->created_at, 5000000);
+    EXPECT_EQ(found->expires_at, 9000000);
+}
+
+// Запись по окну и по числу строк в шарде
+TEST_F(TieredSessionStoreTest, WritesBackByIntervalAndRows) {
+    {
+        auto wb = backend(1, std::chrono::milliseconds(20));
+        TieredSessionStore store(wb, 0);
+        store.save_session({ imsi_at(1), 1000, 2000 });
+        ASSERT_TRUE(wait_flushes(*wb, 1));
+        EXPECT_TRUE(wb->cold().session_exists(imsi_at(1)));
+    }
+    {
+        auto wb = backend(1, std::chrono::hours(1), 8);
+        TieredSessionStore store(wb, 0);
+        std::vector<StoredSession> batch;
+        for (size_t i = 0; i < 8; ++i) {
+            batch.push_back({ imsi_at(100 + i), 1000, 2000 });
+        }
+        store.upsert_batch(batch);
+        ASSERT_TRUE(wait_flushes(*wb, 1));
+        EXPECT_EQ(wb->stats().last_batch_rows, 8u);
+        EXPECT_EQ(wb->cold().load_sessions(0).size(), 9u);
+    }
+}
+
+// Перезапуск: всё, что было в памяти, записано при закрытии и раздаётся шардам заново
+TEST_F(TieredSessionStoreTest, RecoversShardsAfterRestart) {
+    constexpr size_t kShards = 4;
+    constexpr size_t kCount  = 200;
+    {
+        auto wb = backend(kShards, std::chrono::hours(1));
+        std::vector<std::unique_ptr<TieredSessionStore>> stores;
+        for (size_t i = 0; i < kShards; ++i) {
+            stores.push_back(std::make_unique<TieredSessionStore>(wb, i));
+        }
+        for (size_t i = 0; i < kCount; ++i) {
+            Imsi imsi = imsi_at(i);
+            stores[session_shard(imsi, kShards)]->upsert({ imsi, EpochMs(i) * 1000, EpochMs(100000 + i) * 1000 });
+        }
+        std::vector<Imsi> gone = { imsi_at(0), imsi_at(1) };
+        for (Imsi imsi : gone) {
+            EXPECT_TRUE(stores[session_shard(imsi, kShards)]->delete_session(imsi));
+        }
+    }
+
+    auto wb = backend(kShards, std::chrono::hours(1));
+    size_t total = 0;
+    for (size_t shard = 0; shard < kShards; ++shard) {
+        TieredSessionStore store(wb, shard);
+        auto loaded = store.load_sessions(0);
+        total += loaded.size();
+        for (const auto& s : loaded) {
+            EXPECT_EQ(session_shard(s.imsi, kShards), shard);
+            EXPECT_EQ(s.expires_at - s.created_at, 100000000);
+        }
+    }
+    EXPECT_EQ(total, kCount - 2);
+}
+
+// SessionManager поверх многоуровневого хранилища: сессии переживают перезапуск,
+// истёкшие за время простоя удаляются и из базы
+TEST_F(TieredSessionStoreTest, SessionManagerRestart) {
+    constexpr size_t kShards = 4;
+    {
+        CdrWriter cdr(cdr_path);
+        auto wb = backend(kShards, std::chrono::milliseconds(20));
+        SessionManager sessions(std::chrono::seconds(60),
+                                [wb](size_t shard) { return std::make_unique<TieredSessionStore>(wb, shard); },
+                                kShards, cdr);
+        for (size_t i = 0; i < 50; ++i) {
+            EXPECT_TRUE(sessions.touch_session(imsi_at(i)));
+        }
+        EXPECT_TRUE(sessions.end_session(imsi_at(0)));
+    }
+    // Строка, истёкшая пока сервер не работал
+    {
+        SqliteSessionStore db(db_path);
+        EpochMs now = epoch_ms_now();
+        db.save_session({ imsi_at(999), now - 120000, now - 60000 });
+    }
+
+    CdrWriter cdr(cdr_path);
+    auto wb = backend(kShards, std::chrono::milliseconds(20));
+    SessionManager sessions(std::chrono::seconds(60),
+                            [wb](size_t shard) { return std::make_unique<TieredSessionStore>(wb, shard); },
+                            kShards, cdr);
+    EXPECT_FALSE(sessions.is_active(imsi_at(0)));
+    for (size_t i = 1; i < 50; ++i) {
+        EXPECT_TRUE(sessions.is_active(imsi_at(i))) << i;
+    }
+    EXPECT_EQ(sessions.list_sessions().size(), 49u);
+    ASSERT_TRUE(wb->flush());
+    EXPECT_FALSE(wb->cold().session_exists(imsi_at(999)));
+}
@@ -0,0 +1,145 @@
+#include <gtest/gtest.h>
+#include "pgw/timing_wheel.hpp"
+#include <map>
+#include <random>
+#include <set>
+
+using namespace pgw;
+
+static Imsi imsi_at(uint64_t i) {
+    return Imsi::from_string(std::to_string(1010000000000ull + i));
+}
+
+// Тестируем, что каждая сессия снимается ровно на своём тике, на любом уровне колеса
+TEST(TimingWheelTest, ExpiresExactlyAtDeadline) {
+    TimingWheel wheel;
+    const uint64_t deadlines[] = {0, 1, 63, 64, 65, 4095, 4096, 5000, 262143, 262144, 300000};
+    for (size_t i = 0; i < std::size(deadlines); ++i) {
+        wheel.schedule(imsi_at(i), deadlines[i]);
+    }
+    EXPECT_EQ(wheel.size(), std::size(deadlines));
+
+    std::vector<TimingWheel::Expired> due;
+    size_t popped = 0;
+    for (uint64_t now = 0; now <= 300000; ++now) {
+        due.clear();
+        wheel.advance(now, due);
+        for (auto& e : due) {
+            EXPECT_EQ(e.deadline, now);
+            EXPECT_EQ(e.imsi, imsi_at(std::find(std::begin(deadlines), std::end(deadlines), now) - std::begin(deadlines)));
+        }
+        popped += due.size();
+    }
+    EXPECT_EQ(popped, std::size(deadlines));
+    EXPECT_EQ(wheel.size(), 0u);
+    EXPECT_EQ(wheel.next_event(), TimingWheel::kNever);
+}
+
+// Тестируем перевзвод, отмену и срок в прошлом
+TEST(TimingWheelTest, RearmAndCancel) {
+    TimingWheel wheel(100);
+    wheel.schedule(imsi_at(1), 150);
+    wheel.schedule(imsi_at(2), 150);
+    wheel.schedule(imsi_at(1), 5000);  // Продление
+    EXPECT_TRUE(wheel.cancel(imsi_at(2)));
+    EXPECT_FALSE(wheel.cancel(imsi_at(2)));
+    wheel.schedule(imsi_at(3), 10);    // Уже просрочена
+
+    std::vector<TimingWheel::Expired> due;
+    wheel.advance(100, due);
+    ASSERT_EQ(due.size(), 1u);
+    EXPECT_EQ(due[0].imsi, imsi_at(3));
+
+    due.clear();
+    wheel.advance(4999, due);
+    EXPECT_TRUE(due.empty());
+    wheel.advance(5000, due);
+    ASSERT_EQ(due.size(), 1u);
+    EXPECT_EQ(due[0].imsi, imsi_at(1));
+}
+
+// Тестируем, что next_event() не пропускает срок и что большой скачок времени не теряет сессий
+TEST(TimingWheelTest, NextEventBoundsDeadline) {
+    TimingWheel wheel(7);
+    wheel.schedule(imsi_at(1), 20);
+    EXPECT_EQ(wheel.next_event(), 20u);  // Уровень 0 — точно
+
+    wheel.cancel(imsi_at(1));
+    wheel.schedule(imsi_at(2), 100000);
+    uint64_t next = wheel.next_event();
+    EXPECT_GT(next, 7u);
+    EXPECT_LE(next, 100000u);
+
+    // Колесо пустое до next — обработка тиков до next - 1 ничего не снимает
+    std::vector<TimingWheel::Expired> due;
+    wheel.advance(next - 1, due);
+    EXPECT_TRUE(due.empty());
+
+    wheel.advance(1000000, due);
+    ASSERT_EQ(due.size(), 1u);
+    EXPECT_EQ(due[0].deadline, 100000u);
+}
+
+// Тестируем сроки дальше охвата колеса (2^24 тиков)
+TEST(TimingWheelTest, DeadlineBeyondRange) {
+    TimingWheel wheel;
+    const uint64_t far = (uint64_t(1) << 26) + 12345;
+    wheel.schedule(imsi_at(1), far);
+
+    std::vector<TimingWheel::Expired> due;
+    wheel.advance(far - 1, due);
+    EXPECT_TRUE(due.empty());
+    wheel.advance(far, due);
+    ASSERT_EQ(due.size(), 1u);
+    EXPECT_EQ(due[0].deadline, far);
+}
+
+// Тестируем колесо против эталона (std::multimap) на случайных операциях и скачках времени
+TEST(TimingWheelTest, MatchesReferenceModel) {
+    std::mt19937_64 rng(42);
+    TimingWheel wheel;
+    std::map<uint64_t, uint64_t> deadline_of;  // IMSI-номер → срок
+    uint64_t now = 0;
+
+    std::vector<TimingWheel::Expired> due;
+    for (int step = 0; step < 20000; ++step) {
+        uint64_t id = rng() % 2000;
+        switch (rng() % 4) {
+        case 0:
+        case 1: {
+            // Сроки разного масштаба: от ближайших тиков до сотен тысяч
+            uint64_t span  = uint64_t(1) << (rng() % 20);
+            uint64_t when  = now + 1 + rng() % span;
+            wheel.schedule(imsi_at(id), when);
+            deadline_of[id] = when;
+            break;
+        }
+        case 2:
+            EXPECT_EQ(wheel.cancel(imsi_at(id)), deadline_of.erase(id) > 0);
+            break;
+        default: {
+            uint64_t target = now + rng() % (uint64_t(1) << (rng() % 16));
+            due.clear();
+            wheel.advance(target, due);
+
+            std::set<uint64_t> expected;
+            for (auto it = deadline_of.begin(); it != deadline_of.end(); ) {
+                if (it->second <= target) {
+                    expected.insert(it->first);
+                    it = deadline_of.erase(it);
+                } else {
+                    ++it;
+                }
+            }
+            ASSERT_EQ(due.size(), expected.size()) << "step " << step;
+            for (auto& e : due) {
+                EXPECT_LE(e.deadline, target);
+                EXPECT_GE(e.deadline, now);
+            }
+            now = target + 1;
+            break;
+        }
+        }
+        ASSERT_EQ(wheel.size(), deadline_of.size());
+    }
+}
@@ -0,0 +1,298 @@
+#include <gtest/gtest.h>
+#include "pgw/udp_server.hpp"
+#include "pgw/in_memory_session_store.hpp"
+#include <spdlog/spdlog.h>
+#include <arpa/inet.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <chrono>
+#include <filesystem>
+#include <map>
+#include <string>
+#include <thread>
+#include <tuple>
+#include <vector>
+
+namespace fs = std::filesystem;
+using namespace pgw;
+
+// Сборка тестовых сообщений GTPv2-C
+static void put_ie(std::vector<uint8_t>& m, uint8_t type, std::vector<uint8_t> value) {
+    m.insert(m.end(), { type, uint8_t(value.size() >> 8), uint8_t(value.size()), 0 });
+    m.insert(m.end(), value.begin(), value.end());
+}
+
+static std::vector<uint8_t> make_message(GtpMessageType type, uint32_t teid, uint32_t seq, const std::vector<uint8_t>& ies) {
+    std::vector<uint8_t> m{0x48, uint8_t(type), 0, 0,
+                           uint8_t(teid >> 24), uint8_t(teid >> 16), uint8_t(teid >> 8), uint8_t(teid),
+                           uint8_t(seq >> 16), uint8_t(seq >> 8), uint8_t(seq), 0};
+    m.insert(m.end(), ies.begin(), ies.end());
+    m[2] = uint8_t((m.size() - 4) >> 8);
+    m[3] = uint8_t(m.size() - 4);
+    return m;
+}
+
+// Create Session Request: IMSI, Sender F-TEID 0x11223344, Bearer Context с EBI 5
+static std::vector<uint8_t> make_create_session(Imsi imsi, uint32_t seq) {
+    uint8_t bcd[8];
+    std::vector<uint8_t> ies;
+    put_ie(ies, 1, std::vector<uint8_t>(bcd, bcd + imsi.to_bcd(bcd)));
+    put_ie(ies, 87, {0x86, 0x11, 0x22, 0x33, 0x44, 10, 0, 0, 1});
+    std::vector<uint8_t> bearer;
+    put_ie(bearer, 73, {0x05});
+    put_ie(ies, 93, bearer);
+    return make_message(GtpMessageType::CreateSessionRequest, 0, seq, ies);
+}
+
+// Delete Session Request на наш TEID с Linked EBI 5
+static std::vector<uint8_t> make_delete_session(uint32_t teid, uint32_t seq) {
+    std::vector<uint8_t> ies;
+    put_ie(ies, 73, {0x05});
+    return make_message(GtpMessageType::DeleteSessionRequest, teid, seq, ies);
+}
+
+// Параметры: бэкенд приёма и число потоков обработки (0 — без конвейера)
+class UdpServerTest : public ::testing::TestWithParam<std::tuple<UdpBackend, size_t>> {
+protected:
+    std::string cdr_path = "udp_server_test_cdr.csv";
+    int         client   = -1;
+
+    void SetUp() override {
+        // Каждая датаграмма логируется на уровне info
+        spdlog::set_level(spdlog::level::warn);
+        fs::remove(cdr_path);
+    }
+
+    void TearDown() override {
+        if (client >= 0)
+            ::close(client);
+        spdlog::set_level(spdlog::level::info);
+        fs::remove(cdr_path);
+    }
+
+    // Свой порт на каждую комбинацию параметров
+    uint16_t port() const {
+        auto [backend, threads] = GetParam();
+        return uint16_t(19800 + 4 * int(backend) + threads);
+    }
+
+    UdpServerOptions options() const {
+        UdpServerOptions o;
+        o.backend            = std::get<0>(GetParam());
+        o.processing_threads = std::get<1>(GetParam());
+        return o;
+    }
+
+    void connect_client() {
+        client = ::socket(AF_INET, SOCK_DGRAM, 0);
+        ASSERT_GE(client, 0);
+        sockaddr_in addr{};
+        addr.sin_family = AF_INET;
+        addr.sin_port   = htons(port());
+        inet_pton(AF_INET, "127.0.0.1", &addr.sin_addr);
+        ASSERT_EQ(::connect(client, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)), 0);
+        timeval tv{2, 0};
+        ::setsockopt(client, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+    }
+
+    // Отправляет все датаграммы одним sendmmsg, чтобы они легли в очередь сокета сервера разом
+    void send_all(std::vector<std::vector<uint8_t>>& datagrams) {
+        std::vector<iovec>   iov(datagrams.size());
+        std::vector<mmsghdr> msgs(datagrams.size());
+        for (size_t i = 0; i < datagrams.size(); ++i) {
+            iov[i] = { datagrams[i].data(), datagrams[i].size() };
+            msgs[i].msg_hdr.msg_iov    = &iov[i];
+            msgs[i].msg_hdr.msg_iovlen = 1;
+        }
+        ASSERT_EQ(::sendmmsg(client, msgs.data(), unsigned(msgs.size()), 0), int(msgs.size()));
+    }
+
+    // Принимает count ответов (или сколько придёт до таймаута)
+    std::vector<std::vector<uint8_t>> receive(size_t count) {
+        std::vector<std::vector<uint8_t>> replies;
+        while (replies.size() < count) {
+            uint8_t buf[512];
+            ssize_t n = ::recv(client, buf, sizeof(buf), 0);
+            if (n < 0)
+                break;
+            replies.emplace_back(buf, buf + n);
+        }
+        return replies;
+    }
+
+    static std::vector<uint8_t> bcd(Imsi imsi) {
+        uint8_t out[8];
+        size_t n = imsi.to_bcd(out);
+        return std::vector<uint8_t>(out, out + n);
+    }
+
+    static Imsi imsi_at(size_t i) { return Imsi::from_string(std::to_string(1010000000000ull + i)); }
+};
+
+// Пачка BCD-запросов и Create Session приходит одним sendmmsg: ответы на каждую датаграмму,
+// сессии созданы, а приём забирает несколько датаграмм за вызов
+TEST_P(UdpServerTest, AnswersBatchOfImsiAndGtp) {
+    constexpr size_t kImsis = 16;
+    const Imsi blocked = imsi_at(7);
+
+    CdrWriter cdr(cdr_path);
+    Blacklist blacklist({ blocked.to_string() });
+    SessionManager sessions(std::chrono::seconds(60), std::make_unique<InMemorySessionStore>(), cdr);
+    UdpServer server("127.0.0.1", port(), blacklist, sessions, options());
+    server.start();
+    connect_client();
+
+    std::vector<std::vector<uint8_t>> datagrams;
+    for (size_t i = 0; i < kImsis; ++i) {
+        datagrams.push_back(bcd(imsi_at(i)));
+    }
+    // 9 байт: первые 8 — валидный IMSI, но датаграмма им не является
+    auto overlong = bcd(Imsi::from_string("001010123456788"));
+    overlong.push_back(0x00);
+    datagrams.push_back(overlong);
+    datagrams.push_back(make_create_session(Imsi::from_string("001010123456789"), 0x000102));
+    send_all(datagrams);
+
+    auto replies = receive(datagrams.size());
+    ASSERT_EQ(replies.size(), datagrams.size());
+
+    std::map<std::string, size_t> texts;
+    size_t gtp_replies = 0;
+    for (const auto& r : replies) {
+        if (!looks_like_gtpv2(r.data(), r.size())) {
+            ++texts[std::string(r.begin(), r.end())];
+            continue;
+        }
+        ++gtp_replies;
+        GtpMessage resp;
+        ASSERT_EQ(parse_gtpv2(r.data(), r.size(), resp), GtpParseStatus::Ok);
+        EXPECT_EQ(resp.type, uint8_t(GtpMessageType::CreateSessionResponse));
+        EXPECT_EQ(resp.teid, 0x11223344u);
+        EXPECT_EQ(resp.sequence, 0x000102u);
+        GtpIeReader reader(resp.ies);
+        GtpIe ie;
+        bool accepted = false;
+        while (reader.next(ie)) {
+            if (GtpIeType(ie.type) == GtpIeType::Cause && !ie.value.empty())
+                accepted = ie.value[0] == uint8_t(GtpCause::RequestAccepted);
+        }
+        EXPECT_TRUE(accepted);
+    }
+    EXPECT_EQ(gtp_replies, 1u);
+    EXPECT_EQ(texts["created"], kImsis - 1);
+    EXPECT_EQ(texts["rejected"], 2u);  // Чёрный список и 9-байтная датаграмма
+
+    for (size_t i = 0; i < kImsis; ++i) {
+        EXPECT_EQ(sessions.is_active(imsi_at(i)), imsi_at(i) != blocked) << i;
+    }
+    EXPECT_TRUE(sessions.is_active(Imsi::from_string("001010123456789")));
+    EXPECT_FALSE(sessions.is_active(Imsi::from_string("001010123456788")));
+
+    server.stop();
+    server.join();
+
+    UdpStats st = server.stats();
+    EXPECT_EQ(st.rx_packets, datagrams.size());
+    EXPECT_EQ(st.tx_packets, datagrams.size());
+    EXPECT_EQ(st.gtp_messages, 1u);
+    EXPECT_EQ(st.gtp_invalid, 0u);
+    EXPECT_GE(st.rx_syscalls, 1u);
+    EXPECT_LT(st.rx_syscalls, st.rx_packets);  // Несколько датаграмм за вызов приёма
+    EXPECT_EQ(st.pipeline, std::get<1>(GetParam()) > 0);
+    if (st.pipeline) {
+        EXPECT_EQ(st.process_stage.processed, datagrams.size());
+        EXPECT_EQ(st.process_stage.dropped, 0u);
+        EXPECT_EQ(st.tx_stage.processed, datagrams.size());
+    }
+}
+
+// Источник сверх своего темпа получает "throttled"; отказ не создаёт сессию
+TEST_P(UdpServerTest, RepliesThrottledOverRateLimit) {
+    constexpr size_t kRequests = 8;
+
+    CdrWriter cdr(cdr_path);
+    Blacklist blacklist({});
+    SessionManager sessions(std::chrono::seconds(60), std::make_unique<InMemorySessionStore>(), cdr);
+    UdpServerOptions o = options();
+    o.rate_limit_pps   = 1;
+    o.rate_limit_burst = 2;
+    o.rate_limit_reply = true;
+    UdpServer server("127.0.0.1", port(), blacklist, sessions, o);
+    server.start();
+    connect_client();
+
+    std::vector<std::vector<uint8_t>> datagrams;
+    for (size_t i = 0; i < kRequests; ++i) {
+        datagrams.push_back(bcd(imsi_at(i)));
+    }
+    send_all(datagrams);
+
+    auto replies = receive(kRequests);
+    ASSERT_EQ(replies.size(), kRequests);
+    std::map<std::string, size_t> texts;
+    for (const auto& r : replies) {
+        ++texts[std::string(r.begin(), r.end())];
+    }
+    EXPECT_EQ(texts["created"], 2u);
+    EXPECT_EQ(texts["throttled"], kRequests - 2);
+
+    server.stop();
+    server.join();
+    EXPECT_EQ(sessions.list_sessions().size(), 2u);
+    EXPECT_EQ(server.stats().throttled, kRequests - 2);
+}
+
+// Сообщения одного абонента обрабатываются по порядку: Delete Session и следующий за ним
+// Create Session из одной пачки не меняются местами, и сессия в итоге активна
+TEST_P(UdpServerTest, KeepsPerSubscriberOrder) {
+    constexpr size_t kSubscribers = 32;
+
+    CdrWriter cdr(cdr_path);
+    Blacklist blacklist({});
+    SessionManager sessions(std::chrono::seconds(60), std::make_unique<InMemorySessionStore>(), cdr);
+    UdpServer server("127.0.0.1", port(), blacklist, sessions, options());
+    server.start();
+    connect_client();
+
+    // Открываем туннели и запоминаем наши TEID из ответов
+    std::vector<std::vector<uint8_t>> creates;
+    for (size_t i = 0; i < kSubscribers; ++i) {
+        creates.push_back(make_create_session(imsi_at(i), uint32_t(i)));
+    }
+    send_all(creates);
+    auto replies = receive(kSubscribers);
+    ASSERT_EQ(replies.size(), kSubscribers);
+    std::vector<uint32_t> teids(kSubscribers, 0);
+    for (const auto& r : replies) {
+        GtpMessage resp;
+        ASSERT_EQ(parse_gtpv2(r.data(), r.size(), resp), GtpParseStatus::Ok);
+        ASSERT_LT(resp.sequence, kSubscribers);
+        ASSERT_TRUE(resp.has_sender_teid);
+        teids[resp.sequence] = resp.sender_teid;
+    }
+
+    // Каждый абонент: Delete, затем снова Create — всё одной пачкой
+    std::vector<std::vector<uint8_t>> batch;
+    for (size_t i = 0; i < kSubscribers; ++i) {
+        batch.push_back(make_delete_session(teids[i], uint32_t(kSubscribers + 2 * i)));
+        batch.push_back(make_create_session(imsi_at(i), uint32_t(kSubscribers + 2 * i + 1)));
+    }
+    send_all(batch);
+    replies = receive(batch.size());
+    ASSERT_EQ(replies.size(), batch.size());
+
+    server.stop();
+    server.join();
+    for (size_t i = 0; i < kSubscribers; ++i) {
+        EXPECT_TRUE(sessions.is_active(imsi_at(i))) << i;
+    }
+}
+
+INSTANTIATE_TEST_SUITE_P(
+    Backends, UdpServerTest,
+    ::testing::Combine(::testing::Values(UdpBackend::Blocking, UdpBackend::Epoll, UdpBackend::IoUring),
+                       ::testing::Values(size_t(0), size_t(2))),
+    [](const auto& info) {
+        return std::string(to_string(std::get<0>(info.param))) + "_threads" +
+               std::to_string(std::get<1>(info.param));
+    });